@@ -85,6 +85,27 @@ struct assegment_header {
 	uint8_t length;
 };
 
+/* Raw AS_PATH attribute data, used as a hash lookup key by aspath_parse()
+ * so that already interned paths can be found without decoding them.
+ */
+struct aspath_wire {
+	const uint8_t *data;
+	size_t length;
+	int use32bit;
+	unsigned int key;
+};
+
+/* Hash key mixing, shared by aspath_key_make() and aspath_wire_scan() so
+ * that a path hashes identically in its internal and on-wire forms.
+ * assegment_normalise() merges runs of AS_SEQUENCEs, so the boundaries
+ * between adjacent AS_SEQUENCE segments must not contribute to the key.
+ */
+#define ASPATH_KEY_INIT 2334325
+#define ASPATH_KEY_SEGMENT(K, T) jhash_1word(0xffffff00U | (T), (K))
+#define ASPATH_KEY_ASN(K, A) jhash_1word((A), (K))
+#define ASPATH_KEY_SEGMENT_NEEDED(PREV, T)                                     \
+	((T) != AS_SEQUENCE || (PREV) != AS_SEQUENCE)
+
 /* Hash for aspath.  This is the top level structure of AS path. */
 static struct hash *ashash;
 
@@ -632,15 +653,27 @@ void aspath_str_update(struct aspath *as, bool make_json)
 	aspath_make_str_count(as, make_json);
 }
 
+/* Drop the rendered string after the segments changed, it is rebuilt on
+ * demand by aspath_print().
+ */
+static void aspath_str_invalidate(struct aspath *as)
+{
+	XFREE(MTYPE_AS_STR, as->str);
+	as->str_len = 0;
+
+	if (as->json) {
+		json_object_free(as->json);
+		as->json = NULL;
+	}
+}
+
 /* Intern allocated AS path. */
 struct aspath *aspath_intern(struct aspath *aspath)
 {
 	struct aspath *find;
 
-	/* Assert this AS path structure is not interned and has the string
-	   representation built. */
+	/* Assert this AS path structure is not interned. */
 	assert(aspath->refcnt == 0);
-	assert(aspath->str);
 
 	/* Check AS path hash. */
 	find = hash_get(ashash, aspath, hash_alloc_intern);
@@ -685,9 +718,6 @@ static void *aspath_hash_alloc(void *arg)
 	const struct aspath *aspath = arg;
 	struct aspath *new;
 
-	/* Malformed AS path value. */
-	assert(aspath->str);
-
 	/* New aspath structure is needed. */
 	new = XMALLOC(MTYPE_AS_PATH, sizeof(struct aspath));
 
@@ -697,10 +727,142 @@ static void *aspath_hash_alloc(void *arg)
 	new->str = aspath->str;
 	new->str_len = aspath->str_len;
 	new->json = aspath->json;
+	new->wire = NULL;
 
 	return new;
 }
 
+/* Fetch one ASN from raw segment data and advance past it */
+static inline as_t aspath_wire_getas(const uint8_t **pnt, int use32bit)
+{
+	const uint8_t *p = *pnt;
+
+	if (use32bit) {
+		*pnt += AS_VALUE_SIZE;
+		return ((as_t)p[0] << 24) | ((as_t)p[1] << 16)
+		       | ((as_t)p[2] << 8) | (as_t)p[3];
+	}
+
+	*pnt += AS16_VALUE_SIZE;
+	return ((as_t)p[0] << 8) | (as_t)p[1];
+}
+
+/* Validate the raw AS_PATH at the stream's getp without consuming it and
+ * compute the hash key of the path it decodes to.  Returns false if the
+ * data is malformed or not already in the form assegment_normalise() would
+ * produce (unsorted or duplicated set members); such paths have to go
+ * through the full parse.
+ */
+static bool aspath_wire_scan(struct stream *s, size_t length, int use32bit,
+			     struct aspath_wire *wire)
+{
+	const uint8_t *pnt, *end;
+	unsigned int key = ASPATH_KEY_INIT;
+	uint8_t type, prev_type = 0;
+	uint8_t seglen;
+	as_t as, prev_as = 0;
+	int i;
+
+	wire->data = NULL;
+	wire->length = length;
+	wire->use32bit = use32bit;
+	wire->key = key;
+
+	if (length == 0)
+		return true;
+
+	if (STREAM_READABLE(s) < length)
+		return false;
+
+	pnt = stream_pnt(s);
+	end = pnt + length;
+
+	while (pnt < end) {
+		if ((size_t)(end - pnt) <= AS_HEADER_SIZE)
+			return false;
+
+		type = pnt[0];
+		seglen = pnt[1];
+
+		if (seglen == 0
+		    || ASSEGMENT_SIZE(seglen, use32bit) > (size_t)(end - pnt))
+			return false;
+
+		switch (type) {
+		case AS_SEQUENCE:
+		case AS_SET:
+		case AS_CONFED_SEQUENCE:
+		case AS_CONFED_SET:
+			break;
+		default:
+			return false;
+		}
+
+		if (ASPATH_KEY_SEGMENT_NEEDED(prev_type, type))
+			key = ASPATH_KEY_SEGMENT(key, type);
+
+		pnt += AS_HEADER_SIZE;
+		for (i = 0; i < seglen; i++) {
+			as = aspath_wire_getas(&pnt, use32bit);
+
+			if ((type == AS_SET || type == AS_CONFED_SET) && i
+			    && as <= prev_as)
+				return false;
+
+			key = ASPATH_KEY_ASN(key, as);
+			prev_as = as;
+		}
+
+		prev_type = type;
+	}
+
+	wire->data = stream_pnt(s);
+	wire->key = key;
+	return true;
+}
+
+/* Compare an internal path against raw data validated by
+ * aspath_wire_scan().  A normalised AS_SEQUENCE may span several wire
+ * segments, any other segment type has to match one to one.
+ */
+static bool aspath_cmp_wire(const struct aspath *aspath,
+			    const struct aspath_wire *wire)
+{
+	const struct assegment *seg;
+	const uint8_t *pnt, *end;
+	uint8_t seglen;
+	int i, j;
+
+	if (wire->length == 0)
+		return aspath->segments == NULL;
+
+	pnt = wire->data;
+	end = wire->data + wire->length;
+
+	for (seg = aspath->segments; seg; seg = seg->next) {
+		i = 0;
+		do {
+			if (pnt >= end || pnt[0] != seg->type)
+				return false;
+
+			seglen = pnt[1];
+			if (i + seglen > seg->length)
+				return false;
+
+			pnt += AS_HEADER_SIZE;
+			for (j = 0; j < seglen; j++, i++)
+				if (aspath_wire_getas(&pnt, wire->use32bit)
+				    != seg->as[i])
+					return false;
+		} while (i < seg->length && seg->type == AS_SEQUENCE);
+
+		if (i != seg->length)
+			return false;
+	}
+
+	return pnt == end;
+}
+
 /* parse as-segment byte stream in struct assegment */
 static int assegments_parse(struct stream *s, size_t length,
 			    struct assegment **result, int use32bit)
@@ -807,6 +969,7 @@ static int assegments_parse(struct stream *s, size_t length,
 struct aspath *aspath_parse(struct stream *s, size_t length, int use32bit)
 {
 	struct aspath as;
+	struct aspath_wire wire;
 	struct aspath *find;
 
 	/* If length is odd it's malformed AS path. */
@@ -819,6 +982,23 @@ struct aspath *aspath_parse(struct stream *s, size_t length, int use32bit)
 		return NULL;
 
 	memset(&as, 0, sizeof(struct aspath));
+
+	/* Most paths are received many times over, look them up by their
+	 * raw bytes first and only decode the ones we don't know yet.
+	 */
+	if (aspath_wire_scan(s, length, use32bit, &wire)) {
+		as.wire = &wire;
+		find = hash_lookup(ashash, &as);
+		as.wire = NULL;
+
+		if (find) {
+			if (length)
+				stream_forward_getp(s, length);
+			find->refcnt++;
+			return find;
+		}
+	}
+
 	if (assegments_parse(s, length, &as.segments, use32bit) < 0)
 		return NULL;
 
@@ -829,15 +1009,8 @@ struct aspath *aspath_parse(struct stream *s, size_t length, int use32bit)
 	assert(find);
 
 	/* if the aspath was already hashed free temporary memory. */
-	if (find->refcnt) {
+	if (find->refcnt)
 		assegment_free_all(as.segments);
-		/* aspath_key_make() always updates the string */
-		XFREE(MTYPE_AS_STR, as.str);
-		if (as.json) {
-			json_object_free(as.json);
-			as.json = NULL;
-		}
-	}
 
 	find->refcnt++;
 
@@ -1092,7 +1265,7 @@ struct aspath *aspath_aggregate(struct aspath *as1, struct aspath *as2)
 	}
 
 	assegment_normalise(aspath->segments);
-	aspath_str_update(aspath, false);
+	aspath_str_invalidate(aspath);
 	return aspath;
 }
 
@@ -1227,7 +1400,7 @@ struct aspath *aspath_replace_specific_asn(struct aspath *aspath,
 		seg = seg->next;
 	}
 
-	aspath_str_update(new, false);
+	aspath_str_invalidate(new);
 	return new;
 }
 
@@ -1253,7 +1426,7 @@ struct aspath *aspath_replace_private_asns(struct aspath *aspath, as_t asn,
 		seg = seg->next;
 	}
 
-	aspath_str_update(new, false);
+	aspath_str_invalidate(new);
 	return new;
 }
 
@@ -1317,7 +1490,7 @@ struct aspath *aspath_remove_private_asns(struct aspath *aspath, as_t peer_asn)
 		seg = seg->next;
 	}
 
-	aspath_str_update(new, false);
+	aspath_str_invalidate(new);
 	return new;
 }
 
@@ -1373,7 +1546,7 @@ static struct aspath *aspath_merge(struct aspath *as1, struct aspath *as2)
 	if (last)
 		last->next = as2->segments;
 	as2->segments = new;
-	aspath_str_update(as2, false);
+	aspath_str_invalidate(as2);
 	return as2;
 }
 
@@ -1390,7 +1563,7 @@ struct aspath *aspath_prepend(struct aspath *as1, struct aspath *as2)
 	/* If as2 is empty, only need to dupe as1's chain onto as2 */
 	if (as2->segments == NULL) {
 		as2->segments = assegment_dup_all(as1->segments);
-		aspath_str_update(as2, false);
+		aspath_str_invalidate(as2);
 		return as2;
 	}
 
@@ -1410,7 +1583,7 @@ struct aspath *aspath_prepend(struct aspath *as1, struct aspath *as2)
 
 	if (!as2->segments) {
 		as2->segments = assegment_dup_all(as1->segments);
-		aspath_str_update(as2, false);
+		aspath_str_invalidate(as2);
 		return as2;
 	}
 
@@ -1455,7 +1628,7 @@ struct aspath *aspath_prepend(struct aspath *as1, struct aspath *as2)
 		/* we've now prepended as1's segment chain to as2, merging
 		 * the inbetween AS_SEQUENCE of seg2 in the process
 		 */
-		aspath_str_update(as2, false);
+		aspath_str_invalidate(as2);
 		return as2;
 	} else {
 		/* AS_SET merge code is needed at here. */
@@ -1534,7 +1707,7 @@ struct aspath *aspath_filter_exclude(struct aspath *source,
 			lastseg->next = newseg;
 		lastseg = newseg;
 	}
-	aspath_str_update(newpath, false);
+	aspath_str_invalidate(newpath);
 	/* We are happy returning even an empty AS_PATH, because the
 	 * administrator
 	 * might expect this very behaviour. There's a mean to avoid this, if
@@ -1572,7 +1745,7 @@ static struct aspath *aspath_add_asns(struct aspath *aspath, as_t asno,
 		aspath->segments = newsegment;
 	}
 
-	aspath_str_update(aspath, false);
+	aspath_str_invalidate(aspath);
 	return aspath;
 }
 
@@ -1663,14 +1836,14 @@ struct aspath *aspath_reconcile_as4(struct aspath *aspath,
 
 	if (!hops) {
 		newpath = aspath_dup(as4path);
-		aspath_str_update(newpath, false);
+		aspath_str_invalidate(newpath);
 		return newpath;
 	}
 
 	if (BGP_DEBUG(as4, AS4))
 		zlog_debug(
 			"[AS4] got AS_PATH %s and AS4_PATH %s synthesizing now",
-			aspath->str, as4path->str);
+			aspath_print(aspath), aspath_print(as4path));
 
 	while (seg && hops > 0) {
 		switch (seg->type) {
@@ -1725,11 +1898,11 @@ struct aspath *aspath_reconcile_as4(struct aspath *aspath,
 	mergedpath = aspath_merge(newpath, aspath_dup(as4path));
 	aspath_free(newpath);
 	mergedpath->segments = assegment_normalise(mergedpath->segments);
-	aspath_str_update(mergedpath, false);
+	aspath_str_invalidate(mergedpath);
 
 	if (BGP_DEBUG(as4, AS4))
 		zlog_debug("[AS4] result of synthesizing is %s",
-			   mergedpath->str);
+			   aspath_print(mergedpath));
 
 	return mergedpath;
 }
@@ -1797,7 +1970,7 @@ struct aspath *aspath_delete_confed_seq(struct aspath *aspath)
 	}
 
 	if (removed_confed_segment)
-		aspath_str_update(aspath, false);
+		aspath_str_invalidate(aspath);
 
 	return aspath;
 }
@@ -2008,12 +2181,23 @@ struct aspath *aspath_str2aspath(const char *str)
 unsigned int aspath_key_make(const void *p)
 {
 	const struct aspath *aspath = p;
-	unsigned int key = 0;
+	const struct assegment *seg;
+	unsigned int key = ASPATH_KEY_INIT;
+	uint8_t prev_type = 0;
+	int i;
 
-	if (!aspath->str)
-		aspath_str_update((struct aspath *)aspath, false);
+	if (aspath->wire)
+		return aspath->wire->key;
 
-	key = jhash(aspath->str, aspath->str_len, 2334325);
+	for (seg = aspath->segments; seg; seg = seg->next) {
+		if (ASPATH_KEY_SEGMENT_NEEDED(prev_type, seg->type))
+			key = ASPATH_KEY_SEGMENT(key, seg->type);
+
+		for (i = 0; i < seg->length; i++)
+			key = ASPATH_KEY_ASN(key, seg->as[i]);
+
+		prev_type = seg->type;
+	}
 
 	return key;
 }
@@ -2021,8 +2205,15 @@ unsigned int aspath_key_make(const void *p)
 /* If two aspath have same value then return 1 else return 0 */
 bool aspath_cmp(const void *arg1, const void *arg2)
 {
-	const struct assegment *seg1 = ((const struct aspath *)arg1)->segments;
-	const struct assegment *seg2 = ((const struct aspath *)arg2)->segments;
+	const struct aspath *as1 = arg1;
+	const struct aspath *as2 = arg2;
+	const struct assegment *seg1 = as1->segments;
+	const struct assegment *seg2 = as2->segments;
+
+	if (as2->wire)
+		return aspath_cmp_wire(as1, as2->wire);
+	if (as1->wire)
+		return aspath_cmp_wire(as2, as1->wire);
 
 	while (seg1 || seg2) {
 		int i;
@@ -2058,10 +2249,16 @@ void aspath_finish(void)
 		stream_free(snmp_stream);
 }
 
-/* return and as path value */
+/* return and as path value, rendering the string on first use */
 const char *aspath_print(struct aspath *as)
 {
-	return (as ? as->str : NULL);
+	if (!as)
+		return NULL;
+
+	if (!as->str)
+		aspath_make_str_count(as, false);
+
+	return as->str;
 }
 
 /* Printing functions */
@@ -2072,7 +2269,7 @@ void aspath_print_vty(struct vty *vty, const char *format, struct aspath *as,
 		      const char *suffix)
 {
 	assert(format);
-	vty_out(vty, format, as->str);
+	vty_out(vty, format, aspath_print(as));
 	if (as->str_len && strlen(suffix))
 		vty_out(vty, "%s", suffix);
 }
@@ -2085,7 +2282,7 @@ static void aspath_show_all_iterator(struct hash_bucket *bucket,
 	as = (struct aspath *)bucket->data;
 
 	vty_out(vty, "[%p:%u] (%ld) ", (void *)bucket, bucket->key, as->refcnt);
-	vty_out(vty, "%s\n", as->str);
+	vty_out(vty, "%s\n", aspath_print(as));
 }
 
 /* Print all aspath and hash information.  This function is used from
@@ -56,6 +56,8 @@ struct assegment {
 	uint8_t type;
 };
 
+struct aspath_wire;
+
 /* AS path may be include some AsSegments.  */
 struct aspath {
 	/* Reference count to this aspath.  */
@@ -68,9 +70,14 @@ struct aspath {
 	json_object *json;
 
 	/* String expression of AS path.  This string is used by vty output
-	   and AS path regular expression match.  */
+	   and AS path regular expression match.  It is rendered lazily, use
+	   aspath_print() rather than accessing it directly.  */
 	char *str;
 	unsigned short str_len;
+
+	/* Raw on-wire segments; only set on the lookup key aspath_parse()
+	   builds on the stack to find an interned path without decoding. */
+	const struct aspath_wire *wire;
 };
 
 #define ASPATH_STR_DEFAULT_LEN 32
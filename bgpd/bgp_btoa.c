@@ -102,7 +102,7 @@ static int attr_parse(struct stream *s, uint16_t len)
 			struct aspath *aspath;
 
 			aspath = aspath_parse(s, length, 1);
-			printf("ASPATH: %s\n", aspath->str);
+			printf("ASPATH: %s\n", aspath_print(aspath));
 			aspath_free(aspath);
 		} break;
 		case BGP_ATTR_NEXT_HOP: {
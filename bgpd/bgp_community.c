@@ -42,6 +42,7 @@ void community_free(struct community **com)
 {
 	XFREE(MTYPE_COMMUNITY_VAL, (*com)->val);
 	XFREE(MTYPE_COMMUNITY_STR, (*com)->str);
+	XFREE(MTYPE_COMMUNITY_BLOOM, (*com)->bloom);
 
 	if ((*com)->json) {
 		json_object_free((*com)->json);
@@ -51,6 +52,14 @@ void community_free(struct community **com)
 	XFREE(MTYPE_COMMUNITY, (*com));
 }
 
+/* Values of the community changed, keep an interned one's summary current */
+static void community_val_changed(struct community *com)
+{
+	community_bloom_update(&com->bloom, com->refcnt,
+			       (const uint8_t *)com->val, com->size,
+			       sizeof(uint32_t));
+}
+
 /* Add one community value to the community. */
 static void community_add_val(struct community *com, uint32_t val)
 {
@@ -63,6 +72,8 @@ static void community_add_val(struct community *com, uint32_t val)
 
 	val = htonl(val);
 	memcpy(com_lastval(com), &val, sizeof(uint32_t));
+
+	community_val_changed(com);
 }
 
 /* Delete one community. */
@@ -91,6 +102,7 @@ void community_del_val(struct community *com, uint32_t *val)
 				XFREE(MTYPE_COMMUNITY_VAL, com->val);
 				com->val = NULL;
 			}
+			community_val_changed(com);
 			return;
 		}
 		i++;
@@ -129,12 +141,114 @@ static int community_compare(const void *a1, const void *a2)
 	return 0;
 }
 
+/* The low 18 bits of a value's hash pick its 3 bits within a word, the
+ * others pick the word.
+ */
+static inline uint32_t community_bloom_key(const void *val, size_t size)
+{
+	return jhash(val, size, 0x9e3779b9);
+}
+
+static inline uint64_t community_bloom_bits(uint32_t key)
+{
+	return ((uint64_t)1 << (key & 63)) | ((uint64_t)1 << ((key >> 6) & 63))
+	       | ((uint64_t)1 << ((key >> 12) & 63));
+}
+
+static inline uint32_t community_bloom_word(const struct community_bloom *bloom,
+					    uint32_t key)
+{
+	return (key >> 18) & bloom->mask;
+}
+
+/* Build the membership summary of NUM values of SIZE octets each.  Arrays
+ * that fit in a cache line are scanned just as fast, and unsorted ones
+ * cannot be binary searched, so NULL is returned for those.
+ */
+struct community_bloom *community_bloom_new(const uint8_t *val, int num,
+					    size_t size)
+{
+	struct community_bloom *bloom;
+	uint32_t words = 1;
+	uint32_t key;
+	int i;
+
+	if (num * size <= 64)
+		return NULL;
+
+	for (i = 1; i < num; i++)
+		if (memcmp(val + (i - 1) * size, val + i * size, size) >= 0)
+			return NULL;
+
+	while (words < COMMUNITY_BLOOM_MAX_WORDS
+	       && words * 64 < (uint32_t)num * COMMUNITY_BLOOM_BITS_PER_VAL)
+		words <<= 1;
+
+	bloom = XCALLOC(MTYPE_COMMUNITY_BLOOM,
+			sizeof(struct community_bloom)
+				+ words * sizeof(uint64_t));
+	bloom->mask = words - 1;
+
+	for (i = 0; i < num; i++) {
+		key = community_bloom_key(val + i * size, size);
+		bloom->bits[community_bloom_word(bloom, key)] |=
+			community_bloom_bits(key);
+	}
+
+	return bloom;
+}
+
+/* The values summarised by BLOOM changed.  The summary of an interned set
+ * (REFCNT not 0) is rebuilt, as the set may be shared by many paths.
+ */
+void community_bloom_update(struct community_bloom **bloom,
+			    unsigned long refcnt, const uint8_t *val, int num,
+			    size_t size)
+{
+	XFREE(MTYPE_COMMUNITY_BLOOM, *bloom);
+
+	if (refcnt)
+		*bloom = community_bloom_new(val, num, size);
+}
+
+/* Is KEY one of the NUM values of SIZE octets summarised by BLOOM? */
+bool community_bloom_member(const struct community_bloom *bloom,
+			    const uint8_t *val, int num, size_t size,
+			    const void *key)
+{
+	uint32_t hash = community_bloom_key(key, size);
+	uint64_t bits = community_bloom_bits(hash);
+	int low = 0, high = num - 1, mid, ret;
+
+	if ((bloom->bits[community_bloom_word(bloom, hash)] & bits) != bits)
+		return false;
+
+	while (low <= high) {
+		mid = low + (high - low) / 2;
+		ret = memcmp(val + mid * size, key, size);
+		if (ret == 0)
+			return true;
+		if (ret < 0)
+			low = mid + 1;
+		else
+			high = mid - 1;
+	}
+
+	return false;
+}
+
 int community_include(struct community *com, uint32_t val)
 {
 	int i;
 
 	val = htonl(val);
 
+	if (com->bloom)
+		return community_bloom_member(com->bloom,
+					      (const uint8_t *)com->val,
+					      com->size, sizeof(uint32_t),
+					      &val);
+
 	for (i = 0; i < com->size; i++)
 		if (memcmp(&val, com_nthval(com, i), sizeof(uint32_t)) == 0)
 			return 1;
@@ -481,6 +595,11 @@ struct community *community_intern(struct community *com)
 	if (find != com)
 		community_free(&com);
 
+	/* Newly interned, values won't change any more. */
+	if (find->refcnt == 0)
+		find->bloom = community_bloom_new((const uint8_t *)find->val,
+						  find->size, sizeof(uint32_t));
+
 	/* Increment refrence counter.  */
 	find->refcnt++;
 
@@ -580,6 +699,26 @@ int community_match(const struct community *com1, const struct community *com2)
 		return 0;
 
 	/* Every community on com2 needs to be on com1 for this to match */
+	if (com1->bloom) {
+		/* and in the same order, as in the walk below: com1 is
+		 * sorted, so com2 must be too.
+		 */
+		for (j = 0; j < com2->size; j++) {
+			if (j > 0
+			    && memcmp(com2->val + j - 1, com2->val + j,
+				      sizeof(uint32_t))
+				       >= 0)
+				return 0;
+			if (!community_bloom_member(com1->bloom,
+						    (const uint8_t *)com1->val,
+						    com1->size,
+						    sizeof(uint32_t),
+						    com2->val + j))
+				return 0;
+		}
+		return 1;
+	}
+
 	while (i < com1->size && j < com2->size) {
 		if (memcmp(com1->val + i, com2->val + j, sizeof(uint32_t)) == 0)
 			j++;
@@ -621,6 +760,8 @@ struct community *community_merge(struct community *com1,
 	memcpy(com1->val + com1->size, com2->val, com2->size * 4);
 	com1->size += com2->size;
 
+	community_val_changed(com1);
+
 	return com1;
 }
 
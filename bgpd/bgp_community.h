@@ -24,6 +24,21 @@
 #include "lib/json.h"
 #include "bgpd/bgp_route.h"
 
+/* Membership summary of an interned (e|l)community value array: a
+ * blocked bloom filter with 16 bits per value, of which each value sets 3
+ * in a single 64-bit word, for about 1% false positives.  It is only built
+ * for sorted arrays larger than a cache line, so a member lookup is a test
+ * of one word followed by a binary search.
+ */
+#define COMMUNITY_BLOOM_BITS_PER_VAL 16
+#define COMMUNITY_BLOOM_MAX_WORDS (1 << 14)
+
+struct community_bloom {
+	/* Number of words minus one, a power of two minus one. */
+	uint32_t mask;
+	uint64_t bits[];
+};
+
 /* Communities attribute.  */
 struct community {
 	/* Reference count of communities value.  */
@@ -41,6 +56,9 @@ struct community {
 	/* String of community attribute.  This sring is used by vty output
 	   and expanded community-list for regular expression match.  */
 	char *str;
+
+	/* Membership summary, built when interned (may be NULL). */
+	struct community_bloom *bloom;
 };
 
 /* Well-known communities value.  */
@@ -104,4 +122,13 @@ extern void bgp_remove_comm_from_aggregate_hash(struct bgp_aggregate *aggregate,
 						struct community *community);
 extern void bgp_aggr_community_remove(void *arg);
 
+extern struct community_bloom *community_bloom_new(const uint8_t *val,
+						   int num, size_t size);
+extern bool community_bloom_member(const struct community_bloom *bloom,
+				   const uint8_t *val, int num, size_t size,
+				   const void *key);
+extern void community_bloom_update(struct community_bloom **bloom,
+				   unsigned long refcnt, const uint8_t *val,
+				   int num, size_t size);
+
 #endif /* _QUAGGA_BGP_COMMUNITY_H */
@@ -30,6 +30,7 @@
 #include "stream.h"
 
 #include "bgpd/bgpd.h"
+#include "bgpd/bgp_community.h"
 #include "bgpd/bgp_ecommunity.h"
 #include "bgpd/bgp_lcommunity.h"
 #include "bgpd/bgp_aspath.h"
@@ -61,6 +62,7 @@ void ecommunity_free(struct ecommunity **ecom)
 {
 	XFREE(MTYPE_ECOMMUNITY_VAL, (*ecom)->val);
 	XFREE(MTYPE_ECOMMUNITY_STR, (*ecom)->str);
+	XFREE(MTYPE_COMMUNITY_BLOOM, (*ecom)->bloom);
 	XFREE(MTYPE_ECOMMUNITY, *ecom);
 }
 
@@ -70,6 +72,13 @@ static void ecommunity_hash_free(struct ecommunity *ecom)
 }
 
 
+/* Values of the set changed, keep an interned one's summary current */
+static void ecommunity_val_changed(struct ecommunity *ecom)
+{
+	community_bloom_update(&ecom->bloom, ecom->refcnt, ecom->val,
+			       ecom->size, ECOMMUNITY_SIZE);
+}
+
 /* Add a new Extended Communities value to Extended Communities
    Attribute structure.  When the value is already exists in the
    structure, we don't add the value.  Newly added value is sorted by
@@ -86,6 +95,7 @@ int ecommunity_add_val(struct ecommunity *ecom, struct ecommunity_val *eval)
 		ecom->size++;
 		ecom->val = XMALLOC(MTYPE_ECOMMUNITY_VAL, ecom_length(ecom));
 		memcpy(ecom->val, eval->val, ECOMMUNITY_SIZE);
+		ecommunity_val_changed(ecom);
 		return 1;
 	}
 
@@ -109,6 +119,7 @@ int ecommunity_add_val(struct ecommunity *ecom, struct ecommunity_val *eval)
 		(ecom->size - 1 - c) * ECOMMUNITY_SIZE);
 	memcpy(ecom->val + c * ECOMMUNITY_SIZE, eval->val, ECOMMUNITY_SIZE);
 
+	ecommunity_val_changed(ecom);
 	return 1;
 }
 
@@ -198,6 +209,8 @@ struct ecommunity *ecommunity_merge(struct ecommunity *ecom1,
 	       ecom2->size * ECOMMUNITY_SIZE);
 	ecom1->size += ecom2->size;
 
+	ecommunity_val_changed(ecom1);
+
 	return ecom1;
 }
 
@@ -213,6 +226,10 @@ struct ecommunity *ecommunity_intern(struct ecommunity *ecom)
 	if (find != ecom)
 		ecommunity_free(&ecom);
 
+	if (find->refcnt == 0)
+		find->bloom = community_bloom_new(find->val, find->size,
+						  ECOMMUNITY_SIZE);
+
 	find->refcnt++;
 
 	if (!find->str)
@@ -867,6 +884,24 @@ int ecommunity_match(const struct ecommunity *ecom1,
 		return 0;
 
 	/* Every community on com2 needs to be on com1 for this to match */
+	if (ecom1->bloom) {
+		/* and in the same order, as in the walk below */
+		for (j = 0; j < ecom2->size; j++) {
+			if (j > 0
+			    && memcmp(ecom2->val + (j - 1) * ECOMMUNITY_SIZE,
+				      ecom2->val + j * ECOMMUNITY_SIZE,
+				      ECOMMUNITY_SIZE)
+				       >= 0)
+				return 0;
+			if (!community_bloom_member(
+				    ecom1->bloom, ecom1->val, ecom1->size,
+				    ECOMMUNITY_SIZE,
+				    ecom2->val + (j * ECOMMUNITY_SIZE)))
+				return 0;
+		}
+		return 1;
+	}
+
 	while (i < ecom1->size && j < ecom2->size) {
 		if (memcmp(ecom1->val + i * ECOMMUNITY_SIZE,
 			   ecom2->val + j * ECOMMUNITY_SIZE, ECOMMUNITY_SIZE)
@@ -936,6 +971,7 @@ extern int ecommunity_strip(struct ecommunity *ecom, uint8_t type,
 	/* shift last ecommunities */
 	XFREE(MTYPE_ECOMMUNITY, ecom->val);
 	ecom->val = p;
+	ecommunity_val_changed(ecom);
 	return 1;
 }
 
@@ -972,6 +1008,7 @@ int ecommunity_del_val(struct ecommunity *ecom, struct ecommunity_val *eval)
 		       (ecom->size - c) * ECOMMUNITY_SIZE);
 	XFREE(MTYPE_ECOMMUNITY_VAL, ecom->val);
 	ecom->val = p;
+	ecommunity_val_changed(ecom);
 	return 1;
 }
 
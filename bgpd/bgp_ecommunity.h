@@ -88,6 +88,9 @@ struct ecommunity {
 
 	/* Human readable format string.  */
 	char *str;
+
+	/* Membership summary, built when interned (may be NULL). */
+	struct community_bloom *bloom;
 };
 
 struct ecommunity_as {
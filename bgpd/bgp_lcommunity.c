@@ -29,6 +29,7 @@
 #include "stream.h"
 
 #include "bgpd/bgpd.h"
+#include "bgpd/bgp_community.h"
 #include "bgpd/bgp_lcommunity.h"
 #include "bgpd/bgp_aspath.h"
 
@@ -46,6 +47,7 @@ void lcommunity_free(struct lcommunity **lcom)
 {
 	XFREE(MTYPE_LCOMMUNITY_VAL, (*lcom)->val);
 	XFREE(MTYPE_LCOMMUNITY_STR, (*lcom)->str);
+	XFREE(MTYPE_COMMUNITY_BLOOM, (*lcom)->bloom);
 	XFREE(MTYPE_LCOMMUNITY, *lcom);
 }
 
@@ -54,6 +56,13 @@ static void lcommunity_hash_free(struct lcommunity *lcom)
 	lcommunity_free(&lcom);
 }
 
+/* Values of the set changed, keep an interned one's summary current */
+static void lcommunity_val_changed(struct lcommunity *lcom)
+{
+	community_bloom_update(&lcom->bloom, lcom->refcnt, lcom->val,
+			       lcom->size, LCOMMUNITY_SIZE);
+}
+
 /* Add a new Large Communities value to Large Communities
    Attribute structure.  When the value is already exists in the
    structure, we don't add the value.  Newly added value is sorted by
@@ -71,6 +80,7 @@ static int lcommunity_add_val(struct lcommunity *lcom,
 		lcom->size++;
 		lcom->val = XMALLOC(MTYPE_LCOMMUNITY_VAL, lcom_length(lcom));
 		memcpy(lcom->val, lval->val, LCOMMUNITY_SIZE);
+		lcommunity_val_changed(lcom);
 		return 1;
 	}
 
@@ -94,6 +104,7 @@ static int lcommunity_add_val(struct lcommunity *lcom,
 		(lcom->size - 1 - c) * LCOMMUNITY_SIZE);
 	memcpy(lcom->val + c * LCOMMUNITY_SIZE, lval->val, LCOMMUNITY_SIZE);
 
+	lcommunity_val_changed(lcom);
 	return 1;
 }
 
@@ -170,6 +181,8 @@ struct lcommunity *lcommunity_merge(struct lcommunity *lcom1,
 	memcpy(lcom1->val + lcom_length(lcom1), lcom2->val, lcom_length(lcom2));
 	lcom1->size += lcom2->size;
 
+	lcommunity_val_changed(lcom1);
+
 	return lcom1;
 }
 
@@ -259,6 +272,10 @@ struct lcommunity *lcommunity_intern(struct lcommunity *lcom)
 	if (find != lcom)
 		lcommunity_free(&lcom);
 
+	if (find->refcnt == 0)
+		find->bloom = community_bloom_new(find->val, find->size,
+						  LCOMMUNITY_SIZE);
+
 	find->refcnt++;
 
 	if (!find->str)
@@ -463,6 +480,10 @@ int lcommunity_include(struct lcommunity *lcom, uint8_t *ptr)
 	int i;
 	uint8_t *lcom_ptr;
 
+	if (lcom->bloom)
+		return community_bloom_member(lcom->bloom, lcom->val,
+					      lcom->size, LCOMMUNITY_SIZE, ptr);
+
 	for (i = 0; i < lcom->size; i++) {
 		lcom_ptr = lcom->val + (i * LCOMMUNITY_SIZE);
 		if (memcmp(ptr, lcom_ptr, LCOMMUNITY_SIZE) == 0)
@@ -487,6 +508,24 @@ int lcommunity_match(const struct lcommunity *lcom1,
 		return 0;
 
 	/* Every community on com2 needs to be on com1 for this to match */
+	if (lcom1->bloom) {
+		/* and in the same order, as in the walk below */
+		for (j = 0; j < lcom2->size; j++) {
+			if (j > 0
+			    && memcmp(lcom2->val + (j - 1) * LCOMMUNITY_SIZE,
+				      lcom2->val + j * LCOMMUNITY_SIZE,
+				      LCOMMUNITY_SIZE)
+				       >= 0)
+				return 0;
+			if (!community_bloom_member(
+				    lcom1->bloom, lcom1->val, lcom1->size,
+				    LCOMMUNITY_SIZE,
+				    lcom2->val + (j * LCOMMUNITY_SIZE)))
+				return 0;
+		}
+		return 1;
+	}
+
 	while (i < lcom1->size && j < lcom2->size) {
 		if (memcmp(lcom1->val + (i * LCOMMUNITY_SIZE),
 			   lcom2->val + (j * LCOMMUNITY_SIZE), LCOMMUNITY_SIZE)
@@ -531,6 +570,7 @@ void lcommunity_del_val(struct lcommunity *lcom, uint8_t *ptr)
 				XFREE(MTYPE_LCOMMUNITY_VAL, lcom->val);
 				lcom->val = NULL;
 			}
+			lcommunity_val_changed(lcom);
 			return;
 		}
 		i++;
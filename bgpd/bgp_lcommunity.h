@@ -43,6 +43,9 @@ struct lcommunity {
 
 	/* Human readable format string.  */
 	char *str;
+
+	/* Membership summary, built when interned (may be NULL). */
+	struct community_bloom *bloom;
 };
 
 /* Large community value is 12 octets.  */
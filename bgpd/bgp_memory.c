@@ -41,6 +41,7 @@ DEFINE_MTYPE(BGPD, PEER_PASSWORD, "Peer password string")
 DEFINE_MTYPE(BGPD, BGP_PEER_AF, "BGP peer af")
 DEFINE_MTYPE(BGPD, BGP_UPDGRP, "BGP update group")
 DEFINE_MTYPE(BGPD, BGP_UPD_SUBGRP, "BGP update subgroup")
+DEFINE_MTYPE(BGPD, BGP_UPDGRP_SNAPSHOT, "BGP update group table snapshot")
 DEFINE_MTYPE(BGPD, BGP_PACKET, "BGP packet")
 DEFINE_MTYPE(BGPD, ATTR, "BGP attribute")
 DEFINE_MTYPE(BGPD, AS_PATH, "BGP aspath")
@@ -68,6 +69,7 @@ DEFINE_MTYPE(BGPD, AS_FILTER_STR, "BGP AS filter str")
 DEFINE_MTYPE(BGPD, COMMUNITY, "community")
 DEFINE_MTYPE(BGPD, COMMUNITY_VAL, "community val")
 DEFINE_MTYPE(BGPD, COMMUNITY_STR, "community str")
+DEFINE_MTYPE(BGPD, COMMUNITY_BLOOM, "community bloom filter")
 
 DEFINE_MTYPE(BGPD, ECOMMUNITY, "extcommunity")
 DEFINE_MTYPE(BGPD, ECOMMUNITY_VAL, "extcommunity val")
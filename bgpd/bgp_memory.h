@@ -37,6 +37,7 @@ DECLARE_MTYPE(PEER_PASSWORD)
 DECLARE_MTYPE(BGP_PEER_AF)
 DECLARE_MTYPE(BGP_UPDGRP)
 DECLARE_MTYPE(BGP_UPD_SUBGRP)
+DECLARE_MTYPE(BGP_UPDGRP_SNAPSHOT)
 DECLARE_MTYPE(BGP_PACKET)
 DECLARE_MTYPE(ATTR)
 DECLARE_MTYPE(AS_PATH)
@@ -64,6 +65,7 @@ DECLARE_MTYPE(AS_FILTER_STR)
 DECLARE_MTYPE(COMMUNITY)
 DECLARE_MTYPE(COMMUNITY_VAL)
 DECLARE_MTYPE(COMMUNITY_STR)
+DECLARE_MTYPE(COMMUNITY_BLOOM)
 
 DECLARE_MTYPE(ECOMMUNITY)
 DECLARE_MTYPE(ECOMMUNITY_VAL)
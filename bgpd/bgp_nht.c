@@ -772,6 +772,8 @@ static void evaluate_paths(struct bgp_nexthop_cache *bnc)
 		if (CHECK_FLAG(bnc->change_flags, BGP_NEXTHOP_METRIC_CHANGED)
 		    || CHECK_FLAG(bnc->change_flags, BGP_NEXTHOP_CHANGED))
 			SET_FLAG(path->flags, BGP_PATH_IGP_CHANGED);
+		if (CHECK_FLAG(bnc->change_flags, BGP_NEXTHOP_CHANGED))
+			SET_FLAG(path->flags, BGP_PATH_NH_CHANGED);
 
 		bgp_process(bgp_path, rn, afi, safi);
 	}
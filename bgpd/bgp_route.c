@@ -2222,6 +2222,10 @@ int subgroup_process_announce_selected(struct update_subgroup *subgrp,
 	memset(&attr, 0, sizeof(struct attr));
 	/* It's initialized in bgp_announce_check() */
 
+	/* The new best path is advertised once zebra has installed it */
+	if (selected && bgp_fib_pending(rn))
+		return 0;
+
 	/* Announcement to the subgroup.  If the route is filtered withdraw it.
 	 */
 	if (selected) {
@@ -2252,6 +2256,7 @@ void bgp_zebra_clear_route_change_flags(struct bgp_node *rn)
 		if (BGP_PATH_HOLDDOWN(pi))
 			continue;
 		UNSET_FLAG(pi->flags, BGP_PATH_IGP_CHANGED);
+		UNSET_FLAG(pi->flags, BGP_PATH_NH_CHANGED);
 		UNSET_FLAG(pi->flags, BGP_PATH_ATTR_CHANGED);
 	}
 }
@@ -2290,6 +2295,29 @@ int bgp_zebra_has_route_changed(struct bgp_node *rn,
 	return 0;
 }
 
+/*
+ * Has the forwarding of a best path changed, rather than only the IGP
+ * metric to its nexthops? Only such changes are held back by "bgp
+ * suppress-fib-pending".
+ */
+static bool bgp_zebra_has_nexthop_changed(struct bgp_path_info *selected)
+{
+	struct bgp_path_info *mpinfo;
+
+	if (CHECK_FLAG(selected->flags, BGP_PATH_NH_CHANGED)
+	    || CHECK_FLAG(selected->flags, BGP_PATH_MULTIPATH_CHG))
+		return true;
+
+	for (mpinfo = bgp_path_info_mpath_first(selected); mpinfo;
+	     mpinfo = bgp_path_info_mpath_next(mpinfo)) {
+		if (CHECK_FLAG(mpinfo->flags, BGP_PATH_NH_CHANGED)
+		    || CHECK_FLAG(mpinfo->flags, BGP_PATH_ATTR_CHANGED))
+			return true;
+	}
+
+	return false;
+}
+
 struct bgp_process_queue {
 	struct bgp *bgp;
 	STAILQ_HEAD(, bgp_node) pqueue;
@@ -2325,6 +2353,7 @@ static void bgp_process_main_one(struct bgp *bgp, struct bgp_node *rn,
 	struct bgp_path_info_pair old_and_new;
 	char pfx_buf[PREFIX2STR_BUFFER];
 	int debug = 0;
+	bool fib_update, fib_install, fib_changed, fib_pending;
 
 	if (bgp_flag_check(bgp, BGP_FLAG_DELETE_IN_PROGRESS)) {
 		if (rn)
@@ -2347,6 +2376,7 @@ static void bgp_process_main_one(struct bgp *bgp, struct bgp_node *rn,
 			if (bgp_fibupd_safi(safi))
 				bgp_zebra_announce_table(bgp, afi, safi);
 		}
+		bgp_zebra_update_complete();
 		bgp->main_peers_update_hold = 0;
 
 		bgp_start_routeadv(bgp);
@@ -2434,7 +2464,11 @@ static void bgp_process_main_one(struct bgp *bgp, struct bgp_node *rn,
 				if (new_select->type == ZEBRA_ROUTE_BGP
 				    && (new_select->sub_type == BGP_ROUTE_NORMAL
 					|| new_select->sub_type
-						   == BGP_ROUTE_IMPORTED))
+						   == BGP_ROUTE_IMPORTED)
+				    && (!bgp_zebra_has_nexthop_changed(
+						old_select)
+					|| !bgp_zebra_fib_pending_add(rn, bgp,
+								      safi)))
 
 					bgp_zebra_announce(rn, p, old_select,
 							   bgp, afi, safi);
@@ -2464,10 +2498,6 @@ static void bgp_process_main_one(struct bgp *bgp, struct bgp_node *rn,
 		return;
 	}
 
-	/* If the user did "clear ip bgp prefix x.x.x.x" this flag will be set
-	 */
-	UNSET_FLAG(rn->flags, BGP_NODE_USER_CLEAR);
-
 	/* bestpath has changed; bump version */
 	if (old_select || new_select) {
 		bgp_bump_version(rn);
@@ -2482,6 +2512,13 @@ static void bgp_process_main_one(struct bgp *bgp, struct bgp_node *rn,
 		}
 	}
 
+	/* A new best path, or new attributes or nexthops for it */
+	fib_changed = old_select != new_select
+		      || (new_select
+			  && (CHECK_FLAG(new_select->flags,
+					 BGP_PATH_ATTR_CHANGED)
+			      || bgp_zebra_has_nexthop_changed(new_select)));
+
 	if (old_select)
 		bgp_path_info_unset_flag(rn, old_select, BGP_PATH_SELECTED);
 	if (new_select) {
@@ -2509,6 +2546,22 @@ static void bgp_process_main_one(struct bgp *bgp, struct bgp_node *rn,
 	}
 #endif
 
+	/* FIB update. */
+	fib_update = bgp_fibupd_safi(safi)
+		     && (bgp->inst_type != BGP_INSTANCE_TYPE_VIEW)
+		     && !bgp_option_check(BGP_OPT_NO_FIB);
+	fib_install = fib_update && new_select
+		      && new_select->type == ZEBRA_ROUTE_BGP
+		      && (new_select->sub_type == BGP_ROUTE_NORMAL
+			  || new_select->sub_type == BGP_ROUTE_AGGREGATE
+			  || new_select->sub_type == BGP_ROUTE_IMPORTED);
+
+	/* With suppress-fib-pending the download is queued before the peers
+	 * are walked, so that they wait for zebra to install the new best path.
+	 */
+	fib_pending = fib_install && fib_changed
+		      && bgp_zebra_fib_pending_add(rn, bgp, safi);
+
 	group_announce_route(bgp, afi, safi, rn, new_select);
 
 	/* unicast routes must also be annouced to labeled-unicast update-groups
@@ -2517,13 +2570,13 @@ static void bgp_process_main_one(struct bgp *bgp, struct bgp_node *rn,
 		group_announce_route(bgp, afi, SAFI_LABELED_UNICAST, rn,
 				     new_select);
 
-	/* FIB update. */
-	if (bgp_fibupd_safi(safi) && (bgp->inst_type != BGP_INSTANCE_TYPE_VIEW)
-	    && !bgp_option_check(BGP_OPT_NO_FIB)) {
-		if (new_select && new_select->type == ZEBRA_ROUTE_BGP
-		    && (new_select->sub_type == BGP_ROUTE_NORMAL
-			|| new_select->sub_type == BGP_ROUTE_AGGREGATE
-			|| new_select->sub_type == BGP_ROUTE_IMPORTED)) {
+	/* If the user did "clear ip bgp prefix x.x.x.x" this flag will be set,
+	 * addpath update-groups look at it to re-advertise every path.
+	 */
+	UNSET_FLAG(rn->flags, BGP_NODE_USER_CLEAR);
+
+	if (fib_update) {
+		if (fib_install) {
 
 			/* if this is an evpn imported type-5 prefix,
 			 * we need to withdraw the route first to clear
@@ -2533,7 +2586,9 @@ static void bgp_process_main_one(struct bgp *bgp, struct bgp_node *rn,
 			    is_route_parent_evpn(old_select))
 				bgp_zebra_withdraw(p, old_select, bgp, safi);
 
-			bgp_zebra_announce(rn, p, new_select, bgp, afi, safi);
+			if (!fib_pending)
+				bgp_zebra_announce(rn, p, new_select, bgp, afi,
+						   safi);
 		} else {
 			/* Withdraw the route from the kernel. */
 			if (old_select && old_select->type == ZEBRA_ROUTE_BGP
@@ -2542,6 +2597,12 @@ static void bgp_process_main_one(struct bgp *bgp, struct bgp_node *rn,
 				|| old_select->sub_type == BGP_ROUTE_IMPORTED))
 
 				bgp_zebra_withdraw(p, old_select, bgp, safi);
+
+			/* Withdrawals are not held back, nothing is left for
+			 * zebra to confirm.
+			 */
+			UNSET_FLAG(rn->flags, BGP_NODE_FIB_INSTALL_PENDING
+						      | BGP_NODE_FIB_INSTALL_FAILED);
 		}
 	}
 
@@ -2628,6 +2689,12 @@ static void bgp_processq_del(struct work_queue *wq, void *data)
 	XFREE(MTYPE_BGP_PROCESS_QUEUE, pqnode);
 }
 
+static void bgp_processq_complete(struct work_queue *wq)
+{
+	/* The routes of an initial update may just have been sent */
+	bgp_zebra_update_complete();
+}
+
 void bgp_process_queue_init(void)
 {
 	if (!bm->process_main_queue)
@@ -2636,6 +2703,7 @@ void bgp_process_queue_init(void)
 
 	bm->process_main_queue->spec.workfunc = &bgp_process_wq;
 	bm->process_main_queue->spec.del_item_data = &bgp_processq_del;
+	bm->process_main_queue->spec.completion_func = &bgp_processq_complete;
 	bm->process_main_queue->spec.max_retries = 0;
 	bm->process_main_queue->spec.hold = 50;
 	/* Use a higher yield value of 50ms for main queue processing */
@@ -7426,9 +7494,9 @@ void route_vty_out(struct vty *vty, struct prefix *p,
 			 * CLI. "aspath" will be deprecated in future.
 			 */
 			json_object_string_add(json_path, "aspath",
-					       attr->aspath->str);
+					       aspath_print(attr->aspath));
 			json_object_string_add(json_path, "path",
-						attr->aspath->str);
+						aspath_print(attr->aspath));
 		} else
 			aspath_print_vty(vty, "%s", attr->aspath, " ");
 	}
@@ -7595,9 +7663,9 @@ void route_vty_out_tmp(struct vty *vty, struct prefix *p, struct attr *attr,
 				 * deprecated in future.
 				 */
 				json_object_string_add(json_net, "asPath",
-						       attr->aspath->str);
+						       aspath_print(attr->aspath));
 				json_object_string_add(json_net, "path",
-							attr->aspath->str);
+							aspath_print(attr->aspath));
 			}
 
 			/* Print origin */
@@ -7929,7 +7997,7 @@ static void damp_route_vty_out(struct vty *vty, struct prefix *p,
 	if (attr->aspath) {
 		if (use_json)
 			json_object_string_add(json, "asPath",
-					       attr->aspath->str);
+					       aspath_print(attr->aspath));
 		else
 			aspath_print_vty(vty, "%s", attr->aspath, " ");
 	}
@@ -8024,7 +8092,7 @@ static void flap_route_vty_out(struct vty *vty, struct prefix *p,
 	if (attr->aspath) {
 		if (use_json)
 			json_object_string_add(json, "asPath",
-					       attr->aspath->str);
+					       aspath_print(attr->aspath));
 		else
 			aspath_print_vty(vty, "%s", attr->aspath, " ");
 	}
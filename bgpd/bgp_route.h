@@ -226,6 +226,7 @@ struct bgp_path_info {
 #define BGP_PATH_MULTIPATH_CHG (1 << 12)
 #define BGP_PATH_RIB_ATTR_CHG (1 << 13)
 #define BGP_PATH_ANNC_NH_SELF (1 << 14)
+#define BGP_PATH_NH_CHANGED (1 << 15)
 
 	/* BGP route type.  This can be static, RIP, OSPF, BGP etc.  */
 	uint8_t type;
@@ -426,6 +427,18 @@ static inline void bgp_bump_version(struct bgp_node *node)
 	node->version = bgp_table_next_version(bgp_node_table(node));
 }
 
+/*
+ * With "bgp suppress-fib-pending" a best path is held back from peers while
+ * its FIB download is queued or not yet confirmed by zebra, and after zebra
+ * failed to install it.
+ */
+static inline bool bgp_fib_pending(struct bgp_node *node)
+{
+	return CHECK_FLAG(node->flags, BGP_NODE_FIB_UPDATE_PENDING
+					       | BGP_NODE_FIB_INSTALL_PENDING
+					       | BGP_NODE_FIB_INSTALL_FAILED);
+}
+
 static inline int bgp_fibupd_safi(safi_t safi)
 {
 	if (safi == SAFI_UNICAST || safi == SAFI_MULTICAST
@@ -367,11 +367,12 @@ route_match_command(void *rule, const struct prefix *prefix,
 	lua_setfield(L, -2, "metric");
 	lua_pushinteger(L, path->attr->nh_ifindex);
 	lua_setfield(L, -2, "ifindex");
-	lua_pushstring(L, path->attr->aspath->str);
+	lua_pushstring(L, aspath_print(path->attr->aspath));
 	lua_setfield(L, -2, "aspath");
 	lua_pushinteger(L, path->attr->local_pref);
 	lua_setfield(L, -2, "localpref");
-	zlog_debug("%s %d", path->attr->aspath->str, path->attr->nh_ifindex);
+	zlog_debug("%s %d", aspath_print(path->attr->aspath),
+		   path->attr->nh_ifindex);
 	lua_setglobal(L, "nexthop");
 
 	zlog_debug("Set up nexthop information");
@@ -120,6 +120,8 @@ struct bgp_table *bgp_table_init(struct bgp *bgp, afi_t afi, safi_t safi)
 	 */
 	rt->bgp = bgp;
 
+	STAILQ_INIT(&rt->fib_pending);
+
 	bgp_table_lock(rt);
 	rt->afi = afi;
 	rt->safi = safi;
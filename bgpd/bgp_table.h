@@ -40,6 +40,11 @@ struct bgp_table {
 
 	struct route_table *route_table;
 	uint64_t version;
+
+	/* Nodes whose FIB download is being held back, see
+	 * "bgp suppress-fib-pending".
+	 */
+	STAILQ_HEAD(, bgp_node) fib_pending;
 };
 
 enum bgp_path_selection_reason {
@@ -85,6 +90,7 @@ struct bgp_node {
 	struct bgp_node *prn;
 
 	STAILQ_ENTRY(bgp_node) pq;
+	STAILQ_ENTRY(bgp_node) fibq;
 
 	uint64_t version;
 
@@ -95,6 +101,9 @@ struct bgp_node {
 #define BGP_NODE_USER_CLEAR             (1 << 1)
 #define BGP_NODE_LABEL_CHANGED          (1 << 2)
 #define BGP_NODE_REGISTERED_FOR_LABEL   (1 << 3)
+#define BGP_NODE_FIB_UPDATE_PENDING     (1 << 4)
+#define BGP_NODE_FIB_INSTALL_PENDING    (1 << 5)
+#define BGP_NODE_FIB_INSTALL_FAILED     (1 << 6)
 
 	struct bgp_addpath_node_data tx_addpath;
 
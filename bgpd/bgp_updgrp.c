@@ -573,6 +573,19 @@ static int update_group_show_walkcb(struct update_group *updgrp, void *arg)
 		vty_out(vty, "  Outgoing route map: %s\n",
 			filter->map[RMAP_OUT].name);
 	vty_out(vty, "  MRAI value (seconds): %d\n", updgrp->conf->v_routeadv);
+	if (updgrp->snapshot)
+		vty_out(vty,
+			"  Table snapshot: %u packets from subgroup %" PRIu64
+			"%s\n",
+			updgrp->snapshot->count, updgrp->snapshot->owner->id,
+			updgrp->snapshot->recording ? " (recording)" : "");
+	if (updgrp->snapshot && updgrp->snapshot->delta)
+		vty_out(vty, "  Table snapshot delta: %lu adj-outs\n",
+			updgrp->snapshot->delta->count);
+	vty_out(vty,
+		"  Table snapshot replays: %u, table walks: %u, corrections: %u\n",
+		updgrp->snapshot_replays, updgrp->snapshot_walks,
+		updgrp->snapshot_corrections);
 	if (updgrp->conf->change_local_as)
 		vty_out(vty, "  Local AS %u%s%s\n",
 			updgrp->conf->change_local_as,
@@ -723,11 +736,169 @@ static struct update_group *update_group_create(struct peer_af *paf)
 	return updgrp;
 }
 
+/* An adj-out of the snapshot's owner that changed after the recording */
+struct update_group_snapshot_delta {
+	struct bgp_node *rn;
+	uint32_t addpath_tx_id;
+};
+
+static unsigned int snapshot_delta_hash_key(const void *arg)
+{
+	const struct update_group_snapshot_delta *delta = arg;
+
+	return jhash_2words((uint32_t)(uintptr_t)delta->rn,
+			    delta->addpath_tx_id, 0);
+}
+
+static bool snapshot_delta_hash_cmp(const void *arg1, const void *arg2)
+{
+	const struct update_group_snapshot_delta *delta1 = arg1;
+	const struct update_group_snapshot_delta *delta2 = arg2;
+
+	return delta1->rn == delta2->rn
+	       && delta1->addpath_tx_id == delta2->addpath_tx_id;
+}
+
+static void *snapshot_delta_hash_alloc(void *arg)
+{
+	struct update_group_snapshot_delta *key = arg;
+	struct update_group_snapshot_delta *delta;
+
+	delta = XCALLOC(MTYPE_BGP_UPDGRP_SNAPSHOT,
+			sizeof(struct update_group_snapshot_delta));
+	delta->rn = bgp_lock_node(key->rn);
+	delta->addpath_tx_id = key->addpath_tx_id;
+
+	return delta;
+}
+
+static void snapshot_delta_free(void *arg)
+{
+	struct update_group_snapshot_delta *delta = arg;
+
+	bgp_unlock_node(delta->rn);
+	XFREE(MTYPE_BGP_UPDGRP_SNAPSHOT, delta);
+}
+
+static void update_group_snapshot_free(struct update_group *updgrp)
+{
+	struct update_group_snapshot *snap = updgrp->snapshot;
+	struct bpacket *pkt;
+
+	if (!snap)
+		return;
+
+	while ((pkt = TAILQ_FIRST(&snap->pkts))) {
+		TAILQ_REMOVE(&snap->pkts, pkt, pkt_train);
+		bpacket_free(pkt);
+	}
+
+	if (snap->delta) {
+		hash_clean(snap->delta, snapshot_delta_free);
+		hash_free(snap->delta);
+	}
+
+	XFREE(MTYPE_BGP_UPDGRP_SNAPSHOT, updgrp->snapshot);
+}
+
+static void update_group_snapshot_start(struct update_subgroup *subgrp)
+{
+	struct update_group *updgrp = subgrp->update_group;
+	struct update_group_snapshot *snap;
+
+	update_group_snapshot_free(updgrp);
+
+	snap = XCALLOC(MTYPE_BGP_UPDGRP_SNAPSHOT,
+		       sizeof(struct update_group_snapshot));
+	snap->owner = subgrp;
+	snap->recording = true;
+	TAILQ_INIT(&snap->pkts);
+
+	updgrp->snapshot = snap;
+}
+
+/*
+ * The owner of a snapshot that is being recorded has sent everything.
+ */
+static void update_subgroup_snapshot_done(struct update_subgroup *subgrp)
+{
+	struct update_group_snapshot *snap = subgrp->update_group->snapshot;
+
+	if (!snap || !snap->recording || snap->owner != subgrp)
+		return;
+
+	snap->recording = false;
+
+	if (BGP_DEBUG(update_groups, UPDATE_GROUPS))
+		zlog_debug("u%" PRIu64 ":s%" PRIu64
+			   " table snapshot of %u packets recorded",
+			   subgrp->update_group->id, subgrp->id, snap->count);
+}
+
+/*
+ * An adj-out of the owner of a recorded snapshot changed; replays bring it
+ * up to date from now on.
+ */
+void update_subgroup_snapshot_delta(struct update_subgroup *subgrp,
+				    struct bgp_node *rn, uint32_t addpath_tx_id)
+{
+	struct update_group_snapshot *snap = subgrp->update_group->snapshot;
+	struct update_group_snapshot_delta key;
+
+	/* The default route of default-originate is announced per replay */
+	if (!rn)
+		return;
+
+	if (!snap->delta)
+		snap->delta = hash_create(snapshot_delta_hash_key,
+					  snapshot_delta_hash_cmp,
+					  "BGP update group snapshot delta");
+
+	key.rn = rn;
+	key.addpath_tx_id = addpath_tx_id;
+	hash_get(snap->delta, &key, snapshot_delta_hash_alloc);
+
+	if (snap->delta->count
+	    <= subgrp->adj_count / UPDGRP_SNAPSHOT_DELTA_DIV)
+		return;
+
+	if (BGP_DEBUG(update_groups, UPDATE_GROUPS))
+		zlog_debug("u%" PRIu64 ":s%" PRIu64
+			   " %lu adj-outs changed, table snapshot dropped",
+			   subgrp->update_group->id, subgrp->id,
+			   snap->delta->count);
+
+	update_group_snapshot_free(subgrp->update_group);
+}
+
+void update_subgroup_snapshot_record(struct update_subgroup *subgrp,
+				     struct bpacket *pkt)
+{
+	struct update_group_snapshot *snap = subgrp->update_group->snapshot;
+	struct bpacket *copy;
+
+	if (!pkt || !snap || !snap->recording || snap->owner != subgrp)
+		return;
+
+	if (snap->count > subgrp->adj_count + UPDGRP_SNAPSHOT_SLACK) {
+		update_group_snapshot_free(subgrp->update_group);
+		return;
+	}
+
+	copy = bpacket_alloc();
+	copy->buffer = stream_dup(pkt->buffer);
+	copy->arr = pkt->arr;
+	TAILQ_INSERT_TAIL(&snap->pkts, copy, pkt_train);
+	snap->count++;
+}
+
 static void update_group_delete(struct update_group *updgrp)
 {
 	if (BGP_DEBUG(update_groups, UPDATE_GROUPS))
 		zlog_debug("delete update group %" PRIu64, updgrp->id);
 
+	update_group_snapshot_free(updgrp);
+
 	UPDGRP_GLOBAL_STAT(updgrp, updgrps_deleted) += 1;
 
 	hash_release(updgrp->bgp->update_groups[updgrp->afid], updgrp);
@@ -758,6 +929,13 @@ static void update_group_remove_subgroup(struct update_group *updgrp,
 	if (!updgrp || !subgrp)
 		return;
 
+	/*
+	 * The snapshot matches its owner's adj-out and the group's outbound
+	 * policy; no other subgroup has that adj-out to replay it with.
+	 */
+	if (updgrp->snapshot && updgrp->snapshot->owner == subgrp)
+		update_group_snapshot_free(updgrp);
+
 	LIST_REMOVE(subgrp, updgrp_train);
 	subgrp->update_group = NULL;
 	if (LIST_EMPTY(&(updgrp->subgrps)))
@@ -1051,6 +1229,7 @@ static void update_subgroup_merge(struct update_subgroup *subgrp,
 				  const char *reason)
 {
 	struct peer_af *paf;
+	struct update_group_snapshot *snap;
 	int result;
 	int peer_count;
 
@@ -1076,6 +1255,14 @@ static void update_subgroup_merge(struct update_subgroup *subgrp,
 
 	SUBGRP_INCR_STAT(target, merge_events);
 
+	/*
+	 * The target has the same adj-out, it takes over the snapshot and
+	 * its delta.
+	 */
+	snap = subgrp->update_group->snapshot;
+	if (snap && snap->owner == subgrp && !snap->recording)
+		snap->owner = target;
+
 	if (BGP_DEBUG(update_groups, UPDATE_GROUPS))
 		zlog_debug("u%" PRIu64 ":s%" PRIu64
 			   " (%d peers) merged into u%" PRIu64 ":s%" PRIu64
@@ -1105,6 +1292,8 @@ int update_subgroup_check_merge(struct update_subgroup *subgrp,
 	if (!update_subgroup_ready_for_merge(subgrp))
 		return 0;
 
+	update_subgroup_snapshot_done(subgrp);
+
 	/*
 	 * Look for a subgroup to merge into.
 	 */
@@ -1214,6 +1403,89 @@ static int update_subgroup_copy_packets(struct update_subgroup *dest,
 	return count;
 }
 
+static void update_subgroup_snapshot_correct(struct hash_bucket *hb,
+					     void *arg)
+{
+	struct update_group_snapshot_delta *delta = hb->data;
+	struct update_subgroup *subgrp = arg;
+
+	subgroup_announce_node(subgrp, delta->rn, delta->addpath_tx_id);
+}
+
+/*
+ * update_subgroup_snapshot_replay
+ *
+ * Announce the table to a subgroup that has not announced anything yet from
+ * the update group's snapshot.  The adj-outs in the snapshot's delta are
+ * announced again after its packets.  Returns false if that is not
+ * possible; the caller then walks the table, and the subgroup may record a
+ * new snapshot while doing so.
+ */
+bool update_subgroup_snapshot_replay(struct update_subgroup *subgrp)
+{
+	struct update_group *updgrp = subgrp->update_group;
+	struct update_group_snapshot *snap = updgrp->snapshot;
+	struct update_subgroup *owner;
+	struct bpacket *pkt;
+	struct peer *peer;
+
+	if (subgrp->version || !TAILQ_EMPTY(&subgrp->adjq)
+	    || !bpacket_queue_is_empty(SUBGRP_PKTQ(subgrp)))
+		return false;
+
+	/* An owner with nothing to announce never advances a peer's queue */
+	if (snap && snap->recording && snap->owner != subgrp
+	    && update_subgroup_ready_for_merge(snap->owner))
+		update_subgroup_snapshot_done(snap->owner);
+
+	if (snap && snap->recording)
+		goto walk;
+
+	if (!snap || snap->owner == subgrp) {
+		update_group_snapshot_start(subgrp);
+		goto walk;
+	}
+
+	/* Whatever the owner still has to send is not in the snapshot */
+	owner = snap->owner;
+	if (!update_subgroup_ready_for_merge(owner))
+		goto walk;
+
+	peer = SUBGRP_PEER(subgrp);
+	if (CHECK_FLAG(peer->af_flags[SUBGRP_AFI(subgrp)][SUBGRP_SAFI(subgrp)],
+		       PEER_FLAG_DEFAULT_ORIGINATE))
+		subgroup_default_originate(subgrp, 0);
+
+	update_subgroup_copy_adj_out(owner, subgrp);
+	TAILQ_FOREACH (pkt, &snap->pkts, pkt_train)
+		bpacket_queue_add(SUBGRP_PKTQ(subgrp), stream_dup(pkt->buffer),
+				  &pkt->arr);
+	subgrp->version = owner->version;
+
+	if (snap->delta) {
+		hash_iterate(snap->delta, update_subgroup_snapshot_correct,
+			     subgrp);
+		UPDGRP_INCR_STAT_BY(updgrp, snapshot_corrections,
+				    snap->delta->count);
+	}
+
+	UPDGRP_INCR_STAT(updgrp, snapshot_replays);
+
+	if (BGP_DEBUG(update_groups, UPDATE_GROUPS))
+		zlog_debug("u%" PRIu64 ":s%" PRIu64
+			   " announcing table snapshot of u%" PRIu64
+			   ":s%" PRIu64 " (%u packets, %lu corrections)",
+			   updgrp->id, subgrp->id, updgrp->id, owner->id,
+			   snap->count, snap->delta ? snap->delta->count : 0);
+
+	subgroup_trigger_write(subgrp);
+	return true;
+
+walk:
+	UPDGRP_INCR_STAT(updgrp, snapshot_walks);
+	return false;
+}
+
 static int updgrp_prefix_list_update(struct update_group *updgrp,
 				     const char *name)
 {
@@ -1604,6 +1876,12 @@ void update_group_show_stats(struct bgp *bgp, struct vty *vty)
 		bgp->update_group_stats.peer_refreshes_combined);
 	vty_out(vty, "Merge checks triggered: %u\n",
 		bgp->update_group_stats.merge_checks_triggered);
+	vty_out(vty, "Table snapshot replays: %u\n",
+		bgp->update_group_stats.snapshot_replays);
+	vty_out(vty, "Table snapshot walks: %u\n",
+		bgp->update_group_stats.snapshot_walks);
+	vty_out(vty, "Table snapshot corrections: %u\n",
+		bgp->update_group_stats.snapshot_corrections);
 }
 
 /*
@@ -121,6 +121,40 @@ struct bpacket_queue {
 	unsigned int max_count_reached_count;
 };
 
+/*
+ * Packets of a subgroup's initial full-table announcement.  A subgroup that
+ * joins the update group later is fed copies of them, along with the owner's
+ * adj-out, instead of walking the RIB and applying outbound policy again.
+ * Adj-outs of the owner that change after the recording are kept in the
+ * delta; a replay re-announces just those on top of the packets.
+ */
+struct update_group_snapshot {
+	struct update_subgroup *owner;
+
+	/* owner's announcement has not finished yet */
+	bool recording;
+
+	TAILQ_HEAD(, bpacket) pkts;
+	unsigned int count;
+
+	/* (node, addpath ID) of the owner's adj-outs changed since */
+	struct hash *delta;
+};
+
+/*
+ * A recording is given up when it holds more packets than the owner has
+ * adj-outs, plus this much; route churn rather than the initial table is
+ * being recorded then.
+ */
+#define UPDGRP_SNAPSHOT_SLACK 1024
+
+/*
+ * A snapshot is dropped once its delta holds more than this fraction
+ * (1/N) of the owner's adj-outs; re-announcing them on every replay then
+ * costs about as much as walking the table.
+ */
+#define UPDGRP_SNAPSHOT_DELTA_DIV 4
+
 struct update_group {
 	/* back pointer to the BGP instance */
 	struct bgp *bgp;
@@ -150,8 +184,13 @@ struct update_group {
 
 	uint32_t subgrps_created;
 	uint32_t subgrps_deleted;
+	uint32_t snapshot_replays;
+	uint32_t snapshot_walks;
+	uint32_t snapshot_corrections;
 
 	uint32_t num_dbg_en_peers;
+
+	struct update_group_snapshot *snapshot;
 };
 
 /*
@@ -389,6 +428,12 @@ extern void update_group_start_advtimer(struct bgp *bgp);
 
 extern void update_subgroup_inherit_info(struct update_subgroup *to,
 					 struct update_subgroup *from);
+extern void update_subgroup_snapshot_record(struct update_subgroup *subgrp,
+					    struct bpacket *pkt);
+extern bool update_subgroup_snapshot_replay(struct update_subgroup *subgrp);
+extern void update_subgroup_snapshot_delta(struct update_subgroup *subgrp,
+					   struct bgp_node *rn,
+					   uint32_t addpath_tx_id);
 
 /* bgp_updgrp_packet.c */
 extern struct bpacket *bpacket_alloc(void);
@@ -462,6 +507,8 @@ extern void bgp_adj_out_unset_subgroup(struct bgp_node *rn,
 				       char withdraw, uint32_t addpath_tx_id);
 void subgroup_announce_table(struct update_subgroup *subgrp,
 			     struct bgp_table *table);
+extern void subgroup_announce_node(struct update_subgroup *subgrp,
+				   struct bgp_node *rn, uint32_t addpath_tx_id);
 extern void subgroup_trigger_write(struct update_subgroup *subgrp);
 
 extern int update_group_clear_update_dbg(struct update_group *updgrp,
@@ -586,6 +633,26 @@ static inline void bgp_announce_peer(struct peer *peer)
 	}
 }
 
+/*
+ * The subgroup's adj-out for the node changed: a snapshot it recorded no
+ * longer matches it there.
+ */
+static inline void update_subgroup_adj_changed(struct update_subgroup *subgrp,
+					       struct bgp_node *rn,
+					       uint32_t addpath_tx_id)
+{
+	struct update_group_snapshot *snap;
+
+	subgrp->adj_version++;
+
+	if (!subgrp->update_group)
+		return;
+
+	snap = subgrp->update_group->snapshot;
+	if (snap && snap->owner == subgrp && !snap->recording)
+		update_subgroup_snapshot_delta(subgrp, rn, addpath_tx_id);
+}
+
 /**
  * advertise_list_is_empty
  */
@@ -55,6 +55,11 @@
 /********************
  * PRIVATE FUNCTIONS
  ********************/
+/*
+ * adj-outs are keyed on (subgroup, addpath ID), so all the paths a node has
+ * advertised to one subgroup are adjacent in the tree and can be found or
+ * walked without visiting the other subgroups' entries.
+ */
 static int bgp_adj_out_compare(const struct bgp_adj_out *o1,
 			       const struct bgp_adj_out *o2)
 {
@@ -64,53 +69,84 @@ static int bgp_adj_out_compare(const struct bgp_adj_out *o1,
 	if (o1->subgroup > o2->subgroup)
 		return 1;
 
+	if (o1->addpath_tx_id < o2->addpath_tx_id)
+		return -1;
+
+	if (o1->addpath_tx_id > o2->addpath_tx_id)
+		return 1;
+
 	return 0;
 }
 RB_GENERATE(bgp_adj_out_rb, bgp_adj_out, adj_entry, bgp_adj_out_compare);
 
+/*
+ * The addpath ID an adj-out is stored under.  update-groups that do not
+ * support addpath have a single adj-out per node, stored under ID 0.
+ */
+static inline uint32_t adj_key_id(struct update_subgroup *subgrp,
+				  uint32_t addpath_tx_id)
+{
+	if (!bgp_addpath_encode_tx(SUBGRP_PEER(subgrp), SUBGRP_AFI(subgrp),
+				   SUBGRP_SAFI(subgrp)))
+		return 0;
+
+	return addpath_tx_id;
+}
+
 static inline struct bgp_adj_out *adj_lookup(struct bgp_node *rn,
 					     struct update_subgroup *subgrp,
 					     uint32_t addpath_tx_id)
 {
-	struct bgp_adj_out *adj, lookup;
-	struct peer *peer;
-	afi_t afi;
-	safi_t safi;
-	int addpath_capable;
+	struct bgp_adj_out lookup;
 
 	if (!rn || !subgrp)
 		return NULL;
 
-	peer = SUBGRP_PEER(subgrp);
-	afi = SUBGRP_AFI(subgrp);
-	safi = SUBGRP_SAFI(subgrp);
-	addpath_capable = bgp_addpath_encode_tx(peer, afi, safi);
+	lookup.subgroup = subgrp;
+	lookup.addpath_tx_id = adj_key_id(subgrp, addpath_tx_id);
+
+	return RB_FIND(bgp_adj_out_rb, &rn->adj_out, &lookup);
+}
+
+/* First of the adj-outs a node has towards a subgroup */
+static inline struct bgp_adj_out *adj_first(struct bgp_node *rn,
+					    struct update_subgroup *subgrp)
+{
+	struct bgp_adj_out lookup, *adj;
 
-	/* update-groups that do not support addpath will pass 0 for
-	 * addpath_tx_id so do not both matching against it */
 	lookup.subgroup = subgrp;
-	adj = RB_FIND(bgp_adj_out_rb, &rn->adj_out, &lookup);
-	if (adj) {
-		if (addpath_capable) {
-			if (adj->addpath_tx_id == addpath_tx_id)
-				return adj;
-		} else
-			return adj;
-	}
-	return NULL;
+	lookup.addpath_tx_id = 0;
+
+	adj = RB_NFIND(bgp_adj_out_rb, &rn->adj_out, &lookup);
+	if (adj && adj->subgroup != subgrp)
+		return NULL;
+
+	return adj;
+}
+
+/* Next adj-out towards the same subgroup */
+static inline struct bgp_adj_out *adj_next(struct bgp_adj_out *adj)
+{
+	struct bgp_adj_out *next = RB_NEXT(bgp_adj_out_rb, adj);
+
+	if (next && next->subgroup != adj->subgroup)
+		return NULL;
+
+	return next;
 }
 
 static void adj_free(struct bgp_adj_out *adj)
 {
 	TAILQ_REMOVE(&(adj->subgroup->adjq), adj, subgrp_adj_train);
 	SUBGRP_DECR_STAT(adj->subgroup, adj_count);
+	update_subgroup_adj_changed(adj->subgroup, adj->rn, adj->addpath_tx_id);
 	XFREE(MTYPE_BGP_ADJ_OUT, adj);
 }
 
 static void subgrp_withdraw_stale_addpath(struct updwalk_context *ctx,
 					  struct update_subgroup *subgrp)
 {
-	struct bgp_adj_out *adj, *adj_next;
+	struct bgp_adj_out *adj, *next;
 	uint32_t id;
 	struct bgp_path_info *pi;
 	afi_t afi = SUBGRP_AFI(subgrp);
@@ -119,28 +155,66 @@ static void subgrp_withdraw_stale_addpath(struct updwalk_context *ctx,
 
 	/* Look through all of the paths we have advertised for this rn and send
 	 * a withdraw for the ones that are no longer present */
-	RB_FOREACH_SAFE (adj, bgp_adj_out_rb, &ctx->rn->adj_out, adj_next) {
+	for (adj = adj_first(ctx->rn, subgrp); adj; adj = next) {
+		next = adj_next(adj);
 
-		if (adj->subgroup == subgrp) {
-			for (pi = bgp_node_get_bgp_path_info(ctx->rn);
-			     pi; pi = pi->next) {
-				id = bgp_addpath_id_for_peer(peer, afi, safi,
-					&pi->tx_addpath);
+		for (pi = bgp_node_get_bgp_path_info(ctx->rn); pi;
+		     pi = pi->next) {
+			id = bgp_addpath_id_for_peer(peer, afi, safi,
+						     &pi->tx_addpath);
 
-				if (id == adj->addpath_tx_id) {
-					break;
-				}
-			}
-
-			if (!pi) {
-				subgroup_process_announce_selected(
-					subgrp, NULL, ctx->rn,
-					adj->addpath_tx_id);
-			}
+			if (id == adj->addpath_tx_id)
+				break;
 		}
+
+		if (!pi)
+			subgroup_process_announce_selected(subgrp, NULL, ctx->rn,
+							   adj->addpath_tx_id);
 	}
 }
 
+/*
+ * With addpath-tx-all-paths a change to one path of a node used to re-run
+ * outbound policy and queue a new UPDATE for every other path as well.
+ * Returns true if a non-best path does not need to be looked at again: it
+ * is still eligible, neither its attributes nor its nexthop changed, and
+ * it is currently advertised (or queued for advertisement) to the
+ * subgroup.
+ */
+static bool subgrp_addpath_path_unchanged(struct updwalk_context *ctx,
+					  struct update_subgroup *subgrp,
+					  struct bgp_path_info *pi)
+{
+	struct peer *peer = SUBGRP_PEER(subgrp);
+	afi_t afi = SUBGRP_AFI(subgrp);
+	safi_t safi = SUBGRP_SAFI(subgrp);
+	struct bgp_adj_out *adj;
+
+	if (peer->addpath_type[afi][safi] != BGP_ADDPATH_ALL)
+		return false;
+
+	if (CHECK_FLAG(ctx->rn->flags,
+		       BGP_NODE_USER_CLEAR | BGP_NODE_LABEL_CHANGED))
+		return false;
+
+	if (!CHECK_FLAG(pi->flags, BGP_PATH_VALID)
+	    || CHECK_FLAG(pi->flags, BGP_PATH_HISTORY | BGP_PATH_REMOVED
+					     | BGP_PATH_ATTR_CHANGED
+					     | BGP_PATH_IGP_CHANGED))
+		return false;
+
+	adj = adj_lookup(ctx->rn, subgrp,
+			 bgp_addpath_id_for_peer(peer, afi, safi,
+						 &pi->tx_addpath));
+	if (!adj)
+		return false;
+
+	if (adj->adv)
+		return adj->adv->baa && adj->adv->pathi == pi;
+
+	return adj->attr != NULL;
+}
+
 static int group_announce_route_walkcb(struct update_group *updgrp, void *arg)
 {
 	struct updwalk_context *ctx = arg;
@@ -149,7 +223,7 @@ static int group_announce_route_walkcb(struct update_group *updgrp, void *arg)
 	afi_t afi;
 	safi_t safi;
 	struct peer *peer;
-	struct bgp_adj_out *adj, *adj_next;
+	struct bgp_adj_out *adj, *next;
 	int addpath_capable;
 
 	afi = UPDGRP_AFI(updgrp);
@@ -183,6 +257,10 @@ static int group_announce_route_walkcb(struct update_group *updgrp, void *arg)
 					if (pi == ctx->pi)
 						continue;
 
+					if (subgrp_addpath_path_unchanged(
+						    ctx, subgrp, pi))
+						continue;
+
 					subgroup_process_announce_selected(
 						subgrp, pi, ctx->rn,
 						bgp_addpath_id_for_peer(
@@ -214,15 +292,12 @@ static int group_announce_route_walkcb(struct update_group *updgrp, void *arg)
 					/* Find the addpath_tx_id of the path we
 					 * had advertised and
 					 * send a withdraw */
-					RB_FOREACH_SAFE (adj, bgp_adj_out_rb,
-							 &ctx->rn->adj_out,
-							 adj_next) {
-						if (adj->subgroup == subgrp) {
-							subgroup_process_announce_selected(
-								subgrp, NULL,
-								ctx->rn,
-								adj->addpath_tx_id);
-						}
+					for (adj = adj_first(ctx->rn, subgrp);
+					     adj; adj = next) {
+						next = adj_next(adj);
+						subgroup_process_announce_selected(
+							subgrp, NULL, ctx->rn,
+							adj->addpath_tx_id);
 					}
 				}
 			}
@@ -403,15 +478,16 @@ struct bgp_adj_out *bgp_adj_out_alloc(struct update_subgroup *subgrp,
 
 	adj = XCALLOC(MTYPE_BGP_ADJ_OUT, sizeof(struct bgp_adj_out));
 	adj->subgroup = subgrp;
+	adj->addpath_tx_id = adj_key_id(subgrp, addpath_tx_id);
 	if (rn) {
 		RB_INSERT(bgp_adj_out_rb, &rn->adj_out, adj);
 		bgp_lock_node(rn);
 		adj->rn = rn;
 	}
 
-	adj->addpath_tx_id = addpath_tx_id;
 	TAILQ_INSERT_TAIL(&(subgrp->adjq), adj, subgrp_adj_train);
 	SUBGRP_INCR_STAT(subgrp, adj_count);
+	update_subgroup_adj_changed(subgrp, rn, adj->addpath_tx_id);
 	return adj;
 }
 
@@ -519,6 +595,7 @@ void bgp_adj_out_set_subgroup(struct bgp_node *rn,
 	bgp_adv_fifo_add_tail(&subgrp->sync->update, adv);
 
 	subgrp->version = max(subgrp->version, rn->version);
+	update_subgroup_adj_changed(subgrp, rn, adj->addpath_tx_id);
 }
 
 /* The only time 'withdraw' will be false is if we are sending
@@ -538,6 +615,8 @@ void bgp_adj_out_unset_subgroup(struct bgp_node *rn,
 
 	/* Lookup existing adjacency */
 	if ((adj = adj_lookup(rn, subgrp, addpath_tx_id)) != NULL) {
+		update_subgroup_adj_changed(subgrp, rn, adj->addpath_tx_id);
+
 		/* Clean up previous advertisement.  */
 		if (adj->adv)
 			bgp_advertise_clean_subgroup(subgrp, adj);
@@ -601,6 +680,87 @@ void subgroup_clear_table(struct update_subgroup *subgrp)
 	}
 }
 
+/*
+ * Announce, or withdraw, the paths of one node to the subgroup as a walk
+ * of the table does.
+ */
+static void subgroup_announce_paths(struct update_subgroup *subgrp,
+				    struct bgp_node *rn, int addpath_capable)
+{
+	struct bgp_path_info *ri;
+	struct attr attr;
+	struct peer *peer;
+	afi_t afi;
+	safi_t safi;
+
+	peer = SUBGRP_PEER(subgrp);
+	afi = SUBGRP_AFI(subgrp);
+	safi = SUBGRP_SAFI(subgrp);
+
+	if (safi == SAFI_LABELED_UNICAST)
+		safi = SAFI_UNICAST;
+
+	/* Announced once zebra has installed it */
+	if (bgp_fib_pending(rn))
+		return;
+
+	for (ri = bgp_node_get_bgp_path_info(rn); ri; ri = ri->next)
+
+		if (CHECK_FLAG(ri->flags, BGP_PATH_SELECTED)
+		    || (addpath_capable
+			&& bgp_addpath_tx_path(peer->addpath_type[afi][safi],
+					       ri))) {
+			if (subgroup_announce_check(rn, ri, subgrp, &rn->p,
+						    &attr))
+				bgp_adj_out_set_subgroup(rn, subgrp, &attr, ri);
+			else
+				bgp_adj_out_unset_subgroup(
+					rn, subgrp, 1,
+					bgp_addpath_id_for_peer(
+						peer, afi, safi,
+						&ri->tx_addpath));
+		}
+}
+
+/*
+ * subgroup_announce_node
+ *
+ * Bring the peers of a subgroup that were sent an out of date
+ * announcement of the node, under the given addpath ID, up to date.  The
+ * node's current paths are announced; if that leaves nothing announced
+ * under the ID, it is withdrawn.
+ */
+void subgroup_announce_node(struct update_subgroup *subgrp,
+			    struct bgp_node *rn, uint32_t addpath_tx_id)
+{
+	struct bgp_adj_out *adj;
+	struct bgp_advertise *adv;
+	bool trigger_write;
+
+	subgroup_announce_paths(subgrp, rn,
+				bgp_addpath_encode_tx(SUBGRP_PEER(subgrp),
+						      SUBGRP_AFI(subgrp),
+						      SUBGRP_SAFI(subgrp)));
+
+	if (adj_lookup(rn, subgrp, addpath_tx_id))
+		return;
+
+	/* Queue a withdraw for an adj-out that is only there to be sent */
+	adj = bgp_adj_out_alloc(subgrp, rn, addpath_tx_id);
+	adj->adv = bgp_advertise_new();
+	adv = adj->adv;
+	adv->rn = rn;
+	adv->adj = adj;
+
+	/* The withdraw counts this as a prefix sent before */
+	subgrp->scount++;
+
+	trigger_write = !bgp_adv_fifo_count(&subgrp->sync->withdraw);
+	bgp_adv_fifo_add_tail(&subgrp->sync->withdraw, adv);
+	if (trigger_write)
+		subgroup_trigger_write(subgrp);
+}
+
 /*
  * subgroup_announce_table
  */
@@ -608,8 +768,6 @@ void subgroup_announce_table(struct update_subgroup *subgrp,
 			     struct bgp_table *table)
 {
 	struct bgp_node *rn;
-	struct bgp_path_info *ri;
-	struct attr attr;
 	struct peer *peer;
 	afi_t afi;
 	safi_t safi;
@@ -632,24 +790,7 @@ void subgroup_announce_table(struct update_subgroup *subgrp,
 		subgroup_default_originate(subgrp, 0);
 
 	for (rn = bgp_table_top(table); rn; rn = bgp_route_next(rn))
-		for (ri = bgp_node_get_bgp_path_info(rn); ri; ri = ri->next)
-
-			if (CHECK_FLAG(ri->flags, BGP_PATH_SELECTED)
-			    || (addpath_capable
-				&& bgp_addpath_tx_path(
-					   peer->addpath_type[afi][safi],
-					   ri))) {
-				if (subgroup_announce_check(rn, ri, subgrp,
-							    &rn->p, &attr))
-					bgp_adj_out_set_subgroup(rn, subgrp,
-								 &attr, ri);
-				else
-					bgp_adj_out_unset_subgroup(
-						rn, subgrp, 1,
-						bgp_addpath_id_for_peer(
-							peer, afi, safi,
-							&ri->tx_addpath));
-			}
+		subgroup_announce_paths(subgrp, rn, addpath_capable);
 
 	/*
 	 * We walked through the whole table -- make sure our version number
@@ -694,9 +835,10 @@ void subgroup_announce_route(struct update_subgroup *subgrp)
 
 	if (SUBGRP_SAFI(subgrp) != SAFI_MPLS_VPN
 	    && SUBGRP_SAFI(subgrp) != SAFI_ENCAP
-	    && SUBGRP_SAFI(subgrp) != SAFI_EVPN)
-		subgroup_announce_table(subgrp, NULL);
-	else
+	    && SUBGRP_SAFI(subgrp) != SAFI_EVPN) {
+		if (!update_subgroup_snapshot_replay(subgrp))
+			subgroup_announce_table(subgrp, NULL);
+	} else {
 		for (rn = bgp_table_top(update_subgroup_rib(subgrp)); rn;
 		     rn = bgp_route_next(rn)) {
 			table = bgp_node_get_bgp_table_info(rn);
@@ -704,6 +846,7 @@ void subgroup_announce_route(struct update_subgroup *subgrp)
 				continue;
 			subgroup_announce_table(subgrp, table);
 		}
+	}
 }
 
 void subgroup_default_originate(struct update_subgroup *subgrp, int withdraw)
@@ -921,6 +921,7 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 				    - stream_get_getp(packet)),
 				   num_pfx);
 		pkt = bpacket_queue_add(SUBGRP_PKTQ(subgrp), packet, &vecarr);
+		update_subgroup_snapshot_record(subgrp, pkt);
 		stream_reset(s);
 		stream_reset(snlri);
 		return pkt;
@@ -1079,6 +1080,7 @@ struct bpacket *subgroup_withdraw_packet(struct update_subgroup *subgrp)
 				   num_pfx);
 		pkt = bpacket_queue_add(SUBGRP_PKTQ(subgrp), stream_dup(s),
 					NULL);
+		update_subgroup_snapshot_record(subgrp, pkt);
 		stream_reset(s);
 		return pkt;
 	}
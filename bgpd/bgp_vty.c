@@ -2134,6 +2134,36 @@ DEFUN (no_bgp_graceful_shutdown,
 	return CMD_SUCCESS;
 }
 
+/* "bgp suppress-fib-pending" configuration */
+DEFPY (bgp_suppress_fib_pending,
+       bgp_suppress_fib_pending_cmd,
+       "[no] bgp suppress-fib-pending [coalesce-time (0-10000)$window]",
+       NO_STR
+       BGP_STR
+       "Advertise only routes that are installed in the FIB\n"
+       "Hold best path changes before downloading them to zebra\n"
+       "Hold time in milliseconds\n")
+{
+	VTY_DECLVAR_CONTEXT(bgp, bgp);
+
+	if (no) {
+		bgp->fib_coalesce_time = BGP_DEFAULT_FIB_COALESCE_TIME;
+		if (bgp_flag_check(bgp, BGP_FLAG_SUPPRESS_FIB_PENDING)) {
+			bgp_flag_unset(bgp, BGP_FLAG_SUPPRESS_FIB_PENDING);
+			bgp_zebra_fib_pending_flush(bgp, false);
+			bgp_zebra_fib_notify_update();
+		}
+		return CMD_SUCCESS;
+	}
+
+	bgp_flag_set(bgp, BGP_FLAG_SUPPRESS_FIB_PENDING);
+	bgp_zebra_fib_notify_update();
+	bgp->fib_coalesce_time =
+		window_str ? window : BGP_DEFAULT_FIB_COALESCE_TIME;
+
+	return CMD_SUCCESS;
+}
+
 /* "bgp fast-external-failover" configuration. */
 DEFUN (bgp_fast_external_failover,
        bgp_fast_external_failover_cmd,
@@ -13147,6 +13177,9 @@ void bgp_vty_init(void)
 	install_element(BGP_NODE, &bgp_graceful_shutdown_cmd);
 	install_element(BGP_NODE, &no_bgp_graceful_shutdown_cmd);
 
+	/* "bgp suppress-fib-pending" commands */
+	install_element(BGP_NODE, &bgp_suppress_fib_pending_cmd);
+
 	/* "bgp fast-external-failover" commands */
 	install_element(BGP_NODE, &bgp_fast_external_failover_cmd);
 	install_element(BGP_NODE, &no_bgp_fast_external_failover_cmd);
@@ -30,6 +30,7 @@
 #include "routemap.h"
 #include "thread.h"
 #include "queue.h"
+#include "workqueue.h"
 #include "memory.h"
 #include "lib/json.h"
 #include "lib/bfd.h"
@@ -61,6 +62,7 @@
 #include "bgpd/bgp_pbr.h"
 #include "bgpd/bgp_evpn_private.h"
 #include "bgpd/bgp_mac.h"
+#include "bgpd/bgp_updgrp.h"
 
 /* All information about zebra. */
 struct zclient *zclient = NULL;
@@ -82,6 +84,9 @@ static inline int bgp_install_info_to_zebra(struct bgp *bgp)
 
 int zclient_num_connects;
 
+/* ZEBRA_ROUTE_UPDATE_COMPLETE sent on the current zebra connection */
+static bool update_complete_sent;
+
 /* Router-id update message from zebra. */
 static int bgp_router_id_update(ZAPI_CALLBACK_ARGS)
 {
@@ -1441,9 +1446,17 @@ void bgp_zebra_announce(struct bgp_node *rn, struct prefix *p,
 			__func__, buf_prefix,
 			(recursion_flag ? "" : "NOT "));
 	}
-	zclient_route_send(valid_nh_count ? ZEBRA_ROUTE_ADD
-					  : ZEBRA_ROUTE_DELETE,
-			   zclient, &api);
+
+	/* A held back download: peers wait for zebra to report the route
+	 * installed, see bgp_zebra_route_notify_owner().
+	 */
+	if (valid_nh_count
+	    && CHECK_FLAG(rn->flags, BGP_NODE_FIB_UPDATE_PENDING))
+		SET_FLAG(rn->flags, BGP_NODE_FIB_INSTALL_PENDING);
+
+	zclient_route_bulk_send(valid_nh_count ? ZEBRA_ROUTE_ADD
+					       : ZEBRA_ROUTE_DELETE,
+				zclient, &api);
 }
 
 /* Announce all routes of a table to zebra */
@@ -1515,7 +1528,363 @@ void bgp_zebra_withdraw(struct prefix *p, struct bgp_path_info *info,
 		zlog_debug("Tx route delete VRF %u %s", bgp->vrf_id, buf);
 	}
 
-	zclient_route_send(ZEBRA_ROUTE_DELETE, zclient, &api);
+	zclient_route_bulk_send(ZEBRA_ROUTE_DELETE, zclient, &api);
+}
+
+/*
+ * "bgp suppress-fib-pending"
+ *
+ * Best path changes are queued on their table instead of being sent to zebra
+ * right away.  The queue is drained once the coalesce window expires, so a
+ * prefix that flaps during convergence is only programmed with its final
+ * best path.  The window is fixed: it starts with the first change queued
+ * and is not extended by later ones, so constant churn can't hold the
+ * downloads back indefinitely.  IGP metric moves of an unchanged best path
+ * are sent right away.
+ *
+ * Peers are not told about a new best path until zebra reports it
+ * installed.  If zebra fails to install it, it is withdrawn from the peers
+ * until a later download is installed.  Withdrawals are never held back.
+ *
+ * Route notifications carry no SAFI, so only unicast tables take part.
+ */
+static bool bgp_zebra_fib_suppress(struct bgp *bgp, safi_t safi)
+{
+	return safi == SAFI_UNICAST
+	       && bgp_flag_check(bgp, BGP_FLAG_SUPPRESS_FIB_PENDING);
+}
+
+/*
+ * Route notifications cost zebra a message per route, so they are only
+ * asked for while some instance holds routes back for them.
+ */
+void bgp_zebra_fib_notify_update(void)
+{
+	struct listnode *node;
+	struct bgp *bgp;
+	bool notify = false;
+
+	for (ALL_LIST_ELEMENTS_RO(bm->bgp, node, bgp))
+		if (bgp_flag_check(bgp, BGP_FLAG_SUPPRESS_FIB_PENDING)) {
+			notify = true;
+			break;
+		}
+
+	if (!zclient || zclient->receive_notify == notify)
+		return;
+
+	zclient_send_route_notify_request(zclient, notify);
+}
+
+/*
+ * Has the instance sent zebra the routes of its initial update? With an
+ * update-delay that is when the delay is over and the held routes are
+ * shipped. Without one, it is when every configured peer is up and has
+ * sent End-of-RIB for all its address families; the routes learnt are
+ * then only sent once the process queue has run them.
+ */
+static bool bgp_zebra_initial_update_done(struct bgp *bgp, bool *queued)
+{
+	struct listnode *node;
+	struct peer *peer;
+	afi_t afi;
+	safi_t safi;
+
+	if (bgp_update_delay_configured(bgp))
+		return bgp->update_delay_over && !bgp->main_zebra_update_hold;
+
+	for (ALL_LIST_ELEMENTS_RO(bgp->peer, node, peer)) {
+		if (!CHECK_FLAG(peer->flags, PEER_FLAG_CONFIG_NODE)
+		    || CHECK_FLAG(peer->flags, PEER_FLAG_SHUTDOWN))
+			continue;
+
+		if (peer->status != Established)
+			return false;
+
+		FOREACH_AFI_SAFI (afi, safi)
+			if (peer->afc_nego[afi][safi]
+			    && !CHECK_FLAG(peer->af_sflags[afi][safi],
+					   PEER_STATUS_EOR_RECEIVED))
+				return false;
+	}
+
+	*queued = true;
+	return true;
+}
+
+/*
+ * Tell zebra all routes of the initial update are sent, so that it can
+ * remove those the previous bgpd left in the kernel and that did not
+ * come again. This waits until every instance has finished its initial
+ * update, and is sent again after zebra reconnects.
+ */
+void bgp_zebra_update_complete(void)
+{
+	struct listnode *node;
+	struct bgp *bgp;
+	bool queued = false;
+
+	if (update_complete_sent || !zclient || zclient->sock < 0)
+		return;
+
+	for (ALL_LIST_ELEMENTS_RO(bm->bgp, node, bgp))
+		if (!bgp_zebra_initial_update_done(bgp, &queued))
+			return;
+
+	if (queued && bm->process_main_queue
+	    && !work_queue_empty(bm->process_main_queue))
+		return;
+
+	if (zclient_send_route_update_complete(zclient) < 0)
+		return;
+
+	update_complete_sent = true;
+
+	if (BGP_DEBUG(zebra, ZEBRA))
+		zlog_debug("Initial update complete, sent to zebra");
+}
+
+static struct bgp_path_info *bgp_zebra_fib_selected(struct bgp_node *rn)
+{
+	struct bgp_path_info *pi;
+
+	for (pi = bgp_node_get_bgp_path_info(rn); pi; pi = pi->next)
+		if (CHECK_FLAG(pi->flags, BGP_PATH_SELECTED))
+			return pi;
+
+	return NULL;
+}
+
+/* Tell the peers about a best path that was held back */
+static void bgp_zebra_fib_advertise(struct bgp *bgp, struct bgp_node *rn,
+				    afi_t afi, struct bgp_path_info *pi)
+{
+	/* The paths' change flags were consumed when the node was processed,
+	 * make addpath update-groups look at every path again.
+	 */
+	SET_FLAG(rn->flags, BGP_NODE_USER_CLEAR);
+
+	group_announce_route(bgp, afi, SAFI_UNICAST, rn, pi);
+	group_announce_route(bgp, afi, SAFI_LABELED_UNICAST, rn, pi);
+
+	UNSET_FLAG(rn->flags, BGP_NODE_USER_CLEAR);
+}
+
+/* Withdraw a best path zebra could not install from the peers */
+static void bgp_zebra_fib_withdraw(struct bgp_node *rn)
+{
+	struct bgp_adj_out *adj, *next;
+
+	RB_FOREACH_SAFE (adj, bgp_adj_out_rb, &rn->adj_out, next)
+		bgp_adj_out_unset_subgroup(rn, adj->subgroup, 1,
+					   adj->addpath_tx_id);
+}
+
+static void bgp_zebra_fib_download_node(struct bgp *bgp, struct bgp_node *rn,
+					afi_t afi)
+{
+	struct bgp_path_info *pi;
+
+	UNSET_FLAG(rn->flags, BGP_NODE_FIB_INSTALL_PENDING
+				      | BGP_NODE_FIB_INSTALL_FAILED);
+
+	/* A withdrawal is sent as soon as the node is processed */
+	pi = bgp_zebra_fib_selected(rn);
+	if (!pi) {
+		UNSET_FLAG(rn->flags, BGP_NODE_FIB_UPDATE_PENDING);
+		return;
+	}
+
+	if (pi->type == ZEBRA_ROUTE_BGP
+	    && (pi->sub_type == BGP_ROUTE_NORMAL
+		|| pi->sub_type == BGP_ROUTE_AGGREGATE
+		|| pi->sub_type == BGP_ROUTE_IMPORTED))
+		bgp_zebra_announce(rn, &rn->p, pi, bgp, afi, SAFI_UNICAST);
+
+	UNSET_FLAG(rn->flags, BGP_NODE_FIB_UPDATE_PENDING);
+
+	/* Nothing was sent that zebra will confirm */
+	if (!CHECK_FLAG(rn->flags, BGP_NODE_FIB_INSTALL_PENDING))
+		bgp_zebra_fib_advertise(bgp, rn, afi, pi);
+}
+
+static void bgp_zebra_fib_download_table(struct bgp *bgp, afi_t afi)
+{
+	struct bgp_table *table = bgp->rib[afi][SAFI_UNICAST];
+	struct bgp_node *rn;
+
+	if (!table)
+		return;
+
+	while ((rn = STAILQ_FIRST(&table->fib_pending))) {
+		STAILQ_REMOVE_HEAD(&table->fib_pending, fibq);
+		bgp_zebra_fib_download_node(bgp, rn, afi);
+		bgp_unlock_node(rn);
+	}
+}
+
+static int bgp_zebra_fib_download(struct thread *thread)
+{
+	struct bgp *bgp = THREAD_ARG(thread);
+
+	bgp_zebra_fib_download_table(bgp, AFI_IP);
+	bgp_zebra_fib_download_table(bgp, AFI_IP6);
+
+	return 0;
+}
+
+/*
+ * Queue the FIB download of a node's best path.  Returns false if the
+ * download is not held back and should be done by the caller.
+ */
+bool bgp_zebra_fib_pending_add(struct bgp_node *rn, struct bgp *bgp,
+			       safi_t safi)
+{
+	struct bgp_table *table;
+
+	if (!bgp_zebra_fib_suppress(bgp, safi))
+		return false;
+
+	if (!CHECK_FLAG(rn->flags, BGP_NODE_FIB_UPDATE_PENDING)) {
+		table = bgp_node_table(rn);
+
+		SET_FLAG(rn->flags, BGP_NODE_FIB_UPDATE_PENDING);
+		bgp_lock_node(rn);
+		STAILQ_INSERT_TAIL(&table->fib_pending, rn, fibq);
+	}
+
+	thread_add_timer_msec(bm->master, bgp_zebra_fib_download, bgp,
+			      bgp->fib_coalesce_time, &bgp->t_fib_download);
+
+	return true;
+}
+
+/*
+ * Stop holding back FIB downloads: send whatever is queued and advertise
+ * every best path that is still waiting for zebra.  With 'discard' the
+ * queues are emptied without sending anything, for instance deletion.
+ */
+void bgp_zebra_fib_pending_flush(struct bgp *bgp, bool discard)
+{
+	struct bgp_table *table;
+	struct bgp_node *rn;
+	struct bgp_path_info *pi;
+	afi_t afi;
+
+	THREAD_OFF(bgp->t_fib_download);
+
+	for (afi = AFI_IP; afi <= AFI_IP6; afi++) {
+		table = bgp->rib[afi][SAFI_UNICAST];
+		if (!table)
+			continue;
+
+		if (!discard)
+			bgp_zebra_fib_download_table(bgp, afi);
+
+		while ((rn = STAILQ_FIRST(&table->fib_pending))) {
+			STAILQ_REMOVE_HEAD(&table->fib_pending, fibq);
+			UNSET_FLAG(rn->flags, BGP_NODE_FIB_UPDATE_PENDING);
+			bgp_unlock_node(rn);
+		}
+
+		if (discard)
+			continue;
+
+		for (rn = bgp_table_top(table); rn; rn = bgp_route_next(rn)) {
+			if (!bgp_fib_pending(rn))
+				continue;
+
+			UNSET_FLAG(rn->flags, BGP_NODE_FIB_INSTALL_PENDING
+						      | BGP_NODE_FIB_INSTALL_FAILED);
+			pi = bgp_zebra_fib_selected(rn);
+			if (pi)
+				bgp_zebra_fib_advertise(bgp, rn, afi, pi);
+		}
+	}
+}
+
+/*
+ * Zebra reports what became of a best path downloaded to it.  If a newer
+ * best path is already queued, the peers wait for that one instead.
+ */
+static void bgp_zebra_fib_notify(struct bgp *bgp, struct bgp_node *rn,
+				 afi_t afi, enum zapi_route_notify_owner note)
+{
+	struct bgp_path_info *pi;
+
+	if (!CHECK_FLAG(rn->flags, BGP_NODE_FIB_INSTALL_PENDING
+					   | BGP_NODE_FIB_INSTALL_FAILED)
+	    || CHECK_FLAG(rn->flags, BGP_NODE_FIB_UPDATE_PENDING))
+		return;
+
+	switch (note) {
+	case ZAPI_ROUTE_INSTALLED:
+		/* Release the route to the peers */
+		UNSET_FLAG(rn->flags, BGP_NODE_FIB_INSTALL_PENDING
+					      | BGP_NODE_FIB_INSTALL_FAILED);
+
+		pi = bgp_zebra_fib_selected(rn);
+		if (pi)
+			bgp_zebra_fib_advertise(bgp, rn, afi, pi);
+		break;
+	case ZAPI_ROUTE_FAIL_INSTALL:
+	case ZAPI_ROUTE_BETTER_ADMIN_WON:
+		/* The router doesn't forward on it, take it back */
+		if (!CHECK_FLAG(rn->flags, BGP_NODE_FIB_INSTALL_PENDING))
+			break;
+
+		UNSET_FLAG(rn->flags, BGP_NODE_FIB_INSTALL_PENDING);
+		SET_FLAG(rn->flags, BGP_NODE_FIB_INSTALL_FAILED);
+
+		bgp_zebra_fib_withdraw(rn);
+		break;
+	case ZAPI_ROUTE_REMOVED:
+	case ZAPI_ROUTE_REMOVE_FAIL:
+		break;
+	}
+}
+
+static int bgp_zebra_route_notify_owner(ZAPI_CALLBACK_ARGS)
+{
+	struct prefix p;
+	uint32_t table_id;
+	enum zapi_route_notify_owner note;
+	struct bgp *bgp;
+	struct bgp_table *table;
+	struct bgp_node *rn;
+	afi_t afi;
+
+	if (!zapi_route_notify_decode(zclient->ibuf, &p, &table_id, &note))
+		return -1;
+
+	bgp = bgp_lookup_by_vrf_id(vrf_id);
+	if (!bgp)
+		return 0;
+
+	afi = family2afi(p.family);
+	if (afi != AFI_IP && afi != AFI_IP6)
+		return 0;
+
+	table = bgp->rib[afi][SAFI_UNICAST];
+	if (!table)
+		return 0;
+
+	rn = bgp_node_lookup(table, &p);
+	if (!rn)
+		return 0;
+
+	if (bgp_debug_zebra(&p)) {
+		char buf[PREFIX_STRLEN];
+
+		zlog_debug("Rx route notify VRF %u %s table %u note %d",
+			   vrf_id, prefix2str(&p, buf, sizeof(buf)), table_id,
+			   note);
+	}
+
+	bgp_zebra_fib_notify(bgp, rn, afi, note);
+
+	bgp_unlock_node(rn);
+	return 0;
 }
 
 struct bgp_redist *bgp_redist_lookup(struct bgp *bgp, afi_t afi, uint8_t type,
@@ -2406,10 +2775,23 @@ static void bgp_encode_pbr_iptable_match(struct stream *s,
 /* BGP has established connection with Zebra. */
 static void bgp_zebra_connected(struct zclient *zclient)
 {
+	struct listnode *node;
 	struct bgp *bgp;
+	bool queued = false;
 
 	zclient_num_connects++; /* increment even if not responding */
 
+	/*
+	 * A restarted zebra waits for the routes again. Instances past their
+	 * initial update ship their tables once more through an eoiu mark,
+	 * which then sends the update complete message.
+	 */
+	update_complete_sent = false;
+	for (ALL_LIST_ELEMENTS_RO(bm->bgp, node, bgp))
+		if (zclient_num_connects > 1
+		    && bgp_zebra_initial_update_done(bgp, &queued))
+			bgp_add_eoiu_mark(bgp);
+
 	/* At this point, we may or may not have BGP instances configured, but
 	 * we're only interested in the default VRF (others wouldn't have learnt
 	 * the VRF from Zebra yet.)
@@ -2704,13 +3086,19 @@ static int bgp_ifp_create(struct interface *ifp)
 
 void bgp_zebra_init(struct thread_master *master, unsigned short instance)
 {
+	/*
+	 * Route notifications release held back routes to the peers, they
+	 * are turned on by bgp_zebra_fib_notify_update() when needed
+	 */
+	struct zclient_options opt = {.receive_notify = false};
+
 	zclient_num_connects = 0;
 
 	if_zapi_callbacks(bgp_ifp_create, bgp_ifp_up,
 			  bgp_ifp_down, bgp_ifp_destroy);
 
 	/* Set default values. */
-	zclient = zclient_new(master, &zclient_options_default);
+	zclient = zclient_new(master, &opt);
 	zclient_init(zclient, ZEBRA_ROUTE_BGP, 0, &bgpd_privs);
 	zclient->zebra_connected = bgp_zebra_connected;
 	zclient->router_id_update = bgp_router_id_update;
@@ -2740,6 +3128,7 @@ void bgp_zebra_init(struct thread_master *master, unsigned short instance)
 	zclient->ipset_notify_owner = ipset_notify_owner;
 	zclient->ipset_entry_notify_owner = ipset_entry_notify_owner;
 	zclient->iptable_notify_owner = iptable_notify_owner;
+	zclient->route_notify_owner = bgp_zebra_route_notify_owner;
 	zclient->instance = instance;
 }
 
@@ -42,6 +42,11 @@ extern void bgp_zebra_announce(struct bgp_node *rn, struct prefix *p,
 extern void bgp_zebra_announce_table(struct bgp *, afi_t, safi_t);
 extern void bgp_zebra_withdraw(struct prefix *p, struct bgp_path_info *path,
 			       struct bgp *bgp, safi_t safi);
+extern bool bgp_zebra_fib_pending_add(struct bgp_node *rn, struct bgp *bgp,
+				      safi_t safi);
+extern void bgp_zebra_fib_pending_flush(struct bgp *bgp, bool discard);
+extern void bgp_zebra_fib_notify_update(void);
+extern void bgp_zebra_update_complete(void);
 
 extern void bgp_zebra_initiate_radv(struct bgp *bgp, struct peer *peer);
 extern void bgp_zebra_terminate_radv(struct bgp *bgp, struct peer *peer);
@@ -3040,6 +3040,7 @@ static struct bgp *bgp_create(as_t *as, const char *name,
 	atomic_store_explicit(&bgp->rpkt_quanta, BGP_READ_PACKET_MAX,
 			      memory_order_relaxed);
 	bgp->coalesce_time = BGP_DEFAULT_SUBGROUP_COALESCE_TIME;
+	bgp->fib_coalesce_time = BGP_DEFAULT_FIB_COALESCE_TIME;
 
 	QOBJ_REG(bgp, bgp);
 
@@ -3307,6 +3308,13 @@ int bgp_delete(struct bgp *bgp)
 	THREAD_OFF(bgp->t_update_delay);
 	THREAD_OFF(bgp->t_establish_wait);
 
+	/* Drop held back FIB downloads, their nodes are about to go */
+	bgp_zebra_fib_pending_flush(bgp, true);
+	if (bgp_flag_check(bgp, BGP_FLAG_SUPPRESS_FIB_PENDING)) {
+		bgp_flag_unset(bgp, BGP_FLAG_SUPPRESS_FIB_PENDING);
+		bgp_zebra_fib_notify_update();
+	}
+
 	/* Set flag indicating bgp instance delete in progress */
 	bgp_flag_set(bgp, BGP_FLAG_DELETE_IN_PROGRESS);
 
@@ -7693,6 +7701,16 @@ int bgp_config_write(struct vty *vty)
 		if (bgp_flag_check(bgp, BGP_FLAG_GRACEFUL_SHUTDOWN))
 			vty_out(vty, " bgp graceful-shutdown\n");
 
+		/* BGP suppress-fib-pending */
+		if (bgp_flag_check(bgp, BGP_FLAG_SUPPRESS_FIB_PENDING)) {
+			vty_out(vty, " bgp suppress-fib-pending");
+			if (bgp->fib_coalesce_time
+			    != BGP_DEFAULT_FIB_COALESCE_TIME)
+				vty_out(vty, " coalesce-time %u",
+					bgp->fib_coalesce_time);
+			vty_out(vty, "\n");
+		}
+
 		/* BGP graceful-restart Preserve State F bit. */
 		if (bgp_flag_check(bgp, BGP_FLAG_GR_PRESERVE_FWD))
 			vty_out(vty,
@@ -283,6 +283,9 @@ struct bgp {
 		uint32_t updgrps_deleted;
 		uint32_t subgrps_created;
 		uint32_t subgrps_deleted;
+		uint32_t snapshot_replays;
+		uint32_t snapshot_walks;
+		uint32_t snapshot_corrections;
 	} update_group_stats;
 
 	/* BGP configuration.  */
@@ -367,6 +370,7 @@ struct bgp {
 #define BGP_FLAG_GR_PRESERVE_FWD          (1 << 20)
 #define BGP_FLAG_GRACEFUL_SHUTDOWN        (1 << 21)
 #define BGP_FLAG_DELETE_IN_PROGRESS       (1 << 22)
+#define BGP_FLAG_SUPPRESS_FIB_PENDING     (1 << 23)
 
 	/* BGP Per AF flags */
 	uint16_t af_flags[AFI_MAX][SAFI_MAX];
@@ -443,6 +447,14 @@ struct bgp {
 	struct thread *t_rmap_def_originate_eval;
 #define RMAP_DEFAULT_ORIGINATE_EVAL_TIMER 5
 
+	/* With suppress-fib-pending, best path changes are held for this
+	 * many msecs and downloaded to zebra together; peers only see a
+	 * route once zebra has confirmed it is installed.
+	 */
+	struct thread *t_fib_download;
+	uint32_t fib_coalesce_time;
+#define BGP_DEFAULT_FIB_COALESCE_TIME 100
+
 	/* BGP distance configuration.  */
 	uint8_t distance_ebgp[AFI_MAX][SAFI_MAX];
 	uint8_t distance_ibgp[AFI_MAX][SAFI_MAX];
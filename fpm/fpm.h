@@ -150,8 +150,68 @@ typedef enum fpm_msg_type_e_ {
 	 */
 	FPM_MSG_TYPE_NETLINK = 1,
 	FPM_MSG_TYPE_PROTOBUF = 2,
+
+	/*
+	 * Synchronization message, see fpm_sync_msg_t below. These are
+	 * only exchanged if zebra has been configured to resume the FPM
+	 * session ("fpm resume").
+	 */
+	FPM_MSG_TYPE_SYNC = 3,
 } fpm_msg_type_e;
 
+#ifdef __SUNPRO_C
+#pragma pack(1)
+#endif
+
+/*
+ * Payload of an FPM_MSG_TYPE_SYNC message, all fields in network byte
+ * order.
+ *
+ * Every route update zebra queues for the FPM is stamped with a
+ * sequence number that increases over the lifetime of the zebra
+ * instance, identified by 'epoch'. Zebra periodically sends a MARK
+ * once everything up to 'seq' has been sent. After reconnecting, an
+ * FPM that kept its state sends a RESUME with the epoch and sequence
+ * number of the last MARK (or END) it has processed, and zebra then
+ * only sends the updates made since. Otherwise, or if the FPM sends no
+ * RESUME, zebra sends a full snapshot, bracketed by BEGIN with a 'seq'
+ * of 0 and END; entries not refreshed in between are stale.
+ */
+typedef struct fpm_sync_msg_t_ {
+	/*
+	 * Version of this message, FPM_SYNC_VERSION.
+	 */
+	uint8_t version;
+
+	/*
+	 * Operation, see FPM_SYNC_OP_*.
+	 */
+	uint8_t op;
+
+	uint16_t reserved;
+
+	uint32_t epoch;
+	uint64_t seq;
+} __attribute__((packed)) fpm_sync_msg_t;
+
+#ifdef __SUNPRO_C
+#pragma pack()
+#endif
+
+#define FPM_SYNC_VERSION 1
+
+/* zebra -> FPM: updates since 'seq' follow, 0 for a full snapshot */
+#define FPM_SYNC_OP_BEGIN 1
+
+/* zebra -> FPM: the snapshot or resumption is complete as of 'seq' */
+#define FPM_SYNC_OP_END 2
+
+/* zebra -> FPM: all updates up to 'seq' have been sent */
+#define FPM_SYNC_OP_MARK 3
+
+/* FPM -> zebra: the FPM holds state as of 'epoch' and 'seq' */
+#define FPM_SYNC_OP_RESUME 4
+
 /*
  * The FPM message header is aligned to the same boundary as netlink
  * messages (4). This means that a netlink message does not need
@@ -160,6 +160,7 @@ enum node_type {
 	OPENFABRIC_NODE,	/* OpenFabric router configuration node */
 	VRRP_NODE,		 /* VRRP node */
 	BMP_NODE,		/* BMP config under router bgp */
+	FPM_NODE,		/* Dataplane FPM node. */
 	NODE_TYPE_MAX, /* maximum */
 };
 
@@ -295,6 +295,26 @@ uint32_t idalloc_reserve(struct id_alloc *alloc, uint32_t id)
 	return id;
 }
 
+/*
+ * Check whether an ID is currently allocated or reserved. Unlike
+ * idalloc_reserve(), this never grows the allocator.
+ */
+bool idalloc_is_allocated(struct id_alloc *alloc, uint32_t id)
+{
+	struct id_alloc_page *page;
+
+	if (id >= alloc->capacity)
+		return false;
+
+	page = find_or_create_page(alloc, id, 0);
+	if (!page)
+		return false;
+
+	return (page->allocated_mask[ID_WORD(id)]
+		& (((uint32_t)1) << ID_OFFSET(id)))
+	       != 0;
+}
+
 /*
  * Set up an empty ID allocator, with IDALLOC_INVALID pre-reserved.
  */
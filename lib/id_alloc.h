@@ -22,6 +22,7 @@
 
 #include <strings.h>
 #include <limits.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -88,6 +89,7 @@ uint32_t idalloc_allocate(struct id_alloc *alloc);
 uint32_t idalloc_allocate_prefer_pool(struct id_alloc *alloc,
 				      struct id_alloc_pool **pool_ptr);
 uint32_t idalloc_reserve(struct id_alloc *alloc, uint32_t id);
+bool idalloc_is_allocated(struct id_alloc *alloc, uint32_t id);
 struct id_alloc *idalloc_new(const char *name);
 void idalloc_destroy(struct id_alloc *alloc);
 
@@ -1093,6 +1093,10 @@ static const struct zebra_desc_table command_types[] = {
 	DESC_ENTRY(ZEBRA_VXLAN_SG_ADD),
 	DESC_ENTRY(ZEBRA_VXLAN_SG_DEL),
 	DESC_ENTRY(ZEBRA_VXLAN_SG_REPLAY),
+	DESC_ENTRY(ZEBRA_ROUTE_BULK),
+	DESC_ENTRY(ZEBRA_ROUTE_NOTIFY_OWNER_BULK),
+	DESC_ENTRY(ZEBRA_ROUTE_UPDATE_COMPLETE),
+	DESC_ENTRY(ZEBRA_ROUTE_NOTIFY_REQUEST),
 };
 #undef DESC_ENTRY
 
@@ -91,6 +91,8 @@ void zclient_free(struct zclient *zclient)
 		stream_free(zclient->ibuf);
 	if (zclient->obuf)
 		stream_free(zclient->obuf);
+	if (zclient->route_bulk)
+		stream_free(zclient->route_bulk);
 	if (zclient->wb)
 		buffer_free(zclient->wb);
 
@@ -156,10 +158,12 @@ void zclient_stop(struct zclient *zclient)
 	THREAD_OFF(zclient->t_read);
 	THREAD_OFF(zclient->t_connect);
 	THREAD_OFF(zclient->t_write);
+	THREAD_OFF(zclient->t_route_bulk);
 
 	/* Reset streams. */
 	stream_reset(zclient->ibuf);
 	stream_reset(zclient->obuf);
+	zclient->route_bulk_count = 0;
 
 	/* Empty the write buffer. */
 	buffer_reset(zclient->wb);
@@ -269,13 +273,12 @@ static int zclient_flush_data(struct thread *thread)
 	return 0;
 }
 
-int zclient_send_message(struct zclient *zclient)
+static int zclient_send_stream(struct zclient *zclient, struct stream *s)
 {
 	if (zclient->sock < 0)
 		return -1;
-	switch (buffer_write(zclient->wb, zclient->sock,
-			     STREAM_DATA(zclient->obuf),
-			     stream_get_endp(zclient->obuf))) {
+	switch (buffer_write(zclient->wb, zclient->sock, STREAM_DATA(s),
+			     stream_get_endp(s))) {
 	case BUFFER_ERROR:
 		flog_err(EC_LIB_ZAPI_SOCKET,
 			 "%s: buffer_write failed to zclient fd %d, closing",
@@ -293,6 +296,15 @@ int zclient_send_message(struct zclient *zclient)
 	return 0;
 }
 
+int zclient_send_message(struct zclient *zclient)
+{
+	/* Keep pending bulk route updates ordered with other messages */
+	if (zclient->route_bulk_count && zclient_route_bulk_flush(zclient) < 0)
+		return -1;
+
+	return zclient_send_stream(zclient, zclient->obuf);
+}
+
 /*
  * If we add more data to this structure please ensure that
  * struct zmsghdr in lib/zclient.h is updated as appropriate.
@@ -405,6 +417,44 @@ void zclient_send_vrf_label(struct zclient *zclient, vrf_id_t vrf_id, afi_t afi,
 	zclient_send_message(zclient);
 }
 
+/*
+ * Tell zebra that all routes have been sent since connecting, in every VRF.
+ * Routes zebra kept in the kernel from a previous run of the daemon, and
+ * which it did not re-send, are removed then rather than when zebra's
+ * graceful restart timer runs out.
+ */
+int zclient_send_route_update_complete(struct zclient *zclient)
+{
+	if (zclient->sock < 0)
+		return -1;
+
+	return zebra_message_send(zclient, ZEBRA_ROUTE_UPDATE_COMPLETE,
+				  VRF_DEFAULT);
+}
+
+/*
+ * Turn the notifications about the routes we own on or off, after the
+ * ZEBRA_HELLO that set them up initially. Remembered for reconnects.
+ */
+int zclient_send_route_notify_request(struct zclient *zclient, bool notify)
+{
+	struct stream *s;
+
+	zclient->receive_notify = notify;
+
+	if (zclient->sock < 0)
+		return -1;
+
+	s = zclient->obuf;
+	stream_reset(s);
+
+	zclient_create_header(s, ZEBRA_ROUTE_NOTIFY_REQUEST, VRF_DEFAULT);
+	stream_putc(s, notify);
+	stream_putw_at(s, 0, stream_get_endp(s));
+
+	return zclient_send_message(zclient);
+}
+
 /* Send register requests to zebra daemon for the information in a VRF. */
 void zclient_send_reg_requests(struct zclient *zclient, vrf_id_t vrf_id)
 {
@@ -859,12 +909,10 @@ static void zapi_nexthop_group_sort(struct zapi_nexthop *nh_grp,
 	      &zapi_nexthop_cmp);
 }
 
+static int zapi_route_encode_tail(struct stream *s, struct zapi_route *api);
+
 int zapi_route_encode(uint8_t cmd, struct stream *s, struct zapi_route *api)
 {
-	struct zapi_nexthop *api_nh;
-	int i;
-	int psize;
-
 	stream_reset(s);
 	zclient_create_header(s, cmd, api->vrf_id);
 
@@ -888,6 +936,25 @@ int zapi_route_encode(uint8_t cmd, struct stream *s, struct zapi_route *api)
 	}
 	stream_putc(s, api->safi);
 
+	if (zapi_route_encode_tail(s, api) < 0)
+		return -1;
+
+	/* Put length at the first point of the stream. */
+	stream_putw_at(s, 0, stream_get_endp(s));
+
+	return 0;
+}
+
+/*
+ * Encode a route from its prefix onwards; shared by single route messages
+ * and the routes of a bulk message.
+ */
+static int zapi_route_encode_tail(struct stream *s, struct zapi_route *api)
+{
+	struct zapi_nexthop *api_nh;
+	int i;
+	int psize;
+
 	/* Put prefix information. */
 	stream_putc(s, api->prefix.family);
 	psize = PSIZE(api->prefix.prefixlen);
@@ -989,17 +1056,13 @@ int zapi_route_encode(uint8_t cmd, struct stream *s, struct zapi_route *api)
 	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_TABLEID))
 		stream_putl(s, api->tableid);
 
-	/* Put length at the first point of the stream. */
-	stream_putw_at(s, 0, stream_get_endp(s));
-
 	return 0;
 }
 
+static int zapi_route_decode_tail(struct stream *s, struct zapi_route *api);
+
 int zapi_route_decode(struct stream *s, struct zapi_route *api)
 {
-	struct zapi_nexthop *api_nh;
-	int i;
-
 	memset(api, 0, sizeof(*api));
 
 	/* Type, flags, message. */
@@ -1022,6 +1085,18 @@ int zapi_route_decode(struct stream *s, struct zapi_route *api)
 		return -1;
 	}
 
+	return zapi_route_decode_tail(s, api);
+
+stream_failure:
+	return -1;
+}
+
+/* Decode a route from its prefix onwards */
+static int zapi_route_decode_tail(struct stream *s, struct zapi_route *api)
+{
+	struct zapi_nexthop *api_nh;
+	int i;
+
 	/* Prefix. */
 	STREAM_GETC(s, api->prefix.family);
 	STREAM_GETC(s, api->prefix.prefixlen);
@@ -1157,6 +1232,171 @@ stream_failure:
 	return -1;
 }
 
+int zapi_route_bulk_decode_header(struct stream *s,
+				  struct zapi_route_bulk *bulk)
+{
+	memset(bulk, 0, sizeof(*bulk));
+
+	STREAM_GETC(s, bulk->type);
+	if (bulk->type >= ZEBRA_ROUTE_MAX) {
+		flog_err(EC_LIB_ZAPI_ENCODE,
+			 "%s: Specified route type: %d is not a legal value",
+			 __func__, bulk->type);
+		return -1;
+	}
+
+	STREAM_GETW(s, bulk->instance);
+	STREAM_GETC(s, bulk->safi);
+	if (bulk->safi < SAFI_UNICAST || bulk->safi >= SAFI_MAX) {
+		flog_err(EC_LIB_ZAPI_ENCODE,
+			 "%s: Specified route SAFI (%u) is not a legal value",
+			 __func__, bulk->safi);
+		return -1;
+	}
+
+	STREAM_GETW(s, bulk->count);
+
+	return 0;
+stream_failure:
+	return -1;
+}
+
+int zapi_route_bulk_decode(struct stream *s,
+			   const struct zapi_route_bulk *bulk, uint16_t *cmd,
+			   struct zapi_route *api)
+{
+	memset(api, 0, sizeof(*api));
+
+	api->type = bulk->type;
+	api->instance = bulk->instance;
+	api->safi = bulk->safi;
+
+	STREAM_GETW(s, *cmd);
+	STREAM_GETL(s, api->flags);
+	STREAM_GETC(s, api->message);
+
+	return zapi_route_decode_tail(s, api);
+
+stream_failure:
+	return -1;
+}
+
+/* Upper bound on the size of a route in a bulk message */
+static size_t zapi_route_bulk_size(const struct zapi_route *api)
+{
+	return 64
+	       + api->nexthop_num
+			 * (27 + MPLS_MAX_LABELS * sizeof(mpls_label_t)
+			    + sizeof(struct ethaddr));
+}
+
+/* Can 'api' join the routes pending in the bulk message 's'? */
+static bool zapi_route_bulk_match(struct stream *s,
+				  const struct zapi_route *api)
+{
+	return stream_getl_from(s, 4) == api->vrf_id
+	       && stream_getc_from(s, ZAPI_ROUTE_BULK_TYPE_OFFSET) == api->type
+	       && stream_getw_from(s, ZAPI_ROUTE_BULK_INSTANCE_OFFSET)
+			  == api->instance
+	       && stream_getc_from(s, ZAPI_ROUTE_BULK_SAFI_OFFSET)
+			  == api->safi
+	       && STREAM_WRITEABLE(s) >= zapi_route_bulk_size(api);
+}
+
+static int zclient_route_bulk_event(struct thread *thread)
+{
+	struct zclient *zclient = THREAD_ARG(thread);
+
+	zclient_route_bulk_flush(zclient);
+
+	return 0;
+}
+
+/*
+ * Queue a route update in a ZEBRA_ROUTE_BULK message rather than sending
+ * it on its own. Updates are sent when the message fills up, when a route
+ * of another VRF, type, instance or SAFI is queued, before any other
+ * message to zebra, and at the latest once the caller's current task
+ * completes.
+ */
+int zclient_route_bulk_send(uint8_t cmd, struct zclient *zclient,
+			    struct zapi_route *api)
+{
+	struct stream *s;
+	size_t start;
+
+	if (api->type >= ZEBRA_ROUTE_MAX) {
+		flog_err(EC_LIB_ZAPI_ENCODE,
+			 "%s: Specified route type (%u) is not a legal value",
+			 __func__, api->type);
+		return -1;
+	}
+	if (api->safi < SAFI_UNICAST || api->safi >= SAFI_MAX) {
+		flog_err(EC_LIB_ZAPI_ENCODE,
+			 "%s: Specified route SAFI (%u) is not a legal value",
+			 __func__, api->safi);
+		return -1;
+	}
+
+	if (!zclient->route_bulk)
+		zclient->route_bulk = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	s = zclient->route_bulk;
+
+	if (zclient->route_bulk_count && !zapi_route_bulk_match(s, api)
+	    && zclient_route_bulk_flush(zclient) < 0)
+		return -1;
+
+	if (zclient->route_bulk_count == 0) {
+		/* Too large for a bulk message: send it on its own */
+		if (STREAM_SIZE(s) - ZAPI_ROUTE_BULK_COUNT_OFFSET - 2
+		    < zapi_route_bulk_size(api))
+			return zclient_route_send(cmd, zclient, api);
+
+		stream_reset(s);
+		zclient_create_header(s, ZEBRA_ROUTE_BULK, api->vrf_id);
+		stream_putc(s, api->type);
+		stream_putw(s, api->instance);
+		stream_putc(s, api->safi);
+		stream_putw(s, 0);
+	}
+
+	start = stream_get_endp(s);
+
+	stream_putw(s, cmd);
+	stream_putl(s, api->flags);
+	stream_putc(s, api->message);
+
+	if (zapi_route_encode_tail(s, api) < 0) {
+		stream_set_endp(s, start);
+		return -1;
+	}
+
+	zclient->route_bulk_count++;
+
+	thread_add_event(zclient->master, zclient_route_bulk_event, zclient, 0,
+			 &zclient->t_route_bulk);
+
+	return 0;
+}
+
+/* Send the route updates pending in a bulk message, if any */
+int zclient_route_bulk_flush(struct zclient *zclient)
+{
+	struct stream *s = zclient->route_bulk;
+
+	THREAD_OFF(zclient->t_route_bulk);
+
+	if (zclient->route_bulk_count == 0)
+		return 0;
+
+	stream_putw_at(s, ZAPI_ROUTE_BULK_COUNT_OFFSET,
+		       zclient->route_bulk_count);
+	stream_putw_at(s, 0, stream_get_endp(s));
+	zclient->route_bulk_count = 0;
+
+	return zclient_send_stream(zclient, s);
+}
+
 static void zapi_encode_prefix(struct stream *s, struct prefix *p,
 			       uint8_t family)
 {
@@ -2721,6 +2961,50 @@ stream_failure:
 	return;
 }
 
+/*
+ * Hand each notification of a ZEBRA_ROUTE_NOTIFY_OWNER_BULK message to the
+ * route_notify_owner callback, as if it had arrived on its own. Each one
+ * is the VRF followed by the body of a ZEBRA_ROUTE_NOTIFY_OWNER message.
+ */
+static void zclient_route_notify_owner_bulk(struct zclient *zclient,
+					    uint16_t length)
+{
+	struct stream *s = zclient->ibuf;
+	struct prefix p = {};
+	uint16_t count, i;
+	vrf_id_t vrf_id;
+	size_t next;
+
+	STREAM_GETW(s, count);
+
+	for (i = 0; i < count; i++) {
+		STREAM_GETL(s, vrf_id);
+
+		/* Locate the next notification, whatever the callback
+		 * consumes of this one.
+		 */
+		if (STREAM_READABLE(s) < sizeof(enum zapi_route_notify_owner) + 2)
+			goto stream_failure;
+
+		next = stream_get_getp(s) + sizeof(enum zapi_route_notify_owner);
+		p.family = stream_getc_from(s, next);
+		next += 2 + prefix_blen(&p) + 4;
+		if (next > stream_get_endp(s))
+			goto stream_failure;
+
+		(*zclient->route_notify_owner)(ZEBRA_ROUTE_NOTIFY_OWNER,
+					       zclient, length, vrf_id);
+
+		stream_set_getp(s, next);
+	}
+
+	return;
+
+stream_failure:
+	flog_err(EC_LIB_ZAPI_MISSMATCH,
+		 "%s: truncated route notification from zebra", __func__);
+}
+
 /* Zebra client message read function. */
 static int zclient_read(struct thread *thread)
 {
@@ -2978,6 +3262,10 @@ static int zclient_read(struct thread *thread)
 			(*zclient->route_notify_owner)(command, zclient, length,
 						       vrf_id);
 		break;
+	case ZEBRA_ROUTE_NOTIFY_OWNER_BULK:
+		if (zclient->route_notify_owner)
+			zclient_route_notify_owner_bulk(zclient, length);
+		break;
 	case ZEBRA_RULE_NOTIFY_OWNER:
 		if (zclient->rule_notify_owner)
 			(*zclient->rule_notify_owner)(command, zclient, length,
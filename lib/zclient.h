@@ -178,6 +178,10 @@ typedef enum {
 	ZEBRA_VXLAN_SG_ADD,
 	ZEBRA_VXLAN_SG_DEL,
 	ZEBRA_VXLAN_SG_REPLAY,
+	ZEBRA_ROUTE_BULK,
+	ZEBRA_ROUTE_NOTIFY_OWNER_BULK,
+	ZEBRA_ROUTE_UPDATE_COMPLETE,
+	ZEBRA_ROUTE_NOTIFY_REQUEST,
 } zebra_message_types_t;
 
 struct redist_proto {
@@ -224,6 +228,13 @@ struct zclient {
 	/* Thread to write buffered data to zebra. */
 	struct thread *t_write;
 
+	/* Route updates pending in a ZEBRA_ROUTE_BULK message, and the
+	 * event that sends them.
+	 */
+	struct stream *route_bulk;
+	uint16_t route_bulk_count;
+	struct thread *t_route_bulk;
+
 	/* Redistribute information. */
 	uint8_t redist_default; /* clients protocol */
 	unsigned short instance;
@@ -393,6 +404,25 @@ struct zapi_route {
 	uint32_t tableid;
 };
 
+/*
+ * Common header of a ZEBRA_ROUTE_BULK message. It is followed by 'count'
+ * routes, each made of the command (ZEBRA_ROUTE_ADD or ZEBRA_ROUTE_DELETE)
+ * and the remainder of its zapi_route encoding; the VRF is the one of the
+ * message.
+ */
+struct zapi_route_bulk {
+	uint8_t type;
+	unsigned short instance;
+	safi_t safi;
+	uint16_t count;
+};
+
+/* Offsets of the common fields from the start of a bulk message */
+#define ZAPI_ROUTE_BULK_TYPE_OFFSET     ZEBRA_HEADER_SIZE
+#define ZAPI_ROUTE_BULK_INSTANCE_OFFSET (ZEBRA_HEADER_SIZE + 1)
+#define ZAPI_ROUTE_BULK_SAFI_OFFSET     (ZEBRA_HEADER_SIZE + 3)
+#define ZAPI_ROUTE_BULK_COUNT_OFFSET    (ZEBRA_HEADER_SIZE + 4)
+
 struct zapi_nexthop_label {
 	enum nexthop_types_t type;
 	int family;
@@ -526,6 +556,9 @@ extern void zclient_send_vrf_label(struct zclient *zclient, vrf_id_t vrf_id,
 				   enum lsp_types_t ltype);
 
 extern void zclient_send_reg_requests(struct zclient *, vrf_id_t);
+extern int zclient_send_route_update_complete(struct zclient *zclient);
+extern int zclient_send_route_notify_request(struct zclient *zclient,
+					     bool notify);
 extern void zclient_send_dereg_requests(struct zclient *, vrf_id_t);
 
 extern void zclient_send_interface_radv_req(struct zclient *zclient,
@@ -654,11 +687,19 @@ extern int zebra_send_pw(struct zclient *zclient, int command,
 extern void zebra_read_pw_status_update(ZAPI_CALLBACK_ARGS, struct zapi_pw_status *pw);
 
 extern int zclient_route_send(uint8_t, struct zclient *, struct zapi_route *);
+extern int zclient_route_bulk_send(uint8_t cmd, struct zclient *zclient,
+				   struct zapi_route *api);
+extern int zclient_route_bulk_flush(struct zclient *zclient);
 extern int zclient_send_rnh(struct zclient *zclient, int command,
 			    struct prefix *p, bool exact_match,
 			    vrf_id_t vrf_id);
 extern int zapi_route_encode(uint8_t, struct stream *, struct zapi_route *);
 extern int zapi_route_decode(struct stream *, struct zapi_route *);
+extern int zapi_route_bulk_decode_header(struct stream *s,
+					 struct zapi_route_bulk *bulk);
+extern int zapi_route_bulk_decode(struct stream *s,
+				  const struct zapi_route_bulk *bulk,
+				  uint16_t *cmd, struct zapi_route *api);
 bool zapi_route_notify_decode(struct stream *s, struct prefix *p,
 			      uint32_t *tableid,
 			      enum zapi_route_notify_owner *note);
@@ -42,6 +42,12 @@ struct sharp_routes {
 
 	struct timeval t_start;
 	struct timeval t_end;
+
+	/* Install times across the runs of the last command */
+	uint32_t install_runs;
+	struct timeval t_install_min;
+	struct timeval t_install_max;
+	struct timeval t_install_total;
 };
 
 struct sharp_global {
@@ -157,6 +157,27 @@ DEFPY (install_routes_data_dump,
 		sg.r.removed_routes,
 		(intmax_t)r.tv_sec, (long)r.tv_usec);
 
+	if (sg.r.install_runs) {
+		uint64_t total_usec, avg_usec;
+
+		total_usec = sg.r.t_install_total.tv_sec * 1000000ULL
+			     + sg.r.t_install_total.tv_usec;
+		avg_usec = total_usec / sg.r.install_runs;
+
+		vty_out(vty,
+			"Installs: %u Time min: %jd.%06ld avg: %" PRIu64
+			".%06" PRIu64 " max: %jd.%06ld\n",
+			sg.r.install_runs, (intmax_t)sg.r.t_install_min.tv_sec,
+			(long)sg.r.t_install_min.tv_usec, avg_usec / 1000000,
+			avg_usec % 1000000,
+			(intmax_t)sg.r.t_install_max.tv_sec,
+			(long)sg.r.t_install_max.tv_usec);
+		if (avg_usec)
+			vty_out(vty, "Install rate: %" PRIu64 " routes/sec\n",
+				(uint64_t)sg.r.total_routes * 1000000
+					/ avg_usec);
+	}
+
 	return CMD_SUCCESS;
 }
 
@@ -188,6 +209,11 @@ DEFPY (install_routes,
 	sg.r.total_routes = routes;
 	sg.r.installed_routes = 0;
 
+	sg.r.install_runs = 0;
+	timerclear(&sg.r.t_install_min);
+	timerclear(&sg.r.t_install_max);
+	timerclear(&sg.r.t_install_total);
+
 	if (rpt >= 2)
 		sg.r.repeat = rpt * 2;
 	else
@@ -176,6 +176,16 @@ static int route_notify_owner(ZAPI_CALLBACK_ARGS)
 			timersub(&sg.r.t_end, &sg.r.t_start, &r);
 			zlog_debug("Installed All Items %jd.%ld",
 				   (intmax_t)r.tv_sec, (long)r.tv_usec);
+
+			if (sg.r.install_runs == 0
+			    || timercmp(&r, &sg.r.t_install_min, <))
+				sg.r.t_install_min = r;
+			if (timercmp(&r, &sg.r.t_install_max, >))
+				sg.r.t_install_max = r;
+			timeradd(&sg.r.t_install_total, &r,
+				 &sg.r.t_install_total);
+			sg.r.install_runs++;
+
 			handle_repeated(true);
 		}
 		break;
@@ -269,7 +279,7 @@ void route_add(struct prefix *p, vrf_id_t vrf_id,
 	}
 	api.nexthop_num = i;
 
-	zclient_route_send(ZEBRA_ROUTE_ADD, zclient, &api);
+	zclient_route_bulk_send(ZEBRA_ROUTE_ADD, zclient, &api);
 }
 
 void route_delete(struct prefix *p, vrf_id_t vrf_id, uint8_t instance)
@@ -282,7 +292,7 @@ void route_delete(struct prefix *p, vrf_id_t vrf_id, uint8_t instance)
 	api.safi = SAFI_UNICAST;
 	api.instance = instance;
 	memcpy(&api.prefix, p, sizeof(*p));
-	zclient_route_send(ZEBRA_ROUTE_DELETE, zclient, &api);
+	zclient_route_bulk_send(ZEBRA_ROUTE_DELETE, zclient, &api);
 
 	return;
 }
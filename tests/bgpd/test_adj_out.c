@@ -0,0 +1,248 @@
+/*
+ * Test of the adj-out keying on (subgroup, addpath ID) and of the
+ * unchanged-path skip used for addpath-tx-all-paths subgroups.
+ *
+ * This file is part of FRRouting
+ *
+ * FRRouting is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * FRRouting is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include "prefix.h"
+#include "table.h"
+#include "bgpd/bgp_updgrp_adv.c"
+
+/* Satisfy link requirements from including bgpd.h */
+struct zebra_privs_t bgpd_privs = {0};
+
+#define PATHS		4
+#define SUBGROUPS	3
+
+static struct bgp *bgp;
+static struct peer addpath_peer, plain_peer;
+static struct update_group addpath_updgrp, plain_updgrp;
+static struct update_subgroup subgrps[SUBGROUPS], plain_subgrp;
+
+static void init_updgrp(struct update_group *updgrp, struct peer *peer)
+{
+	updgrp->bgp = bgp;
+	updgrp->conf = peer;
+	updgrp->afi = AFI_IP;
+	updgrp->safi = SAFI_UNICAST;
+}
+
+static void init_subgrp(struct update_subgroup *subgrp,
+			struct update_group *updgrp)
+{
+	subgrp->update_group = updgrp;
+	TAILQ_INIT(&subgrp->adjq);
+}
+
+static int adj_count(struct bgp_node *rn, struct update_subgroup *subgrp)
+{
+	struct bgp_adj_out *adj;
+	int count = 0;
+
+	for (adj = adj_first(rn, subgrp); adj; adj = adj_next(adj)) {
+		assert(adj->subgroup == subgrp);
+		count++;
+	}
+
+	return count;
+}
+
+/* Every (subgroup, addpath ID) has its own adj-out and is found directly */
+static void test_keying(struct bgp_node *rn)
+{
+	struct bgp_adj_out *adj, *prev;
+	int j, k;
+
+	for (k = 0; k < SUBGROUPS; k++)
+		for (j = 1; j <= PATHS; j++)
+			assert(bgp_adj_out_alloc(&subgrps[k], rn, j));
+
+	for (k = 0; k < SUBGROUPS; k++) {
+		assert(adj_count(rn, &subgrps[k]) == PATHS);
+
+		for (j = 1; j <= PATHS; j++) {
+			adj = adj_lookup(rn, &subgrps[k], j);
+			assert(adj);
+			assert(adj->subgroup == &subgrps[k]);
+			assert(adj->addpath_tx_id == (uint32_t)j);
+		}
+		assert(!adj_lookup(rn, &subgrps[k], PATHS + 1));
+
+		/* a subgroup's entries are walked in addpath ID order */
+		prev = NULL;
+		for (adj = adj_first(rn, &subgrps[k]); adj;
+		     adj = adj_next(adj)) {
+			if (prev)
+				assert(prev->addpath_tx_id
+				       < adj->addpath_tx_id);
+			prev = adj;
+		}
+	}
+
+	/* removing one path leaves the others, and the other subgroups */
+	bgp_adj_out_unset_subgroup(rn, &subgrps[1], 0, 2);
+	assert(!adj_lookup(rn, &subgrps[1], 2));
+	assert(adj_lookup(rn, &subgrps[1], 1));
+	assert(adj_lookup(rn, &subgrps[1], 3));
+	assert(adj_count(rn, &subgrps[1]) == PATHS - 1);
+	assert(adj_count(rn, &subgrps[0]) == PATHS);
+	assert(adj_count(rn, &subgrps[2]) == PATHS);
+
+	for (k = 0; k < SUBGROUPS; k++)
+		for (j = 1; j <= PATHS; j++)
+			bgp_adj_out_unset_subgroup(rn, &subgrps[k], 0, j);
+
+	for (k = 0; k < SUBGROUPS; k++) {
+		assert(!adj_first(rn, &subgrps[k]));
+		assert(TAILQ_EMPTY(&subgrps[k].adjq));
+	}
+	assert(RB_EMPTY(bgp_adj_out_rb, &rn->adj_out));
+
+	printf("Checks successfull\n");
+}
+
+/* Subgroups without addpath keep their single adj-out under ID 0 */
+static void test_plain(struct bgp_node *rn)
+{
+	struct bgp_adj_out *adj;
+
+	adj = bgp_adj_out_alloc(&plain_subgrp, rn, 7);
+	assert(adj->addpath_tx_id == 0);
+	assert(adj_lookup(rn, &plain_subgrp, 0) == adj);
+	assert(adj_lookup(rn, &plain_subgrp, 7) == adj);
+	assert(adj_lookup(rn, &plain_subgrp, 9) == adj);
+	assert(adj_count(rn, &plain_subgrp) == 1);
+
+	bgp_adj_out_unset_subgroup(rn, &plain_subgrp, 0, 9);
+	assert(!adj_first(rn, &plain_subgrp));
+	assert(RB_EMPTY(bgp_adj_out_rb, &rn->adj_out));
+
+	printf("Checks successfull\n");
+}
+
+/* A non-best path is only skipped while it is advertised unchanged */
+static void test_skip(struct bgp_node *rn)
+{
+	struct updwalk_context ctx = {.rn = rn};
+	struct bgp_path_info pi = {0};
+	struct bgp_advertise adv = {0};
+	struct bgp_advertise_attr baa = {0};
+	struct attr attr = {0};
+	struct bgp_adj_out *adj;
+
+	pi.flags = BGP_PATH_VALID;
+	pi.tx_addpath.addpath_tx_id[BGP_ADDPATH_ALL] = 3;
+
+	/* not advertised yet */
+	assert(!subgrp_addpath_path_unchanged(&ctx, &subgrps[0], &pi));
+
+	/* advertised with its current attributes */
+	adj = bgp_adj_out_alloc(&subgrps[0], rn, 3);
+	adj->attr = &attr;
+	assert(subgrp_addpath_path_unchanged(&ctx, &subgrps[0], &pi));
+
+	/* only to this subgroup */
+	assert(!subgrp_addpath_path_unchanged(&ctx, &subgrps[1], &pi));
+
+	/* the path or its nexthop changed */
+	pi.flags |= BGP_PATH_ATTR_CHANGED;
+	assert(!subgrp_addpath_path_unchanged(&ctx, &subgrps[0], &pi));
+	pi.flags = BGP_PATH_VALID | BGP_PATH_IGP_CHANGED;
+	assert(!subgrp_addpath_path_unchanged(&ctx, &subgrps[0], &pi));
+
+	/* the path is no longer eligible */
+	pi.flags = 0;
+	assert(!subgrp_addpath_path_unchanged(&ctx, &subgrps[0], &pi));
+	pi.flags = BGP_PATH_VALID | BGP_PATH_REMOVED;
+	assert(!subgrp_addpath_path_unchanged(&ctx, &subgrps[0], &pi));
+	pi.flags = BGP_PATH_VALID;
+
+	/* "clear ip bgp prefix" forces a re-advertisement */
+	SET_FLAG(rn->flags, BGP_NODE_USER_CLEAR);
+	assert(!subgrp_addpath_path_unchanged(&ctx, &subgrps[0], &pi));
+	UNSET_FLAG(rn->flags, BGP_NODE_USER_CLEAR);
+
+	/* queued for advertisement with this very path */
+	adj->attr = NULL;
+	adj->adv = &adv;
+	adv.baa = &baa;
+	adv.pathi = &pi;
+	assert(subgrp_addpath_path_unchanged(&ctx, &subgrps[0], &pi));
+
+	/* queued with another path, or for withdrawal */
+	adv.pathi = NULL;
+	assert(!subgrp_addpath_path_unchanged(&ctx, &subgrps[0], &pi));
+	adv.pathi = &pi;
+	adv.baa = NULL;
+	assert(!subgrp_addpath_path_unchanged(&ctx, &subgrps[0], &pi));
+	adj->adv = NULL;
+
+	/* only subgroups sending all paths skip */
+	adj->attr = &attr;
+	addpath_peer.addpath_type[AFI_IP][SAFI_UNICAST] =
+		BGP_ADDPATH_BEST_PER_AS;
+	pi.tx_addpath.addpath_tx_id[BGP_ADDPATH_BEST_PER_AS] = 3;
+	assert(!subgrp_addpath_path_unchanged(&ctx, &subgrps[0], &pi));
+	addpath_peer.addpath_type[AFI_IP][SAFI_UNICAST] = BGP_ADDPATH_ALL;
+
+	adj->attr = NULL;
+	bgp_adj_out_unset_subgroup(rn, &subgrps[0], 0, 3);
+	assert(RB_EMPTY(bgp_adj_out_rb, &rn->adj_out));
+
+	printf("Checks successfull\n");
+}
+
+int main(void)
+{
+	struct bgp_table *table;
+	struct bgp_node *rn;
+	struct prefix_ipv4 p;
+	int k;
+
+	bgp = calloc(1, sizeof(*bgp));
+
+	SET_FLAG(addpath_peer.af_cap[AFI_IP][SAFI_UNICAST],
+		 PEER_CAP_ADDPATH_AF_TX_ADV);
+	SET_FLAG(addpath_peer.af_cap[AFI_IP][SAFI_UNICAST],
+		 PEER_CAP_ADDPATH_AF_RX_RCV);
+	addpath_peer.addpath_type[AFI_IP][SAFI_UNICAST] = BGP_ADDPATH_ALL;
+	plain_peer.addpath_type[AFI_IP][SAFI_UNICAST] = BGP_ADDPATH_NONE;
+
+	init_updgrp(&addpath_updgrp, &addpath_peer);
+	init_updgrp(&plain_updgrp, &plain_peer);
+	for (k = 0; k < SUBGROUPS; k++)
+		init_subgrp(&subgrps[k], &addpath_updgrp);
+	init_subgrp(&plain_subgrp, &plain_updgrp);
+
+	table = bgp_table_init(NULL, AFI_IP, SAFI_UNICAST);
+	p.family = AF_INET;
+	p.prefixlen = 24;
+	p.prefix.s_addr = htonl(0x0a000000);
+	rn = bgp_node_get(table, (struct prefix *)&p);
+
+	test_keying(rn);
+	test_plain(rn);
+	test_skip(rn);
+
+	bgp_unlock_node(rn);
+	bgp_table_unlock(table);
+	free(bgp);
+	return 0;
+}
@@ -0,0 +1,8 @@
+import frrtest
+
+class TestAdjOut(frrtest.TestMultiOut):
+    program = './test_adj_out'
+
+TestAdjOut.onesimple('Checks successfull')
+TestAdjOut.onesimple('Checks successfull')
+TestAdjOut.onesimple('Checks successfull')
@@ -27,6 +27,7 @@
 #include "filter.h"
 
 #include "bgpd/bgpd.h"
+#include "bgpd/bgp_community.h"
 #include "bgpd/bgp_ecommunity.h"
 
 /* need these to link in libbgp */
@@ -134,6 +135,189 @@ static void parse_test(struct test_segment *t)
 	ecommunity_unintern(&ecom);
 }
 
+/* rt 65000:N */
+static void rt_val(struct ecommunity_val *eval, uint16_t n)
+{
+	memset(eval, 0, sizeof(*eval));
+	eval->val[0] = ECOMMUNITY_ENCODE_AS;
+	eval->val[1] = ECOMMUNITY_ROUTE_TARGET;
+	eval->val[2] = 0xfd;
+	eval->val[3] = 0xe8;
+	eval->val[6] = n >> 8;
+	eval->val[7] = n & 0xff;
+}
+
+/* interned set of rt 65000:0 .. rt 65000:(2 * (num - 1)), even ones */
+static struct ecommunity *rt_even_set(int num)
+{
+	struct ecommunity *ecom;
+	struct ecommunity_val eval;
+	int i;
+
+	ecom = ecommunity_new();
+	for (i = 0; i < num; i++) {
+		rt_val(&eval, 2 * i);
+		ecommunity_add_val(ecom, &eval);
+	}
+
+	return ecommunity_intern(ecom);
+}
+
+/* membership test against an interned set large enough to be summarised */
+static void match_test(void)
+{
+	struct ecommunity *ecom, *needle;
+	struct ecommunity_val eval;
+	int i, fails = 0;
+
+	printf("match: rt 65000:0 .. rt 65000:62 (even)\n");
+
+	ecom = rt_even_set(32);
+	if (!ecom->bloom) {
+		printf("not summarised\n");
+		fails++;
+	}
+
+	for (i = 0; i < 64; i++) {
+		needle = ecommunity_new();
+		rt_val(&eval, i);
+		ecommunity_add_val(needle, &eval);
+		if (ecommunity_match(ecom, needle) != !(i % 2)) {
+			printf("rt 65000:%d: got %d\n", i,
+			       ecommunity_match(ecom, needle));
+			fails++;
+		}
+		ecommunity_free(&needle);
+	}
+
+	failed += fails;
+	printf("%s\n\n", fails ? "failed" : "OK");
+	ecommunity_unintern(&ecom);
+}
+
+/* every value of the list must be on the set, in the same order */
+static void match_order_test(void)
+{
+	struct ecommunity *ecom, *needle;
+	struct ecommunity_val eval;
+	int fails = 0;
+
+	printf("match-order: rt 65000:2 rt 65000:4 in and out of order\n");
+
+	ecom = rt_even_set(32);
+
+	needle = ecommunity_new();
+	rt_val(&eval, 2);
+	ecommunity_add_val(needle, &eval);
+	rt_val(&eval, 4);
+	ecommunity_add_val(needle, &eval);
+	if (!ecommunity_match(ecom, needle)) {
+		printf("in order: no match\n");
+		fails++;
+	}
+
+	/* swap them, as a parsed attribute may carry them */
+	memcpy(eval.val, needle->val, ECOMMUNITY_SIZE);
+	memcpy(needle->val, needle->val + ECOMMUNITY_SIZE, ECOMMUNITY_SIZE);
+	memcpy(needle->val + ECOMMUNITY_SIZE, eval.val, ECOMMUNITY_SIZE);
+	if (ecommunity_match(ecom, needle)) {
+		printf("out of order: match\n");
+		fails++;
+	}
+
+	/* a value listed twice */
+	memcpy(needle->val, needle->val + ECOMMUNITY_SIZE, ECOMMUNITY_SIZE);
+	if (ecommunity_match(ecom, needle)) {
+		printf("duplicate: match\n");
+		fails++;
+	}
+	ecommunity_free(&needle);
+
+	failed += fails;
+	printf("%s\n\n", fails ? "failed" : "OK");
+	ecommunity_unintern(&ecom);
+}
+
+/* changing an interned set, as bgp_add_routermac_ecom() does */
+static void mutate_test(void)
+{
+	struct ecommunity *ecom, *needle;
+	struct ecommunity_val eval;
+	int fails = 0;
+
+	printf("mutate: add, delete and strip values of an interned set\n");
+
+	ecom = rt_even_set(32);
+	needle = ecommunity_new();
+	rt_val(&eval, 7);
+	ecommunity_add_val(needle, &eval);
+
+	ecommunity_add_val(ecom, &eval);
+	if (!ecommunity_match(ecom, needle)) {
+		printf("added: no match\n");
+		fails++;
+	}
+
+	ecommunity_del_val(ecom, &eval);
+	if (ecommunity_match(ecom, needle)) {
+		printf("deleted: match\n");
+		fails++;
+	}
+
+	/* soo 65000:7 */
+	eval.val[1] = ECOMMUNITY_SITE_ORIGIN;
+	memcpy(needle->val, eval.val, ECOMMUNITY_SIZE);
+	ecommunity_add_val(ecom, &eval);
+	if (!ecommunity_match(ecom, needle)) {
+		printf("added soo: no match\n");
+		fails++;
+	}
+
+	ecommunity_strip(ecom, ECOMMUNITY_ENCODE_AS, ECOMMUNITY_SITE_ORIGIN);
+	if (ecommunity_match(ecom, needle)) {
+		printf("stripped soo: match\n");
+		fails++;
+	}
+	ecommunity_free(&needle);
+
+	if (!ecom->bloom) {
+		printf("summary lost\n");
+		fails++;
+	}
+
+	failed += fails;
+	printf("%s\n\n", fails ? "failed" : "OK");
+	ecommunity_unintern(&ecom);
+}
+
+/* how many absent values the summary of a set lets through */
+static void bloom_test(void)
+{
+	struct ecommunity *ecom;
+	struct ecommunity_val eval;
+	int i, passed = 0, fails = 0;
+
+	printf("bloom: 200 values, 10000 absent ones\n");
+
+	ecom = rt_even_set(200);
+
+	/* with the value itself as the array, the member test only fails
+	 * if the summary rejects it
+	 */
+	for (i = 0; i < 10000; i++) {
+		rt_val(&eval, 2 * i + 1);
+		if (community_bloom_member(ecom->bloom, (uint8_t *)eval.val, 1,
+					   ECOMMUNITY_SIZE, eval.val))
+			passed++;
+	}
+	printf("false positives: %d\n", passed);
+	if (passed > 300)
+		fails++;
+
+	failed += fails;
+	printf("%s\n\n", fails ? "failed" : "OK");
+	ecommunity_unintern(&ecom);
+}
 
 int main(void)
 {
@@ -141,6 +325,10 @@ int main(void)
 	ecommunity_init();
 	while (test_segments[i].name)
 		parse_test(&test_segments[i++]);
+	match_test();
+	match_order_test();
+	mutate_test();
+	bloom_test();
 
 	printf("failures: %d\n", failed);
 	// printf ("aspath count: %ld\n", aspath_count());
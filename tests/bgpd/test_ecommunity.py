@@ -7,3 +7,7 @@ TestEcommunity.okfail('ipaddr')
 TestEcommunity.okfail('ipaddr-so')
 TestEcommunity.okfail('asn')
 TestEcommunity.okfail('asn4')
+TestEcommunity.okfail('match')
+TestEcommunity.okfail('match-order')
+TestEcommunity.okfail('mutate')
+TestEcommunity.okfail('bloom')
@@ -0,0 +1,242 @@
+/*
+ * Test of the coalesced FIB downloads of suppress-fib-pending and of how
+ * the peers are told about a best path once zebra reports what became of
+ * it.
+ *
+ * This file is part of FRRouting
+ *
+ * FRRouting is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * FRRouting is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include "qobj.h"
+#include "vrf.h"
+#include "prefix.h"
+#include "table.h"
+#include "bgpd/bgp_zebra.c"
+#include "bgpd/bgp_network.h"
+
+/* Satisfy link requirements from including bgpd.h */
+struct zebra_privs_t bgpd_privs = {0};
+struct thread_master *master;
+
+static struct bgp *bgp;
+static struct peer peer;
+static struct update_group updgrp;
+static struct update_subgroup subgrp;
+static struct bgp_path_info path;
+
+static int fib_pending_count(struct bgp_table *table)
+{
+	struct bgp_node *rn;
+	int count = 0;
+
+	STAILQ_FOREACH (rn, &table->fib_pending, fibq)
+		count++;
+
+	return count;
+}
+
+/* Make the node look as if its best path was sent to zebra */
+static void fib_sent(struct bgp_node *rn)
+{
+	SET_FLAG(rn->flags, BGP_NODE_FIB_INSTALL_PENDING);
+	bgp_adj_out_alloc(&subgrp, rn, 0);
+	assert(!RB_EMPTY(bgp_adj_out_rb, &rn->adj_out));
+}
+
+/* Changes to a node are queued once, and only for unicast */
+static void test_coalesce(struct bgp_node *rn)
+{
+	struct bgp_table *table = bgp_node_table(rn);
+
+	assert(bgp_zebra_fib_pending_add(rn, bgp, SAFI_UNICAST));
+	assert(bgp_zebra_fib_pending_add(rn, bgp, SAFI_UNICAST));
+	assert(fib_pending_count(table) == 1);
+	assert(CHECK_FLAG(rn->flags, BGP_NODE_FIB_UPDATE_PENDING));
+	assert(bgp_fib_pending(rn));
+	assert(bgp->t_fib_download);
+
+	assert(!bgp_zebra_fib_pending_add(rn, bgp, SAFI_MULTICAST));
+	assert(!bgp_zebra_fib_pending_add(rn, bgp, SAFI_LABELED_UNICAST));
+
+	bgp_flag_unset(bgp, BGP_FLAG_SUPPRESS_FIB_PENDING);
+	assert(!bgp_zebra_fib_pending_add(rn, bgp, SAFI_UNICAST));
+	bgp_flag_set(bgp, BGP_FLAG_SUPPRESS_FIB_PENDING);
+
+	/* without zebra nothing is sent that it would confirm */
+	bgp_zebra_fib_download_table(bgp, AFI_IP);
+	assert(fib_pending_count(table) == 0);
+	assert(!bgp_fib_pending(rn));
+
+	THREAD_OFF(bgp->t_fib_download);
+
+	printf("Checks successfull\n");
+}
+
+/* A route zebra fails to install is withdrawn until one is installed */
+static void test_fail_install(struct bgp_node *rn)
+{
+	struct bgp_table *table = bgp_node_table(rn);
+	enum zapi_route_notify_owner fail[] = {ZAPI_ROUTE_FAIL_INSTALL,
+					       ZAPI_ROUTE_BETTER_ADMIN_WON};
+	unsigned int i;
+
+	for (i = 0; i < array_size(fail); i++) {
+		fib_sent(rn);
+
+		bgp_zebra_fib_notify(bgp, rn, AFI_IP, fail[i]);
+		assert(!CHECK_FLAG(rn->flags, BGP_NODE_FIB_INSTALL_PENDING));
+		assert(CHECK_FLAG(rn->flags, BGP_NODE_FIB_INSTALL_FAILED));
+		assert(bgp_fib_pending(rn));
+		assert(RB_EMPTY(bgp_adj_out_rb, &rn->adj_out));
+		assert(fib_pending_count(table) == 0);
+
+		/* the failure is only acted on once */
+		bgp_zebra_fib_notify(bgp, rn, AFI_IP, fail[i]);
+		assert(CHECK_FLAG(rn->flags, BGP_NODE_FIB_INSTALL_FAILED));
+
+		/* removals of other routes don't release it */
+		bgp_zebra_fib_notify(bgp, rn, AFI_IP, ZAPI_ROUTE_REMOVED);
+		assert(bgp_fib_pending(rn));
+
+		bgp_zebra_fib_notify(bgp, rn, AFI_IP, ZAPI_ROUTE_INSTALLED);
+		assert(!bgp_fib_pending(rn));
+	}
+
+	printf("Checks successfull\n");
+}
+
+/* The peers wait for a newer best path that is already queued */
+static void test_newer_queued(struct bgp_node *rn)
+{
+	struct bgp_table *table = bgp_node_table(rn);
+
+	fib_sent(rn);
+	assert(bgp_zebra_fib_pending_add(rn, bgp, SAFI_UNICAST));
+
+	bgp_zebra_fib_notify(bgp, rn, AFI_IP, ZAPI_ROUTE_FAIL_INSTALL);
+	assert(CHECK_FLAG(rn->flags, BGP_NODE_FIB_INSTALL_PENDING));
+	assert(!CHECK_FLAG(rn->flags, BGP_NODE_FIB_INSTALL_FAILED));
+	assert(!RB_EMPTY(bgp_adj_out_rb, &rn->adj_out));
+
+	bgp_zebra_fib_notify(bgp, rn, AFI_IP, ZAPI_ROUTE_INSTALLED);
+	assert(CHECK_FLAG(rn->flags, BGP_NODE_FIB_INSTALL_PENDING));
+	assert(fib_pending_count(table) == 1);
+
+	bgp_zebra_fib_download_table(bgp, AFI_IP);
+	assert(fib_pending_count(table) == 0);
+	assert(!bgp_fib_pending(rn));
+
+	bgp_adj_out_unset_subgroup(rn, &subgrp, 0, 0);
+	THREAD_OFF(bgp->t_fib_download);
+
+	printf("Checks successfull\n");
+}
+
+/* Turning suppress-fib-pending off releases every held route */
+static void test_flush(struct bgp_node *rn, struct bgp_node *rn2)
+{
+	struct bgp_table *table = bgp_node_table(rn);
+
+	fib_sent(rn);
+	bgp_zebra_fib_notify(bgp, rn, AFI_IP, ZAPI_ROUTE_FAIL_INSTALL);
+	assert(bgp_fib_pending(rn));
+
+	assert(bgp_zebra_fib_pending_add(rn2, bgp, SAFI_UNICAST));
+	assert(fib_pending_count(table) == 1);
+
+	bgp_zebra_fib_pending_flush(bgp, false);
+	assert(fib_pending_count(table) == 0);
+	assert(!bgp_fib_pending(rn));
+	assert(!bgp_fib_pending(rn2));
+	assert(!bgp->t_fib_download);
+
+	/* discarding drops the queue without sending */
+	assert(bgp_zebra_fib_pending_add(rn2, bgp, SAFI_UNICAST));
+	bgp_zebra_fib_pending_flush(bgp, true);
+	assert(fib_pending_count(table) == 0);
+	assert(!CHECK_FLAG(rn2->flags, BGP_NODE_FIB_UPDATE_PENDING));
+
+	printf("Checks successfull\n");
+}
+
+static struct bgp_node *test_node(struct bgp_table *table, uint32_t addr)
+{
+	struct prefix_ipv4 p;
+	struct bgp_node *rn;
+
+	p.family = AF_INET;
+	p.prefixlen = 24;
+	p.prefix.s_addr = htonl(addr);
+	rn = bgp_node_get(table, (struct prefix *)&p);
+	bgp_node_set_bgp_path_info(rn, &path);
+
+	return rn;
+}
+
+int main(void)
+{
+	struct bgp_node *rn, *rn2;
+	afi_t afi;
+
+	qobj_init();
+	master = thread_master_create(NULL);
+	zclient = zclient_new(master, &zclient_options_default);
+	bgp_master_init(master, BGP_SOCKET_SNDBUF_SIZE);
+	vrf_init(NULL, NULL, NULL, NULL, NULL);
+	bgp_option_set(BGP_OPT_NO_LISTEN);
+
+	bgp = XCALLOC(MTYPE_BGP, sizeof(struct bgp));
+	for (afi = AFI_IP; afi <= AFI_IP6; afi++)
+		bgp->rib[afi][SAFI_UNICAST] =
+			bgp_table_init(bgp, afi, SAFI_UNICAST);
+	update_bgp_group_init(bgp);
+	bgp_flag_set(bgp, BGP_FLAG_SUPPRESS_FIB_PENDING);
+	bgp->fib_coalesce_time = 1000;
+
+	peer.addpath_type[AFI_IP][SAFI_UNICAST] = BGP_ADDPATH_NONE;
+	updgrp.bgp = bgp;
+	updgrp.conf = &peer;
+	updgrp.afi = AFI_IP;
+	updgrp.safi = SAFI_UNICAST;
+	subgrp.update_group = &updgrp;
+	TAILQ_INIT(&subgrp.adjq);
+
+	path.type = ZEBRA_ROUTE_BGP;
+	path.sub_type = BGP_ROUTE_NORMAL;
+	path.flags = BGP_PATH_SELECTED | BGP_PATH_VALID;
+
+	rn = test_node(bgp->rib[AFI_IP][SAFI_UNICAST], 0x0a000000);
+	rn2 = test_node(bgp->rib[AFI_IP][SAFI_UNICAST], 0x0a000100);
+
+	test_coalesce(rn);
+	test_fail_install(rn);
+	test_newer_queued(rn);
+	test_flush(rn, rn2);
+
+	bgp_node_set_bgp_path_info(rn, NULL);
+	bgp_node_set_bgp_path_info(rn2, NULL);
+	bgp_unlock_node(rn);
+	bgp_unlock_node(rn2);
+	for (afi = AFI_IP; afi <= AFI_IP6; afi++)
+		bgp_table_unlock(bgp->rib[afi][SAFI_UNICAST]);
+	update_bgp_group_free(bgp);
+	XFREE(MTYPE_BGP, bgp);
+	zclient_free(zclient);
+
+	return 0;
+}
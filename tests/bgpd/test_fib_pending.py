@@ -0,0 +1,9 @@
+import frrtest
+
+class TestFibPending(frrtest.TestMultiOut):
+    program = './test_fib_pending'
+
+TestFibPending.onesimple('Checks successfull')
+TestFibPending.onesimple('Checks successfull')
+TestFibPending.onesimple('Checks successfull')
+TestFibPending.onesimple('Checks successfull')
@@ -192,6 +192,27 @@ int main(int argc, char **argv)
 	}
 	idalloc_destroy(a);
 
+	/* 6. Allocation queries. Querying must track allocations, frees and
+	 * reservations, and must not grow the allocator for IDs beyond it.
+	 */
+	a = idalloc_new("Queries");
+
+	assert(idalloc_is_allocated(a, IDALLOC_INVALID));
+	val = idalloc_allocate(a);
+	assert(idalloc_is_allocated(a, val));
+	assert(!idalloc_is_allocated(a, val + 1));
+	idalloc_free(a, val);
+	assert(!idalloc_is_allocated(a, val));
+
+	assert(!idalloc_is_allocated(a, 3 * IDS_PER_PAGE + 9));
+	assert(a->capacity == IDS_PER_PAGE);
+	assert(idalloc_reserve(a, 3 * IDS_PER_PAGE + 9)
+	       == 3 * IDS_PER_PAGE + 9);
+	assert(idalloc_is_allocated(a, 3 * IDS_PER_PAGE + 9));
+	assert(!idalloc_is_allocated(a, 3 * IDS_PER_PAGE + 8));
+	assert(!idalloc_is_allocated(a, UINT32_MAX));
+	idalloc_destroy(a);
+
 	puts("ID Allocator test successful.\n");
 	return 0;
 }
@@ -0,0 +1,194 @@
+/*
+ * ZEBRA_ROUTE_BULK encode/decode round-trip test.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include "memory.h"
+#include "network.h"
+#include "prefix.h"
+#include "stream.h"
+#include "thread.h"
+#include "zclient.h"
+
+#define ROUTES 64
+
+struct thread_master *master;
+
+/* Route i of a test run: adds with a nexthop, every third one a delete */
+static void test_route(struct zapi_route *api, int i, uint8_t type)
+{
+	struct zapi_nexthop *api_nh;
+
+	memset(api, 0, sizeof(*api));
+	api->type = type;
+	api->instance = 3;
+	api->safi = SAFI_UNICAST;
+	api->vrf_id = VRF_DEFAULT;
+	api->flags = ZEBRA_FLAG_ALLOW_RECURSION;
+
+	api->prefix.family = AF_INET;
+	api->prefix.prefixlen = 24;
+	api->prefix.u.prefix4.s_addr = htonl(0x0a000000 | (i << 8));
+
+	if (i % 3 == 2)
+		return;
+
+	SET_FLAG(api->message, ZAPI_MESSAGE_NEXTHOP);
+	api->nexthop_num = 1;
+	api_nh = &api->nexthops[0];
+	api_nh->type = NEXTHOP_TYPE_IPV4_IFINDEX;
+	api_nh->vrf_id = VRF_DEFAULT;
+	api_nh->gate.ipv4.s_addr = htonl(0xc0a80001 + i);
+	api_nh->ifindex = 1 + i % 4;
+
+	SET_FLAG(api->message, ZAPI_MESSAGE_DISTANCE);
+	api->distance = 20 + i % 2 * 180;
+	SET_FLAG(api->message, ZAPI_MESSAGE_METRIC);
+	api->metric = i;
+}
+
+static uint8_t test_cmd(int i)
+{
+	return i % 3 == 2 ? ZEBRA_ROUTE_DELETE : ZEBRA_ROUTE_ADD;
+}
+
+static void test_route_same(const struct zapi_route *a,
+			    const struct zapi_route *b)
+{
+	assert(a->type == b->type);
+	assert(a->instance == b->instance);
+	assert(a->safi == b->safi);
+	assert(a->flags == b->flags);
+	assert(a->message == b->message);
+	assert(prefix_same(&a->prefix, &b->prefix));
+	assert(a->nexthop_num == b->nexthop_num);
+	if (a->nexthop_num) {
+		assert(a->nexthops[0].type == b->nexthops[0].type);
+		assert(a->nexthops[0].gate.ipv4.s_addr
+		       == b->nexthops[0].gate.ipv4.s_addr);
+		assert(a->nexthops[0].ifindex == b->nexthops[0].ifindex);
+	}
+	assert(a->distance == b->distance);
+	assert(a->metric == b->metric);
+}
+
+/* Read the next message zclient sent and decode its bulk header */
+static void test_read_bulk(int sock, struct stream *s,
+			   struct zapi_route_bulk *bulk)
+{
+	uint16_t size, cmd;
+	uint8_t marker, version;
+	vrf_id_t vrf_id;
+
+	stream_reset(s);
+	assert(zclient_read_header(s, sock, &size, &marker, &version, &vrf_id,
+				   &cmd)
+	       == 0);
+	assert(marker == ZEBRA_HEADER_MARKER);
+	assert(version == ZSERV_VERSION);
+	assert(vrf_id == VRF_DEFAULT);
+	assert(cmd == ZEBRA_ROUTE_BULK);
+	assert(size > 0);
+
+	assert(zapi_route_bulk_decode_header(s, bulk) == 0);
+}
+
+int main(int argc, char **argv)
+{
+	struct zclient *zclient;
+	struct zapi_route_bulk bulk;
+	struct zapi_route api, dec;
+	struct stream *s;
+	uint16_t cmd;
+	int sv[2], i;
+
+	master = thread_master_create(NULL);
+	zclient = zclient_new(master, &zclient_options_default);
+	s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+
+	assert(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+	set_nonblocking(sv[0]);
+	zclient->sock = sv[0];
+
+	/* 1. Many routes sharing a header go out as one message */
+	for (i = 0; i < ROUTES; i++) {
+		test_route(&api, i, ZEBRA_ROUTE_BGP);
+		assert(zclient_route_bulk_send(test_cmd(i), zclient, &api)
+		       == 0);
+	}
+	assert(zclient->route_bulk_count == ROUTES);
+	assert(zclient_route_bulk_flush(zclient) == 0);
+	assert(zclient->route_bulk_count == 0);
+
+	test_read_bulk(sv[1], s, &bulk);
+	assert(bulk.type == ZEBRA_ROUTE_BGP);
+	assert(bulk.instance == 3);
+	assert(bulk.safi == SAFI_UNICAST);
+	assert(bulk.count == ROUTES);
+
+	for (i = 0; i < ROUTES; i++) {
+		test_route(&api, i, ZEBRA_ROUTE_BGP);
+		assert(zapi_route_bulk_decode(s, &bulk, &cmd, &dec) == 0);
+		assert(cmd == test_cmd(i));
+		test_route_same(&api, &dec);
+	}
+	assert(STREAM_READABLE(s) == 0);
+
+	/* 2. A route with another header sends the pending ones first */
+	test_route(&api, 0, ZEBRA_ROUTE_BGP);
+	assert(zclient_route_bulk_send(ZEBRA_ROUTE_ADD, zclient, &api) == 0);
+	test_route(&api, 1, ZEBRA_ROUTE_STATIC);
+	assert(zclient_route_bulk_send(ZEBRA_ROUTE_ADD, zclient, &api) == 0);
+	assert(zclient->route_bulk_count == 1);
+	assert(zclient_route_bulk_flush(zclient) == 0);
+
+	test_read_bulk(sv[1], s, &bulk);
+	assert(bulk.type == ZEBRA_ROUTE_BGP);
+	assert(bulk.count == 1);
+	assert(zapi_route_bulk_decode(s, &bulk, &cmd, &dec) == 0);
+	test_route(&api, 0, ZEBRA_ROUTE_BGP);
+	test_route_same(&api, &dec);
+	assert(STREAM_READABLE(s) == 0);
+
+	test_read_bulk(sv[1], s, &bulk);
+	assert(bulk.type == ZEBRA_ROUTE_STATIC);
+	assert(bulk.count == 1);
+	assert(zapi_route_bulk_decode(s, &bulk, &cmd, &dec) == 0);
+	test_route(&api, 1, ZEBRA_ROUTE_STATIC);
+	test_route_same(&api, &dec);
+	assert(STREAM_READABLE(s) == 0);
+
+	/* 3. A truncated route fails to decode */
+	stream_reset(s);
+	test_route(&api, 0, ZEBRA_ROUTE_BGP);
+	assert(zclient_route_bulk_send(ZEBRA_ROUTE_ADD, zclient, &api) == 0);
+	assert(zclient_route_bulk_flush(zclient) == 0);
+	test_read_bulk(sv[1], s, &bulk);
+	stream_set_endp(s, stream_get_endp(s) - 1);
+	assert(zapi_route_bulk_decode(s, &bulk, &cmd, &dec) < 0);
+
+	close(sv[1]);
+	zclient->sock = -1;
+	close(sv[0]);
+	zclient_free(zclient);
+	stream_free(s);
+	thread_master_free(master);
+
+	puts("ZAPI route bulk test successful.\n");
+	return 0;
+}
@@ -0,0 +1,6 @@
+import frrtest
+
+class TestZapiRouteBulk(frrtest.TestMultiOut):
+    program = './test_zapi_route_bulk'
+
+TestZapiRouteBulk.onesimple('ZAPI route bulk test successful.')
@@ -0,0 +1,191 @@
+#!/usr/bin/env python
+
+#
+# test_bgp_update_group_snapshot.py
+#
+# Permission to use, copy, modify, and/or distribute this software
+# for any purpose with or without fee is hereby granted, provided
+# that the above copyright notice and this permission notice appear
+# in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND NETDEF DISCLAIMS ALL WARRANTIES
+# WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL NETDEF BE LIABLE FOR
+# ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY
+# DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+# WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS
+# ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+# OF THIS SOFTWARE.
+#
+
+"""
+test_bgp_update_group_snapshot.py: Check that peers joining an update
+group are sent the recorded table snapshot while the table changes
+between them.
+
+r1 originates a table and brings its peers r2 to r6, all in one update
+group, up one after the other. Before each peer comes up some of the
+routes are replaced. Every peer but the first must be announced the
+table from the snapshot, corrected by the routes that changed since,
+and end up with r1's current table.
+"""
+
+import os
+import re
+import sys
+import json
+import pytest
+from functools import partial
+
+CWD = os.path.dirname(os.path.realpath(__file__))
+sys.path.append(os.path.join(CWD, '../'))
+
+# pylint: disable=C0413
+from lib import topotest
+from lib.topogen import Topogen, TopoRouter, get_topogen
+from lib.topolog import logger
+from mininet.topo import Topo
+
+PEERS = range(2, 7)
+ROUTES = 400
+CHURN = 10
+
+# Networks r1 currently originates
+table = set(range(ROUTES))
+
+class SnapshotTopo(Topo):
+    "r1 and its peers on one switch"
+
+    def build(self, *_args, **_opts):
+        tgen = get_topogen(self)
+
+        switch = tgen.add_switch('s1')
+        for routern in range(1, 7):
+            tgen.add_router('r{}'.format(routern))
+            switch.add_link(tgen.gears['r{}'.format(routern)])
+
+def setup_module(mod):
+    tgen = Topogen(SnapshotTopo, mod.__name__)
+    tgen.start_topology()
+
+    router_list = tgen.routers()
+
+    for rname, router in router_list.iteritems():
+        router.load_config(
+            TopoRouter.RD_ZEBRA,
+            os.path.join(CWD, '{}/zebra.conf'.format(rname))
+        )
+        router.load_config(
+            TopoRouter.RD_BGP,
+            os.path.join(CWD, '{}/bgpd.conf'.format(rname))
+        )
+
+    tgen.start_router()
+
+def teardown_module(mod):
+    tgen = get_topogen()
+    tgen.stop_topology()
+
+def network(k):
+    return '10.{}.{}.0/24'.format(k // 256, k % 256)
+
+def set_networks(router, add, delete):
+    "Originate and withdraw networks on r1"
+    commands = ['configure terminal', 'router bgp 65001',
+                'address-family ipv4 unicast']
+    commands += ['network {}'.format(network(k)) for k in add]
+    commands += ['no network {}'.format(network(k)) for k in delete]
+    router.vtysh_multicmd('\n'.join(commands))
+
+def received(router):
+    "Networks a peer has from r1"
+    output = json.loads(router.vtysh_cmd('show ip bgp json'))
+    return sorted(p for p in output.get('routes', {})
+                  if p.startswith('10.'))
+
+def expect_table(router):
+    expected = sorted(network(k) for k in table)
+    test_func = partial(received, router)
+    _, result = topotest.run_and_expect(test_func, expected, count=60,
+                                        wait=1)
+    assert result == expected, \
+        '{} has {} routes, r1 announces {}'.format(router.name,
+                                                   len(result),
+                                                   len(expected))
+
+def snapshot_stats(router):
+    "Replays, table walks and corrections of r1's update groups"
+    output = router.vtysh_cmd('show bgp update-groups statistics')
+    stats = {}
+    for name in ('replays', 'walks', 'corrections'):
+        match = re.search(r'Table snapshot {}: (\d+)'.format(name), output)
+        stats[name] = int(match.group(1)) if match else 0
+    return stats
+
+def test_first_peer():
+    "The first peer walks the table"
+    tgen = get_topogen()
+    if tgen.routers_have_failure():
+        pytest.skip(tgen.errors)
+
+    set_networks(tgen.gears['r1'], sorted(table), [])
+    expect_table(tgen.gears['r2'])
+
+def test_peers_join_during_churn():
+    "Later peers are sent the snapshot plus what changed since"
+    tgen = get_topogen()
+    if tgen.routers_have_failure():
+        pytest.skip(tgen.errors)
+
+    r1 = tgen.gears['r1']
+    added = ROUTES
+
+    for peer in PEERS[1:]:
+        delete = sorted(table)[:CHURN]
+        add = range(added, added + CHURN)
+        added += CHURN
+        table.difference_update(delete)
+        table.update(add)
+        set_networks(r1, add, delete)
+
+        # the peers already up have the change, nothing is left queued
+        expect_table(tgen.gears['r2'])
+
+        r1.vtysh_multicmd('\n'.join([
+            'configure terminal', 'router bgp 65001',
+            'no neighbor 192.168.1.{} shutdown'.format(peer)]))
+        expect_table(tgen.gears['r{}'.format(peer)])
+
+    # every peer still has the current table
+    for peer in PEERS:
+        expect_table(tgen.gears['r{}'.format(peer)])
+
+def test_replay_hit_rate():
+    "Changes to the table do not cost the snapshot"
+    tgen = get_topogen()
+    if tgen.routers_have_failure():
+        pytest.skip(tgen.errors)
+
+    stats = snapshot_stats(tgen.gears['r1'])
+    joins = stats['replays'] + stats['walks']
+    hit_rate = float(stats['replays']) / joins if joins else 0.0
+    logger.info('table snapshot: %d replays, %d walks, %d corrections, '
+                'hit rate %.2f', stats['replays'], stats['walks'],
+                stats['corrections'], hit_rate)
+
+    assert stats['replays'] == len(PEERS) - 1, \
+        'snapshot replayed to {} of {} peers (hit rate {:.2f})'.format(
+            stats['replays'], len(PEERS) - 1, hit_rate)
+    assert stats['corrections'] > 0, 'no change was replayed as a delta'
+
+def test_memory_leak():
+    "Run the memory leak test and report results."
+    tgen = get_topogen()
+    if not tgen.is_memleak_enabled():
+        pytest.skip('Memory leak test/report is disabled')
+
+    tgen.report_memory_leaks()
+
+if __name__ == '__main__':
+    args = ["-s"] + sys.argv[1:]
+    sys.exit(pytest.main(args))
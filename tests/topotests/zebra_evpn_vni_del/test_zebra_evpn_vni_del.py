@@ -0,0 +1,166 @@
+#!/usr/bin/env python
+
+#
+# test_zebra_evpn_vni_del.py
+#
+# Permission to use, copy, modify, and/or distribute this software
+# for any purpose with or without fee is hereby granted, provided
+# that the above copyright notice and this permission notice appear
+# in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND NETDEF DISCLAIMS ALL WARRANTIES
+# WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL NETDEF BE LIABLE FOR
+# ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY
+# DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+# WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS
+# ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+# OF THIS SOFTWARE.
+#
+
+"""
+test_zebra_evpn_vni_del.py: Check that zebra frees a VNI that still has
+MACs and neighbors.
+
+r1 has a bridge with a VxLAN interface for VNI 100 and a dummy access
+port. Local MACs are added on the port and neighbors on the bridge, one
+of them with a MAC the bridge never learnt. Deleting the VxLAN interface
+must free the VNI with all its entries, and the VNI must come back with
+the interface.
+"""
+
+import os
+import sys
+import json
+import pytest
+from functools import partial
+
+# Save the Current Working Directory to find configuration files.
+CWD = os.path.dirname(os.path.realpath(__file__))
+sys.path.append(os.path.join(CWD, '../'))
+
+# pylint: disable=C0413
+# Import topogen and topotest helpers
+from lib import topotest
+from lib.topogen import Topogen, TopoRouter, get_topogen
+
+# Required to instantiate the topology builder class.
+from mininet.topo import Topo
+
+MACS = 8
+
+class EvpnVniDelTopo(Topo):
+    "Single router with a VxLAN bridge"
+
+    def build(self, **_opts):
+        "Build function"
+        tgen = get_topogen(self)
+
+        tgen.add_router('r1')
+
+def add_vxlan(router):
+    "Create the VxLAN interface of VNI 100 in the bridge"
+    router.run('ip link add vxlan100 type vxlan id 100 local 10.0.0.1 '
+               'dstport 4789 nolearning')
+    router.run('ip link set vxlan100 master br100')
+    router.run('ip link set vxlan100 up')
+
+def setup_module(mod):
+    "Sets up the pytest environment"
+    tgen = Topogen(EvpnVniDelTopo, mod.__name__)
+    tgen.start_topology()
+
+    router = tgen.gears['r1']
+    router.run('ip link add br100 type bridge')
+    router.run('ip link set br100 up')
+    router.run('ip addr add 192.168.100.1/24 dev br100')
+    router.run('ip link add dum100 type dummy')
+    router.run('ip link set dum100 master br100')
+    router.run('ip link set dum100 up')
+    add_vxlan(router)
+
+    router.load_config(TopoRouter.RD_ZEBRA,
+                       os.path.join(CWD, 'r1/zebra.conf'))
+    router.load_config(TopoRouter.RD_BGP,
+                       os.path.join(CWD, 'r1/bgpd.conf'))
+
+    tgen.start_router()
+
+def teardown_module(_mod):
+    "Teardown the pytest environment"
+    tgen = get_topogen()
+    tgen.stop_topology()
+
+def vni_entries(router):
+    "MACs and neighbors of VNI 100, None if zebra does not know it"
+    output = json.loads(router.vtysh_cmd('show evpn vni json'))
+    if '100' not in output:
+        return None
+
+    return (output['100']['numMacs'], output['100']['numArpNd'])
+
+def learn_entries(router):
+    "Add local MACs and neighbors and wait for zebra to have them"
+    for i in range(1, MACS + 1):
+        router.run('bridge fdb add 00:00:00:00:01:{:02x} dev dum100 '
+                   'master static'.format(i))
+        router.run('ip neigh replace 192.168.100.{0} lladdr '
+                   '00:00:00:00:01:{0:02x} dev br100 nud reachable'.format(
+                       i + 10))
+
+    # a neighbor whose MAC the bridge does not know
+    router.run('ip neigh replace 192.168.100.100 lladdr 00:00:00:00:02:01 '
+               'dev br100 nud reachable')
+
+    def learnt():
+        entries = vni_entries(router)
+        return entries is not None and entries[1] > MACS
+
+    _, result = topotest.run_and_expect(learnt, True, count=30, wait=1)
+    assert result, 'expected {} neighbors on VNI 100, got {}'.format(
+        MACS + 1, vni_entries(router))
+
+def delete_vni(router):
+    "Delete the VxLAN interface and wait for zebra to drop the VNI"
+    router.run('ip link del vxlan100')
+
+    test_func = partial(vni_entries, router)
+    _, result = topotest.run_and_expect(test_func, None, count=30, wait=1)
+    assert result is None, 'VNI 100 still has {}'.format(result)
+
+def test_vni_del():
+    "A VNI with MACs and neighbors is freed with its interface"
+    tgen = get_topogen()
+    if tgen.routers_have_failure():
+        pytest.skip(tgen.errors)
+
+    router = tgen.gears['r1']
+    learn_entries(router)
+    delete_vni(router)
+
+    assert not tgen.routers_have_failure(), tgen.errors
+
+def test_vni_readd():
+    "The VNI comes back with its interface and can be freed again"
+    tgen = get_topogen()
+    if tgen.routers_have_failure():
+        pytest.skip(tgen.errors)
+
+    router = tgen.gears['r1']
+    add_vxlan(router)
+    learn_entries(router)
+    delete_vni(router)
+
+    assert not tgen.routers_have_failure(), tgen.errors
+
+def test_memory_leak():
+    "Run the memory leak test and report results."
+    tgen = get_topogen()
+    if not tgen.is_memleak_enabled():
+        pytest.skip('Memory leak test/report is disabled')
+
+    tgen.report_memory_leaks()
+
+if __name__ == '__main__':
+    args = ["-s"] + sys.argv[1:]
+    sys.exit(pytest.main(args))
@@ -0,0 +1,145 @@
+#!/usr/bin/env python
+
+#
+# test_zebra_if_event.py
+#
+# Permission to use, copy, modify, and/or distribute this software
+# for any purpose with or without fee is hereby granted, provided
+# that the above copyright notice and this permission notice appear
+# in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND NETDEF DISCLAIMS ALL WARRANTIES
+# WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL NETDEF BE LIABLE FOR
+# ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY
+# DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+# WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS
+# ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+# OF THIS SOFTWARE.
+#
+
+"""
+test_zebra_if_event.py: Check that zebra merges bursts of interface
+events from the kernel.
+
+r1 runs with a 1 second interface event window. A burst of MTU changes
+on an interface that stays up must be sent to clients as one update, and
+a burst of address deletes must run one pass over the kernel routes;
+"show zebra" counts both.
+"""
+
+import os
+import re
+import sys
+import time
+import pytest
+
+# Save the Current Working Directory to find configuration files.
+CWD = os.path.dirname(os.path.realpath(__file__))
+sys.path.append(os.path.join(CWD, '../'))
+
+# pylint: disable=C0413
+# Import topogen and topotest helpers
+from lib.topogen import Topogen, TopoRouter, get_topogen
+
+# Required to instantiate the topology builder class.
+from mininet.topo import Topo
+
+BURST = 10
+WINDOW = 1.0
+
+class IfEventTopo(Topo):
+    "Single router with a LAN interface"
+
+    def build(self, **_opts):
+        "Build function"
+        tgen = get_topogen(self)
+
+        tgen.add_router('r1')
+
+        switch = tgen.add_switch('s1')
+        switch.add_link(tgen.gears['r1'])
+
+def setup_module(mod):
+    "Sets up the pytest environment"
+    tgen = Topogen(IfEventTopo, mod.__name__)
+    tgen.start_topology()
+
+    router = tgen.gears['r1']
+    router.load_config(TopoRouter.RD_ZEBRA,
+                       os.path.join(CWD, 'r1/zebra.conf'))
+
+    tgen.start_router()
+
+def teardown_module(_mod):
+    "Teardown the pytest environment"
+    tgen = get_topogen()
+    tgen.stop_topology()
+
+def if_event_counters(router):
+    "Interface event counters from 'show zebra'"
+    output = router.vtysh_cmd('show zebra')
+    match = re.search(r'Interface events: (\d+) updates, (\d+) merged; '
+                      r'(\d+) kernel route passes, (\d+) merged', output)
+    assert match is not None, 'no interface event counters in "show zebra"'
+
+    return [int(count) for count in match.groups()]
+
+def run_burst(router, commands):
+    "Run commands back to back and wait for the window to expire"
+    before = if_event_counters(router)
+    router.run(' && '.join(commands))
+    time.sleep(WINDOW * 2)
+    after = if_event_counters(router)
+
+    return [a - b for a, b in zip(after, before)]
+
+def test_update_burst():
+    "A burst of MTU changes is sent to clients once"
+    tgen = get_topogen()
+    if tgen.routers_have_failure():
+        pytest.skip(tgen.errors)
+
+    router = tgen.gears['r1']
+    commands = ['ip link set dev r1-eth0 mtu {}'.format(1400 + i)
+                for i in range(BURST)]
+    updates, merged, _, _ = run_burst(router, commands)
+
+    assert updates == 1, \
+        'expected 1 interface update, got {}'.format(updates)
+    assert merged >= BURST - 1, \
+        'expected at least {} merged updates, got {}'.format(BURST - 1,
+                                                             merged)
+
+def test_address_delete_burst():
+    "A burst of address deletes runs one kernel route pass"
+    tgen = get_topogen()
+    if tgen.routers_have_failure():
+        pytest.skip(tgen.errors)
+
+    router = tgen.gears['r1']
+    addresses = ['10.0.2.{}/32'.format(i + 1) for i in range(BURST)]
+    router.run(' && '.join(['ip address add {} dev r1-eth0'.format(addr)
+                            for addr in addresses]))
+    time.sleep(WINDOW * 2)
+
+    commands = ['ip address del {} dev r1-eth0'.format(addr)
+                for addr in addresses]
+    _, _, passes, merged = run_burst(router, commands)
+
+    assert passes == 1, \
+        'expected 1 kernel route pass, got {}'.format(passes)
+    assert merged == BURST - 1, \
+        'expected {} merged passes, got {}'.format(BURST - 1, merged)
+
+def test_memory_leak():
+    "Run the memory leak test and report results."
+    tgen = get_topogen()
+    if not tgen.is_memleak_enabled():
+        pytest.skip('Memory leak test/report is disabled')
+
+    tgen.report_memory_leaks()
+
+if __name__ == '__main__':
+    args = ["-s"] + sys.argv[1:]
+    sys.exit(pytest.main(args))
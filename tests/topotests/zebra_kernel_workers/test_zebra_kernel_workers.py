@@ -0,0 +1,160 @@
+#!/usr/bin/env python
+
+#
+# test_zebra_kernel_workers.py
+#
+# Permission to use, copy, modify, and/or distribute this software
+# for any purpose with or without fee is hereby granted, provided
+# that the above copyright notice and this permission notice appear
+# in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND NETDEF DISCLAIMS ALL WARRANTIES
+# WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL NETDEF BE LIABLE FOR
+# ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY
+# DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+# WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS
+# ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+# OF THIS SOFTWARE.
+#
+
+"""
+test_zebra_kernel_workers.py: Check that zebra installs the routes of
+several VRFs from parallel kernel workers.
+
+r1 has four VRFs and runs four kernel route workers. sharpd installs
+routes in every VRF; each VRF's kernel table must get all of them, and
+"show zebra dplane detailed" must show the routes spread over more than
+one worker. Going back to one worker must stop the workers and still
+install routes.
+"""
+
+import os
+import re
+import sys
+import pytest
+from functools import partial
+
+# Save the Current Working Directory to find configuration files.
+CWD = os.path.dirname(os.path.realpath(__file__))
+sys.path.append(os.path.join(CWD, '../'))
+
+# pylint: disable=C0413
+# Import topogen and topotest helpers
+from lib import topotest
+from lib.topogen import Topogen, TopoRouter, get_topogen
+
+# Required to instantiate the topology builder class.
+from mininet.topo import Topo
+
+VRFS = 4
+ROUTES = 200
+
+class KernelWorkersTopo(Topo):
+    "Single router with a few VRFs"
+
+    def build(self, **_opts):
+        "Build function"
+        tgen = get_topogen(self)
+
+        tgen.add_router('r1')
+
+def setup_module(mod):
+    "Sets up the pytest environment"
+    tgen = Topogen(KernelWorkersTopo, mod.__name__)
+    tgen.start_topology()
+
+    router = tgen.gears['r1']
+    for vrf in range(1, VRFS + 1):
+        router.run('ip link add vrf{0} type vrf table {1}'.format(vrf,
+                                                                 1000 + vrf))
+        router.run('ip link set vrf{} up'.format(vrf))
+        router.run('ip link add dum{} type dummy'.format(vrf))
+        router.run('ip link set dum{0} master vrf{0}'.format(vrf))
+        router.run('ip link set dum{} up'.format(vrf))
+
+    router.load_config(TopoRouter.RD_ZEBRA,
+                       os.path.join(CWD, 'r1/zebra.conf'))
+    router.load_config(TopoRouter.RD_SHARP)
+
+    tgen.start_router()
+
+def teardown_module(_mod):
+    "Teardown the pytest environment"
+    tgen = get_topogen()
+    tgen.stop_topology()
+
+def worker_routes(router):
+    "Routes installed by each kernel worker, from 'show zebra dplane'"
+    output = router.vtysh_cmd('show zebra dplane detailed')
+
+    return [int(routes) for routes in
+            re.findall(r'Kernel worker \d+: routes (\d+),', output)]
+
+def kernel_routes(router, vrf, prefix):
+    "Number of sharp routes under a /8 in a VRF's kernel table"
+    output = router.run('ip -4 route show table {} proto 194'.format(
+        1000 + vrf))
+
+    return len([line for line in output.splitlines()
+                if line.startswith('{}.'.format(prefix))])
+
+def install_routes(router, prefix):
+    "Install sharp routes in every VRF and wait for the kernel to have them"
+    for vrf in range(1, VRFS + 1):
+        router.vtysh_cmd('sharp install routes vrf vrf{0} {1}.{0}.0.0 '
+                         'nexthop 10.{0}.0.2 {2}'.format(vrf, prefix,
+                                                          ROUTES))
+
+    for vrf in range(1, VRFS + 1):
+        test_func = partial(kernel_routes, router, vrf, prefix)
+        _, result = topotest.run_and_expect(test_func, ROUTES, count=30,
+                                            wait=1)
+        assert result == ROUTES, \
+            'vrf{}: expected {} kernel routes, got {}'.format(vrf, ROUTES,
+                                                             result)
+
+def test_parallel_install():
+    "Routes of several VRFs are installed by several workers"
+    tgen = get_topogen()
+    if tgen.routers_have_failure():
+        pytest.skip(tgen.errors)
+
+    router = tgen.gears['r1']
+    install_routes(router, 20)
+
+    routes = worker_routes(router)
+    assert len(routes) == VRFS, \
+        'expected {} kernel workers, got {}'.format(VRFS, len(routes))
+    assert sum(routes) >= VRFS * ROUTES, \
+        'expected {} routes from the workers, got {}'.format(VRFS * ROUTES,
+                                                             sum(routes))
+    busy = len([count for count in routes if count > 0])
+    assert busy > 1, 'expected several busy workers, got {}'.format(busy)
+
+def test_single_worker():
+    "Going back to one worker stops the workers"
+    tgen = get_topogen()
+    if tgen.routers_have_failure():
+        pytest.skip(tgen.errors)
+
+    router = tgen.gears['r1']
+    router.vtysh_cmd('configure terminal\nno zebra dplane kernel-workers')
+
+    test_func = lambda: len(worker_routes(router))
+    _, result = topotest.run_and_expect(test_func, 0, count=10, wait=1)
+    assert result == 0, 'expected no kernel workers, got {}'.format(result)
+
+    install_routes(router, 30)
+
+def test_memory_leak():
+    "Run the memory leak test and report results."
+    tgen = get_topogen()
+    if not tgen.is_memleak_enabled():
+        pytest.skip('Memory leak test/report is disabled')
+
+    tgen.report_memory_leaks()
+
+if __name__ == '__main__':
+    args = ["-s"] + sys.argv[1:]
+    sys.exit(pytest.main(args))
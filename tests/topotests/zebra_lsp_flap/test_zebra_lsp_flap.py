@@ -0,0 +1,164 @@
+#!/usr/bin/env python
+
+#
+# test_zebra_lsp_flap.py
+#
+# Permission to use, copy, modify, and/or distribute this software
+# for any purpose with or without fee is hereby granted, provided
+# that the above copyright notice and this permission notice appear
+# in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND NETDEF DISCLAIMS ALL WARRANTIES
+# WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL NETDEF BE LIABLE FOR
+# ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY
+# DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+# WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS
+# ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+# OF THIS SOFTWARE.
+#
+
+"""
+test_zebra_lsp_flap.py: Measure how long zebra takes to reprogram a large
+number of static LSPs when the interface they resolve through flaps.
+
+r1 has TOPOTESTS_LSP_COUNT (default 50000) static LSPs whose nexthop is
+on r1-eth0. Taking the interface down removes them from the kernel and
+bringing it back up installs them again; the time each takes is logged,
+along with the dataplane's LSP batch counters.
+"""
+
+import os
+import sys
+import time
+import tempfile
+import pytest
+
+# Save the Current Working Directory to find configuration files.
+CWD = os.path.dirname(os.path.realpath(__file__))
+sys.path.append(os.path.join(CWD, '../'))
+
+# pylint: disable=C0413
+# Import topogen and topotest helpers
+from lib.topogen import Topogen, TopoRouter, get_topogen
+from lib.topolog import logger
+
+# Required to instantiate the topology builder class.
+from mininet.topo import Topo
+
+LSP_COUNT = int(os.environ.get('TOPOTESTS_LSP_COUNT', '50000'))
+LSP_BASE_LABEL = 16000
+LSP_NEXTHOP = '10.0.1.2'
+LSP_TIMEOUT = 300
+
+class LspFlapTopo(Topo):
+    "Single router with a LAN interface"
+
+    def build(self, **_opts):
+        "Build function"
+        tgen = get_topogen(self)
+
+        tgen.add_router('r1')
+
+        switch = tgen.add_switch('s1')
+        switch.add_link(tgen.gears['r1'])
+
+def build_zebra_conf():
+    "Write the base configuration followed by the static LSPs"
+    conf = tempfile.NamedTemporaryFile(prefix='zebra_lsp_flap_',
+                                       suffix='.conf', delete=False)
+    with open(os.path.join(CWD, 'r1/zebra.conf')) as base:
+        conf.write(base.read())
+
+    for label in range(LSP_BASE_LABEL, LSP_BASE_LABEL + LSP_COUNT):
+        conf.write('mpls lsp {} {} {}\n'.format(label, LSP_NEXTHOP, label))
+
+    conf.close()
+    return conf.name
+
+def setup_module(mod):
+    "Sets up the pytest environment"
+    tgen = Topogen(LspFlapTopo, mod.__name__)
+    tgen.start_topology()
+
+    if not tgen.hasmpls:
+        tgen.set_error('MPLS is not available in the kernel')
+        return
+
+    mod.zebra_conf = build_zebra_conf()
+
+    router = tgen.gears['r1']
+    router.load_config(TopoRouter.RD_ZEBRA, mod.zebra_conf)
+
+    tgen.start_router()
+
+def teardown_module(mod):
+    "Teardown the pytest environment"
+    tgen = get_topogen()
+    tgen.stop_topology()
+
+    if hasattr(mod, 'zebra_conf'):
+        os.unlink(mod.zebra_conf)
+
+def kernel_lsp_count(router):
+    "Number of LSPs programmed in the kernel"
+    output = router.run('ip -M route show | grep -c "^[0-9]"')
+    try:
+        return int(output.strip())
+    except ValueError:
+        return 0
+
+def wait_lsp_count(router, count):
+    "Wait for the kernel to hold 'count' LSPs, returns the time it took"
+    start = time.time()
+    while time.time() - start < LSP_TIMEOUT:
+        if kernel_lsp_count(router) == count:
+            return time.time() - start
+        time.sleep(0.5)
+
+    return None
+
+def test_lsp_install():
+    "Wait for the static LSPs to be installed"
+    tgen = get_topogen()
+    if tgen.routers_have_failure():
+        pytest.skip(tgen.errors)
+
+    router = tgen.gears['r1']
+    elapsed = wait_lsp_count(router, LSP_COUNT)
+    assert elapsed is not None, \
+        'r1 did not install {} LSPs'.format(LSP_COUNT)
+
+def test_lsp_flap():
+    "Flap the interface the LSPs resolve through and time the kernel"
+    tgen = get_topogen()
+    if tgen.routers_have_failure():
+        pytest.skip(tgen.errors)
+
+    router = tgen.gears['r1']
+
+    router.run('ip link set dev r1-eth0 down')
+    elapsed = wait_lsp_count(router, 0)
+    assert elapsed is not None, 'r1 did not remove its LSPs'
+    logger.info('{} LSPs removed in {:.2f} seconds'.format(LSP_COUNT,
+                                                           elapsed))
+
+    router.run('ip link set dev r1-eth0 up')
+    elapsed = wait_lsp_count(router, LSP_COUNT)
+    assert elapsed is not None, 'r1 did not reinstall its LSPs'
+    logger.info('{} LSPs installed in {:.2f} seconds'.format(LSP_COUNT,
+                                                             elapsed))
+
+    logger.info(router.vtysh_cmd('show zebra dplane'))
+
+def test_memory_leak():
+    "Run the memory leak test and report results."
+    tgen = get_topogen()
+    if not tgen.is_memleak_enabled():
+        pytest.skip('Memory leak test/report is disabled')
+
+    tgen.report_memory_leaks()
+
+if __name__ == '__main__':
+    args = ["-s"] + sys.argv[1:]
+    sys.exit(pytest.main(args))
@@ -0,0 +1,195 @@
+#!/usr/bin/env python
+
+#
+# test_zebra_netlink_resync.py
+#
+# Permission to use, copy, modify, and/or distribute this software
+# for any purpose with or without fee is hereby granted, provided
+# that the above copyright notice and this permission notice appear
+# in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND NETDEF DISCLAIMS ALL WARRANTIES
+# WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL NETDEF BE LIABLE FOR
+# ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY
+# DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+# WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS
+# ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+# OF THIS SOFTWARE.
+#
+
+"""
+test_zebra_netlink_resync.py: Check that zebra's kernel routes follow
+the kernel through a burst of route changes that overruns its netlink
+listener.
+
+zebra runs with a small netlink receive buffer. A burst adds routes,
+deletes some, re-adds some of those with another nexthop and adds
+duplicates with NLM_F_APPEND. zebra must resync after the overrun and
+end up with the kernel's routes. Kernel routes that did not change must
+not be re-added by the resync.
+"""
+
+import os
+import sys
+import json
+import time
+import pytest
+from functools import partial
+
+# Save the Current Working Directory to find configuration files.
+CWD = os.path.dirname(os.path.realpath(__file__))
+sys.path.append(os.path.join(CWD, '../'))
+
+# pylint: disable=C0413
+# Import topogen and topotest helpers
+from lib import topotest
+from lib.topogen import Topogen, TopoRouter, get_topogen
+
+# Required to instantiate the topology builder class.
+from mininet.topo import Topo
+
+ROUTES = 4000
+STABLE = 50
+
+class NetlinkResyncTopo(Topo):
+    "Single router"
+
+    def build(self, **_opts):
+        "Build function"
+        tgen = get_topogen(self)
+
+        tgen.add_router('r1')
+
+def setup_module(mod):
+    "Sets up the pytest environment"
+    tgen = Topogen(NetlinkResyncTopo, mod.__name__)
+    tgen.start_topology()
+
+    router = tgen.gears['r1']
+    router.run('ip link add dum0 type dummy')
+    router.run('ip link set dum0 up')
+
+    router.load_config(TopoRouter.RD_ZEBRA,
+                       os.path.join(CWD, 'r1/zebra.conf'), '-s 8192')
+
+    tgen.start_router()
+
+def teardown_module(_mod):
+    "Teardown the pytest environment"
+    tgen = get_topogen()
+    tgen.stop_topology()
+
+def route(i):
+    "Prefix of burst route i"
+    return '172.16.{}.{}/32'.format(i // 256, i % 256)
+
+def expected_routes():
+    "Nexthops the kernel ends up with for the burst routes"
+    expected = {}
+    for i in range(ROUTES):
+        if i % 4 == 0:
+            expected[route(i)] = '10.0.0.3'
+        elif i % 2 == 1:
+            expected[route(i)] = '10.0.0.2'
+    return expected
+
+def zebra_routes(router, prefix):
+    "zebra's kernel routes under a /16, with their first nexthop"
+    output = json.loads(router.vtysh_cmd('show ip route kernel json'))
+
+    routes = {}
+    for dest, entries in output.items():
+        if not dest.startswith(prefix):
+            continue
+        for entry in entries:
+            if entry.get('protocol') == 'kernel':
+                routes[dest] = entry['nexthops'][0].get('ip')
+    return routes
+
+def test_stable_routes():
+    "Routes added before the burst are learnt"
+    tgen = get_topogen()
+    if tgen.routers_have_failure():
+        pytest.skip(tgen.errors)
+
+    router = tgen.gears['r1']
+    for i in range(STABLE):
+        router.run('ip route add 172.17.0.{}/32 via 10.0.0.2 proto static'
+                   .format(i))
+
+    expected = dict(('172.17.0.{}/32'.format(i), '10.0.0.2')
+                    for i in range(STABLE))
+    test_func = partial(zebra_routes, router, '172.17.')
+    _, result = topotest.run_and_expect(test_func, expected, count=30,
+                                        wait=1)
+    assert result == expected, 'stable routes not learnt'
+
+def test_burst_resync():
+    "zebra follows the kernel through an overrun"
+    tgen = get_topogen()
+    if tgen.routers_have_failure():
+        pytest.skip(tgen.errors)
+
+    router = tgen.gears['r1']
+
+    # let the stable routes age so that a re-add would show
+    time.sleep(3)
+
+    commands = []
+    for i in range(ROUTES):
+        commands.append('route add {} via 10.0.0.2 proto static'.format(
+            route(i)))
+    for i in range(0, ROUTES, 2):
+        commands.append('route del {}'.format(route(i)))
+    for i in range(0, ROUTES, 4):
+        commands.append('route add {} via 10.0.0.3 proto static'.format(
+            route(i)))
+    # appended duplicates with another metric, removed again
+    for i in range(1, ROUTES, 8):
+        commands.append('route append {} via 10.0.0.4 proto static '
+                        'metric 5'.format(route(i)))
+    for i in range(1, ROUTES, 8):
+        commands.append('route del {} via 10.0.0.4 metric 5'.format(
+            route(i)))
+
+    router.run('cat > /tmp/r1-burst <<EOF\n{}\nEOF'.format(
+        '\n'.join(commands)))
+    router.run('ip -batch /tmp/r1-burst')
+    router.run('rm -f /tmp/r1-burst')
+
+    expected = expected_routes()
+    test_func = partial(zebra_routes, router, '172.16.')
+    _, result = topotest.run_and_expect(test_func, expected, count=60,
+                                        wait=1)
+    assert result == expected, \
+        'zebra has {} burst routes, the kernel {}'.format(len(result),
+                                                         len(expected))
+
+    log = tgen.net['r1'].getLog('log', 'zebra')
+    assert 'resyncing kernel routes' in log, 'the burst did not overrun'
+
+def test_stable_not_readded():
+    "The resync leaves the unchanged kernel routes alone"
+    tgen = get_topogen()
+    if tgen.routers_have_failure():
+        pytest.skip(tgen.errors)
+
+    router = tgen.gears['r1']
+    output = json.loads(router.vtysh_cmd('show ip route 172.17.0.0/24 '
+                                         'longer-prefixes json'))
+    fresh = [dest for dest, entries in output.items()
+             if entries[0]['uptime'] in ('00:00:00', '00:00:01')]
+    assert not fresh, 'resync re-added {}'.format(', '.join(fresh))
+
+def test_memory_leak():
+    "Run the memory leak test and report results."
+    tgen = get_topogen()
+    if not tgen.is_memleak_enabled():
+        pytest.skip('Memory leak test/report is disabled')
+
+    tgen.report_memory_leaks()
+
+if __name__ == '__main__':
+    args = ["-s"] + sys.argv[1:]
+    sys.exit(pytest.main(args))
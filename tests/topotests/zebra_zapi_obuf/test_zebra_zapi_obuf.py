@@ -0,0 +1,211 @@
+#!/usr/bin/env python
+
+#
+# test_zebra_zapi_obuf.py
+#
+# Permission to use, copy, modify, and/or distribute this software
+# for any purpose with or without fee is hereby granted, provided
+# that the above copyright notice and this permission notice appear
+# in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND NETDEF DISCLAIMS ALL WARRANTIES
+# WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL NETDEF BE LIABLE FOR
+# ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY
+# DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+# WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS
+# ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+# OF THIS SOFTWARE.
+#
+
+"""
+test_zebra_zapi_obuf.py: Check the bounds of zebra's output queue to a
+client that stops reading.
+
+bgpd redistributes kernel routes and is stopped while they change.
+Updates of the same routes are coalesced once the queue passes the
+high watermark, and bgpd ends up with the last version of each route
+once it reads again. A burst of distinct routes that would take the
+queue past the limit closes bgpd's session; bgpd reconnects and is
+sent every route again.
+"""
+
+import os
+import re
+import sys
+import json
+import pytest
+from functools import partial
+
+CWD = os.path.dirname(os.path.realpath(__file__))
+sys.path.append(os.path.join(CWD, '../'))
+
+# pylint: disable=C0413
+from lib import topotest
+from lib.topogen import Topogen, TopoRouter, get_topogen
+
+from mininet.topo import Topo
+
+# Limit from r1/zebra.conf, in bytes
+LIMIT = 1024 * 1024
+
+CHURN_ROUTES = 500
+CHURN_ROUNDS = 40
+BURST_ROUTES = 50000
+
+class ZapiObufTopo(Topo):
+    "Single router"
+
+    def build(self, **_opts):
+        tgen = get_topogen(self)
+
+        tgen.add_router('r1')
+
+def setup_module(mod):
+    tgen = Topogen(ZapiObufTopo, mod.__name__)
+    tgen.start_topology()
+
+    router = tgen.gears['r1']
+    router.run('ip link add dum0 type dummy')
+    router.run('ip link set dum0 up')
+
+    router.load_config(TopoRouter.RD_ZEBRA,
+                       os.path.join(CWD, 'r1/zebra.conf'))
+    router.load_config(TopoRouter.RD_BGP,
+                       os.path.join(CWD, 'r1/bgpd.conf'))
+
+    tgen.start_router()
+
+def teardown_module(_mod):
+    tgen = get_topogen()
+    tgen.stop_topology()
+
+def signal_bgpd(router, sig):
+    router.run('kill -{} $(cat /var/run/frr/bgpd.pid)'.format(sig))
+
+def ip_batch(router, commands):
+    router.run('cat > /tmp/r1-batch <<EOF\n{}\nEOF'.format(
+        '\n'.join(commands)))
+    router.run('ip -batch /tmp/r1-batch')
+    router.run('rm -f /tmp/r1-batch')
+
+def churn_route(i):
+    return '172.16.{}.{}/32'.format(i // 256, i % 256)
+
+def bgp_routes(router, prefix):
+    "bgpd's routes under a /16, with their nexthop"
+    output = json.loads(router.vtysh_cmd('show ip bgp json'))
+    routes = {}
+    for dest, paths in output.get('routes', {}).items():
+        if dest.startswith(prefix):
+            routes[dest] = paths[0]['nexthops'][0]['ip']
+    return routes
+
+def zebra_routes(router, prefix):
+    "zebra's kernel routes under a /16, with their nexthop"
+    output = json.loads(router.vtysh_cmd('show ip route kernel json'))
+    routes = {}
+    for dest, entries in output.items():
+        if dest.startswith(prefix):
+            routes[dest] = entries[0]['nexthops'][0].get('ip')
+    return routes
+
+def bgp_route_count(router, prefix):
+    return len(bgp_routes(router, prefix))
+
+def bgp_client_stats(router):
+    "Output queue statistics of zebra's bgp client"
+    output = router.vtysh_cmd('show zebra client')
+    section = output[output.find('Client: bgp'):]
+    queued = re.search(r'Output queue: (\d+) bytes \(max (\d+)', section)
+    coalesced = re.search(r'(\d+) messages coalesced', section)
+    return (int(queued.group(2)), int(coalesced.group(1)))
+
+def test_coalesce():
+    "Updates of routes still queued for bgpd are coalesced"
+    tgen = get_topogen()
+    if tgen.routers_have_failure():
+        pytest.skip(tgen.errors)
+
+    router = tgen.gears['r1']
+    ip_batch(router, ['route add {} via 10.0.0.2 proto static'.format(
+        churn_route(i)) for i in range(CHURN_ROUTES)])
+
+    expected = dict((churn_route(i), '10.0.0.2')
+                    for i in range(CHURN_ROUTES))
+    test_func = partial(bgp_routes, router, '172.16.')
+    _, result = topotest.run_and_expect(test_func, expected, count=30,
+                                        wait=1)
+    assert result == expected, 'bgpd did not learn the routes'
+
+    signal_bgpd(router, 'STOP')
+
+    commands = []
+    for rnd in range(CHURN_ROUNDS):
+        gateway = '10.0.0.{}'.format(2 + rnd % 2)
+        commands += ['route replace {} via {} proto static'.format(
+            churn_route(i), gateway) for i in range(CHURN_ROUTES)]
+    ip_batch(router, commands)
+
+    # zebra has been notified of every change before bgpd reads again
+    final = '10.0.0.{}'.format(2 + (CHURN_ROUNDS - 1) % 2)
+    expected = dict((churn_route(i), final) for i in range(CHURN_ROUTES))
+    test_func = partial(zebra_routes, router, '172.16.')
+    _, result = topotest.run_and_expect(test_func, expected, count=60,
+                                        wait=1)
+    signal_bgpd(router, 'CONT')
+    assert result == expected, 'zebra did not follow the kernel'
+
+    test_func = partial(bgp_routes, router, '172.16.')
+    _, result = topotest.run_and_expect(test_func, expected, count=60,
+                                        wait=1)
+    assert result == expected, 'bgpd does not have the last updates'
+
+    queued_max, coalesced = bgp_client_stats(router)
+    assert coalesced > 0, 'no update was coalesced'
+    assert queued_max <= LIMIT, \
+        '{} bytes were queued for bgpd'.format(queued_max)
+
+def test_limit():
+    "A client that would have more than the limit queued is closed"
+    tgen = get_topogen()
+    if tgen.routers_have_failure():
+        pytest.skip(tgen.errors)
+
+    router = tgen.gears['r1']
+    signal_bgpd(router, 'STOP')
+
+    ip_batch(router, ['route add 172.17.{}.{}/32 via 10.0.0.2 proto static'
+                      .format(i // 256, i % 256)
+                      for i in range(BURST_ROUTES)])
+
+    def _closed():
+        log = tgen.net['r1'].getLog('log', 'zebra')
+        return "Client 'bgp' is not reading" in log
+
+    _, result = topotest.run_and_expect(_closed, True, count=60, wait=1)
+    signal_bgpd(router, 'CONT')
+    assert result, "zebra did not close bgpd's session"
+
+    # bgpd reconnects and is sent every route again
+    test_func = partial(bgp_route_count, router, '172.17.')
+    _, result = topotest.run_and_expect(test_func, BURST_ROUTES, count=120,
+                                        wait=1)
+    assert result == BURST_ROUTES, \
+        'bgpd has {} of {} routes'.format(result, BURST_ROUTES)
+
+    queued_max, _ = bgp_client_stats(router)
+    assert queued_max <= LIMIT, \
+        '{} bytes were queued for bgpd'.format(queued_max)
+
+def test_memory_leak():
+    "Run the memory leak test and report results."
+    tgen = get_topogen()
+    if not tgen.is_memleak_enabled():
+        pytest.skip('Memory leak test/report is disabled')
+
+    tgen.report_memory_leaks()
+
+if __name__ == '__main__':
+    args = ["-s"] + sys.argv[1:]
+    sys.exit(pytest.main(args))
@@ -0,0 +1,1051 @@
+/*
+ * Zebra dataplane plugin for the Forwarding Plane Manager (FPM) using
+ * netlink.
+ *
+ * This file is part of FRRouting.
+ *
+ * FRRouting is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * FRRouting is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Unlike the zebra_fpm module, which is told about every RIB change through
+ * the rib_update hook, this module is a dataplane provider: it sees the same
+ * contexts as the kernel, after the kernel has been programmed. Nexthop
+ * groups are sent once as RTM_NEWNEXTHOP messages, and routes refer to them
+ * by ID.
+ *
+ * The provider encodes on the dataplane pthread into a single output
+ * buffer; a pthread of its own owns the connection and writes out whatever
+ * has accumulated, so that many messages go out in a single write.
+ *
+ * When the connection comes up, the zebra main pthread replays the
+ * installed nexthop groups and routes to the provider, a chunk at a time.
+ */
+
+#include <zebra.h>
+
+#include "lib/frr_pthread.h"
+#include "lib/libfrr.h"
+#include "lib/network.h"
+#include "lib/command.h"
+#include "lib/memory.h"
+#include "lib/stream.h"
+#include "lib/typesafe.h"
+#include "lib/version.h"
+
+#include "fpm/fpm.h"
+#include "zebra/kernel_netlink.h"
+#include "zebra/rt_netlink.h"
+#include "zebra/zebra_dplane.h"
+#include "zebra/zebra_memory.h"
+#include "zebra/zebra_nhg.h"
+#include "zebra/zebra_router.h"
+#include "zebra/zebra_vrf.h"
+#include "zebra/debug.h"
+
+#define FPM_NL_DEFAULT_PORT 2620
+
+/* Size of the output buffer, the dataplane stops feeding us when full. */
+#define FPM_NL_OBUF_SIZE (NL_PKT_BUF_SIZE * 128)
+
+/* Seconds between connection attempts. */
+#define FPM_NL_RECONNECT_SECS 3
+
+/* Contexts replayed per run of the resync walk, and how many may be
+ * waiting for the dataplane before the walk pauses.
+ */
+#define FPM_NL_RESYNC_CHUNK 1000
+#define FPM_NL_RESYNC_QUEUED_MAX 10000
+#define FPM_NL_RESYNC_PAUSE_MSEC 10
+
+DEFINE_MTYPE_STATIC(ZEBRA, FPM_NL_CTX, "FPM netlink context");
+DEFINE_MTYPE_STATIC(ZEBRA, FPM_NL_NHG, "FPM netlink nexthop group");
+DEFINE_MTYPE_STATIC(ZEBRA, FPM_NL_RESYNC, "FPM netlink resync");
+
+/* Nexthop groups sent on the current session. */
+PREDECL_HASH(fpm_nl_nhg_sent);
+
+struct fpm_nl_nhg {
+	uint32_t id;
+
+	struct fpm_nl_nhg_sent_item item;
+};
+
+static int fpm_nl_nhg_cmp(const struct fpm_nl_nhg *a,
+			  const struct fpm_nl_nhg *b)
+{
+	return numcmp(a->id, b->id);
+}
+
+static uint32_t fpm_nl_nhg_hash(const struct fpm_nl_nhg *nhg)
+{
+	return nhg->id;
+}
+
+DECLARE_HASH(fpm_nl_nhg_sent, struct fpm_nl_nhg, item, fpm_nl_nhg_cmp,
+	     fpm_nl_nhg_hash);
+
+/* State of the resync walk, zebra main pthread only. */
+struct fpm_nl_resync {
+	uint32_t session;
+
+	/* Nexthop group IDs, singletons are replayed before groups. */
+	uint32_t *nhg_ids;
+	uint32_t nhg_count;
+	uint32_t nhg_next;
+	bool nhg_groups;
+
+	/* Table being walked, and the last prefix replayed from it. */
+	struct zebra_router_table table_key;
+	bool table_started;
+	bool table_walking;
+	struct prefix last;
+
+	struct thread *t_resync;
+};
+
+struct fpm_nl_ctx {
+	/* Configuration, zebra main pthread. */
+	union sockunion addr;
+	uint16_t port;
+
+	/* Connection, FPM pthread. */
+	int socket;
+	bool connecting;
+	struct frr_pthread *fthread;
+	struct thread *t_connect;
+	struct thread *t_read;
+	struct thread *t_write;
+	struct thread *t_wakeup;
+
+	_Atomic bool connected;
+	_Atomic uint32_t session;
+
+	/* Encoded messages, written by the dataplane pthread and drained by
+	 * the FPM pthread.
+	 */
+	pthread_mutex_t obuf_mutex;
+	struct stream *obuf;
+	_Atomic bool obuf_full;
+
+	/* Dataplane pthread. */
+	struct zebra_dplane_provider *prov;
+	uint32_t nhg_session;
+	struct fpm_nl_nhg_sent_head nhg_sent;
+
+	/* Replayed contexts, queued by zebra main for the dataplane. */
+	pthread_mutex_t resync_mutex;
+	struct dplane_ctx_q resync_q;
+	_Atomic uint32_t resync_queued;
+	struct fpm_nl_resync resync;
+
+	struct {
+		_Atomic uint32_t connects;
+		_Atomic uint32_t disconnects;
+		_Atomic uint32_t route_msgs;
+		_Atomic uint32_t nhg_msgs;
+		_Atomic uint32_t nhg_routes;
+		_Atomic uint32_t nhg_skipped;
+		_Atomic uint32_t encode_errors;
+		_Atomic uint32_t obuf_full;
+		_Atomic uint32_t resync_ctxs;
+		_Atomic uint64_t write_calls;
+		_Atomic uint64_t bytes_written;
+		_Atomic uint32_t obuf_peak;
+	} counters;
+} *gfnc;
+
+static int fpm_nl_connect(struct thread *t);
+static int fpm_nl_write(struct thread *t);
+static int fpm_nl_resync_cb(struct thread *t);
+
+/*
+ * Connection, FPM pthread
+ */
+
+static void fpm_nl_reconnect(struct fpm_nl_ctx *fnc)
+{
+	if (fnc->socket >= 0) {
+		if (atomic_exchange_explicit(&fnc->connected, false,
+					     memory_order_relaxed))
+			atomic_fetch_add_explicit(&fnc->counters.disconnects,
+						  1, memory_order_relaxed);
+		THREAD_OFF(fnc->t_read);
+		THREAD_OFF(fnc->t_write);
+		close(fnc->socket);
+		fnc->socket = -1;
+	}
+
+	frr_with_mutex(&fnc->obuf_mutex) {
+		stream_reset(fnc->obuf);
+	}
+
+	/* Let the dataplane move on if it was waiting for us. */
+	if (atomic_exchange_explicit(&fnc->obuf_full, false,
+				     memory_order_relaxed))
+		dplane_provider_work_ready();
+
+	thread_add_timer(fnc->fthread->master, fpm_nl_connect, fnc,
+			 FPM_NL_RECONNECT_SECS, &fnc->t_connect);
+}
+
+static int fpm_nl_read(struct thread *t)
+{
+	struct fpm_nl_ctx *fnc = THREAD_ARG(t);
+	uint8_t buf[NL_PKT_BUF_SIZE];
+	ssize_t rv;
+
+	/* Nothing is expected from the FPM, just notice it going away. */
+	rv = read(fnc->socket, buf, sizeof(buf));
+	if (rv == 0 || (rv < 0 && !ERRNO_IO_RETRY(errno))) {
+		zlog_info("%s: connection closed: %s", __func__,
+			  rv == 0 ? "EOF" : safe_strerror(errno));
+		fpm_nl_reconnect(fnc);
+		return 0;
+	}
+
+	thread_add_read(fnc->fthread->master, fpm_nl_read, fnc, fnc->socket,
+			&fnc->t_read);
+	return 0;
+}
+
+static void fpm_nl_connected(struct fpm_nl_ctx *fnc)
+{
+	fnc->connecting = false;
+
+	frr_with_mutex(&fnc->obuf_mutex) {
+		stream_reset(fnc->obuf);
+	}
+
+	atomic_fetch_add_explicit(&fnc->session, 1, memory_order_relaxed);
+	atomic_store_explicit(&fnc->connected, true, memory_order_relaxed);
+	atomic_fetch_add_explicit(&fnc->counters.connects, 1,
+				  memory_order_relaxed);
+
+	zlog_info("%s: connected to the FPM", __func__);
+
+	thread_add_read(fnc->fthread->master, fpm_nl_read, fnc, fnc->socket,
+			&fnc->t_read);
+
+	/* Replay what is installed. */
+	thread_add_event(zrouter.master, fpm_nl_resync_cb, fnc, 0, NULL);
+	dplane_provider_work_ready();
+}
+
+static int fpm_nl_connect(struct thread *t)
+{
+	struct fpm_nl_ctx *fnc = THREAD_ARG(t);
+	union sockunion su = fnc->addr;
+	socklen_t slen;
+	int sock, rv;
+
+	switch (su.sa.sa_family) {
+	case AF_INET:
+		su.sin.sin_port = htons(fnc->port);
+		slen = sizeof(su.sin);
+		break;
+	case AF_INET6:
+		su.sin6.sin6_port = htons(fnc->port);
+		slen = sizeof(su.sin6);
+		break;
+	default:
+		/* Not configured. */
+		return 0;
+	}
+
+	sock = socket(su.sa.sa_family, SOCK_STREAM, 0);
+	if (sock == -1) {
+		zlog_err("%s: fpm socket failed: %s", __func__,
+			 safe_strerror(errno));
+		thread_add_timer(fnc->fthread->master, fpm_nl_connect, fnc,
+				 FPM_NL_RECONNECT_SECS, &fnc->t_connect);
+		return 0;
+	}
+
+	set_nonblocking(sock);
+
+	rv = connect(sock, &su.sa, slen);
+	if (rv == -1 && errno != EINPROGRESS) {
+		zlog_debug("%s: fpm connection failed: %s", __func__,
+			   safe_strerror(errno));
+		close(sock);
+		thread_add_timer(fnc->fthread->master, fpm_nl_connect, fnc,
+				 FPM_NL_RECONNECT_SECS, &fnc->t_connect);
+		return 0;
+	}
+
+	fnc->socket = sock;
+	fnc->connecting = true;
+	thread_add_write(fnc->fthread->master, fpm_nl_write, fnc, sock,
+			 &fnc->t_write);
+	return 0;
+}
+
+static int fpm_nl_write(struct thread *t)
+{
+	struct fpm_nl_ctx *fnc = THREAD_ARG(t);
+	socklen_t len;
+	ssize_t bwritten;
+	size_t readable;
+	int err = 0;
+
+	if (fnc->connecting) {
+		len = sizeof(err);
+		if (getsockopt(fnc->socket, SOL_SOCKET, SO_ERROR, &err, &len)
+			    == -1
+		    || err) {
+			zlog_debug("%s: fpm connection failed: %s", __func__,
+				   safe_strerror(err ? err : errno));
+			fpm_nl_reconnect(fnc);
+			return 0;
+		}
+
+		fpm_nl_connected(fnc);
+		return 0;
+	}
+
+	frr_with_mutex(&fnc->obuf_mutex) {
+		readable = STREAM_READABLE(fnc->obuf);
+		if (readable == 0)
+			break;
+
+		bwritten = write(fnc->socket, stream_pnt(fnc->obuf), readable);
+		atomic_fetch_add_explicit(&fnc->counters.write_calls, 1,
+					  memory_order_relaxed);
+		if (bwritten < 0) {
+			if (ERRNO_IO_RETRY(errno))
+				break;
+			err = errno;
+			break;
+		}
+
+		atomic_fetch_add_explicit(&fnc->counters.bytes_written,
+					  bwritten, memory_order_relaxed);
+		stream_forward_getp(fnc->obuf, bwritten);
+
+		readable = STREAM_READABLE(fnc->obuf);
+		if (readable == 0) {
+			stream_reset(fnc->obuf);
+		} else if (stream_get_getp(fnc->obuf) > FPM_NL_OBUF_SIZE / 2) {
+			/* Make room for the encoder after a partial write. */
+			memmove(STREAM_DATA(fnc->obuf), stream_pnt(fnc->obuf),
+				readable);
+			stream_set_getp(fnc->obuf, 0);
+			stream_set_endp(fnc->obuf, readable);
+		}
+	}
+
+	if (err) {
+		zlog_info("%s: fpm write failed: %s", __func__,
+			  safe_strerror(err));
+		fpm_nl_reconnect(fnc);
+		return 0;
+	}
+
+	if (readable)
+		thread_add_write(fnc->fthread->master, fpm_nl_write, fnc,
+				 fnc->socket, &fnc->t_write);
+
+	if (atomic_exchange_explicit(&fnc->obuf_full, false,
+				     memory_order_relaxed))
+		dplane_provider_work_ready();
+
+	return 0;
+}
+
+/*
+ * Scheduled by the dataplane pthread once it has encoded messages.
+ */
+static int fpm_nl_write_kick(struct thread *t)
+{
+	struct fpm_nl_ctx *fnc = THREAD_ARG(t);
+
+	if (fnc->socket < 0 || fnc->connecting)
+		return 0;
+
+	thread_add_write(fnc->fthread->master, fpm_nl_write, fnc, fnc->socket,
+			 &fnc->t_write);
+	return 0;
+}
+
+/*
+ * Scheduled by the CLI when the FPM address changes.
+ */
+static int fpm_nl_addr_changed(struct thread *t)
+{
+	struct fpm_nl_ctx *fnc = THREAD_ARG(t);
+
+	THREAD_OFF(fnc->t_connect);
+	fpm_nl_reconnect(fnc);
+	return 0;
+}
+
+/*
+ * Encoding, dataplane pthread
+ */
+
+static bool fpm_nl_nhg_is_sent(struct fpm_nl_ctx *fnc, uint32_t id)
+{
+	struct fpm_nl_nhg ref = {.id = id};
+
+	return fpm_nl_nhg_sent_find(&fnc->nhg_sent, &ref) != NULL;
+}
+
+static void fpm_nl_nhg_set_sent(struct fpm_nl_ctx *fnc, uint32_t id,
+				bool sent)
+{
+	struct fpm_nl_nhg ref = {.id = id}, *nhg;
+
+	nhg = fpm_nl_nhg_sent_find(&fnc->nhg_sent, &ref);
+	if (sent && !nhg) {
+		nhg = XCALLOC(MTYPE_FPM_NL_NHG, sizeof(*nhg));
+		nhg->id = id;
+		fpm_nl_nhg_sent_add(&fnc->nhg_sent, nhg);
+	} else if (!sent && nhg) {
+		fpm_nl_nhg_sent_del(&fnc->nhg_sent, nhg);
+		XFREE(MTYPE_FPM_NL_NHG, nhg);
+	}
+}
+
+static void fpm_nl_nhg_sent_clear(struct fpm_nl_ctx *fnc)
+{
+	struct fpm_nl_nhg *nhg;
+
+	while ((nhg = fpm_nl_nhg_sent_pop(&fnc->nhg_sent)))
+		XFREE(MTYPE_FPM_NL_NHG, nhg);
+}
+
+/*
+ * A group can only be referenced once all of its members have been sent.
+ */
+static bool fpm_nl_nhg_members_sent(struct fpm_nl_ctx *fnc,
+				    const struct zebra_dplane_ctx *ctx)
+{
+	const struct nh_grp *grp = dplane_ctx_get_nhe_nh_grp(ctx);
+	uint8_t i;
+
+	for (i = 0; i < dplane_ctx_get_nhe_nh_grp_count(ctx); i++)
+		if (!fpm_nl_nhg_is_sent(fnc, grp[i].id))
+			return false;
+
+	return true;
+}
+
+/*
+ * Encode the update carried by a context into the output buffer, which
+ * must be locked and have room for a full message.
+ */
+static void fpm_nl_encode(struct fpm_nl_ctx *fnc,
+			  struct zebra_dplane_ctx *ctx)
+{
+	fpm_msg_hdr_t *hdr;
+	uint8_t *data;
+	size_t room;
+	ssize_t len = 0;
+	uint32_t nhg_id;
+	bool use_nhg;
+
+	if (dplane_ctx_get_status(ctx) != ZEBRA_DPLANE_REQUEST_SUCCESS)
+		return;
+
+	hdr = (fpm_msg_hdr_t *)(STREAM_DATA(fnc->obuf)
+				+ stream_get_endp(fnc->obuf));
+	data = (uint8_t *)fpm_msg_data(hdr);
+	room = FPM_MAX_MSG_LEN - FPM_MSG_HDR_LEN;
+
+	switch (dplane_ctx_get_op(ctx)) {
+	case DPLANE_OP_ROUTE_INSTALL:
+	case DPLANE_OP_ROUTE_UPDATE:
+		nhg_id = dplane_ctx_get_nhe_id(ctx);
+		use_nhg = nhg_id && fpm_nl_nhg_is_sent(fnc, nhg_id);
+
+		len = netlink_route_multipath_msg_encode(RTM_NEWROUTE, ctx, data,
+							 room, use_nhg);
+		if (len > 0) {
+			atomic_fetch_add_explicit(&fnc->counters.route_msgs, 1,
+						  memory_order_relaxed);
+			if (use_nhg)
+				atomic_fetch_add_explicit(
+					&fnc->counters.nhg_routes, 1,
+					memory_order_relaxed);
+		}
+		break;
+
+	case DPLANE_OP_ROUTE_DELETE:
+		len = netlink_route_multipath_msg_encode(RTM_DELROUTE, ctx, data,
+							 room, false);
+		if (len > 0)
+			atomic_fetch_add_explicit(&fnc->counters.route_msgs, 1,
+						  memory_order_relaxed);
+		break;
+
+	case DPLANE_OP_NH_INSTALL:
+	case DPLANE_OP_NH_UPDATE:
+		if (!fpm_nl_nhg_members_sent(fnc, ctx)) {
+			atomic_fetch_add_explicit(&fnc->counters.nhg_skipped, 1,
+						  memory_order_relaxed);
+			break;
+		}
+
+		len = netlink_nexthop_msg_encode(RTM_NEWNEXTHOP, ctx, data,
+						 room);
+		if (len > 0) {
+			fpm_nl_nhg_set_sent(fnc, dplane_ctx_get_nhe_id(ctx),
+					    true);
+			atomic_fetch_add_explicit(&fnc->counters.nhg_msgs, 1,
+						  memory_order_relaxed);
+		}
+		break;
+
+	case DPLANE_OP_NH_DELETE:
+		if (!fpm_nl_nhg_is_sent(fnc, dplane_ctx_get_nhe_id(ctx)))
+			break;
+
+		len = netlink_nexthop_msg_encode(RTM_DELNEXTHOP, ctx, data,
+						 room);
+		fpm_nl_nhg_set_sent(fnc, dplane_ctx_get_nhe_id(ctx), false);
+		if (len > 0)
+			atomic_fetch_add_explicit(&fnc->counters.nhg_msgs, 1,
+						  memory_order_relaxed);
+		break;
+
+	default:
+		break;
+	}
+
+	if (len < 0) {
+		atomic_fetch_add_explicit(&fnc->counters.encode_errors, 1,
+					  memory_order_relaxed);
+		return;
+	}
+	if (len == 0)
+		return;
+
+	hdr->version = FPM_PROTO_VERSION;
+	hdr->msg_type = FPM_MSG_TYPE_NETLINK;
+	hdr->msg_len = htons(fpm_data_len_to_msg_len(len));
+	stream_forward_endp(fnc->obuf, fpm_data_len_to_msg_len(len));
+}
+
+/*
+ * Returns true if the output buffer has room for another message, and
+ * flags it as full otherwise. Called with the buffer locked.
+ */
+static bool fpm_nl_obuf_room(struct fpm_nl_ctx *fnc)
+{
+	if (STREAM_WRITEABLE(fnc->obuf) >= FPM_MAX_MSG_LEN)
+		return true;
+
+	atomic_store_explicit(&fnc->obuf_full, true, memory_order_relaxed);
+	atomic_fetch_add_explicit(&fnc->counters.obuf_full, 1,
+				  memory_order_relaxed);
+	return false;
+}
+
+static int fpm_nl_process(struct zebra_dplane_provider *prov)
+{
+	struct fpm_nl_ctx *fnc = dplane_provider_get_data(prov);
+	struct zebra_dplane_ctx *ctx;
+	uint32_t session, peak;
+	bool connected, room = true, more = false;
+	size_t endp, before;
+	int counter, limit;
+
+	limit = dplane_provider_get_work_limit(prov);
+	connected = atomic_load_explicit(&fnc->connected, memory_order_relaxed);
+
+	/* Nexthop groups have to be sent again on a new session. */
+	session = atomic_load_explicit(&fnc->session, memory_order_relaxed);
+	if (session != fnc->nhg_session) {
+		fpm_nl_nhg_sent_clear(fnc);
+		fnc->nhg_session = session;
+	}
+
+	pthread_mutex_lock(&fnc->obuf_mutex);
+	before = stream_get_endp(fnc->obuf);
+
+	/*
+	 * Replayed state comes first: the updates still in flight are at
+	 * least as recent.
+	 */
+	for (counter = 0; connected && counter < limit; counter++) {
+		room = fpm_nl_obuf_room(fnc);
+		if (!room)
+			break;
+
+		frr_with_mutex(&fnc->resync_mutex) {
+			ctx = dplane_ctx_dequeue(&fnc->resync_q);
+		}
+		if (!ctx)
+			break;
+
+		atomic_fetch_sub_explicit(&fnc->resync_queued, 1,
+					  memory_order_relaxed);
+		fpm_nl_encode(fnc, ctx);
+		dplane_ctx_fini(&ctx);
+	}
+
+	for (counter = 0; room && counter < limit; counter++) {
+		if (connected) {
+			room = fpm_nl_obuf_room(fnc);
+			if (!room)
+				break;
+		}
+
+		ctx = dplane_provider_dequeue_in_ctx(prov);
+		if (!ctx)
+			break;
+
+		if (connected)
+			fpm_nl_encode(fnc, ctx);
+
+		dplane_provider_enqueue_out_ctx(prov, ctx);
+	}
+	if (counter >= limit)
+		more = true;
+
+	endp = stream_get_endp(fnc->obuf);
+	pthread_mutex_unlock(&fnc->obuf_mutex);
+
+	peak = atomic_load_explicit(&fnc->counters.obuf_peak,
+				    memory_order_relaxed);
+	if (endp > peak)
+		atomic_store_explicit(&fnc->counters.obuf_peak, endp,
+				      memory_order_relaxed);
+
+	/* Write out everything encoded in this run at once. */
+	if (endp > before)
+		thread_add_event(fnc->fthread->master, fpm_nl_write_kick, fnc,
+				 0, &fnc->t_wakeup);
+
+	/*
+	 * Come back for the rest, unless the FPM pthread will tell us once
+	 * the buffer has drained.
+	 */
+	if (more && room)
+		dplane_provider_work_ready();
+
+	return 0;
+}
+
+/*
+ * Resync, zebra main pthread
+ */
+
+static void fpm_nl_resync_queue(struct fpm_nl_ctx *fnc,
+				struct zebra_dplane_ctx *ctx)
+{
+	frr_with_mutex(&fnc->resync_mutex) {
+		dplane_ctx_enqueue_tail(&fnc->resync_q, ctx);
+	}
+	atomic_fetch_add_explicit(&fnc->resync_queued, 1,
+				  memory_order_relaxed);
+	atomic_fetch_add_explicit(&fnc->counters.resync_ctxs, 1,
+				  memory_order_relaxed);
+}
+
+static void fpm_nl_resync_flush(struct fpm_nl_ctx *fnc)
+{
+	struct zebra_dplane_ctx *ctx;
+
+	frr_with_mutex(&fnc->resync_mutex) {
+		while ((ctx = dplane_ctx_dequeue(&fnc->resync_q)))
+			dplane_ctx_fini(&ctx);
+		atomic_store_explicit(&fnc->resync_queued, 0,
+				      memory_order_relaxed);
+	}
+}
+
+static void fpm_nl_resync_reset(struct fpm_nl_resync *rs)
+{
+	XFREE(MTYPE_FPM_NL_RESYNC, rs->nhg_ids);
+	rs->nhg_count = 0;
+	rs->nhg_next = 0;
+	rs->nhg_groups = false;
+	rs->table_started = false;
+	rs->table_walking = false;
+}
+
+static int fpm_nl_resync_nhg_collect(struct hash_bucket *bucket, void *arg)
+{
+	struct fpm_nl_resync *rs = arg;
+	struct nhg_hash_entry *nhe = bucket->data;
+
+	rs->nhg_ids[rs->nhg_count++] = nhe->id;
+	return HASHWALK_CONTINUE;
+}
+
+/*
+ * Replay installed nexthop groups, returns the remaining budget.
+ */
+static int fpm_nl_resync_nhgs(struct fpm_nl_ctx *fnc, int budget)
+{
+	struct fpm_nl_resync *rs = &fnc->resync;
+	struct zebra_dplane_ctx *ctx;
+	struct nhg_hash_entry *nhe;
+	bool group;
+
+	while (budget > 0) {
+		if (rs->nhg_next == rs->nhg_count) {
+			if (rs->nhg_groups)
+				break;
+			rs->nhg_groups = true;
+			rs->nhg_next = 0;
+		}
+
+		nhe = zebra_nhg_lookup_id(rs->nhg_ids[rs->nhg_next++]);
+		if (!nhe || !CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_INSTALLED))
+			continue;
+
+		group = !zebra_nhg_depends_is_empty(nhe)
+			&& !CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_RECURSIVE);
+		if (group != rs->nhg_groups)
+			continue;
+
+		ctx = dplane_ctx_alloc();
+		if (dplane_ctx_nexthop_snapshot(ctx, nhe) == 0)
+			fpm_nl_resync_queue(fnc, ctx);
+		else
+			dplane_ctx_fini(&ctx);
+		budget--;
+	}
+
+	return budget;
+}
+
+/*
+ * Replay installed unicast routes, table by table. Returns true once all
+ * tables have been walked. Source-specific routes are not replayed.
+ */
+static bool fpm_nl_resync_routes(struct fpm_nl_ctx *fnc, int budget)
+{
+	struct fpm_nl_resync *rs = &fnc->resync;
+	struct zebra_router_table *zrt;
+	struct zebra_dplane_ctx *ctx;
+	struct route_node *rn;
+	struct route_entry *re;
+	rib_dest_t *dest;
+
+	if (!rs->table_started) {
+		zrt = RB_MIN(zebra_router_table_head, &zrouter.tables);
+		rs->table_started = true;
+	} else
+		zrt = RB_NFIND(zebra_router_table_head, &zrouter.tables,
+			       &rs->table_key);
+
+	for (; zrt; zrt = RB_NEXT(zebra_router_table_head, zrt)) {
+		if (zrt->safi != SAFI_UNICAST)
+			continue;
+
+		/* The table we were walking may have gone away. */
+		if (rs->table_walking
+		    && (zrt->tableid != rs->table_key.tableid
+			|| zrt->afi != rs->table_key.afi
+			|| zrt->ns_id != rs->table_key.ns_id))
+			rs->table_walking = false;
+
+		rs->table_key = *zrt;
+
+		if (rs->table_walking)
+			rn = route_table_get_next(zrt->table, &rs->last);
+		else
+			rn = route_top(zrt->table);
+
+		for (; rn; rn = route_next(rn)) {
+			dest = rib_dest_from_rnode(rn);
+			re = dest ? dest->selected_fib : NULL;
+			if (!re
+			    || !CHECK_FLAG(re->status, ROUTE_ENTRY_INSTALLED))
+				continue;
+
+			ctx = dplane_ctx_alloc();
+			if (dplane_ctx_route_snapshot(ctx, rn, re) == 0)
+				fpm_nl_resync_queue(fnc, ctx);
+			else
+				dplane_ctx_fini(&ctx);
+
+			if (--budget == 0) {
+				prefix_copy(&rs->last, &rn->p);
+				rs->table_walking = true;
+				route_unlock_node(rn);
+				return false;
+			}
+		}
+
+		rs->table_walking = false;
+	}
+
+	return true;
+}
+
+static int fpm_nl_resync_cb(struct thread *t)
+{
+	struct fpm_nl_ctx *fnc = THREAD_ARG(t);
+	struct fpm_nl_resync *rs = &fnc->resync;
+	uint32_t session;
+	int budget;
+
+	if (!atomic_load_explicit(&fnc->connected, memory_order_relaxed))
+		return 0;
+
+	/* A new session starts the walk over. */
+	session = atomic_load_explicit(&fnc->session, memory_order_relaxed);
+	if (session != rs->session) {
+		THREAD_OFF(rs->t_resync);
+		fpm_nl_resync_flush(fnc);
+		fpm_nl_resync_reset(rs);
+		rs->session = session;
+
+		rs->nhg_ids = XCALLOC(MTYPE_FPM_NL_RESYNC,
+				      (zrouter.nhgs_id->count + 1)
+					      * sizeof(uint32_t));
+		hash_walk(zrouter.nhgs_id, fpm_nl_resync_nhg_collect, rs);
+	} else if (!rs->nhg_ids)
+		return 0;
+
+	/* Let the dataplane catch up. */
+	if (atomic_load_explicit(&fnc->resync_queued, memory_order_relaxed)
+	    > FPM_NL_RESYNC_QUEUED_MAX) {
+		thread_add_timer_msec(zrouter.master, fpm_nl_resync_cb, fnc,
+				      FPM_NL_RESYNC_PAUSE_MSEC, &rs->t_resync);
+		return 0;
+	}
+
+	budget = fpm_nl_resync_nhgs(fnc, FPM_NL_RESYNC_CHUNK);
+	if (budget == 0 || !fpm_nl_resync_routes(fnc, budget)) {
+		thread_add_event(zrouter.master, fpm_nl_resync_cb, fnc, 0,
+				 &rs->t_resync);
+		dplane_provider_work_ready();
+		return 0;
+	}
+
+	if (IS_ZEBRA_DEBUG_DPLANE)
+		zlog_debug("%s: replayed %u nexthop groups and routes",
+			   __func__,
+			   atomic_load_explicit(&fnc->counters.resync_ctxs,
+						memory_order_relaxed));
+
+	/* Done, until the next session. */
+	fpm_nl_resync_reset(rs);
+	dplane_provider_work_ready();
+	return 0;
+}
+
+/*
+ * CLI
+ */
+
+DEFUN(fpm_set_address, fpm_set_address_cmd,
+      "fpm address <A.B.C.D|X:X::X:X> [port (1-65535)]",
+      "Forwarding Path Manager configuration\n"
+      "FPM remote listening server address\n"
+      "Remote IPv4 FPM server\n"
+      "Remote IPv6 FPM server\n"
+      "FPM remote listening server port\n"
+      "Remote FPM server port\n")
+{
+	union sockunion su;
+	uint16_t port = FPM_NL_DEFAULT_PORT;
+
+	if (str2sockunion(argv[2]->arg, &su) < 0) {
+		vty_out(vty, "%% Invalid address %s\n", argv[2]->arg);
+		return CMD_WARNING_CONFIG_FAILED;
+	}
+
+	if (argc > 4)
+		port = strtoul(argv[4]->arg, NULL, 10);
+
+	gfnc->addr = su;
+	gfnc->port = port;
+
+	/* Reconnect to the new address. */
+	thread_add_event(gfnc->fthread->master, fpm_nl_addr_changed, gfnc, 0,
+			 NULL);
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(no_fpm_set_address, no_fpm_set_address_cmd,
+      "no fpm address [<A.B.C.D|X:X::X:X> [port (1-65535)]]",
+      NO_STR
+      "Forwarding Path Manager configuration\n"
+      "FPM remote listening server address\n"
+      "Remote IPv4 FPM server\n"
+      "Remote IPv6 FPM server\n"
+      "FPM remote listening server port\n"
+      "Remote FPM server port\n")
+{
+	memset(&gfnc->addr, 0, sizeof(gfnc->addr));
+
+	/* Disconnect. */
+	thread_add_event(gfnc->fthread->master, fpm_nl_addr_changed, gfnc, 0,
+			 NULL);
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(show_fpm_counters, show_fpm_counters_cmd,
+      "show fpm counters",
+      SHOW_STR
+      "Forwarding Path Manager information\n"
+      "FPM statistic counters\n")
+{
+#define SHOW_COUNTER(label, counter)                                           \
+	vty_out(vty, "%28s: %" PRIu64 "\n", (label),                           \
+		(uint64_t)atomic_load_explicit(&gfnc->counters.counter,        \
+					       memory_order_relaxed))
+
+	vty_out(vty, "%28s: %s\n", "Connection",
+		atomic_load_explicit(&gfnc->connected, memory_order_relaxed)
+			? "up"
+			: "down");
+	SHOW_COUNTER("Connects", connects);
+	SHOW_COUNTER("Disconnects", disconnects);
+	SHOW_COUNTER("Route messages", route_msgs);
+	SHOW_COUNTER("Routes using nexthop groups", nhg_routes);
+	SHOW_COUNTER("Nexthop group messages", nhg_msgs);
+	SHOW_COUNTER("Nexthop groups skipped", nhg_skipped);
+	SHOW_COUNTER("Encoding errors", encode_errors);
+	SHOW_COUNTER("Replayed updates", resync_ctxs);
+	SHOW_COUNTER("Write calls", write_calls);
+	SHOW_COUNTER("Bytes written", bytes_written);
+	SHOW_COUNTER("Output buffer full", obuf_full);
+	SHOW_COUNTER("Output buffer peak bytes", obuf_peak);
+
+#undef SHOW_COUNTER
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(clear_fpm_counters, clear_fpm_counters_cmd,
+      "clear fpm counters",
+      CLEAR_STR
+      "Forwarding Path Manager information\n"
+      "FPM statistic counters\n")
+{
+	memset(&gfnc->counters, 0, sizeof(gfnc->counters));
+	return CMD_SUCCESS;
+}
+
+static int fpm_write_config(struct vty *vty)
+{
+	char addrstr[INET6_ADDRSTRLEN];
+
+	if (gfnc->addr.sa.sa_family != AF_INET
+	    && gfnc->addr.sa.sa_family != AF_INET6)
+		return 0;
+
+	sockunion2str(&gfnc->addr, addrstr, sizeof(addrstr));
+
+	if (gfnc->port != FPM_NL_DEFAULT_PORT)
+		vty_out(vty, "fpm address %s port %u\n", addrstr, gfnc->port);
+	else
+		vty_out(vty, "fpm address %s\n", addrstr);
+
+	return 1;
+}
+
+static struct cmd_node fpm_node = {FPM_NODE, "", 1};
+
+/*
+ * Provider callbacks
+ */
+
+static int fpm_nl_start(struct zebra_dplane_provider *prov)
+{
+	struct fpm_nl_ctx *fnc = dplane_provider_get_data(prov);
+
+	fnc->prov = prov;
+	frr_pthread_run(fnc->fthread, NULL);
+
+	if (fnc->addr.sa.sa_family == AF_INET
+	    || fnc->addr.sa.sa_family == AF_INET6)
+		thread_add_event(fnc->fthread->master, fpm_nl_connect, fnc, 0,
+				 &fnc->t_connect);
+
+	return 0;
+}
+
+static int fpm_nl_finish(struct zebra_dplane_provider *prov, bool early)
+{
+	struct fpm_nl_ctx *fnc = dplane_provider_get_data(prov);
+
+	if (early)
+		return 0;
+
+	frr_pthread_stop(fnc->fthread, NULL);
+	frr_pthread_destroy(fnc->fthread);
+	fnc->fthread = NULL;
+
+	if (fnc->socket >= 0)
+		close(fnc->socket);
+
+	fpm_nl_resync_flush(fnc);
+	fpm_nl_resync_reset(&fnc->resync);
+	fpm_nl_nhg_sent_clear(fnc);
+	fpm_nl_nhg_sent_fini(&fnc->nhg_sent);
+	stream_free(fnc->obuf);
+	pthread_mutex_destroy(&fnc->obuf_mutex);
+	pthread_mutex_destroy(&fnc->resync_mutex);
+	XFREE(MTYPE_FPM_NL_CTX, gfnc);
+
+	return 0;
+}
+
+static int fpm_nl_new(struct thread_master *tm)
+{
+	struct frr_pthread_attr pattr = {
+		.start = frr_pthread_attr_default.start,
+		.stop = frr_pthread_attr_default.stop,
+	};
+	int rv;
+
+	gfnc = XCALLOC(MTYPE_FPM_NL_CTX, sizeof(*gfnc));
+	gfnc->socket = -1;
+	gfnc->obuf = stream_new(FPM_NL_OBUF_SIZE);
+	pthread_mutex_init(&gfnc->obuf_mutex, NULL);
+	pthread_mutex_init(&gfnc->resync_mutex, NULL);
+	TAILQ_INIT(&gfnc->resync_q);
+	fpm_nl_nhg_sent_init(&gfnc->nhg_sent);
+
+	gfnc->fthread = frr_pthread_new(&pattr, "Zebra FPM netlink",
+					"zebra_fpm_nl");
+
+	rv = dplane_provider_register("dplane_fpm_nl", DPLANE_PRIO_POSTPROCESS,
+				      DPLANE_PROV_FLAGS_DEFAULT, fpm_nl_start,
+				      fpm_nl_process, fpm_nl_finish, gfnc,
+				      NULL);
+
+	if (IS_ZEBRA_DEBUG_DPLANE)
+		zlog_debug("%s register status: %d", __func__, rv);
+
+	install_node(&fpm_node, fpm_write_config);
+	install_element(ENABLE_NODE, &show_fpm_counters_cmd);
+	install_element(ENABLE_NODE, &clear_fpm_counters_cmd);
+	install_element(CONFIG_NODE, &fpm_set_address_cmd);
+	install_element(CONFIG_NODE, &no_fpm_set_address_cmd);
+
+	return 0;
+}
+
+static int fpm_nl_init(void)
+{
+	hook_register(frr_late_init, fpm_nl_new);
+	return 0;
+}
+
+FRR_MODULE_SETUP(.name = "dplane_fpm_nl", .version = FRR_VERSION,
+		 .description = "Data plane plugin for FPM using netlink.",
+		 .init = fpm_nl_init, )
@@ -53,6 +53,8 @@
 #include "vrf_int.h"
 #include "mpls.h"
 #include "lib_errors.h"
+#include "hash.h"
+#include "jhash.h"
 
 #include "vty.h"
 #include "zebra/zserv.h"
@@ -70,9 +72,198 @@
 #include "zebra/if_netlink.h"
 #include "zebra/zebra_errors.h"
 #include "zebra/zebra_vxlan.h"
+#include "zebra/zebra_router.h"
 
 extern struct zebra_privs_t zserv_privs;
 
+DEFINE_MTYPE_STATIC(ZEBRA, IF_EVENT, "Interface event")
+
+/*
+ * Interface event damping. A flapping breakout cable, or a host creating
+ * thousands of taps, makes the kernel send bursts of RTM_NEWLINK and
+ * RTM_NEWADDR messages. Attribute updates for an interface that stays up
+ * are held for zrouter.if_event_window msec and sent to clients once per
+ * interface, and the kernel route pass that link downs and address
+ * deletes need is run once for the whole burst. Transitions up and down
+ * are still handled right away, and an address event sends the held
+ * update of its interface first so clients see them in kernel order.
+ */
+struct if_event {
+	ns_id_t ns_id;
+	ifindex_t ifindex;
+};
+
+static struct hash *if_event_hash;
+static struct thread *t_if_event;
+static bool if_event_rib_update;
+
+static struct {
+	uint64_t updates;
+	uint64_t updates_merged;
+	uint64_t rib_updates;
+	uint64_t rib_updates_merged;
+} if_event_stats;
+
+static unsigned int if_event_hash_key(const void *arg)
+{
+	const struct if_event *ev = arg;
+
+	return jhash_2words(ev->ns_id, ev->ifindex, 0);
+}
+
+static bool if_event_hash_equal(const void *arg1, const void *arg2)
+{
+	const struct if_event *ev1 = arg1;
+	const struct if_event *ev2 = arg2;
+
+	return ev1->ns_id == ev2->ns_id && ev1->ifindex == ev2->ifindex;
+}
+
+static void *if_event_alloc(void *arg)
+{
+	struct if_event *ev;
+
+	ev = XCALLOC(MTYPE_IF_EVENT, sizeof(*ev));
+	*ev = *(struct if_event *)arg;
+
+	return ev;
+}
+
+static void if_event_free(void *arg)
+{
+	XFREE(MTYPE_IF_EVENT, arg);
+}
+
+static int if_event_send(struct hash_bucket *bucket, void *arg)
+{
+	struct if_event *ev = bucket->data;
+	struct zebra_ns *zns;
+	struct interface *ifp = NULL;
+
+	zns = zebra_ns_lookup(ev->ns_id);
+	if (zns)
+		ifp = if_lookup_by_index_per_ns(zns, ev->ifindex);
+
+	/* Clients were told already if it went down or away meanwhile */
+	if (ifp && if_is_operative(ifp))
+		zebra_interface_up_update(ifp);
+
+	return HASHWALK_CONTINUE;
+}
+
+static int if_event_flush(struct thread *thread)
+{
+	if (if_event_hash) {
+		hash_walk(if_event_hash, if_event_send, NULL);
+		hash_clean(if_event_hash, if_event_free);
+	}
+
+	if (if_event_rib_update) {
+		if_event_rib_update = false;
+		rib_update(RIB_UPDATE_KERNEL);
+	}
+
+	return 0;
+}
+
+/* Tell clients about new attributes of an interface that is still up */
+static void if_event_up_update(struct interface *ifp, ns_id_t ns_id)
+{
+	struct if_event key;
+
+	if (!zrouter.if_event_window) {
+		zebra_interface_up_update(ifp);
+		return;
+	}
+
+	if (!if_event_hash)
+		if_event_hash = hash_create_size(8, if_event_hash_key,
+						 if_event_hash_equal,
+						 "Interface events");
+
+	key.ns_id = ns_id;
+	key.ifindex = ifp->ifindex;
+	if (hash_lookup(if_event_hash, &key)) {
+		if_event_stats.updates_merged++;
+		return;
+	}
+
+	hash_get(if_event_hash, &key, if_event_alloc);
+	if_event_stats.updates++;
+
+	/* The window is not extended by later events */
+	thread_add_timer_msec(zrouter.master, if_event_flush, NULL,
+			      zrouter.if_event_window, &t_if_event);
+}
+
+/*
+ * Send a held update for ifp now, so that clients see it before the
+ * address events that follow it.
+ */
+static void if_event_up_flush(struct interface *ifp, ns_id_t ns_id)
+{
+	struct if_event key;
+	struct if_event *ev;
+
+	if (!if_event_hash)
+		return;
+
+	key.ns_id = ns_id;
+	key.ifindex = ifp->ifindex;
+	ev = hash_release(if_event_hash, &key);
+	if (!ev)
+		return;
+
+	if (if_is_operative(ifp))
+		zebra_interface_up_update(ifp);
+
+	if_event_free(ev);
+}
+
+/*
+ * Linux kernel does not send route delete on interface down/addr del
+ * so we have to re-process routes it owns (i.e. kernel routes)
+ */
+static void if_event_rib_update_kernel(void)
+{
+	if (!zrouter.if_event_window) {
+		rib_update(RIB_UPDATE_KERNEL);
+		return;
+	}
+
+	if (if_event_rib_update) {
+		if_event_stats.rib_updates_merged++;
+		return;
+	}
+
+	if_event_rib_update = true;
+	if_event_stats.rib_updates++;
+
+	thread_add_timer_msec(zrouter.master, if_event_flush, NULL,
+			      zrouter.if_event_window, &t_if_event);
+}
+
+void netlink_if_event_stats(uint64_t *updates, uint64_t *updates_merged,
+			    uint64_t *rib_updates, uint64_t *rib_updates_merged)
+{
+	*updates = if_event_stats.updates;
+	*updates_merged = if_event_stats.updates_merged;
+	*rib_updates = if_event_stats.rib_updates;
+	*rib_updates_merged = if_event_stats.rib_updates_merged;
+}
+
+void netlink_if_event_finish(void)
+{
+	THREAD_OFF(t_if_event);
+	if_event_rib_update = false;
+
+	if (if_event_hash) {
+		hash_clean(if_event_hash, if_event_free);
+		hash_free(if_event_hash);
+		if_event_hash = NULL;
+	}
+}
+
 /* Note: on netlink systems, there should be a 1-to-1 mapping between interface
    names and ifindex values. */
 static void set_ifindex(struct interface *ifp, ifindex_t ifi_index,
@@ -1076,6 +1267,8 @@ int netlink_interface_addr(struct nlmsghdr *h, ns_id_t ns_id, int startup)
 	if (tb[IFA_RT_PRIORITY])
 		metric = *(uint32_t *)RTA_DATA(tb[IFA_RT_PRIORITY]);
 
+	if_event_up_flush(ifp, ns_id);
+
 	/* Register interface address to the interface. */
 	if (ifa->ifa_family == AF_INET) {
 		if (ifa->ifa_prefixlen > IPV4_MAX_BITLEN) {
@@ -1122,13 +1315,8 @@ int netlink_interface_addr(struct nlmsghdr *h, ns_id_t ns_id, int startup)
 					      NULL, ifa->ifa_prefixlen);
 	}
 
-
-	/*
-	 * Linux kernel does not send route delete on interface down/addr del
-	 * so we have to re-process routes it owns (i.e. kernel routes)
-	 */
 	if (h->nlmsg_type != RTM_NEWADDR)
-		rib_update(RIB_UPDATE_KERNEL);
+		if_event_rib_update_kernel();
 
 	return 0;
 }
@@ -1358,7 +1546,7 @@ int netlink_link_change(struct nlmsghdr *h, ns_id_t ns_id, int startup)
 							"Intf %s(%u) has gone DOWN",
 							name, ifp->ifindex);
 					if_down(ifp);
-					rib_update(RIB_UPDATE_KERNEL);
+					if_event_rib_update_kernel();
 				} else if (if_is_operative(ifp)) {
 					/* Must notify client daemons of new
 					 * interface status. */
@@ -1366,7 +1554,7 @@ int netlink_link_change(struct nlmsghdr *h, ns_id_t ns_id, int startup)
 						zlog_debug(
 							"Intf %s(%u) PTM up, notifying clients",
 							name, ifp->ifindex);
-					zebra_interface_up_update(ifp);
+					if_event_up_update(ifp, ns_id);
 
 					/* Update EVPN VNI when SVI MAC change
 					 */
@@ -1398,7 +1586,7 @@ int netlink_link_change(struct nlmsghdr *h, ns_id_t ns_id, int startup)
 							"Intf %s(%u) has gone DOWN",
 							name, ifp->ifindex);
 					if_down(ifp);
-					rib_update(RIB_UPDATE_KERNEL);
+					if_event_rib_update_kernel();
 				}
 			}
 
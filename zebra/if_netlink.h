@@ -46,6 +46,13 @@ extern int interface_lookup_netlink(struct zebra_ns *zns);
  */
 int netlink_protodown(struct interface *ifp, bool down);
 
+/* Interface events merged within zrouter.if_event_window */
+extern void netlink_if_event_stats(uint64_t *updates,
+				   uint64_t *updates_merged,
+				   uint64_t *rib_updates,
+				   uint64_t *rib_updates_merged);
+extern void netlink_if_event_finish(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -43,6 +43,8 @@
 #include "vrf.h"
 #include "mpls.h"
 #include "lib_errors.h"
+#include "jhash.h"
+#include "typesafe.h"
 
 //#include "zebra/zserv.h"
 #include "zebra/zebra_router.h"
@@ -151,6 +153,9 @@ extern uint32_t nl_rcvbufsize;
 
 extern struct zebra_privs_t zserv_privs;
 
+DEFINE_MTYPE_STATIC(ZEBRA, NL_BATCH, "Netlink request batch")
+DEFINE_MTYPE_STATIC(ZEBRA, NL_RECV, "Netlink receive buffers")
+
 
 int netlink_talk_filter(struct nlmsghdr *h, ns_id_t ns_id, int startup)
 {
@@ -173,6 +178,7 @@ int netlink_talk_filter(struct nlmsghdr *h, ns_id_t ns_id, int startup)
 static int netlink_recvbuf(struct nlsock *nl, uint32_t newsize)
 {
 	uint32_t oldsize;
+	uint32_t setsize = newsize;
 	socklen_t newlen = sizeof(newsize);
 	socklen_t oldlen = sizeof(oldsize);
 	int ret;
@@ -188,12 +194,11 @@ static int netlink_recvbuf(struct nlsock *nl, uint32_t newsize)
 	/* Try force option (linux >= 2.6.14) and fall back to normal set */
 	frr_with_privs(&zserv_privs) {
 		ret = setsockopt(nl->sock, SOL_SOCKET, SO_RCVBUFFORCE,
-				 &nl_rcvbufsize,
-				 sizeof(nl_rcvbufsize));
+				 &setsize, sizeof(setsize));
 	}
 	if (ret < 0)
-		ret = setsockopt(nl->sock, SOL_SOCKET, SO_RCVBUF,
-				 &nl_rcvbufsize, sizeof(nl_rcvbufsize));
+		ret = setsockopt(nl->sock, SOL_SOCKET, SO_RCVBUF, &setsize,
+				 sizeof(setsize));
 	if (ret < 0) {
 		flog_err_sys(EC_LIB_SOCKET,
 			     "Can't set %s receive buffer size: %s", nl->name,
@@ -395,23 +400,6 @@ static long netlink_read_file(char *buf, const char *fname)
 
 #endif /* HANDLE_NETLINK_FUZZING */
 
-static int kernel_read(struct thread *thread)
-{
-	struct zebra_ns *zns = (struct zebra_ns *)THREAD_ARG(thread);
-	struct zebra_dplane_info dp_info;
-
-	/* Capture key info from ns struct */
-	zebra_dplane_info_from_zns(&dp_info, zns, false);
-
-	netlink_parse_info(netlink_information_fetch, &zns->netlink, &dp_info,
-			   5, 0);
-	zns->t_netlink = NULL;
-	thread_add_read(zrouter.master, kernel_read, zns, zns->netlink.sock,
-			&zns->t_netlink);
-
-	return 0;
-}
-
 /*
  * Filter out messages from self that occur on listener socket,
  * caused by our actions on the command socket(s)
@@ -700,6 +688,93 @@ static void netlink_parse_extended_ack(struct nlmsghdr *h)
 	}
 }
 
+/*
+ * netlink_parse_error
+ *
+ * Check a NLMSG_ERROR reply from the kernel and log it as appropriate.
+ *
+ * nl      -> netlink socket information
+ * h       -> The NLMSG_ERROR message
+ * is_cmd  -> Was the request issued on a command socket?
+ * startup -> Are we reading in under startup conditions?
+ *
+ * Returns 0 for an ACK or for an error known to be harmless, -1 otherwise.
+ */
+static int netlink_parse_error(const struct nlsock *nl, struct nlmsghdr *h,
+			       bool is_cmd, bool startup)
+{
+	struct nlmsgerr *err = (struct nlmsgerr *)NLMSG_DATA(h);
+	int errnum = err->error;
+	int msg_type = err->msg.nlmsg_type;
+
+	if (h->nlmsg_len < NLMSG_LENGTH(sizeof(struct nlmsgerr))) {
+		flog_err(EC_ZEBRA_NETLINK_LENGTH_ERROR,
+			 "%s error: message truncated", nl->name);
+		return -1;
+	}
+
+	/*
+	 * Parse the extended information before we actually handle it.
+	 * At this point in time we do not do anything other than report
+	 * the issue.
+	 */
+	if (h->nlmsg_flags & NLM_F_ACK_TLVS)
+		netlink_parse_extended_ack(h);
+
+	/* If the error field is zero, then this is an ACK */
+	if (err->error == 0) {
+		if (IS_ZEBRA_DEBUG_KERNEL) {
+			zlog_debug("%s: %s ACK: type=%s(%u), seq=%u, pid=%u",
+				   __FUNCTION__, nl->name,
+				   nl_msg_type_to_str(err->msg.nlmsg_type),
+				   err->msg.nlmsg_type, err->msg.nlmsg_seq,
+				   err->msg.nlmsg_pid);
+		}
+
+		return 0;
+	}
+
+	/* Deal with errors that occur because of races in link handling */
+	if (is_cmd
+	    && ((msg_type == RTM_DELROUTE
+		 && (-errnum == ENODEV || -errnum == ESRCH))
+		|| (msg_type == RTM_NEWROUTE
+		    && (-errnum == ENETDOWN || -errnum == EEXIST)))) {
+		if (IS_ZEBRA_DEBUG_KERNEL)
+			zlog_debug("%s: error: %s type=%s(%u), seq=%u, pid=%u",
+				   nl->name, safe_strerror(-errnum),
+				   nl_msg_type_to_str(msg_type), msg_type,
+				   err->msg.nlmsg_seq, err->msg.nlmsg_pid);
+		return 0;
+	}
+
+	/* We see RTM_DELNEIGH when shutting down an interface with an IPv4
+	 * link-local.  The kernel should have already deleted the neighbor
+	 * so do not log these as an error.
+	 */
+	if (msg_type == RTM_DELNEIGH
+	    || (is_cmd && msg_type == RTM_NEWROUTE
+		&& (-errnum == ESRCH || -errnum == ENETUNREACH))) {
+		/* This is known to happen in some situations, don't log
+		 * as error.
+		 */
+		if (IS_ZEBRA_DEBUG_KERNEL)
+			zlog_debug("%s error: %s, type=%s(%u), seq=%u, pid=%u",
+				   nl->name, safe_strerror(-errnum),
+				   nl_msg_type_to_str(msg_type), msg_type,
+				   err->msg.nlmsg_seq, err->msg.nlmsg_pid);
+	} else {
+		if ((msg_type != RTM_GETNEXTHOP) || !startup)
+			flog_err(EC_ZEBRA_UNEXPECTED_MESSAGE,
+				 "%s error: %s, type=%s(%u), seq=%u, pid=%u",
+				 nl->name, safe_strerror(-errnum),
+				 nl_msg_type_to_str(msg_type), msg_type,
+				 err->msg.nlmsg_seq, err->msg.nlmsg_pid);
+	}
+
+	return -1;
+}
+
 /*
  * netlink_parse_info
  *
@@ -801,112 +876,17 @@ int netlink_parse_info(int (*filter)(struct nlmsghdr *, ns_id_t, int),
 
 			/* Error handling. */
 			if (h->nlmsg_type == NLMSG_ERROR) {
+				int error = netlink_parse_error(
+					nl, h, zns->is_cmd, startup);
 				struct nlmsgerr *err =
 					(struct nlmsgerr *)NLMSG_DATA(h);
-				int errnum = err->error;
-				int msg_type = err->msg.nlmsg_type;
-
-				if (h->nlmsg_len
-				    < NLMSG_LENGTH(sizeof(struct nlmsgerr))) {
-					flog_err(EC_ZEBRA_NETLINK_LENGTH_ERROR,
-						 "%s error: message truncated",
-						 nl->name);
-					return -1;
-				}
-
-				/*
-				 * Parse the extended information before
-				 * we actually handle it.
-				 * At this point in time we do not
-				 * do anything other than report the
-				 * issue.
-				 */
-				if (h->nlmsg_flags & NLM_F_ACK_TLVS)
-					netlink_parse_extended_ack(h);
-
-				/* If the error field is zero, then this is an
-				 * ACK */
-				if (err->error == 0) {
-					if (IS_ZEBRA_DEBUG_KERNEL) {
-						zlog_debug(
-							"%s: %s ACK: type=%s(%u), seq=%u, pid=%u",
-							__FUNCTION__, nl->name,
-							nl_msg_type_to_str(
-								err->msg.nlmsg_type),
-							err->msg.nlmsg_type,
-							err->msg.nlmsg_seq,
-							err->msg.nlmsg_pid);
-					}
-
-					/* return if not a multipart message,
-					 * otherwise continue */
-					if (!(h->nlmsg_flags & NLM_F_MULTI))
-						return 0;
+
+				/* return if not an ACK of a multipart
+				 * message, otherwise continue */
+				if (error == 0 && err->error == 0
+				    && (h->nlmsg_flags & NLM_F_MULTI))
 					continue;
-				}
-
-				/* Deal with errors that occur because of races
-				 * in link handling */
-				if (zns->is_cmd
-				    && ((msg_type == RTM_DELROUTE
-					 && (-errnum == ENODEV
-					     || -errnum == ESRCH))
-					|| (msg_type == RTM_NEWROUTE
-					    && (-errnum == ENETDOWN
-						|| -errnum == EEXIST)))) {
-					if (IS_ZEBRA_DEBUG_KERNEL)
-						zlog_debug(
-							"%s: error: %s type=%s(%u), seq=%u, pid=%u",
-							nl->name,
-							safe_strerror(-errnum),
-							nl_msg_type_to_str(
-								msg_type),
-							msg_type,
-							err->msg.nlmsg_seq,
-							err->msg.nlmsg_pid);
-					return 0;
-				}
-
-				/* We see RTM_DELNEIGH when shutting down an
-				 * interface with an IPv4
-				 * link-local.  The kernel should have already
-				 * deleted the neighbor
-				 * so do not log these as an error.
-				 */
-				if (msg_type == RTM_DELNEIGH
-				    || (zns->is_cmd && msg_type == RTM_NEWROUTE
-					&& (-errnum == ESRCH
-					    || -errnum == ENETUNREACH))) {
-					/* This is known to happen in some
-					 * situations, don't log
-					 * as error.
-					 */
-					if (IS_ZEBRA_DEBUG_KERNEL)
-						zlog_debug(
-							"%s error: %s, type=%s(%u), seq=%u, pid=%u",
-							nl->name,
-							safe_strerror(-errnum),
-							nl_msg_type_to_str(
-								msg_type),
-							msg_type,
-							err->msg.nlmsg_seq,
-							err->msg.nlmsg_pid);
-				} else {
-					if ((msg_type != RTM_GETNEXTHOP)
-					    || !startup)
-						flog_err(
-							EC_ZEBRA_UNEXPECTED_MESSAGE,
-							"%s error: %s, type=%s(%u), seq=%u, pid=%u",
-							nl->name,
-							safe_strerror(-errnum),
-							nl_msg_type_to_str(
-								msg_type),
-							msg_type,
-							err->msg.nlmsg_seq,
-							err->msg.nlmsg_pid);
-				}
-
-				return -1;
+				return error;
 			}
 
 			/* OK we got netlink message. */
@@ -953,6 +933,445 @@ int netlink_parse_info(int (*filter)(struct nlmsghdr *, ns_id_t, int),
 	return ret;
 }
 
+/*
+ * Listener receive path.
+ *
+ * The listener socket is drained with recvmmsg() in batches of
+ * NL_RECV_MSGS datagrams, up to NL_RECV_BUDGET datagrams per call of
+ * kernel_read().  Within one batch IPv4 route messages for the same
+ * kernel route (table, metric, destination, tos, type and protocol) are
+ * coalesced.  An RTM_NEWROUTE replaces whatever zebra had for the route,
+ * so the messages before it are skipped.  An RTM_DELROUTE only removes
+ * the route if its nexthops match, so it doesn't stand for the messages
+ * before it.  A route added with NLM_F_APPEND is another route with the
+ * same key; it ends the run, nothing before or at it is skipped.  IPv6
+ * is left alone since the kernel appends nexthops to an existing route
+ * there, so earlier messages still carry information.
+ *
+ * Datagrams that don't fit in the receive buffers make it grow, up to
+ * NL_RECV_BUF_MAX.  When the socket overruns (ENOBUFS) or a datagram
+ * was truncated we have lost messages; the socket buffer is grown and
+ * the kernel routes of the namespace are resynced shortly afterwards
+ * instead of giving up.
+ */
+#define NL_RECV_MSGS 32
+#define NL_RECV_BUDGET 512
+#define NL_RECV_BUF_MAX (256 * 1024)
+#define NL_RCVBUF_MAX (128 * 1024 * 1024)
+#define NL_RESYNC_DELAY_MSEC 100
+
+PREDECL_HASH(nl_coalesce)
+
+struct nl_recv_entry {
+	struct nlmsghdr *h;
+	uint32_t nl_pid;
+
+	/* Coalescing key, only set for IPv4 route messages */
+	bool coalesce;
+	uint32_t table;
+	uint32_t metric;
+	struct in_addr dst;
+	uint8_t dst_len;
+	uint8_t tos;
+	uint8_t type;
+	uint8_t protocol;
+
+	/* Earlier message about the same route not yet superseded */
+	struct nl_recv_entry *run_prev;
+
+	/* A later RTM_NEWROUTE in this batch is about the same route */
+	bool superseded;
+
+	struct nl_coalesce_item item;
+};
+
+static int nl_coalesce_cmp(const struct nl_recv_entry *e1,
+			   const struct nl_recv_entry *e2)
+{
+	if (e1->table != e2->table)
+		return numcmp(e1->table, e2->table);
+	if (e1->metric != e2->metric)
+		return numcmp(e1->metric, e2->metric);
+	if (e1->dst_len != e2->dst_len)
+		return numcmp(e1->dst_len, e2->dst_len);
+	if (e1->tos != e2->tos)
+		return numcmp(e1->tos, e2->tos);
+	if (e1->type != e2->type)
+		return numcmp(e1->type, e2->type);
+	if (e1->protocol != e2->protocol)
+		return numcmp(e1->protocol, e2->protocol);
+	return numcmp(ntohl(e1->dst.s_addr), ntohl(e2->dst.s_addr));
+}
+
+static uint32_t nl_coalesce_hash(const struct nl_recv_entry *e)
+{
+	return jhash_3words(e->dst.s_addr, e->table,
+			    e->metric ^ (e->dst_len << 8) ^ e->tos
+				    ^ (e->type << 16) ^ (e->protocol << 24),
+			    0);
+}
+
+DECLARE_HASH(nl_coalesce, struct nl_recv_entry, item, nl_coalesce_cmp,
+	     nl_coalesce_hash)
+
+static struct {
+	/* Size of each receive buffer, grows on truncation */
+	size_t bufsize;
+	char *bufs[NL_RECV_MSGS];
+	struct mmsghdr msgs[NL_RECV_MSGS];
+	struct iovec iovs[NL_RECV_MSGS];
+	struct sockaddr_nl snls[NL_RECV_MSGS];
+
+	struct nl_recv_entry *entries;
+	size_t entries_size;
+
+	/* Statistics */
+	uint64_t datagrams;
+	uint64_t messages;
+	uint64_t coalesced;
+	uint64_t truncated;
+	uint64_t overruns;
+	uint64_t resyncs;
+} nl_recv;
+
+static void netlink_recv_bufs_alloc(size_t bufsize)
+{
+	int i;
+
+	for (i = 0; i < NL_RECV_MSGS; i++) {
+		XFREE(MTYPE_NL_RECV, nl_recv.bufs[i]);
+		nl_recv.bufs[i] = XMALLOC(MTYPE_NL_RECV, bufsize);
+	}
+	nl_recv.bufsize = bufsize;
+}
+
+static void netlink_recv_fini(void)
+{
+	int i;
+
+	for (i = 0; i < NL_RECV_MSGS; i++)
+		XFREE(MTYPE_NL_RECV, nl_recv.bufs[i]);
+	XFREE(MTYPE_NL_RECV, nl_recv.entries);
+	nl_recv.entries_size = 0;
+	nl_recv.bufsize = 0;
+}
+
+static int netlink_resync(struct thread *thread)
+{
+	struct zebra_ns *zns = THREAD_ARG(thread);
+	unsigned long swept;
+
+	nl_recv.resyncs++;
+	zlog_notice(
+		"%s: resyncing kernel routes after lost messages (overruns %" PRIu64
+		", truncated %" PRIu64 ", resyncs %" PRIu64 ")",
+		zns->netlink.name, nl_recv.overruns, nl_recv.truncated,
+		nl_recv.resyncs);
+	if (IS_ZEBRA_DEBUG_KERNEL)
+		zlog_debug("%s: %" PRIu64 " datagrams, %" PRIu64
+			   " messages, %" PRIu64 " coalesced",
+			   zns->netlink.name, nl_recv.datagrams,
+			   nl_recv.messages, nl_recv.coalesced);
+
+	rib_mark_kernel_stale(zns->ns_id);
+	if (netlink_route_resync(zns) < 0) {
+		/* Sweep nothing on a partial dump, try again later */
+		thread_add_timer_msec(zrouter.master, netlink_resync, zns,
+				      NL_RESYNC_DELAY_MSEC * 10,
+				      &zns->t_netlink_resync);
+		return 0;
+	}
+	swept = rib_sweep_kernel_stale(zns->ns_id);
+
+	if (swept)
+		zlog_notice("%s: resync removed %lu stale kernel routes",
+			    zns->netlink.name, swept);
+	return 0;
+}
+
+/* Messages from the kernel were lost, recover from it */
+static void netlink_overrun(struct zebra_ns *zns)
+{
+	nl_recv.overruns++;
+	flog_warn(EC_ZEBRA_RECVMSG_OVERRUN,
+		  "%s recvmsg overrun: %s, resyncing kernel routes",
+		  zns->netlink.name, safe_strerror(ENOBUFS));
+
+	if (zns->netlink_rcvbuf < NL_RCVBUF_MAX) {
+		zns->netlink_rcvbuf = MIN(zns->netlink_rcvbuf * 2,
+					  NL_RCVBUF_MAX);
+		netlink_recvbuf(&zns->netlink, zns->netlink_rcvbuf);
+	}
+
+	thread_add_timer_msec(zrouter.master, netlink_resync, zns,
+			      NL_RESYNC_DELAY_MSEC, &zns->t_netlink_resync);
+}
+
+static struct nl_recv_entry *netlink_recv_entry_new(size_t *n)
+{
+	if (*n == nl_recv.entries_size) {
+		nl_recv.entries_size = MAX(nl_recv.entries_size * 2, 256);
+		nl_recv.entries = XREALLOC(
+			MTYPE_NL_RECV, nl_recv.entries,
+			nl_recv.entries_size * sizeof(*nl_recv.entries));
+	}
+
+	return &nl_recv.entries[(*n)++];
+}
+
+/* Fill in the coalescing key of an IPv4 route message */
+static void netlink_recv_entry_key(struct nl_recv_entry *entry)
+{
+	struct nlmsghdr *h = entry->h;
+	struct rtmsg *rtm;
+	struct rtattr *tb[RTA_MAX + 1];
+	int len;
+
+	if (h->nlmsg_type != RTM_NEWROUTE && h->nlmsg_type != RTM_DELROUTE)
+		return;
+
+	len = h->nlmsg_len - NLMSG_LENGTH(sizeof(struct rtmsg));
+	if (len < 0)
+		return;
+
+	rtm = NLMSG_DATA(h);
+	if (rtm->rtm_family != AF_INET)
+		return;
+
+	memset(tb, 0, sizeof(tb));
+	netlink_parse_rtattr(tb, RTA_MAX, RTM_RTA(rtm), len);
+
+	entry->table = rtm->rtm_table;
+	if (tb[RTA_TABLE])
+		entry->table = *(uint32_t *)RTA_DATA(tb[RTA_TABLE]);
+	if (tb[RTA_PRIORITY])
+		entry->metric = *(uint32_t *)RTA_DATA(tb[RTA_PRIORITY]);
+	if (tb[RTA_DST])
+		memcpy(&entry->dst, RTA_DATA(tb[RTA_DST]), sizeof(entry->dst));
+	entry->dst_len = rtm->rtm_dst_len;
+	entry->tos = rtm->rtm_tos;
+	entry->type = rtm->rtm_type;
+	entry->protocol = rtm->rtm_protocol;
+	entry->coalesce = true;
+}
+
+/*
+ * Mark the route messages of a batch that a later RTM_NEWROUTE for the
+ * same route supersedes.  The hash holds the last message of each run.
+ */
+static void netlink_recv_coalesce(size_t n)
+{
+	struct nl_coalesce_head coalesce;
+	struct nl_recv_entry *entry, *prev;
+	size_t i;
+
+	nl_coalesce_init(&coalesce);
+	for (i = 0; i < n; i++) {
+		entry = &nl_recv.entries[i];
+		if (!entry->coalesce)
+			continue;
+
+		prev = nl_coalesce_find(&coalesce, entry);
+		if (prev)
+			nl_coalesce_del(&coalesce, prev);
+
+		if (entry->h->nlmsg_flags & NLM_F_APPEND)
+			continue;
+
+		if (entry->h->nlmsg_type == RTM_NEWROUTE) {
+			for (; prev; prev = prev->run_prev) {
+				prev->superseded = true;
+				nl_recv.coalesced++;
+			}
+		} else
+			entry->run_prev = prev;
+
+		nl_coalesce_add(&coalesce, entry);
+	}
+	while (nl_coalesce_pop(&coalesce))
+		;
+	nl_coalesce_fini(&coalesce);
+}
+
+/*
+ * Split a batch of datagrams into messages, mark the route messages that
+ * are superseded later in the batch and hand the rest to
+ * netlink_information_fetch().
+ */
+static void netlink_recv_batch(struct zebra_ns *zns, int count)
+{
+	const struct nlsock *nl = &zns->netlink;
+	struct nl_recv_entry *entry;
+	struct nlmsghdr *h;
+	size_t n = 0, i;
+	int j, status;
+
+	for (j = 0; j < count; j++) {
+		struct msghdr *msg = &nl_recv.msgs[j].msg_hdr;
+
+		status = nl_recv.msgs[j].msg_len;
+		if (status == 0)
+			continue;
+
+		if (msg->msg_namelen != sizeof(struct sockaddr_nl)) {
+			flog_err(EC_ZEBRA_NETLINK_LENGTH_ERROR,
+				 "%s sender address length error: length %d",
+				 nl->name, msg->msg_namelen);
+			continue;
+		}
+
+		if (IS_ZEBRA_DEBUG_KERNEL_MSGDUMP_RECV) {
+			zlog_debug("%s: << netlink message dump [recv]",
+				   __func__);
+			zlog_hexdump(nl_recv.bufs[j], status);
+		}
+
+		for (h = (struct nlmsghdr *)nl_recv.bufs[j];
+		     NLMSG_OK(h, (unsigned int)status);
+		     h = NLMSG_NEXT(h, status)) {
+			entry = netlink_recv_entry_new(&n);
+			memset(entry, 0, sizeof(*entry));
+			entry->h = h;
+			entry->nl_pid = nl_recv.snls[j].nl_pid;
+			if (entry->nl_pid == 0)
+				netlink_recv_entry_key(entry);
+		}
+
+		if (status)
+			flog_err(EC_ZEBRA_NETLINK_LENGTH_ERROR,
+				 "%s error: data remnant size %d", nl->name,
+				 status);
+	}
+
+	nl_recv.datagrams += count;
+	nl_recv.messages += n;
+
+	netlink_recv_coalesce(n);
+
+	for (i = 0; i < n; i++) {
+		entry = &nl_recv.entries[i];
+		h = entry->h;
+
+		if (entry->superseded)
+			continue;
+
+		if (h->nlmsg_type == NLMSG_DONE)
+			continue;
+
+		if (h->nlmsg_type == NLMSG_ERROR) {
+			netlink_parse_error(nl, h, false, false);
+			continue;
+		}
+
+		if (IS_ZEBRA_DEBUG_KERNEL)
+			zlog_debug(
+				"%s: %s type %s(%u), len=%d, seq=%u, pid=%u",
+				__func__, nl->name,
+				nl_msg_type_to_str(h->nlmsg_type),
+				h->nlmsg_type, h->nlmsg_len, h->nlmsg_seq,
+				h->nlmsg_pid);
+
+		/*
+		 * Ignore messages that maybe sent from
+		 * other actors besides the kernel
+		 */
+		if (entry->nl_pid != 0) {
+			zlog_debug("Ignoring message from pid %u",
+				   entry->nl_pid);
+			continue;
+		}
+
+		if (netlink_information_fetch(h, zns->ns_id, 0) < 0)
+			zlog_debug("%s filter function error", nl->name);
+	}
+}
+
+/* Drain the listener socket, up to NL_RECV_BUDGET datagrams */
+static void netlink_recv_listener(struct zebra_ns *zns)
+{
+	bool truncated;
+	int read_in = 0;
+	int count, j;
+
+	if (!nl_recv.bufsize)
+		netlink_recv_bufs_alloc(NL_RCV_PKT_BUF_SIZE);
+
+	while (read_in < NL_RECV_BUDGET) {
+		for (j = 0; j < NL_RECV_MSGS; j++) {
+			nl_recv.iovs[j].iov_base = nl_recv.bufs[j];
+			nl_recv.iovs[j].iov_len = nl_recv.bufsize;
+			memset(&nl_recv.msgs[j], 0, sizeof(nl_recv.msgs[j]));
+			nl_recv.msgs[j].msg_hdr.msg_name = &nl_recv.snls[j];
+			nl_recv.msgs[j].msg_hdr.msg_namelen =
+				sizeof(nl_recv.snls[j]);
+			nl_recv.msgs[j].msg_hdr.msg_iov = &nl_recv.iovs[j];
+			nl_recv.msgs[j].msg_hdr.msg_iovlen = 1;
+		}
+
+		count = recvmmsg(zns->netlink.sock, nl_recv.msgs, NL_RECV_MSGS,
+				 MSG_DONTWAIT, NULL);
+		if (count < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EWOULDBLOCK || errno == EAGAIN)
+				return;
+			if (errno == ENOBUFS) {
+				netlink_overrun(zns);
+				continue;
+			}
+			flog_err_sys(EC_LIB_SOCKET, "%s recvmmsg failed: %s",
+				     zns->netlink.name, safe_strerror(errno));
+			return;
+		}
+		if (count == 0)
+			return;
+
+		netlink_recv_batch(zns, count);
+		read_in += count;
+
+		truncated = false;
+		for (j = 0; j < count; j++)
+			if (nl_recv.msgs[j].msg_hdr.msg_flags & MSG_TRUNC)
+				truncated = true;
+
+		if (truncated) {
+			nl_recv.truncated++;
+			flog_err(EC_ZEBRA_NETLINK_LENGTH_ERROR,
+				 "%s error: message truncated",
+				 zns->netlink.name);
+			if (nl_recv.bufsize < NL_RECV_BUF_MAX)
+				netlink_recv_bufs_alloc(nl_recv.bufsize * 2);
+			thread_add_timer_msec(zrouter.master, netlink_resync,
+					      zns, NL_RESYNC_DELAY_MSEC,
+					      &zns->t_netlink_resync);
+		}
+
+		if (count < NL_RECV_MSGS)
+			return;
+	}
+}
+
+static int kernel_read(struct thread *thread)
+{
+	struct zebra_ns *zns = (struct zebra_ns *)THREAD_ARG(thread);
+#if defined(HANDLE_NETLINK_FUZZING)
+	struct zebra_dplane_info dp_info;
+
+	/* Capture key info from ns struct */
+	zebra_dplane_info_from_zns(&dp_info, zns, false);
+
+	netlink_parse_info(netlink_information_fetch, &zns->netlink, &dp_info,
+			   5, 0);
+#else
+	netlink_recv_listener(zns);
+#endif /* HANDLE_NETLINK_FUZZING */
+	zns->t_netlink = NULL;
+	thread_add_read(zrouter.master, kernel_read, zns, zns->netlink.sock,
+			&zns->t_netlink);
+
+	return 0;
+}
+
 /*
  * netlink_talk_info
  *
@@ -1045,6 +1464,493 @@ int netlink_talk(int (*filter)(struct nlmsghdr *, ns_id_t, int startup),
 	return netlink_talk_info(filter, n, &dp_info, startup);
 }
 
+/*
+ * Netlink sockets private to a dataplane worker pthread, one per
+ * namespace, so that workers can talk to the kernel in parallel.
+ */
+struct kernel_dplane_worker {
+	char name[32];
+
+	struct zebra_dplane_info *socks;
+	uint32_t nsocks;
+};
+
+struct kernel_dplane_worker *kernel_dplane_worker_new(const char *name)
+{
+	struct kernel_dplane_worker *kw;
+
+	kw = XCALLOC(MTYPE_NL_BATCH, sizeof(*kw));
+	strlcpy(kw->name, name, sizeof(kw->name));
+
+	return kw;
+}
+
+void kernel_dplane_worker_free(struct kernel_dplane_worker **pkw)
+{
+	struct kernel_dplane_worker *kw = *pkw;
+	uint32_t i;
+
+	if (kw == NULL)
+		return;
+
+	for (i = 0; i < kw->nsocks; i++)
+		close(kw->socks[i].nls.sock);
+
+	XFREE(MTYPE_NL_BATCH, kw->socks);
+	XFREE(MTYPE_NL_BATCH, *pkw);
+}
+
+/*
+ * Close the worker's socket for a namespace that was deleted.
+ */
+void kernel_dplane_worker_close_ns(struct kernel_dplane_worker *kw,
+				   ns_id_t ns_id)
+{
+	uint32_t i;
+
+	for (i = 0; i < kw->nsocks; i++) {
+		if (kw->socks[i].ns_id != ns_id)
+			continue;
+
+		close(kw->socks[i].nls.sock);
+
+		kw->nsocks--;
+		if (i < kw->nsocks)
+			kw->socks[i] = kw->socks[kw->nsocks];
+		return;
+	}
+}
+
+/*
+ * The worker's socket for a namespace, opened on first use.
+ */
+static struct zebra_dplane_info *
+kernel_dplane_worker_info(struct kernel_dplane_worker *kw, ns_id_t ns_id)
+{
+	struct zebra_dplane_info *info;
+	uint32_t i;
+#if defined SOL_NETLINK
+	int one = 1;
+#endif
+
+	for (i = 0; i < kw->nsocks; i++)
+		if (kw->socks[i].ns_id == ns_id)
+			return &kw->socks[i];
+
+	kw->socks = XREALLOC(MTYPE_NL_BATCH, kw->socks,
+			     (kw->nsocks + 1) * sizeof(*kw->socks));
+	info = &kw->socks[kw->nsocks];
+	memset(info, 0, sizeof(*info));
+
+	info->ns_id = ns_id;
+	info->is_cmd = true;
+	snprintf(info->nls.name, sizeof(info->nls.name), "%s (NS %u)",
+		 kw->name, ns_id);
+	info->nls.sock = -1;
+	if (netlink_socket(&info->nls, 0, ns_id) < 0)
+		return NULL;
+
+#if defined SOL_NETLINK
+	if (setsockopt(info->nls.sock, SOL_NETLINK, NETLINK_EXT_ACK, &one,
+		       sizeof(one))
+	    < 0)
+		zlog_notice("Registration for extended dp ACK failed : %d %s",
+			    errno, safe_strerror(errno));
+#endif
+
+	if (fcntl(info->nls.sock, F_SETFL, O_NONBLOCK) < 0)
+		zlog_err("Can't set %s socket error: %s(%d)",
+			 info->nls.name, safe_strerror(errno), errno);
+
+	netlink_recvbuf(&info->nls, MAX(nl_rcvbufsize, NL_BATCH_RCVBUF_SIZE));
+
+	kw->nsocks++;
+
+	return info;
+}
+
+/*
+ * Batched netlink requests
+ *
+ * Requests are copied back to back into one buffer and handed to the
+ * kernel with a single sendmsg().  Every request asks for an explicit
+ * ACK; the kernel handles a buffer in order, continuing past requests
+ * that fail, so the replies are matched back to their requests by
+ * sequence number as they are read.
+ */
+
+void netlink_batch_init(struct nl_batch *bth,
+			void (*done)(struct nlmsghdr *n, void *arg, int error))
+{
+	memset(bth, 0, sizeof(*bth));
+
+	bth->buf = XMALLOC(MTYPE_NL_BATCH, NL_BATCH_BUF_SIZE);
+	bth->bufsiz = NL_BATCH_BUF_SIZE;
+	bth->done = done;
+}
+
+void netlink_batch_fini(struct nl_batch *bth)
+{
+	netlink_batch_send(bth);
+
+	XFREE(MTYPE_NL_BATCH, bth->buf);
+	XFREE(MTYPE_NL_BATCH, bth->msgs);
+}
+
+/*
+ * Queue a request on a batch.  'arg' is handed back to the batch's 'done'
+ * callback with the result of the request; requests queued with a NULL
+ * 'arg' are sent but their result is ignored.  The batch is sent first if
+ * it is full or was built for another socket.
+ *
+ * Returns 1 once the request is queued, -1 if it could not be.
+ */
+int netlink_batch_add(struct nl_batch *bth, struct nlmsghdr *n,
+		      const struct zebra_dplane_info *dp_info, void *arg)
+{
+	uint32_t len = NLMSG_ALIGN(n->nlmsg_len);
+	struct nl_batch_msg *msg;
+
+	if (len > bth->bufsiz) {
+		flog_err(EC_ZEBRA_NETLINK_LENGTH_ERROR,
+			 "%s: request of %u bytes does not fit a batch",
+			 __func__, n->nlmsg_len);
+		return -1;
+	}
+
+	/* A worker sends on its own socket for the namespace */
+	if (bth->worker) {
+		struct zebra_dplane_info *info;
+
+		info = kernel_dplane_worker_info(bth->worker, dp_info->ns_id);
+		if (info == NULL)
+			return -1;
+
+		info->nls.seq++;
+		dp_info = info;
+	}
+
+	if (bth->msgcnt
+	    && (bth->dp_info.nls.sock != dp_info->nls.sock
+		|| bth->curlen + len > bth->bufsiz))
+		netlink_batch_send(bth);
+
+	if (bth->msgcnt == 0)
+		bth->dp_info = *dp_info;
+
+	if (bth->msgcnt == bth->msgmax) {
+		bth->msgmax = bth->msgmax ? bth->msgmax * 2 : 64;
+		bth->msgs = XREALLOC(MTYPE_NL_BATCH, bth->msgs,
+				     bth->msgmax * sizeof(*bth->msgs));
+	}
+
+	n->nlmsg_seq = dp_info->nls.seq;
+	n->nlmsg_pid = dp_info->nls.snl.nl_pid;
+	n->nlmsg_flags |= NLM_F_ACK;
+
+	if (IS_ZEBRA_DEBUG_KERNEL)
+		zlog_debug(
+			"netlink_batch: %s type %s(%u), len=%d seq=%u flags 0x%x",
+			dp_info->nls.name, nl_msg_type_to_str(n->nlmsg_type),
+			n->nlmsg_type, n->nlmsg_len, n->nlmsg_seq,
+			n->nlmsg_flags);
+
+	msg = &bth->msgs[bth->msgcnt++];
+	msg->offset = bth->curlen;
+	msg->seq = n->nlmsg_seq;
+	msg->arg = arg;
+	msg->error = -1;
+	msg->acked = false;
+
+	memcpy(bth->buf + bth->curlen, n, n->nlmsg_len);
+	memset(bth->buf + bth->curlen + n->nlmsg_len, 0, len - n->nlmsg_len);
+	bth->curlen += len;
+
+	return 1;
+}
+
+/*
+ * Match a reply to the first outstanding request carrying its sequence
+ * number.  Replies arrive in request order, so the search starts at the
+ * oldest request still waiting for one.
+ */
+static struct nl_batch_msg *netlink_batch_match(struct nl_batch *bth,
+						uint32_t *cursor,
+						uint32_t seq)
+{
+	uint32_t i;
+
+	for (i = *cursor; i < bth->msgcnt; i++) {
+		if (bth->msgs[i].seq == seq && !bth->msgs[i].acked) {
+			*cursor = i + 1;
+			return &bth->msgs[i];
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * A request sent again after its reply was lost may find the kernel has
+ * done it the first time.  rtnetlink message types come in groups of four
+ * starting at RTM_BASE: new, delete, get and set.
+ */
+static bool netlink_batch_already_done(const struct nlmsghdr *n, int errnum)
+{
+	if (n->nlmsg_type < RTM_BASE)
+		return false;
+
+	switch ((n->nlmsg_type - RTM_BASE) % 4) {
+	case 0:
+		return errnum == EEXIST;
+	case 1:
+		return errnum == ENOENT || errnum == ESRCH;
+	default:
+		return false;
+	}
+}
+
+/*
+ * Send the requests of a batch that have no reply yet and collect the
+ * replies.  On a resync only the requests whose replies were lost are
+ * sent, in a buffer of their own.
+ *
+ * Returns true if replies were lost because the socket overran.
+ */
+static bool netlink_batch_xmit(struct nl_batch *bth, bool resync)
+{
+	const struct nlsock *nl = &bth->dp_info.nls;
+	struct sockaddr_nl snl = {.nl_family = AF_NETLINK};
+	struct iovec iov = {.iov_base = bth->buf, .iov_len = bth->curlen};
+	struct msghdr msg = {.msg_name = (void *)&snl,
+			     .msg_namelen = sizeof(snl),
+			     .msg_iov = &iov,
+			     .msg_iovlen = 1};
+	uint32_t i, cursor = 0, pending = 0;
+	char *resend = NULL;
+	int status, save_errno = 0;
+	bool overrun = false;
+
+	if (resync) {
+		size_t len = 0;
+
+		resend = XMALLOC(MTYPE_NL_BATCH, bth->curlen);
+		for (i = 0; i < bth->msgcnt; i++) {
+			struct nl_batch_msg *req = &bth->msgs[i];
+			struct nlmsghdr *n;
+
+			if (req->acked)
+				continue;
+
+			n = (struct nlmsghdr *)(bth->buf + req->offset);
+			memcpy(resend + len, n, NLMSG_ALIGN(n->nlmsg_len));
+			len += NLMSG_ALIGN(n->nlmsg_len);
+			pending++;
+		}
+
+		iov.iov_base = resend;
+		iov.iov_len = len;
+	} else
+		pending = bth->msgcnt;
+
+	frr_with_privs(&zserv_privs) {
+		status = sendmsg(nl->sock, &msg, 0);
+		save_errno = errno;
+	}
+
+	if (IS_ZEBRA_DEBUG_KERNEL_MSGDUMP_SEND) {
+		zlog_debug("%s: >> netlink message dump [sent]", __func__);
+		zlog_hexdump(iov.iov_base, iov.iov_len);
+	}
+
+	if (status < 0) {
+		flog_err_sys(EC_LIB_SOCKET,
+			     "netlink_batch sendmsg() error: %s",
+			     safe_strerror(save_errno));
+		XFREE(MTYPE_NL_BATCH, resend);
+		return false;
+	}
+
+	/* The kernel has processed the whole buffer by the time sendmsg()
+	 * returns, so all replies are already queued on the socket.
+	 */
+	while (pending) {
+		char buf[NL_RCV_PKT_BUF_SIZE];
+		struct nlmsghdr *h;
+
+		iov.iov_base = buf;
+		iov.iov_len = sizeof(buf);
+		msg.msg_namelen = sizeof(snl);
+
+		status = recvmsg(nl->sock, &msg, 0);
+		if (status < 0) {
+			if (errno == EINTR)
+				continue;
+			/* Lost replies, the rest may still be queued */
+			if (errno == ENOBUFS) {
+				overrun = true;
+				continue;
+			}
+			if (errno != EWOULDBLOCK && errno != EAGAIN)
+				flog_err(EC_ZEBRA_RECVMSG_OVERRUN,
+					 "%s recvmsg overrun: %s", nl->name,
+					 safe_strerror(errno));
+			break;
+		}
+
+		if (status == 0) {
+			flog_err_sys(EC_LIB_SOCKET, "%s EOF", nl->name);
+			break;
+		}
+
+		if (IS_ZEBRA_DEBUG_KERNEL_MSGDUMP_RECV) {
+			zlog_debug("%s: << netlink message dump [recv]",
+				   __func__);
+			zlog_hexdump(buf, status);
+		}
+
+		/* Ignore messages that maybe sent from other actors
+		 * besides the kernel
+		 */
+		if (snl.nl_pid != 0)
+			continue;
+
+		for (h = (struct nlmsghdr *)buf;
+		     NLMSG_OK(h, (unsigned int)status);
+		     h = NLMSG_NEXT(h, status)) {
+			struct nl_batch_msg *req;
+			struct nlmsgerr *err;
+
+			if (h->nlmsg_type != NLMSG_ERROR) {
+				netlink_talk_filter(h, bth->dp_info.ns_id, 0);
+				continue;
+			}
+
+			req = netlink_batch_match(bth, &cursor, h->nlmsg_seq);
+			if (req == NULL)
+				continue;
+
+			err = NLMSG_DATA(h);
+			if (resync
+			    && h->nlmsg_len >= NLMSG_LENGTH(sizeof(*err))
+			    && netlink_batch_already_done(
+				    (struct nlmsghdr *)(bth->buf
+							+ req->offset),
+				    -err->error))
+				req->error = 0;
+			else
+				req->error = netlink_parse_error(
+					nl, h, bth->dp_info.is_cmd, false);
+			req->acked = true;
+			pending--;
+		}
+	}
+
+	XFREE(MTYPE_NL_BATCH, resend);
+
+	return overrun && pending;
+}
+
+/*
+ * Send a batch and collect the replies to its requests, then report the
+ * result of each request to the batch's 'done' callback, in order.
+ *
+ * When the socket overruns, the kernel has acted on requests whose
+ * replies were lost; those are sent again, and a reply saying the change
+ * is already there counts as success.  Requests still unanswered after
+ * that are reported as failed.
+ *
+ * Returns the number of requests sent.
+ */
+int netlink_batch_send(struct nl_batch *bth)
+{
+	const struct nlsock *nl = &bth->dp_info.nls;
+	uint32_t i, tries;
+	int count;
+
+	if (bth->msgcnt == 0)
+		return 0;
+
+	for (tries = 0; netlink_batch_xmit(bth, tries > 0); tries++) {
+		if (tries == NL_BATCH_RESYNC_TRIES)
+			break;
+
+		if (IS_ZEBRA_DEBUG_KERNEL)
+			zlog_debug("%s: replies lost, resending unanswered requests",
+				   nl->name);
+	}
+
+	for (i = 0; i < bth->msgcnt; i++) {
+		struct nl_batch_msg *req = &bth->msgs[i];
+
+		if (!req->acked)
+			flog_err(EC_ZEBRA_UNEXPECTED_MESSAGE,
+				 "%s: no reply to request seq=%u", nl->name,
+				 req->seq);
+
+		if (req->arg && bth->done)
+			bth->done((struct nlmsghdr *)(bth->buf + req->offset),
+				  req->arg, req->error);
+	}
+
+	count = bth->msgcnt;
+	bth->batches++;
+	bth->msgcnt = 0;
+	bth->curlen = 0;
+
+	return count;
+}
+
+/* Result of a request queued by netlink_batch_ctx_list() */
+static void netlink_batch_ctx_done(struct nlmsghdr *n, void *arg, int error)
+{
+	struct zebra_dplane_ctx *ctx = arg;
+
+	dplane_ctx_set_status(ctx, (error == 0 ? ZEBRA_DPLANE_REQUEST_SUCCESS
+					       : ZEBRA_DPLANE_REQUEST_FAILURE));
+}
+
+/*
+ * Send the updates of a list of dataplane contexts in netlink batches.
+ * 'encode' queues the request of a context on the batch and returns 1,
+ * or returns 0 or -1 if the update succeeded or failed without one.  The
+ * result of each update is set in its context.
+ *
+ * Returns the number of batches sent to the kernel.
+ */
+int netlink_batch_ctx_list(struct dplane_ctx_q *ctx_list,
+			   int (*encode)(struct zebra_dplane_ctx *ctx,
+					 struct nl_batch *bth))
+{
+	struct dplane_ctx_q done_list;
+	struct zebra_dplane_ctx *ctx;
+	struct nl_batch bth;
+	int ret;
+
+	TAILQ_INIT(&done_list);
+	netlink_batch_init(&bth, netlink_batch_ctx_done);
+
+	while ((ctx = dplane_ctx_dequeue(ctx_list)) != NULL) {
+		dplane_ctx_enqueue_tail(&done_list, ctx);
+
+		ret = encode(ctx, &bth);
+
+		/* Queued: the result comes back with the kernel's ACK */
+		if (ret > 0)
+			continue;
+
+		dplane_ctx_set_status(ctx, (ret == 0 ?
+					    ZEBRA_DPLANE_REQUEST_SUCCESS :
+					    ZEBRA_DPLANE_REQUEST_FAILURE));
+	}
+
+	netlink_batch_fini(&bth);
+
+	dplane_ctx_list_append(ctx_list, &done_list);
+
+	return bth.batches;
+}
+
 /* Issue request message to kernel via netlink socket. GET messages
  * are issued through this interface.
  */
@@ -1179,9 +2085,14 @@ void kernel_init(struct zebra_ns *zns)
 			 zns->netlink_dplane.name, safe_strerror(errno), errno);
 
 	/* Set receive buffer size if it's set from command line */
+	zns->netlink_rcvbuf = MAX(nl_rcvbufsize, NL_RCV_PKT_BUF_SIZE);
 	if (nl_rcvbufsize)
 		netlink_recvbuf(&zns->netlink, nl_rcvbufsize);
 
+	/* The dplane socket collects the replies to whole batches */
+	netlink_recvbuf(&zns->netlink_dplane,
+			MAX(nl_rcvbufsize, NL_BATCH_RCVBUF_SIZE));
+
 	netlink_install_filter(zns->netlink.sock,
 			       zns->netlink_cmd.snl.nl_pid,
 			       zns->netlink_dplane.snl.nl_pid);
@@ -1197,6 +2108,7 @@ void kernel_init(struct zebra_ns *zns)
 void kernel_terminate(struct zebra_ns *zns, bool complete)
 {
 	THREAD_READ_OFF(zns->t_netlink);
+	THREAD_OFF(zns->t_netlink_resync);
 
 	if (zns->netlink.sock >= 0) {
 		close(zns->netlink.sock);
@@ -1216,6 +2128,9 @@ void kernel_terminate(struct zebra_ns *zns, bool complete)
 			close(zns->netlink_dplane.sock);
 			zns->netlink_dplane.sock = -1;
 		}
+
+		/* Reallocated by the next read, if any namespace is left */
+		netlink_recv_fini();
 	}
 }
 #endif /* HAVE_NETLINK */
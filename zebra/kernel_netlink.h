@@ -21,6 +21,8 @@
 #ifndef _ZEBRA_KERNEL_NETLINK_H
 #define _ZEBRA_KERNEL_NETLINK_H
 
+#include "zebra/zebra_dplane.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -29,6 +31,56 @@ extern "C" {
 
 #define NL_RCV_PKT_BUF_SIZE     32768
 #define NL_PKT_BUF_SIZE         8192
+#define NL_BATCH_BUF_SIZE       (8 * NL_PKT_BUF_SIZE)
+
+/*
+ * Receive buffer of the sockets batches are sent on: the kernel queues a
+ * reply of about 1KB of socket memory for every request, and a full batch
+ * holds up to one request per 64 bytes.
+ */
+#define NL_BATCH_RCVBUF_SIZE    ((NL_BATCH_BUF_SIZE / 64) * 1024)
+
+/* Times the unanswered requests of a batch are sent again */
+#define NL_BATCH_RESYNC_TRIES   3
+
+/* A request queued on a netlink batch */
+struct nl_batch_msg {
+	/* Position of the request in the batch buffer */
+	uint32_t offset;
+	uint32_t seq;
+
+	/* Caller's argument for the 'done' callback */
+	void *arg;
+
+	/* Result, valid once the batch has been sent */
+	int error;
+	bool acked;
+};
+
+/* Requests sent to the kernel on one netlink socket with one sendmsg() */
+struct nl_batch {
+	/* Socket the queued requests are for */
+	struct zebra_dplane_info dp_info;
+
+	char *buf;
+	uint32_t bufsiz;
+	uint32_t curlen;
+
+	struct nl_batch_msg *msgs;
+	uint32_t msgcnt;
+	uint32_t msgmax;
+
+	/* Number of times the batch was sent */
+	uint32_t batches;
+
+	/* Send on this dataplane worker's sockets rather than the
+	 * requests' own.
+	 */
+	struct kernel_dplane_worker *worker;
+
+	/* Called with the result of each request once the batch is sent */
+	void (*done)(struct nlmsghdr *n, void *arg, int error);
+};
 
 extern void netlink_parse_rtattr(struct rtattr **tb, int max,
 				 struct rtattr *rta, int len);
@@ -70,6 +122,18 @@ int netlink_talk_info(int (*filter)(struct nlmsghdr *, ns_id_t, int startup),
 
 extern int netlink_request(struct nlsock *nl, struct nlmsghdr *n);
 
+extern void netlink_batch_init(struct nl_batch *bth,
+			       void (*done)(struct nlmsghdr *n, void *arg,
+					    int error));
+extern void netlink_batch_fini(struct nl_batch *bth);
+extern int netlink_batch_add(struct nl_batch *bth, struct nlmsghdr *n,
+			     const struct zebra_dplane_info *dp_info,
+			     void *arg);
+extern int netlink_batch_send(struct nl_batch *bth);
+extern int netlink_batch_ctx_list(struct dplane_ctx_q *ctx_list,
+				  int (*encode)(struct zebra_dplane_ctx *ctx,
+						struct nl_batch *bth));
+
 #endif /* HAVE_NETLINK */
 
 #ifdef __cplusplus
@@ -54,6 +54,7 @@
 #include "zebra/zebra_rnh.h"
 #include "zebra/zebra_pbr.h"
 #include "zebra/zebra_vxlan.h"
+#include "zebra/if_netlink.h"
 
 #if defined(HANDLE_NETLINK_FUZZING)
 #include "zebra/kernel_netlink.h"
@@ -157,6 +158,10 @@ static void sigint(void)
 
 	zebra_ptm_finish();
 
+#ifdef HAVE_NETLINK
+	netlink_if_event_finish();
+#endif
+
 	if (retain_mode)
 		RB_FOREACH (vrf, vrf_name_head, &vrfs_by_name) {
 			zvrf = vrf->info;
@@ -168,6 +173,9 @@ static void sigint(void)
 
 	vrf_terminate();
 
+	/* Unreferenced nexthop groups kept for reuse go with the routes */
+	zebra_nhg_gc_flush();
+
 	ns_walk_func(zebra_ns_early_shutdown);
 	zebra_ns_notify_close();
 
@@ -192,14 +200,21 @@ int zebra_finalize(struct thread *dummy)
 {
 	zlog_info("Zebra final shutdown");
 
-	/* Final shutdown of ns resources */
-	ns_walk_func(zebra_ns_final_shutdown);
-
 	/* Stop dplane thread and finish any cleanup */
 	zebra_dplane_shutdown();
 
+	/* PBR rules are removed right away, while the dataplane's netlink
+	 * socket is still open.
+	 */
+	hash_clean(zrouter.rules_hash, zebra_pbr_rules_free);
+
+	/* Final shutdown of ns resources */
+	ns_walk_func(zebra_ns_final_shutdown);
+
 	zebra_router_terminate();
 
+	route_entry_pool_fini();
+
 	frr_fini();
 	exit(0);
 }
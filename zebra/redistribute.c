@@ -157,6 +157,7 @@ void redistribute_update(const struct prefix *p, const struct prefix *src_p,
 	int send_redistribute;
 	int afi;
 	char buf[PREFIX_STRLEN];
+	struct stream *add_msg = NULL, *del_msg = NULL;
 
 	if (IS_ZEBRA_DEBUG_RIB) {
 		zlog_debug(
@@ -210,8 +211,14 @@ void redistribute_update(const struct prefix *p, const struct prefix *src_p,
 					   re->vrf_id, re->type,
 					   re->distance, re->metric);
 			}
-			zsend_redistribute_route(ZEBRA_REDISTRIBUTE_ROUTE_ADD,
-						 client, p, src_p, re);
+			if (!add_msg)
+				add_msg = zapi_redistribute_route_encode(
+					ZEBRA_REDISTRIBUTE_ROUTE_ADD, p, src_p,
+					re);
+			if (add_msg)
+				zsend_redistribute_route_msg(
+					ZEBRA_REDISTRIBUTE_ROUTE_ADD, client, p,
+					src_p, re, add_msg);
 		} else if (prev_re
 			   && ((re->instance
 				&& redist_check_instance(
@@ -221,10 +228,21 @@ void redistribute_update(const struct prefix *p, const struct prefix *src_p,
 			       || vrf_bitmap_check(
 					  client->redist[afi][prev_re->type],
 					  re->vrf_id))) {
-			zsend_redistribute_route(ZEBRA_REDISTRIBUTE_ROUTE_DEL,
-						 client, p, src_p, prev_re);
+			if (!del_msg)
+				del_msg = zapi_redistribute_route_encode(
+					ZEBRA_REDISTRIBUTE_ROUTE_DEL, p, src_p,
+					prev_re);
+			if (del_msg)
+				zsend_redistribute_route_msg(
+					ZEBRA_REDISTRIBUTE_ROUTE_DEL, client, p,
+					src_p, prev_re, del_msg);
 		}
 	}
+
+	if (add_msg)
+		stream_free(add_msg);
+	if (del_msg)
+		stream_free(del_msg);
 }
 
 /*
@@ -244,6 +262,7 @@ void redistribute_delete(const struct prefix *p, const struct prefix *src_p,
 	int afi;
 	char buf[PREFIX_STRLEN];
 	vrf_id_t vrfid;
+	struct stream *del_msg = NULL;
 
 	if (old_re)
 		vrfid = old_re->vrf_id;
@@ -321,10 +340,19 @@ void redistribute_delete(const struct prefix *p, const struct prefix *src_p,
 				       old_re->instance))
 			|| vrf_bitmap_check(client->redist[afi][old_re->type],
 					    old_re->vrf_id))) {
-			zsend_redistribute_route(ZEBRA_REDISTRIBUTE_ROUTE_DEL,
-						 client, p, src_p, old_re);
+			if (!del_msg)
+				del_msg = zapi_redistribute_route_encode(
+					ZEBRA_REDISTRIBUTE_ROUTE_DEL, p, src_p,
+					old_re);
+			if (del_msg)
+				zsend_redistribute_route_msg(
+					ZEBRA_REDISTRIBUTE_ROUTE_DEL, client, p,
+					src_p, old_re, del_msg);
 		}
 	}
+
+	if (del_msg)
+		stream_free(del_msg);
 }
 
 void zebra_redistribute_add(ZAPI_HANDLER_ARGS)
@@ -669,7 +697,7 @@ int zebra_add_import_table_entry(struct zebra_vrf *zvrf, struct route_node *rn,
 		zebra_del_import_table_entry(zvrf, rn, same);
 	}
 
-	newre = XCALLOC(MTYPE_RE, sizeof(struct route_entry));
+	newre = route_entry_new();
 	newre->type = ZEBRA_ROUTE_TABLE;
 	newre->distance = zebra_import_table_distance[afi][re->table];
 	newre->flags = re->flags;
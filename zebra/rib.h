@@ -43,6 +43,7 @@ extern "C" {
 typedef enum { RNH_NEXTHOP_TYPE, RNH_IMPORT_CHECK_TYPE } rnh_type_t;
 
 PREDECL_LIST(rnh_list)
+PREDECL_LIST(nhg_resolve_list)
 
 /* Nexthop structure. */
 struct rnh {
@@ -137,6 +138,8 @@ struct route_entry {
 #define ROUTE_ENTRY_INSTALLED        0x10
 /* Route has Failed installation into the Data Plane in some manner */
 #define ROUTE_ENTRY_FAILED           0x20
+/* Kernel route not yet confirmed by a resync with the kernel */
+#define ROUTE_ENTRY_STALE            0x40
 
 	/* Sequence value incremented for each dataplane operation */
 	uint32_t dplane_sequence;
@@ -161,9 +164,27 @@ struct route_entry {
  * sub-queue 5: any other origin (if any)
  */
 #define MQ_SIZE 6
+
+/* Per sub-queue processing counters, shown under "show zebra". */
+struct meta_queue_stats {
+	uint64_t processed; /* entries taken off the sub-queue */
+	uint64_t runs;      /* work queue invocations serving it */
+	uint64_t usecs;     /* time spent processing its entries */
+	uint32_t max_batch; /* largest number of entries in a single run */
+};
+
 struct meta_queue {
 	struct list *subq[MQ_SIZE];
 	uint32_t size; /* sum of lengths of all subqueues */
+
+	/*
+	 * When non-zero, up to this many route nodes are drained from a
+	 * sub-queue per run and processed in table/prefix order.
+	 */
+	uint32_t batch;
+	struct route_node **batch_nodes;
+
+	struct meta_queue_stats stats[MQ_SIZE];
 };
 
 /*
@@ -198,11 +219,23 @@ typedef struct rib_dest_t_ {
 	 */
 	struct rnh_list_head nht;
 
+	/*
+	 * Cached nexthop resolutions whose longest match lookup
+	 * returned this route node, see zebra_nhg.c.
+	 */
+	struct nhg_resolve_list_head nh_resolve;
+
 	/*
 	 * Linkage to put dest on the FPM processing queue.
 	 */
 	TAILQ_ENTRY(rib_dest_t_) fpm_q_entries;
 
+	/*
+	 * FPM sequence number of the last update to this dest, used to
+	 * resume an FPM session.
+	 */
+	uint64_t fpm_seq;
+
 } rib_dest_t;
 
 DECLARE_LIST(rnh_list, struct rnh, rnh_list_item);
@@ -307,6 +340,10 @@ typedef enum {
 	RIB_UPDATE_MAX
 } rib_update_event_t;
 
+extern struct route_entry *route_entry_new(void);
+extern void route_entry_free(struct route_entry *re);
+extern void route_entry_pool_fini(void);
+
 extern struct nexthop *route_entry_nexthop_ifindex_add(struct route_entry *re,
 						       ifindex_t ifindex,
 						       vrf_id_t nh_vrf_id);
@@ -370,6 +407,11 @@ extern int rib_add(afi_t afi, safi_t safi, vrf_id_t vrf_id, int type,
 extern int rib_add_multipath(afi_t afi, safi_t safi, struct prefix *p,
 			     struct prefix_ipv6 *src_p, struct route_entry *re);
 
+extern int rib_add_multipath_nhg(afi_t afi, safi_t safi, struct prefix *p,
+				 struct prefix_ipv6 *src_p,
+				 struct route_entry *re,
+				 struct nexthop_group *ng);
+
 extern void rib_delete(afi_t afi, safi_t safi, vrf_id_t vrf_id, int type,
 		       unsigned short instance, int flags, struct prefix *p,
 		       struct prefix_ipv6 *src_p, const struct nexthop *nh,
@@ -392,6 +434,9 @@ extern void rib_update_table(struct route_table *table,
 			     rib_update_event_t event);
 extern int rib_sweep_route(struct thread *t);
 extern void rib_sweep_table(struct route_table *table);
+extern unsigned long rib_sweep_stale_proto(uint8_t proto);
+extern void rib_mark_kernel_stale(ns_id_t ns_id);
+extern unsigned long rib_sweep_kernel_stale(ns_id_t ns_id);
 extern void rib_close_table(struct route_table *table);
 extern void rib_init(void);
 extern unsigned long rib_score_proto(uint8_t proto, unsigned short instance);
@@ -406,6 +451,7 @@ struct nhg_ctx; /* Forward declaration */
 extern int rib_queue_nhg_add(struct nhg_ctx *ctx);
 
 extern void meta_queue_free(struct meta_queue *mq);
+extern void rib_meta_queue_batch_set(uint32_t batch);
 extern int zebra_rib_labeled_unicast(struct route_entry *re);
 extern struct route_table *rib_table_ipv6;
 
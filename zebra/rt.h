@@ -48,12 +48,37 @@ extern "C" {
 extern enum zebra_dplane_result kernel_route_update(
 	struct zebra_dplane_ctx *ctx);
 
+/*
+ * Kernel-facing state private to one dataplane worker pthread, such as its
+ * own sockets. Returns NULL if the platform can't run parallel workers.
+ */
+struct kernel_dplane_worker;
+
+extern struct kernel_dplane_worker *kernel_dplane_worker_new(const char *name);
+extern void kernel_dplane_worker_free(struct kernel_dplane_worker **pkw);
+extern void kernel_dplane_worker_close_ns(struct kernel_dplane_worker *kw,
+					  ns_id_t ns_id);
+
+/*
+ * Update or delete a list of routes, setting the result in each context.
+ * A worker, if given, sends the updates on its own sockets.
+ * Returns the number of batches the updates were sent to the kernel in.
+ */
+extern int kernel_route_update_multi(struct kernel_dplane_worker *kw,
+				     struct dplane_ctx_q *ctx_list);
+
 extern enum zebra_dplane_result
 kernel_nexthop_update(struct zebra_dplane_ctx *ctx);
 
 extern enum zebra_dplane_result kernel_lsp_update(
 	struct zebra_dplane_ctx *ctx);
 
+/*
+ * Install, update or delete a list of LSPs, setting the result in each
+ * context. Returns the number of batches the updates were sent in.
+ */
+extern int kernel_lsp_update_multi(struct dplane_ctx_q *ctx_list);
+
 enum zebra_dplane_result kernel_pw_update(struct zebra_dplane_ctx *ctx);
 
 enum zebra_dplane_result kernel_address_update_ctx(
@@ -63,6 +88,12 @@ enum zebra_dplane_result kernel_mac_update_ctx(struct zebra_dplane_ctx *ctx);
 
 enum zebra_dplane_result kernel_neigh_update_ctx(struct zebra_dplane_ctx *ctx);
 
+/*
+ * Update a list of EVPN MACs and neighbors, setting the result in each
+ * context. Returns the number of batches the updates were sent in.
+ */
+extern int kernel_mac_neigh_update_multi(struct dplane_ctx_q *ctx_list);
+
 extern int kernel_neigh_update(int cmd, int ifindex, uint32_t addr, char *lla,
 			       int llalen, ns_id_t ns_id);
 extern int kernel_interface_set_master(struct interface *master,
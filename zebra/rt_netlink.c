@@ -740,7 +740,7 @@ static int netlink_route_change_read_unicast(struct nlmsghdr *h, ns_id_t ns_id,
 			struct rtnexthop *rtnh =
 				(struct rtnexthop *)RTA_DATA(tb[RTA_MULTIPATH]);
 
-			re = XCALLOC(MTYPE_RE, sizeof(struct route_entry));
+			re = route_entry_new();
 			re->type = proto;
 			re->distance = distance;
 			re->flags = flags;
@@ -767,7 +767,7 @@ static int netlink_route_change_read_unicast(struct nlmsghdr *h, ns_id_t ns_id,
 				rib_add_multipath(afi, SAFI_UNICAST, &p,
 						  &src_p, re);
 			else
-				XFREE(MTYPE_RE, re);
+				route_entry_free(re);
 		}
 	} else {
 		if (nhe_id) {
@@ -1017,6 +1017,32 @@ int netlink_route_read(struct zebra_ns *zns)
 	return 0;
 }
 
+/*
+ * Read the routing tables back from the kernel after messages from it were
+ * lost. Unlike at startup, the routes we installed ourselves are ignored.
+ */
+int netlink_route_resync(struct zebra_ns *zns)
+{
+	int ret;
+	struct zebra_dplane_info dp_info;
+
+	zebra_dplane_info_from_zns(&dp_info, zns, true /*is_cmd*/);
+
+	ret = netlink_request_route(zns, AF_INET, RTM_GETROUTE);
+	if (ret < 0)
+		return ret;
+	ret = netlink_parse_info(netlink_route_change_read_unicast,
+				 &zns->netlink_cmd, &dp_info, 0, 0);
+	if (ret < 0)
+		return ret;
+
+	ret = netlink_request_route(zns, AF_INET6, RTM_GETROUTE);
+	if (ret < 0)
+		return ret;
+	return netlink_parse_info(netlink_route_change_read_unicast,
+				  &zns->netlink_cmd, &dp_info, 0, 0);
+}
+
 static void _netlink_route_nl_add_gateway_info(uint8_t route_family,
 					       uint8_t gw_family,
 					       struct nlmsghdr *nlmsg,
@@ -1515,9 +1541,17 @@ static int netlink_neigh_update(int cmd, int ifindex, uint32_t addr, char *lla,
 }
 
 /*
- * Routing table change via netlink interface, using a dataplane context object
+ * Encode a routing table change from a dataplane context object into 'buf'.
+ * With 'nhg_id', the nexthops are referenced by the context's nexthop group
+ * id rather than listed.
+ *
+ * Returns the length of the message, 0 if there is no useful nexthop to
+ * send, or -1 if 'buf' is too small.
  */
-static int netlink_route_multipath(int cmd, struct zebra_dplane_ctx *ctx)
+ssize_t netlink_route_multipath_msg_encode(int cmd,
+					   struct zebra_dplane_ctx *ctx,
+					   uint8_t *buf, size_t buflen,
+					   bool nhg_id)
 {
 	int bytelen;
 	struct nexthop *nexthop = NULL;
@@ -1639,8 +1673,8 @@ static int netlink_route_multipath(int cmd, struct zebra_dplane_ctx *ctx)
 			  RTA_PAYLOAD(rta));
 	}
 
-	if (supports_nh) {
-		/* Kernel supports nexthop objects */
+	if (nhg_id) {
+		/* Nexthops were sent as a nexthop object */
 		addattr32(&req.n, sizeof(req), RTA_NH_ID,
 			  dplane_ctx_get_nhe_id(ctx));
 		goto skip;
@@ -1835,6 +1869,38 @@ static int netlink_route_multipath(int cmd, struct zebra_dplane_ctx *ctx)
 	}
 
 skip:
+	if (req.n.nlmsg_len > buflen)
+		return -1;
+
+	memcpy(buf, &req, req.n.nlmsg_len);
+	return req.n.nlmsg_len;
+}
+
+/*
+ * Routing table change via netlink interface, using a dataplane context object
+ *
+ * With a batch the request is only queued, and its result is reported to
+ * the batch's callback with 'arg'; returns 1 in that case.
+ */
+static int netlink_route_multipath(int cmd, struct zebra_dplane_ctx *ctx,
+				   struct nl_batch *bth, void *arg)
+{
+	struct {
+		struct nlmsghdr n;
+		struct rtmsg r;
+		char buf[NL_PKT_BUF_SIZE];
+	} req;
+	ssize_t len;
+
+	len = netlink_route_multipath_msg_encode(cmd, ctx, (uint8_t *)&req,
+						 sizeof(req), supports_nh);
+	if (len <= 0)
+		return len;
+
+	if (bth)
+		return netlink_batch_add(bth, &req.n, dplane_ctx_get_ns(ctx),
+					 arg);
+
 	/* Talk to netlink socket. */
 	return netlink_talk_info(netlink_talk_filter, &req.n,
 				 dplane_ctx_get_ns(ctx), 0);
@@ -1934,13 +2000,17 @@ static void _netlink_nexthop_build_group(struct nlmsghdr *n, size_t req_size,
 }
 
 /**
- * netlink_nexthop() - Nexthop change via the netlink interface
+ * netlink_nexthop_msg_encode() - Encode a nexthop change
  *
+ * @cmd:	RTM_NEWNEXTHOP or RTM_DELNEXTHOP
  * @ctx:	Dataplane ctx
+ * @buf:	Buffer to encode the message into
+ * @buflen:	Size of buf
  *
- * Return:	Result status
+ * Return:	Length of the message, or -1 on failure
  */
-static int netlink_nexthop(int cmd, struct zebra_dplane_ctx *ctx)
+ssize_t netlink_nexthop_msg_encode(int cmd, struct zebra_dplane_ctx *ctx,
+				   uint8_t *buf, size_t buflen)
 {
 	struct {
 		struct nlmsghdr n;
@@ -1953,10 +2023,6 @@ static int netlink_nexthop(int cmd, struct zebra_dplane_ctx *ctx)
 	int num_labels = 0;
 	size_t req_size = sizeof(req);
 
-	/* Nothing to do if the kernel doesn't support nexthop objects */
-	if (!supports_nh)
-		return 0;
-
 	label_buf[0] = '\0';
 
 	memset(&req, 0, req_size);
@@ -2090,6 +2156,36 @@ static int netlink_nexthop(int cmd, struct zebra_dplane_ctx *ctx)
 
 	_netlink_nexthop_debug(cmd, id);
 
+	if (req.n.nlmsg_len > buflen)
+		return -1;
+
+	memcpy(buf, &req, req.n.nlmsg_len);
+	return req.n.nlmsg_len;
+}
+
+/**
+ * netlink_nexthop() - Nexthop change via the netlink interface
+ *
+ * @ctx:	Dataplane ctx
+ *
+ * Return:	Result status
+ */
+static int netlink_nexthop(int cmd, struct zebra_dplane_ctx *ctx)
+{
+	struct {
+		struct nlmsghdr n;
+		struct nhmsg nhm;
+		char buf[NL_PKT_BUF_SIZE];
+	} req;
+
+	/* Nothing to do if the kernel doesn't support nexthop objects */
+	if (!supports_nh)
+		return 0;
+
+	if (netlink_nexthop_msg_encode(cmd, ctx, (uint8_t *)&req, sizeof(req))
+	    < 0)
+		return -1;
+
 	return netlink_talk_info(netlink_talk_filter, &req.n,
 				 dplane_ctx_get_ns(ctx), 0);
 }
@@ -2135,6 +2231,14 @@ enum zebra_dplane_result kernel_nexthop_update(struct zebra_dplane_ctx *ctx)
 	case DPLANE_OP_NEIGH_DELETE:
 	case DPLANE_OP_VTEP_ADD:
 	case DPLANE_OP_VTEP_DELETE:
+	case DPLANE_OP_RULE_ADD:
+	case DPLANE_OP_RULE_DELETE:
+	case DPLANE_OP_IPSET_ADD:
+	case DPLANE_OP_IPSET_DELETE:
+	case DPLANE_OP_IPSET_ENTRY_ADD:
+	case DPLANE_OP_IPSET_ENTRY_DELETE:
+	case DPLANE_OP_IPTABLE_ADD:
+	case DPLANE_OP_IPTABLE_DELETE:
 	case DPLANE_OP_NONE:
 		flog_err(
 			EC_ZEBRA_NHG_FIB_UPDATE,
@@ -2150,64 +2254,68 @@ enum zebra_dplane_result kernel_nexthop_update(struct zebra_dplane_ctx *ctx)
 }
 
 /*
- * Update or delete a prefix from the kernel,
- * using info from a dataplane context.
+ * Work out the netlink command for a route update context. Some updates
+ * first need the old route removed: that request is issued here, with its
+ * result ignored.
  */
-enum zebra_dplane_result kernel_route_update(struct zebra_dplane_ctx *ctx)
+static int netlink_route_update_cmd(struct zebra_dplane_ctx *ctx,
+				    struct nl_batch *bth)
 {
-	int cmd, ret;
 	const struct prefix *p = dplane_ctx_get_dest(ctx);
-	struct nexthop *nexthop;
 
-	if (dplane_ctx_get_op(ctx) == DPLANE_OP_ROUTE_DELETE) {
-		cmd = RTM_DELROUTE;
-	} else if (dplane_ctx_get_op(ctx) == DPLANE_OP_ROUTE_INSTALL) {
-		cmd = RTM_NEWROUTE;
-	} else if (dplane_ctx_get_op(ctx) == DPLANE_OP_ROUTE_UPDATE) {
+	if (dplane_ctx_get_op(ctx) == DPLANE_OP_ROUTE_DELETE)
+		return RTM_DELROUTE;
 
-		if (p->family == AF_INET || v6_rr_semantics) {
-			/* Single 'replace' operation */
-			cmd = RTM_NEWROUTE;
+	if (dplane_ctx_get_op(ctx) == DPLANE_OP_ROUTE_INSTALL)
+		return RTM_NEWROUTE;
 
-			/*
-			 * With route replace semantics in place
-			 * for v4 routes and the new route is a system
-			 * route we do not install anything.
-			 * The problem here is that the new system
-			 * route should cause us to withdraw from
-			 * the kernel the old non-system route
-			 */
-			if (RSYSTEM_ROUTE(dplane_ctx_get_type(ctx)) &&
-			    !RSYSTEM_ROUTE(dplane_ctx_get_old_type(ctx)))
-				(void)netlink_route_multipath(RTM_DELROUTE,
-							      ctx);
-		} else {
-			/*
-			 * So v6 route replace semantics are not in
-			 * the kernel at this point as I understand it.
-			 * so let's do a delete then an add.
-			 * In the future once v6 route replace semantics
-			 * are in we can figure out what to do here to
-			 * allow working with old and new kernels.
-			 *
-			 * I'm also intentionally ignoring the failure case
-			 * of the route delete.  If that happens yeah we're
-			 * screwed.
-			 */
-			if (!RSYSTEM_ROUTE(dplane_ctx_get_old_type(ctx)))
-				(void)netlink_route_multipath(RTM_DELROUTE,
-							      ctx);
-			cmd = RTM_NEWROUTE;
-		}
+	if (dplane_ctx_get_op(ctx) != DPLANE_OP_ROUTE_UPDATE)
+		return -1;
 
+	if (p->family == AF_INET || v6_rr_semantics) {
+		/* Single 'replace' operation */
+
+		/*
+		 * With route replace semantics in place
+		 * for v4 routes and the new route is a system
+		 * route we do not install anything.
+		 * The problem here is that the new system
+		 * route should cause us to withdraw from
+		 * the kernel the old non-system route
+		 */
+		if (RSYSTEM_ROUTE(dplane_ctx_get_type(ctx)) &&
+		    !RSYSTEM_ROUTE(dplane_ctx_get_old_type(ctx)))
+			(void)netlink_route_multipath(RTM_DELROUTE, ctx, bth,
+						      NULL);
 	} else {
-		return ZEBRA_DPLANE_REQUEST_FAILURE;
+		/*
+		 * So v6 route replace semantics are not in
+		 * the kernel at this point as I understand it.
+		 * so let's do a delete then an add.
+		 * In the future once v6 route replace semantics
+		 * are in we can figure out what to do here to
+		 * allow working with old and new kernels.
+		 *
+		 * I'm also intentionally ignoring the failure case
+		 * of the route delete.  If that happens yeah we're
+		 * screwed.
+		 */
+		if (!RSYSTEM_ROUTE(dplane_ctx_get_old_type(ctx)))
+			(void)netlink_route_multipath(RTM_DELROUTE, ctx, bth,
+						      NULL);
 	}
 
-	if (!RSYSTEM_ROUTE(dplane_ctx_get_type(ctx)))
-		ret = netlink_route_multipath(cmd, ctx);
-	else
-		ret = 0;
+	return RTM_NEWROUTE;
+}
+
+/*
+ * Record the outcome of a route update in its context.
+ */
+static enum zebra_dplane_result
+netlink_route_update_result(struct zebra_dplane_ctx *ctx, int cmd, int ret)
+{
+	struct nexthop *nexthop;
+
 	if ((cmd == RTM_NEWROUTE) && (ret == 0)) {
 		/* Update installed nexthops to signal which have been
 		 * installed.
@@ -2226,6 +2334,85 @@ enum zebra_dplane_result kernel_route_update(struct zebra_dplane_ctx *ctx)
 		ZEBRA_DPLANE_REQUEST_SUCCESS : ZEBRA_DPLANE_REQUEST_FAILURE);
 }
 
+/*
+ * Update or delete a prefix from the kernel,
+ * using info from a dataplane context.
+ */
+enum zebra_dplane_result kernel_route_update(struct zebra_dplane_ctx *ctx)
+{
+	int cmd, ret;
+
+	cmd = netlink_route_update_cmd(ctx, NULL);
+	if (cmd < 0)
+		return ZEBRA_DPLANE_REQUEST_FAILURE;
+
+	if (!RSYSTEM_ROUTE(dplane_ctx_get_type(ctx)))
+		ret = netlink_route_multipath(cmd, ctx, NULL, NULL);
+	else
+		ret = 0;
+
+	return netlink_route_update_result(ctx, cmd, ret);
+}
+
+/* Result of a batched route request */
+static void netlink_route_batch_done(struct nlmsghdr *n, void *arg,
+				     int error)
+{
+	struct zebra_dplane_ctx *ctx = arg;
+
+	dplane_ctx_set_status(
+		ctx, netlink_route_update_result(ctx, n->nlmsg_type, error));
+}
+
+/*
+ * Update or delete a list of prefixes from the kernel, batching the
+ * netlink requests. The result of each update is set in its context.
+ * A worker sends on its own sockets.
+ *
+ * Returns the number of batches sent to the kernel.
+ */
+int kernel_route_update_multi(struct kernel_dplane_worker *kw,
+			      struct dplane_ctx_q *ctx_list)
+{
+	struct dplane_ctx_q done_list;
+	struct zebra_dplane_ctx *ctx;
+	struct nl_batch bth;
+	int cmd, ret;
+
+	TAILQ_INIT(&done_list);
+	netlink_batch_init(&bth, netlink_route_batch_done);
+	bth.worker = kw;
+
+	while ((ctx = dplane_ctx_dequeue(ctx_list)) != NULL) {
+		dplane_ctx_enqueue_tail(&done_list, ctx);
+
+		cmd = netlink_route_update_cmd(ctx, &bth);
+		if (cmd < 0) {
+			dplane_ctx_set_status(ctx,
+					      ZEBRA_DPLANE_REQUEST_FAILURE);
+			continue;
+		}
+
+		if (!RSYSTEM_ROUTE(dplane_ctx_get_type(ctx)))
+			ret = netlink_route_multipath(cmd, ctx, &bth, ctx);
+		else
+			ret = 0;
+
+		/* Queued: the result comes back with the kernel's ACK */
+		if (ret > 0)
+			continue;
+
+		dplane_ctx_set_status(ctx, netlink_route_update_result(ctx, cmd,
+								       ret));
+	}
+
+	netlink_batch_fini(&bth);
+
+	dplane_ctx_list_append(ctx_list, &done_list);
+
+	return bth.batches;
+}
+
 /**
  * netlink_nexthop_process_nh() - Parse the gatway/if info from a new nexthop
  *
@@ -2903,9 +3090,12 @@ int netlink_macfdb_read_specific_mac(struct zebra_ns *zns,
 
 /*
  * Netlink-specific handler for MAC updates using dataplane context object.
+ *
+ * With a batch the request is only queued, and its result is reported to
+ * the batch's callback with 'ctx'; returns 1 in that case.
  */
-static enum zebra_dplane_result
-netlink_macfdb_update_ctx(struct zebra_dplane_ctx *ctx)
+static int netlink_macfdb_update_ctx(struct zebra_dplane_ctx *ctx,
+				     struct nl_batch *bth)
 {
 	uint8_t protocol = RTPROT_ZEBRA;
 	struct {
@@ -2913,7 +3103,6 @@ netlink_macfdb_update_ctx(struct zebra_dplane_ctx *ctx)
 		struct ndmsg ndm;
 		char buf[256];
 	} req;
-	int ret;
 	int dst_alen;
 	int vid_present = 0;
 	int cmd;
@@ -2984,12 +3173,12 @@ netlink_macfdb_update_ctx(struct zebra_dplane_ctx *ctx)
 			   buf, dst_buf);
 	}
 
-	ret = netlink_talk_info(netlink_talk_filter, &req.n,
-				dplane_ctx_get_ns(ctx), 0);
-	if (ret == 0)
-		return ZEBRA_DPLANE_REQUEST_SUCCESS;
-	else
-		return ZEBRA_DPLANE_REQUEST_FAILURE;
+	if (bth)
+		return netlink_batch_add(bth, &req.n, dplane_ctx_get_ns(ctx),
+					 ctx);
+
+	return netlink_talk_info(netlink_talk_filter, &req.n,
+				 dplane_ctx_get_ns(ctx), 0);
 }
 
 /*
@@ -3357,9 +3546,10 @@ int netlink_neigh_change(struct nlmsghdr *h, ns_id_t ns_id)
 
 /*
  * Utility neighbor-update function, using info from dplane context.
+ * With a batch the request is only queued, as for MAC updates.
  */
-static int netlink_neigh_update_ctx(const struct zebra_dplane_ctx *ctx,
-				    int cmd)
+static int netlink_neigh_update_ctx(struct zebra_dplane_ctx *ctx, int cmd,
+				    struct nl_batch *bth)
 {
 	uint8_t protocol = RTPROT_ZEBRA;
 	struct {
@@ -3414,6 +3604,10 @@ static int netlink_neigh_update_ctx(const struct zebra_dplane_ctx *ctx,
 			       : "null",
 			   flags, state);
 
+	if (bth)
+		return netlink_batch_add(bth, &req.n, dplane_ctx_get_ns(ctx),
+					 ctx);
+
 	return netlink_talk_info(netlink_talk_filter, &req.n,
 				 dplane_ctx_get_ns(ctx), 0);
 }
@@ -3423,7 +3617,8 @@ static int netlink_neigh_update_ctx(const struct zebra_dplane_ctx *ctx,
  */
 enum zebra_dplane_result kernel_mac_update_ctx(struct zebra_dplane_ctx *ctx)
 {
-	return netlink_macfdb_update_ctx(ctx);
+	return (netlink_macfdb_update_ctx(ctx, NULL) == 0 ?
+		ZEBRA_DPLANE_REQUEST_SUCCESS : ZEBRA_DPLANE_REQUEST_FAILURE);
 }
 
 enum zebra_dplane_result kernel_neigh_update_ctx(struct zebra_dplane_ctx *ctx)
@@ -3433,10 +3628,10 @@ enum zebra_dplane_result kernel_neigh_update_ctx(struct zebra_dplane_ctx *ctx)
 	switch (dplane_ctx_get_op(ctx)) {
 	case DPLANE_OP_NEIGH_INSTALL:
 	case DPLANE_OP_NEIGH_UPDATE:
-		ret = netlink_neigh_update_ctx(ctx, RTM_NEWNEIGH);
+		ret = netlink_neigh_update_ctx(ctx, RTM_NEWNEIGH, NULL);
 		break;
 	case DPLANE_OP_NEIGH_DELETE:
-		ret = netlink_neigh_update_ctx(ctx, RTM_DELNEIGH);
+		ret = netlink_neigh_update_ctx(ctx, RTM_DELNEIGH, NULL);
 		break;
 	case DPLANE_OP_VTEP_ADD:
 		ret = netlink_vxlan_flood_update_ctx(ctx, RTM_NEWNEIGH);
@@ -3452,11 +3647,43 @@ enum zebra_dplane_result kernel_neigh_update_ctx(struct zebra_dplane_ctx *ctx)
 		ZEBRA_DPLANE_REQUEST_SUCCESS : ZEBRA_DPLANE_REQUEST_FAILURE);
 }
 
+/* Queue the request of a MAC or neighbor update on a batch */
+static int netlink_mac_neigh_update_encode(struct zebra_dplane_ctx *ctx,
+					   struct nl_batch *bth)
+{
+	switch (dplane_ctx_get_op(ctx)) {
+	case DPLANE_OP_MAC_INSTALL:
+	case DPLANE_OP_MAC_DELETE:
+		return netlink_macfdb_update_ctx(ctx, bth);
+	case DPLANE_OP_NEIGH_INSTALL:
+	case DPLANE_OP_NEIGH_UPDATE:
+		return netlink_neigh_update_ctx(ctx, RTM_NEWNEIGH, bth);
+	case DPLANE_OP_NEIGH_DELETE:
+		return netlink_neigh_update_ctx(ctx, RTM_DELNEIGH, bth);
+	default:
+		return -1;
+	}
+}
+
+/*
+ * Update a list of EVPN MACs and neighbors in the kernel, batching the
+ * netlink requests. The result of each update is set in its context.
+ *
+ * Returns the number of batches sent to the kernel.
+ */
+int kernel_mac_neigh_update_multi(struct dplane_ctx_q *ctx_list)
+{
+	return netlink_batch_ctx_list(ctx_list,
+				      netlink_mac_neigh_update_encode);
+}
+
 /*
  * MPLS label forwarding table change via netlink interface, using dataplane
- * context information.
+ * context information. With a batch the request is only queued: the return
+ * is then 1, and the result comes back through the batch's callback.
  */
-int netlink_mpls_multipath(int cmd, struct zebra_dplane_ctx *ctx)
+int netlink_mpls_multipath(int cmd, struct zebra_dplane_ctx *ctx,
+			   struct nl_batch *bth)
 {
 	mpls_lse_t lse;
 	const zebra_nhlfe_t *nhlfe;
@@ -3604,6 +3831,10 @@ int netlink_mpls_multipath(int cmd, struct zebra_dplane_ctx *ctx)
 				  RTA_DATA(rta), RTA_PAYLOAD(rta));
 	}
 
+	if (bth)
+		return netlink_batch_add(bth, &req.n, dplane_ctx_get_ns(ctx),
+					 ctx);
+
 	/* Talk to netlink socket. */
 	return netlink_talk_info(netlink_talk_filter, &req.n,
 				 dplane_ctx_get_ns(ctx), 0);
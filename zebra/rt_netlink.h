@@ -63,11 +63,24 @@ extern "C" {
 
 void rt_netlink_init(void);
 
+struct nl_batch;
+
 /* MPLS label forwarding table change, using dataplane context information. */
-extern int netlink_mpls_multipath(int cmd, struct zebra_dplane_ctx *ctx);
+extern int netlink_mpls_multipath(int cmd, struct zebra_dplane_ctx *ctx,
+				  struct nl_batch *bth);
+
+/* Encode route and nexthop changes without sending them, e.g. for the FPM. */
+extern ssize_t netlink_route_multipath_msg_encode(int cmd,
+						  struct zebra_dplane_ctx *ctx,
+						  uint8_t *buf, size_t buflen,
+						  bool nhg_id);
+extern ssize_t netlink_nexthop_msg_encode(int cmd,
+					  struct zebra_dplane_ctx *ctx,
+					  uint8_t *buf, size_t buflen);
 
 extern int netlink_route_change(struct nlmsghdr *h, ns_id_t ns_id, int startup);
 extern int netlink_route_read(struct zebra_ns *zns);
+extern int netlink_route_resync(struct zebra_ns *zns);
 
 extern int netlink_nexthop_change(struct nlmsghdr *h, ns_id_t ns_id,
 				  int startup);
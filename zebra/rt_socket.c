@@ -364,6 +364,46 @@ enum zebra_dplane_result kernel_route_update(struct zebra_dplane_ctx *ctx)
 	return res;
 }
 
+/*
+ * The routing socket is shared: updates can't be sent from several
+ * pthreads in parallel.
+ */
+struct kernel_dplane_worker *kernel_dplane_worker_new(const char *name)
+{
+	return NULL;
+}
+
+void kernel_dplane_worker_free(struct kernel_dplane_worker **pkw)
+{
+}
+
+void kernel_dplane_worker_close_ns(struct kernel_dplane_worker *kw,
+				   ns_id_t ns_id)
+{
+}
+
+/*
+ * The routing socket has no batching: issue the updates one by one, and
+ * report that no batch was sent.
+ */
+int kernel_route_update_multi(struct kernel_dplane_worker *kw,
+			      struct dplane_ctx_q *ctx_list)
+{
+	struct dplane_ctx_q done_list;
+	struct zebra_dplane_ctx *ctx;
+
+	TAILQ_INIT(&done_list);
+
+	while ((ctx = dplane_ctx_dequeue(ctx_list)) != NULL) {
+		dplane_ctx_set_status(ctx, kernel_route_update(ctx));
+		dplane_ctx_enqueue_tail(&done_list, ctx);
+	}
+
+	dplane_ctx_list_append(ctx_list, &done_list);
+
+	return 0;
+}
+
 enum zebra_dplane_result kernel_nexthop_update(struct zebra_dplane_ctx *ctx)
 {
 	return ZEBRA_DPLANE_REQUEST_SUCCESS;
@@ -395,6 +435,24 @@ enum zebra_dplane_result kernel_mac_update_ctx(struct zebra_dplane_ctx *ctx)
 	return ZEBRA_DPLANE_REQUEST_SUCCESS;
 }
 
+/* Nothing to batch: MAC and neighbor updates are no-ops here too. */
+int kernel_mac_neigh_update_multi(struct dplane_ctx_q *ctx_list)
+{
+	struct dplane_ctx_q done_list;
+	struct zebra_dplane_ctx *ctx;
+
+	TAILQ_INIT(&done_list);
+
+	while ((ctx = dplane_ctx_dequeue(ctx_list)) != NULL) {
+		dplane_ctx_set_status(ctx, ZEBRA_DPLANE_REQUEST_SUCCESS);
+		dplane_ctx_enqueue_tail(&done_list, ctx);
+	}
+
+	dplane_ctx_list_append(ctx_list, &done_list);
+
+	return 0;
+}
+
 extern int kernel_interface_set_master(struct interface *master,
 				       struct interface *slave)
 {
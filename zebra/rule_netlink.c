@@ -48,13 +48,17 @@
 
 /* Private functions */
 
-/* Install or uninstall specified rule for a specific interface.
- * Form netlink message and ship it. Currently, notify status after
- * waiting for netlink status.
+/* Install or uninstall the rule of a dataplane context, for a specific
+ * interface. Form netlink message and ship it, waiting for netlink status.
+ *
+ * With a batch the request is only queued, and its result is reported to
+ * the batch's callback; returns 1 in that case.
  */
-static int netlink_rule_update(int cmd, struct zebra_pbr_rule *rule)
+static int netlink_rule_update(struct zebra_dplane_ctx *ctx,
+			       struct nl_batch *bth)
 {
 	uint8_t protocol = RTPROT_ZEBRA;
+	int cmd;
 	int family;
 	int bytelen;
 	struct {
@@ -62,11 +66,15 @@ static int netlink_rule_update(int cmd, struct zebra_pbr_rule *rule)
 		struct fib_rule_hdr frh;
 		char buf[NL_PKT_BUF_SIZE];
 	} req;
-	struct zebra_ns *zns = zebra_ns_lookup(NS_DEFAULT);
-	struct sockaddr_nl snl;
+	const struct zebra_pbr_rule *rule = dplane_ctx_get_pbr_rule(ctx);
 	char buf1[PREFIX_STRLEN];
 	char buf2[PREFIX_STRLEN];
 
+	if (dplane_ctx_get_op(ctx) == DPLANE_OP_RULE_ADD)
+		cmd = RTM_NEWRULE;
+	else
+		cmd = RTM_DELRULE;
+
 	memset(&req, 0, sizeof(req) - NL_PKT_BUF_SIZE);
 	family = PREFIX_FAMILY(&rule->rule.filter.src_ip);
 	bytelen = (family == AF_INET ? 4 : 16);
@@ -74,7 +82,7 @@ static int netlink_rule_update(int cmd, struct zebra_pbr_rule *rule)
 	req.n.nlmsg_type = cmd;
 	req.n.nlmsg_len = NLMSG_LENGTH(sizeof(struct rtmsg));
 	req.n.nlmsg_flags = NLM_F_REQUEST;
-	req.n.nlmsg_pid = zns->netlink_cmd.snl.nl_pid;
+	req.n.nlmsg_pid = dplane_ctx_get_ns(ctx)->nls.snl.nl_pid;
 
 	req.frh.family = family;
 	req.frh.action = FR_ACT_TO_TBL;
@@ -129,48 +137,40 @@ static int netlink_rule_update(int cmd, struct zebra_pbr_rule *rule)
 				   sizeof(buf2)),
 			rule->rule.action.table);
 
-	/* Ship off the message.
-	 * Note: Currently, netlink_talk() is a blocking call which returns
-	 * back the status.
-	 */
-	memset(&snl, 0, sizeof(snl));
-	snl.nl_family = AF_NETLINK;
-	return netlink_talk(netlink_talk_filter, &req.n,
-			    &zns->netlink_cmd, zns, 0);
+	/* Ship off the message */
+	if (bth)
+		return netlink_batch_add(bth, &req.n, dplane_ctx_get_ns(ctx),
+					 ctx);
+
+	return netlink_talk_info(netlink_talk_filter, &req.n,
+				 dplane_ctx_get_ns(ctx), 0);
 }
 
 
 /* Public functions */
 /*
- * Install specified rule for a specific interface. The preference is what
- * goes in the rule to denote relative ordering; it may or may not be the
- * same as the rule's user-defined sequence number.
+ * Install or uninstall the rule of a dataplane context, for a specific
+ * interface. The preference is what goes in the rule to denote relative
+ * ordering; it may or may not be the same as the rule's user-defined
+ * sequence number.
  */
-enum zebra_dplane_result kernel_add_pbr_rule(struct zebra_pbr_rule *rule)
+enum zebra_dplane_result kernel_pbr_rule_update(struct zebra_dplane_ctx *ctx)
 {
-	int ret = 0;
+	int ret;
 
-	ret = netlink_rule_update(RTM_NEWRULE, rule);
-	kernel_pbr_rule_add_del_status(rule,
-				       (!ret) ? ZEBRA_DPLANE_INSTALL_SUCCESS
-					      : ZEBRA_DPLANE_INSTALL_FAILURE);
+	ret = netlink_rule_update(ctx, NULL);
 
-	return ZEBRA_DPLANE_REQUEST_SUCCESS;
+	return (ret == 0 ? ZEBRA_DPLANE_REQUEST_SUCCESS
+			 : ZEBRA_DPLANE_REQUEST_FAILURE);
 }
 
 /*
- * Uninstall specified rule for a specific interface.
+ * Install or uninstall the rules of a list of dataplane contexts, batching
+ * the netlink requests. Returns the number of batches sent to the kernel.
  */
-enum zebra_dplane_result kernel_del_pbr_rule(struct zebra_pbr_rule *rule)
+int kernel_pbr_rule_update_multi(struct dplane_ctx_q *ctx_list)
 {
-	int ret = 0;
-
-	ret = netlink_rule_update(RTM_DELRULE, rule);
-	kernel_pbr_rule_add_del_status(rule,
-				       (!ret) ? ZEBRA_DPLANE_DELETE_SUCCESS
-					      : ZEBRA_DPLANE_DELETE_FAILURE);
-
-	return ZEBRA_DPLANE_REQUEST_SUCCESS;
+	return netlink_batch_ctx_list(ctx_list, netlink_rule_update);
 }
 
 /*
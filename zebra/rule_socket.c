@@ -43,18 +43,28 @@
 #include "zebra/zebra_pbr.h"
 #include "zebra/zebra_errors.h"
 
-enum zebra_dplane_result kernel_add_pbr_rule(struct zebra_pbr_rule *rule)
+enum zebra_dplane_result kernel_pbr_rule_update(struct zebra_dplane_ctx *ctx)
 {
 	flog_err(EC_LIB_UNAVAILABLE, "%s not Implemented for this platform",
 		 __PRETTY_FUNCTION__);
 	return ZEBRA_DPLANE_REQUEST_FAILURE;
 }
 
-enum zebra_dplane_result kernel_del_pbr_rule(struct zebra_pbr_rule *rule)
+int kernel_pbr_rule_update_multi(struct dplane_ctx_q *ctx_list)
 {
-	flog_err(EC_LIB_UNAVAILABLE, "%s not Implemented for this platform",
-		 __PRETTY_FUNCTION__);
-	return ZEBRA_DPLANE_REQUEST_FAILURE;
+	struct dplane_ctx_q done_list;
+	struct zebra_dplane_ctx *ctx;
+
+	TAILQ_INIT(&done_list);
+
+	while ((ctx = dplane_ctx_dequeue(ctx_list)) != NULL) {
+		dplane_ctx_set_status(ctx, kernel_pbr_rule_update(ctx));
+		dplane_ctx_enqueue_tail(&done_list, ctx);
+	}
+
+	dplane_ctx_list_append(ctx_list, &done_list);
+
+	return 0;
 }
 
 #endif
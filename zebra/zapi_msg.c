@@ -40,10 +40,12 @@
 #include "lib/nexthop.h"
 #include "lib/vrf.h"
 #include "lib/libfrr.h"
+#include "lib/nexthop_group_private.h"
 #include "lib/sockopt.h"
 
 #include "zebra/zebra_router.h"
 #include "zebra/rib.h"
+#include "zebra/connected.h"
 #include "zebra/zebra_memory.h"
 #include "zebra/zebra_ns.h"
 #include "zebra/zebra_vrf.h"
@@ -514,16 +516,19 @@ int zsend_interface_update(int cmd, struct zserv *client, struct interface *ifp)
 	return zserv_send_message(client, s);
 }
 
-int zsend_redistribute_route(int cmd, struct zserv *client,
-			     const struct prefix *p,
-			     const struct prefix *src_p,
-			     const struct route_entry *re)
+/*
+ * Encode a redistributed route. The message does not depend on the client it
+ * is sent to, so redistribute_update() and redistribute_delete() encode it
+ * once and hand a copy to each subscribed client.
+ */
+struct stream *zapi_redistribute_route_encode(int cmd, const struct prefix *p,
+					      const struct prefix *src_p,
+					      const struct route_entry *re)
 {
 	struct zapi_route api;
 	struct zapi_nexthop *api_nh;
 	struct nexthop *nexthop;
 	uint8_t count = 0;
-	afi_t afi;
 	size_t stream_size =
 		MAX(ZEBRA_MAX_PACKET_SIZ, sizeof(struct zapi_route));
 
@@ -534,24 +539,6 @@ int zsend_redistribute_route(int cmd, struct zserv *client,
 	api.instance = re->instance;
 	api.flags = re->flags;
 
-	afi = family2afi(p->family);
-	switch (afi) {
-	case AFI_IP:
-		if (cmd == ZEBRA_REDISTRIBUTE_ROUTE_ADD)
-			client->redist_v4_add_cnt++;
-		else
-			client->redist_v4_del_cnt++;
-		break;
-	case AFI_IP6:
-		if (cmd == ZEBRA_REDISTRIBUTE_ROUTE_ADD)
-			client->redist_v6_add_cnt++;
-		else
-			client->redist_v6_del_cnt++;
-		break;
-	default:
-		break;
-	}
-
 	/* Prefix. */
 	api.prefix = *p;
 	if (src_p) {
@@ -610,24 +597,100 @@ int zsend_redistribute_route(int cmd, struct zserv *client,
 
 	struct stream *s = stream_new(stream_size);
 
-	/* Encode route and send. */
+	/* Encode route. */
 	if (zapi_route_encode(cmd, s, &api) < 0) {
 		stream_free(s);
-		return -1;
+		return NULL;
+	}
+
+	return s;
+}
+
+/*
+ * Send a redistributed route encoded by zapi_redistribute_route_encode().
+ * The client gets its own copy of the message, 'msg' is left to the caller.
+ */
+int zsend_redistribute_route_msg(int cmd, struct zserv *client,
+				 const struct prefix *p,
+				 const struct prefix *src_p,
+				 const struct route_entry *re,
+				 struct stream *msg)
+{
+	struct zserv_coalesce_key key;
+	struct stream *copy;
+	size_t len;
+	uint32_t backlog;
+
+	switch (family2afi(p->family)) {
+	case AFI_IP:
+		if (cmd == ZEBRA_REDISTRIBUTE_ROUTE_ADD)
+			client->redist_v4_add_cnt++;
+		else
+			client->redist_v4_del_cnt++;
+		break;
+	case AFI_IP6:
+		if (cmd == ZEBRA_REDISTRIBUTE_ROUTE_ADD)
+			client->redist_v6_add_cnt++;
+		else
+			client->redist_v6_del_cnt++;
+		break;
+	default:
+		break;
 	}
 
 	if (IS_ZEBRA_DEBUG_SEND) {
 		char buf_prefix[PREFIX_STRLEN];
 
-		prefix2str(&api.prefix, buf_prefix, sizeof(buf_prefix));
+		prefix2str(p, buf_prefix, sizeof(buf_prefix));
 
 		zlog_debug("%s: %s to client %s: type %s, vrf_id %d, p %s",
 			   __func__, zserv_command_string(cmd),
 			   zebra_route_string(client->proto),
-			   zebra_route_string(api.type), api.vrf_id,
+			   zebra_route_string(re->type), re->vrf_id,
 			   buf_prefix);
 	}
-	return zserv_send_message(client, s);
+
+	/* Decremented by the client pthread once written out */
+	backlog = atomic_fetch_add_explicit(&client->redist_backlog, 1,
+					    memory_order_relaxed)
+		  + 1;
+	if (backlog > client->redist_backlog_max)
+		client->redist_backlog_max = backlog;
+
+	/* An add or delete of the route supersedes the queued one */
+	memset(&key, 0, sizeof(key));
+	key.cmd = ZEBRA_REDISTRIBUTE_ROUTE_ADD;
+	key.vrf_id = re->vrf_id;
+	key.type = re->type;
+	key.instance = re->instance;
+	prefix_copy(&key.p, p);
+	if (src_p)
+		prefix_copy(&key.src_p, src_p);
+
+	/* Only the encoded bytes, not the whole encode buffer */
+	len = stream_get_endp(msg);
+	copy = stream_new(len);
+	stream_put(copy, STREAM_DATA(msg), len);
+
+	return zserv_send_message_coalesce(client, copy, &key);
+}
+
+int zsend_redistribute_route(int cmd, struct zserv *client,
+			     const struct prefix *p,
+			     const struct prefix *src_p,
+			     const struct route_entry *re)
+{
+	struct stream *s;
+	int ret;
+
+	s = zapi_redistribute_route_encode(cmd, p, src_p, re);
+	if (!s)
+		return -1;
+
+	ret = zsend_redistribute_route_msg(cmd, client, p, src_p, re, s);
+	stream_free(s);
+
+	return ret;
 }
 
 /*
@@ -684,6 +747,72 @@ static int zsend_ipv4_nexthop_lookup_mrib(struct zserv *client,
 	return zserv_send_message(client, s);
 }
 
+/* Send a client's pending bulk route notifications, if any */
+static void route_notify_bulk_flush(struct zserv *client)
+{
+	struct stream *s = client->notify_bulk;
+
+	THREAD_OFF(client->t_notify_bulk);
+
+	if (!s)
+		return;
+
+	stream_putw_at(s, ZEBRA_HEADER_SIZE, client->notify_bulk_count);
+	stream_putw_at(s, 0, stream_get_endp(s));
+
+	client->notify_bulk = NULL;
+	client->notify_bulk_count = 0;
+
+	zserv_send_message(client, s);
+}
+
+static int route_notify_bulk_send(struct thread *thread)
+{
+	route_notify_bulk_flush(THREAD_ARG(thread));
+
+	return 0;
+}
+
+/*
+ * Add a route notification to the client's pending
+ * ZEBRA_ROUTE_NOTIFY_OWNER_BULK message. The message is sent when it
+ * fills up, or once the current task - typically processing a batch of
+ * dataplane results - completes.
+ */
+static int route_notify_bulk_add(struct zserv *client, const struct prefix *p,
+				 vrf_id_t vrf_id, uint32_t table_id,
+				 enum zapi_route_notify_owner note)
+{
+	struct stream *s = client->notify_bulk;
+
+	if (s && STREAM_WRITEABLE(s) < 4 + sizeof(note) + 2 + 16 + 4) {
+		route_notify_bulk_flush(client);
+		s = NULL;
+	}
+
+	if (!s) {
+		s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+		zclient_create_header(s, ZEBRA_ROUTE_NOTIFY_OWNER_BULK,
+				      VRF_DEFAULT);
+		stream_putw(s, 0);
+		client->notify_bulk = s;
+	}
+
+	stream_putl(s, vrf_id);
+	stream_put(s, &note, sizeof(note));
+	stream_putc(s, p->family);
+	stream_putc(s, p->prefixlen);
+	stream_put(s, &p->u.prefix, prefix_blen(p));
+	stream_putl(s, table_id);
+
+	client->notify_bulk_count++;
+
+	thread_add_event(zrouter.master, route_notify_bulk_send, client, 0,
+			 &client->t_notify_bulk);
+
+	return 0;
+}
+
 /*
  * Common utility send route notification, called from a path using a
  * route_entry and from a path using a dataplane context.
@@ -718,6 +847,10 @@ static int route_notify_internal(const struct prefix *p, int type,
 			   table_id, note, vrf_id);
 	}
 
+	if (client->notify_owner_bulk)
+		return route_notify_bulk_add(client, p, vrf_id, table_id,
+					     note);
+
 	s = stream_new(ZEBRA_MAX_PACKET_SIZ);
 	stream_reset(s);
 
@@ -1384,168 +1517,165 @@ void zserv_nexthop_num_warn(const char *caller, const struct prefix *p,
 	}
 }
 
-static void zread_route_add(ZAPI_HANDLER_ARGS)
+/*
+ * Fill in a nexthop from its zapi encoding. Returns false if the nexthop
+ * type is unknown.
+ */
+static bool zread_nexthop_fill(struct nexthop *nexthop,
+			       const struct zapi_nexthop *api_nh)
+{
+	struct interface *ifp;
+
+	memset(nexthop, 0, sizeof(*nexthop));
+	nexthop->type = api_nh->type;
+	nexthop->vrf_id = api_nh->vrf_id;
+
+	switch (api_nh->type) {
+	case NEXTHOP_TYPE_IFINDEX:
+		nexthop->ifindex = api_nh->ifindex;
+		break;
+	case NEXTHOP_TYPE_IPV4:
+		nexthop->gate.ipv4 = api_nh->gate.ipv4;
+		break;
+	case NEXTHOP_TYPE_IPV4_IFINDEX:
+		nexthop->gate.ipv4 = api_nh->gate.ipv4;
+		nexthop->ifindex = api_nh->ifindex;
+		ifp = if_lookup_by_index(nexthop->ifindex, nexthop->vrf_id);
+		if (ifp && connected_is_unnumbered(ifp))
+			SET_FLAG(nexthop->flags, NEXTHOP_FLAG_ONLINK);
+		break;
+	case NEXTHOP_TYPE_IPV6:
+		nexthop->gate.ipv6 = api_nh->gate.ipv6;
+		break;
+	case NEXTHOP_TYPE_IPV6_IFINDEX:
+		nexthop->gate.ipv6 = api_nh->gate.ipv6;
+		nexthop->ifindex = api_nh->ifindex;
+		break;
+	case NEXTHOP_TYPE_BLACKHOLE:
+		nexthop->vrf_id = VRF_DEFAULT;
+		nexthop->bh_type = api_nh->bh_type;
+		break;
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+/* Release the labels attached to a client's scratch nexthops */
+static void zread_nexthops_release(struct zserv *client, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+		nexthop_del_labels(&client->nh_scratch[i]);
+}
+
+static void zserv_route_add(struct zserv *client, struct zebra_vrf *zvrf,
+			    struct zapi_route *api)
 {
-	struct stream *s;
-	struct zapi_route api;
 	struct zapi_nexthop *api_nh;
 	afi_t afi;
 	struct prefix_ipv6 *src_p = NULL;
 	struct route_entry *re;
+	struct nexthop_group ng = {};
 	struct nexthop *nexthop = NULL;
 	int i, ret;
 	vrf_id_t vrf_id = 0;
 	struct ipaddr vtep_ip;
 
-	s = msg;
-	if (zapi_route_decode(s, &api) < 0) {
-		if (IS_ZEBRA_DEBUG_RECV)
-			zlog_debug("%s: Unable to decode zapi_route sent",
-				   __PRETTY_FUNCTION__);
-		return;
-	}
-
 	if (IS_ZEBRA_DEBUG_RECV) {
 		char buf_prefix[PREFIX_STRLEN];
 
-		prefix2str(&api.prefix, buf_prefix, sizeof(buf_prefix));
+		prefix2str(&api->prefix, buf_prefix, sizeof(buf_prefix));
 		zlog_debug("%s: p=%s, ZAPI_MESSAGE_LABEL: %sset, flags=0x%x",
 			   __func__, buf_prefix,
-			   (CHECK_FLAG(api.message, ZAPI_MESSAGE_LABEL) ? ""
+			   (CHECK_FLAG(api->message, ZAPI_MESSAGE_LABEL) ? ""
 									: "un"),
-			   api.flags);
+			   api->flags);
 	}
 
-	/* Allocate new route. */
-	vrf_id = zvrf_id(zvrf);
-	re = XCALLOC(MTYPE_RE, sizeof(struct route_entry));
-	re->type = api.type;
-	re->instance = api.instance;
-	re->flags = api.flags;
-	re->uptime = monotime(NULL);
-	re->vrf_id = vrf_id;
-	re->ng = nexthop_group_new();
-
-	if (api.tableid)
-		re->table = api.tableid;
-	else
-		re->table = zvrf->table_id;
-
-	if (!CHECK_FLAG(api.message, ZAPI_MESSAGE_NEXTHOP)
-	    || api.nexthop_num == 0) {
+	if (!CHECK_FLAG(api->message, ZAPI_MESSAGE_NEXTHOP)
+	    || api->nexthop_num == 0) {
 		flog_warn(EC_ZEBRA_RX_ROUTE_NO_NEXTHOPS,
 			  "%s: received a route without nexthops for prefix %pFX from client %s",
-			  __func__, &api.prefix,
+			  __func__, &api->prefix,
 			  zebra_route_string(client->proto));
+		return;
+	}
 
-		nexthop_group_delete(&re->ng);
-		XFREE(MTYPE_RE, re);
+	afi = family2afi(api->prefix.family);
+	if (afi != AFI_IP6 && CHECK_FLAG(api->message, ZAPI_MESSAGE_SRCPFX)) {
+		flog_warn(EC_ZEBRA_RX_SRCDEST_WRONG_AFI,
+			  "%s: Received SRC Prefix but afi is not v6",
+			  __PRETTY_FUNCTION__);
 		return;
 	}
+	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_SRCPFX))
+		src_p = &api->src_prefix;
 
 	/*
+	 * Build the nexthop group in the client's scratch nexthops rather
+	 * than allocating them: zebra only keeps copies of them, in the
+	 * nexthop hash entry the route ends up using.
+	 *
 	 * TBD should _all_ of the nexthop add operations use
 	 * api_nh->vrf_id instead of re->vrf_id ? I only changed
 	 * for cases NEXTHOP_TYPE_IPV4 and NEXTHOP_TYPE_IPV6.
 	 */
-	for (i = 0; i < api.nexthop_num; i++) {
-		api_nh = &api.nexthops[i];
-		ifindex_t ifindex = 0;
+	for (i = 0; i < api->nexthop_num; i++) {
+		api_nh = &api->nexthops[i];
+		nexthop = &client->nh_scratch[i];
 
-		if (IS_ZEBRA_DEBUG_RECV)
-			zlog_debug("nh type %d", api_nh->type);
-
-		switch (api_nh->type) {
-		case NEXTHOP_TYPE_IFINDEX:
-			nexthop = route_entry_nexthop_ifindex_add(
-				re, api_nh->ifindex, api_nh->vrf_id);
-			break;
-		case NEXTHOP_TYPE_IPV4:
-			if (IS_ZEBRA_DEBUG_RECV) {
-				char nhbuf[INET6_ADDRSTRLEN] = {0};
+		if (IS_ZEBRA_DEBUG_RECV) {
+			char nhbuf[INET6_ADDRSTRLEN] = {0};
 
+			if (api_nh->type == NEXTHOP_TYPE_IPV4
+			    || api_nh->type == NEXTHOP_TYPE_IPV4_IFINDEX)
 				inet_ntop(AF_INET, &api_nh->gate.ipv4, nhbuf,
 					  INET6_ADDRSTRLEN);
-				zlog_debug("%s: nh=%s, vrf_id=%d", __func__,
-					   nhbuf, api_nh->vrf_id);
-			}
-			nexthop = route_entry_nexthop_ipv4_add(
-				re, &api_nh->gate.ipv4, NULL, api_nh->vrf_id);
-			break;
-		case NEXTHOP_TYPE_IPV4_IFINDEX:
+			zlog_debug("%s: nh type %d, nh=%s, vrf_id=%d, ifindex=%d",
+				   __func__, api_nh->type, nhbuf,
+				   api_nh->vrf_id, api_nh->ifindex);
+		}
 
-			memset(&vtep_ip, 0, sizeof(struct ipaddr));
-			ifindex = api_nh->ifindex;
-			if (IS_ZEBRA_DEBUG_RECV) {
-				char nhbuf[INET6_ADDRSTRLEN] = {0};
+		if (!zread_nexthop_fill(nexthop, api_nh)) {
+			flog_warn(
+				EC_ZEBRA_NEXTHOP_CREATION_FAILED,
+				"%s: Nexthops Specified: %d but we failed to properly create one",
+				__PRETTY_FUNCTION__, api->nexthop_num);
+			zread_nexthops_release(client, i);
+			return;
+		}
 
-				inet_ntop(AF_INET, &api_nh->gate.ipv4, nhbuf,
-					  INET6_ADDRSTRLEN);
-				zlog_debug(
-					"%s: nh=%s, vrf_id=%d (re->vrf_id=%d), ifindex=%d",
-					__func__, nhbuf, api_nh->vrf_id,
-					re->vrf_id, ifindex);
-			}
-			nexthop = route_entry_nexthop_ipv4_ifindex_add(
-				re, &api_nh->gate.ipv4, NULL, ifindex,
-				api_nh->vrf_id);
-
-			/* Special handling for IPv4 routes sourced from EVPN:
-			 * the nexthop and associated MAC need to be installed.
-			 */
-			if (CHECK_FLAG(api.flags, ZEBRA_FLAG_EVPN_ROUTE)) {
+		/* Special handling for routes sourced from EVPN:
+		 * the nexthop and associated MAC need to be installed.
+		 */
+		if (CHECK_FLAG(api->flags, ZEBRA_FLAG_EVPN_ROUTE)) {
+			memset(&vtep_ip, 0, sizeof(struct ipaddr));
+			if (api_nh->type == NEXTHOP_TYPE_IPV4_IFINDEX) {
 				vtep_ip.ipa_type = IPADDR_V4;
 				memcpy(&(vtep_ip.ipaddr_v4),
 				       &(api_nh->gate.ipv4),
 				       sizeof(struct in_addr));
 				zebra_vxlan_evpn_vrf_route_add(
 					api_nh->vrf_id, &api_nh->rmac,
-					&vtep_ip, &api.prefix);
-			}
-			break;
-		case NEXTHOP_TYPE_IPV6:
-			nexthop = route_entry_nexthop_ipv6_add(
-				re, &api_nh->gate.ipv6, api_nh->vrf_id);
-			break;
-		case NEXTHOP_TYPE_IPV6_IFINDEX:
-			memset(&vtep_ip, 0, sizeof(struct ipaddr));
-			ifindex = api_nh->ifindex;
-			nexthop = route_entry_nexthop_ipv6_ifindex_add(
-				re, &api_nh->gate.ipv6, ifindex,
-				api_nh->vrf_id);
-
-			/* Special handling for IPv6 routes sourced from EVPN:
-			 * the nexthop and associated MAC need to be installed.
-			 */
-			if (CHECK_FLAG(api.flags, ZEBRA_FLAG_EVPN_ROUTE)) {
+					&vtep_ip, &api->prefix);
+			} else if (api_nh->type == NEXTHOP_TYPE_IPV6_IFINDEX) {
 				vtep_ip.ipa_type = IPADDR_V6;
 				memcpy(&vtep_ip.ipaddr_v6, &(api_nh->gate.ipv6),
 				       sizeof(struct in6_addr));
 				zebra_vxlan_evpn_vrf_route_add(
 					api_nh->vrf_id, &api_nh->rmac,
-					&vtep_ip, &api.prefix);
+					&vtep_ip, &api->prefix);
 			}
-			break;
-		case NEXTHOP_TYPE_BLACKHOLE:
-			nexthop = route_entry_nexthop_blackhole_add(
-				re, api_nh->bh_type);
-			break;
 		}
 
-		if (!nexthop) {
-			flog_warn(
-				EC_ZEBRA_NEXTHOP_CREATION_FAILED,
-				"%s: Nexthops Specified: %d but we failed to properly create one",
-				__PRETTY_FUNCTION__, api.nexthop_num);
-			nexthop_group_delete(&re->ng);
-			XFREE(MTYPE_RE, re);
-			return;
-		}
 		if (api_nh->onlink)
 			SET_FLAG(nexthop->flags, NEXTHOP_FLAG_ONLINK);
 
 		/* MPLS labels for BGP-LU or Segment Routing */
-		if (CHECK_FLAG(api.message, ZAPI_MESSAGE_LABEL)
+		if (CHECK_FLAG(api->message, ZAPI_MESSAGE_LABEL)
 		    && api_nh->type != NEXTHOP_TYPE_IFINDEX
 		    && api_nh->type != NEXTHOP_TYPE_BLACKHOLE) {
 			enum lsp_types_t label_type;
@@ -1563,33 +1693,40 @@ static void zread_route_add(ZAPI_HANDLER_ARGS)
 					   api_nh->label_num,
 					   &api_nh->labels[0]);
 		}
+
+		_nexthop_group_add_sorted(&ng, nexthop);
 	}
 
-	if (CHECK_FLAG(api.message, ZAPI_MESSAGE_DISTANCE))
-		re->distance = api.distance;
-	if (CHECK_FLAG(api.message, ZAPI_MESSAGE_METRIC))
-		re->metric = api.metric;
-	if (CHECK_FLAG(api.message, ZAPI_MESSAGE_TAG))
-		re->tag = api.tag;
-	if (CHECK_FLAG(api.message, ZAPI_MESSAGE_MTU))
-		re->mtu = api.mtu;
+	/* Allocate new route. */
+	vrf_id = zvrf_id(zvrf);
+	re = route_entry_new();
+	re->type = api->type;
+	re->instance = api->instance;
+	re->flags = api->flags;
+	re->uptime = monotime(NULL);
+	re->vrf_id = vrf_id;
 
-	afi = family2afi(api.prefix.family);
-	if (afi != AFI_IP6 && CHECK_FLAG(api.message, ZAPI_MESSAGE_SRCPFX)) {
-		flog_warn(EC_ZEBRA_RX_SRCDEST_WRONG_AFI,
-			  "%s: Received SRC Prefix but afi is not v6",
-			  __PRETTY_FUNCTION__);
-		nexthop_group_delete(&re->ng);
-		XFREE(MTYPE_RE, re);
-		return;
-	}
-	if (CHECK_FLAG(api.message, ZAPI_MESSAGE_SRCPFX))
-		src_p = &api.src_prefix;
+	if (api->tableid)
+		re->table = api->tableid;
+	else
+		re->table = zvrf->table_id;
+
+	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_DISTANCE))
+		re->distance = api->distance;
+	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_METRIC))
+		re->metric = api->metric;
+	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_TAG))
+		re->tag = api->tag;
+	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_MTU))
+		re->mtu = api->mtu;
 
-	ret = rib_add_multipath(afi, api.safi, &api.prefix, src_p, re);
+	ret = rib_add_multipath_nhg(afi, api->safi, &api->prefix, src_p, re,
+				    &ng);
+
+	zread_nexthops_release(client, api->nexthop_num);
 
 	/* Stats */
-	switch (api.prefix.family) {
+	switch (api->prefix.family) {
 	case AF_INET:
 		if (ret > 0)
 			client->v4_route_add_cnt++;
@@ -1605,39 +1742,50 @@ static void zread_route_add(ZAPI_HANDLER_ARGS)
 	}
 }
 
-static void zread_route_del(ZAPI_HANDLER_ARGS)
+static void zread_route_add(ZAPI_HANDLER_ARGS)
 {
 	struct stream *s;
 	struct zapi_route api;
-	afi_t afi;
-	struct prefix_ipv6 *src_p = NULL;
-	uint32_t table_id;
 
 	s = msg;
-	if (zapi_route_decode(s, &api) < 0)
+	if (zapi_route_decode(s, &api) < 0) {
+		if (IS_ZEBRA_DEBUG_RECV)
+			zlog_debug("%s: Unable to decode zapi_route sent",
+				   __PRETTY_FUNCTION__);
 		return;
+	}
+
+	zserv_route_add(client, zvrf, &api);
+}
 
-	afi = family2afi(api.prefix.family);
-	if (afi != AFI_IP6 && CHECK_FLAG(api.message, ZAPI_MESSAGE_SRCPFX)) {
+static void zserv_route_del(struct zserv *client, struct zebra_vrf *zvrf,
+			    struct zapi_route *api)
+{
+	afi_t afi;
+	struct prefix_ipv6 *src_p = NULL;
+	uint32_t table_id;
+
+	afi = family2afi(api->prefix.family);
+	if (afi != AFI_IP6 && CHECK_FLAG(api->message, ZAPI_MESSAGE_SRCPFX)) {
 		flog_warn(EC_ZEBRA_RX_SRCDEST_WRONG_AFI,
 			  "%s: Received a src prefix while afi is not v6",
 			  __PRETTY_FUNCTION__);
 		return;
 	}
-	if (CHECK_FLAG(api.message, ZAPI_MESSAGE_SRCPFX))
-		src_p = &api.src_prefix;
+	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_SRCPFX))
+		src_p = &api->src_prefix;
 
-	if (api.tableid)
-		table_id = api.tableid;
+	if (api->tableid)
+		table_id = api->tableid;
 	else
 		table_id = zvrf->table_id;
 
-	rib_delete(afi, api.safi, zvrf_id(zvrf), api.type, api.instance,
-		   api.flags, &api.prefix, src_p, NULL, 0, table_id, api.metric,
-		   api.distance, false);
+	rib_delete(afi, api->safi, zvrf_id(zvrf), api->type, api->instance,
+		   api->flags, &api->prefix, src_p, NULL, 0, table_id,
+		   api->metric, api->distance, false);
 
 	/* Stats */
-	switch (api.prefix.family) {
+	switch (api->prefix.family) {
 	case AF_INET:
 		client->v4_route_del_cnt++;
 		break;
@@ -1647,6 +1795,55 @@ static void zread_route_del(ZAPI_HANDLER_ARGS)
 	}
 }
 
+static void zread_route_del(ZAPI_HANDLER_ARGS)
+{
+	struct stream *s;
+	struct zapi_route api;
+
+	s = msg;
+	if (zapi_route_decode(s, &api) < 0)
+		return;
+
+	zserv_route_del(client, zvrf, &api);
+}
+
+/* Route adds and deletes of one type, instance and safi, in bulk */
+static void zread_route_bulk(ZAPI_HANDLER_ARGS)
+{
+	struct zapi_route_bulk bulk;
+	struct zapi_route api;
+	uint16_t cmd, i;
+
+	if (zapi_route_bulk_decode_header(msg, &bulk) < 0)
+		return;
+
+	/* A client sending bulk updates gets its notifications in bulk */
+	client->notify_owner_bulk = true;
+
+	for (i = 0; i < bulk.count; i++) {
+		if (zapi_route_bulk_decode(msg, &bulk, &cmd, &api) < 0) {
+			if (IS_ZEBRA_DEBUG_RECV)
+				zlog_debug("%s: Unable to decode route %u of %u",
+					   __func__, i, bulk.count);
+			return;
+		}
+
+		switch (cmd) {
+		case ZEBRA_ROUTE_ADD:
+			zserv_route_add(client, zvrf, &api);
+			break;
+		case ZEBRA_ROUTE_DELETE:
+			zserv_route_del(client, zvrf, &api);
+			break;
+		default:
+			if (IS_ZEBRA_DEBUG_RECV)
+				zlog_debug("%s: Unknown route command %u",
+					   __func__, cmd);
+			return;
+		}
+	}
+}
+
 /* MRIB Nexthop lookup for IPv4. */
 static void zread_ipv4_nexthop_lookup_mrib(ZAPI_HANDLER_ARGS)
 {
@@ -1739,6 +1936,38 @@ stream_failure:
 	return;
 }
 
+/* The client turns the notifications about its routes on or off */
+static void zread_route_notify_request(ZAPI_HANDLER_ARGS)
+{
+	uint8_t notify;
+
+	STREAM_GETC(msg, notify);
+	client->notify_owner = !!notify;
+
+stream_failure:
+	return;
+}
+
+/*
+ * The client has sent all its routes: those it left in the kernel before
+ * it restarted, and has not re-sent, can go now. Routes read back from the
+ * kernel do not know which instance of a protocol installed them, so they
+ * are left to the graceful restart timer for instanced clients.
+ */
+static void zread_route_update_complete(ZAPI_HANDLER_ARGS)
+{
+	unsigned long n;
+
+	if (client->proto == ZEBRA_ROUTE_SYSTEM || client->instance)
+		return;
+
+	n = rib_sweep_stale_proto(client->proto);
+
+	if (IS_ZEBRA_DEBUG_RIB)
+		zlog_debug("%s: client %s swept %lu stale routes", __func__,
+			   zebra_route_string(client->proto), n);
+}
+
 /* Unregister all information in a VRF. */
 static void zread_vrf_unregister(ZAPI_HANDLER_ARGS)
 {
@@ -2493,6 +2722,7 @@ void (*zserv_handlers[])(ZAPI_HANDLER_ARGS) = {
 	[ZEBRA_INTERFACE_SET_PROTODOWN] = zread_interface_set_protodown,
 	[ZEBRA_ROUTE_ADD] = zread_route_add,
 	[ZEBRA_ROUTE_DELETE] = zread_route_del,
+	[ZEBRA_ROUTE_BULK] = zread_route_bulk,
 	[ZEBRA_REDISTRIBUTE_ADD] = zebra_redistribute_add,
 	[ZEBRA_REDISTRIBUTE_DELETE] = zebra_redistribute_delete,
 	[ZEBRA_REDISTRIBUTE_DEFAULT_ADD] = zebra_redistribute_default_add,
@@ -2556,6 +2786,8 @@ void (*zserv_handlers[])(ZAPI_HANDLER_ARGS) = {
 	[ZEBRA_IPTABLE_DELETE] = zread_iptable,
 	[ZEBRA_VXLAN_FLOOD_CONTROL] = zebra_vxlan_flood_control,
 	[ZEBRA_VXLAN_SG_REPLAY] = zebra_vxlan_sg_replay,
+	[ZEBRA_ROUTE_UPDATE_COMPLETE] = zread_route_update_complete,
+	[ZEBRA_ROUTE_NOTIFY_REQUEST] = zread_route_notify_request,
 };
 
 #if defined(HANDLE_ZAPI_FUZZING)
@@ -66,6 +66,15 @@ extern int zsend_redistribute_route(int cmd, struct zserv *zclient,
 				    const struct prefix *p,
 				    const struct prefix *src_p,
 				    const struct route_entry *re);
+extern struct stream *
+zapi_redistribute_route_encode(int cmd, const struct prefix *p,
+			       const struct prefix *src_p,
+			       const struct route_entry *re);
+extern int zsend_redistribute_route_msg(int cmd, struct zserv *zclient,
+					const struct prefix *p,
+					const struct prefix *src_p,
+					const struct route_entry *re,
+					struct stream *msg);
 
 extern int zsend_router_id_update(struct zserv *zclient, struct prefix *p,
 				  vrf_id_t vrf_id);
@@ -25,6 +25,7 @@
 #include "lib/debug.h"
 #include "lib/frratomic.h"
 #include "lib/frr_pthread.h"
+#include "lib/jhash.h"
 #include "lib/memory.h"
 #include "lib/queue.h"
 #include "lib/zebra.h"
@@ -34,10 +35,13 @@
 #include "zebra/zebra_dplane.h"
 #include "zebra/rt.h"
 #include "zebra/debug.h"
+#include "zebra/zebra_pbr.h"
 
 /* Memory type for context blocks */
 DEFINE_MTYPE_STATIC(ZEBRA, DP_CTX, "Zebra DPlane Ctx")
 DEFINE_MTYPE_STATIC(ZEBRA, DP_PROV, "Zebra DPlane Provider")
+DEFINE_MTYPE_STATIC(ZEBRA, DP_WORKER, "Zebra DPlane Kernel Worker")
+DEFINE_MTYPE_STATIC(ZEBRA, DP_PBR_IFNAME, "Zebra DPlane PBR interface name")
 
 #ifndef AOK
 #  define AOK 0
@@ -52,6 +56,13 @@ const uint32_t DPLANE_DEFAULT_MAX_QUEUED = 200;
 /* Default value for new work per cycle */
 const uint32_t DPLANE_DEFAULT_NEW_WORK = 100;
 
+/* Default and maximum number of kernel route worker pthreads */
+#define DPLANE_DEFAULT_KERNEL_WORKERS 1
+#define DPLANE_MAX_KERNEL_WORKERS 16
+
+/* Kernel updates are sent one by one unless batching is configured */
+#define DPLANE_DEFAULT_KERNEL_BATCH false
+
 /* Validation check macro for context blocks */
 /* #define DPLANE_DEBUG 1 */
 
@@ -186,6 +197,17 @@ struct dplane_neigh_info {
 	uint16_t state;
 };
 
+/*
+ * Policy based routing info for the dataplane: copies of the zebra
+ * objects, so that they can be programmed from the dataplane pthread.
+ */
+struct dplane_pbr_info {
+	struct zebra_pbr_rule rule;
+	struct zebra_pbr_ipset ipset;
+	struct zebra_pbr_ipset_entry entry;
+	struct zebra_pbr_iptable iptable;
+};
+
 /*
  * The context block used to exchange info about route updates across
  * the boundary between the zebra main context (and pthread) and the
@@ -233,6 +255,7 @@ struct zebra_dplane_ctx {
 		struct dplane_intf_info intf;
 		struct dplane_mac_info macinfo;
 		struct dplane_neigh_info neigh;
+		struct dplane_pbr_info pbr;
 	} u;
 
 	/* Namespace info, used especially for netlink kernel communication */
@@ -242,6 +265,55 @@ struct zebra_dplane_ctx {
 	TAILQ_ENTRY(zebra_dplane_ctx) zd_q_entries;
 };
 
+/*
+ * Histogram of queue depths, in power-of-two buckets: bucket 0 counts
+ * zeroes, bucket n counts depths in [2^(n-1), 2^n).
+ */
+#define DPLANE_HIST_BUCKETS 20
+
+struct dplane_hist {
+	_Atomic uint32_t dh_buckets[DPLANE_HIST_BUCKETS];
+};
+
+static void dplane_hist_add(struct dplane_hist *hist, uint64_t val)
+{
+	unsigned int bucket = 0;
+
+	if (val)
+		bucket = 64 - __builtin_clzll(val);
+	if (bucket >= DPLANE_HIST_BUCKETS)
+		bucket = DPLANE_HIST_BUCKETS - 1;
+
+	atomic_fetch_add_explicit(&hist->dh_buckets[bucket], 1,
+				  memory_order_relaxed);
+}
+
+static void dplane_hist_show(struct vty *vty, const char *name,
+			     const char *unit, struct dplane_hist *hist)
+{
+	uint32_t count;
+	unsigned int i;
+
+	vty_out(vty, "  %s (%s):", name, unit);
+
+	for (i = 0; i < DPLANE_HIST_BUCKETS; i++) {
+		count = atomic_load_explicit(&hist->dh_buckets[i],
+					     memory_order_relaxed);
+		if (count == 0)
+			continue;
+
+		if (i == 0)
+			vty_out(vty, " 0:%u", count);
+		else if (i == DPLANE_HIST_BUCKETS - 1)
+			vty_out(vty, " %u+:%u", 1U << (i - 1), count);
+		else
+			vty_out(vty, " %u-%u:%u", 1U << (i - 1),
+				(1U << i) - 1, count);
+	}
+
+	vty_out(vty, "\n");
+}
+
 /* Flag that can be set by a pre-kernel provider as a signal that an update
  * should bypass the kernel.
  */
@@ -292,10 +364,42 @@ struct zebra_dplane_provider {
 	 */
 	struct dplane_ctx_q dp_ctx_out_q;
 
+	/* Queue depth histograms, sampled once per dataplane cycle */
+	struct dplane_hist dp_in_depth;
+	struct dplane_hist dp_out_depth;
+
 	/* Embedded list linkage for provider objects */
 	TAILQ_ENTRY(zebra_dplane_provider) dp_prov_link;
 };
 
+/*
+ * Worker pthread of the kernel provider. Route updates are sharded
+ * across the workers by table, so that the updates for any one prefix
+ * stay in order.
+ */
+struct dplane_kernel_worker {
+	uint32_t dw_id;
+
+	/* Kernel provider the completed updates are returned to */
+	struct zebra_dplane_provider *dw_prov;
+
+	/* Kernel-facing state, e.g. the worker's own sockets */
+	struct kernel_dplane_worker *dw_kernel;
+
+	struct frr_pthread *dw_pthread;
+	struct thread_master *dw_master;
+	struct thread *dw_t_work;
+
+	/* Route updates waiting for the worker */
+	pthread_mutex_t dw_mutex;
+	struct dplane_ctx_q dw_ctx_in_q;
+
+	_Atomic uint32_t dw_queued;
+	_Atomic uint32_t dw_queued_max;
+	_Atomic uint32_t dw_routes;
+	_Atomic uint32_t dw_batches;
+};
+
 /*
  * Globals
  */
@@ -315,6 +419,12 @@ static struct zebra_dplane_globals {
 	/* Update context queue inbound to the dataplane */
 	TAILQ_HEAD(zdg_ctx_q, zebra_dplane_ctx) dg_update_ctx_q;
 
+	/* Depth histogram of the inbound queue */
+	struct dplane_hist dg_update_depth;
+
+	/* Set while an event for the dataplane pthread is pending */
+	_Atomic bool dg_work_signalled;
+
 	/* Ordered list of providers */
 	TAILQ_HEAD(zdg_prov_q, zebra_dplane_provider) dg_providers_q;
 
@@ -327,12 +437,28 @@ static struct zebra_dplane_globals {
 	/* Control whether system route notifications should be produced. */
 	bool dg_sys_route_notifs;
 
+	/* Send route updates to the kernel in batches */
+	_Atomic bool dg_kernel_batch;
+
+	/* Configured number of kernel route workers, and running workers */
+	_Atomic uint32_t dg_kernel_workers_cfg;
+	uint32_t dg_kernel_workers_applied;
+	uint32_t dg_kernel_worker_count;
+	struct dplane_kernel_worker *dg_kernel_workers;
+
+	/* Route updates handed to the workers and not yet returned */
+	_Atomic uint32_t dg_kernel_worker_pending;
+
+	/* Update waiting for the workers to finish the routes before it */
+	struct zebra_dplane_ctx *dg_kernel_held_ctx;
+
 	/* Limit number of new updates dequeued at once, to pace an
 	 * incoming burst.
 	 */
 	uint32_t dg_updates_per_cycle;
 
 	_Atomic uint32_t dg_routes_in;
+	_Atomic uint32_t dg_routes_retained;
 	_Atomic uint32_t dg_routes_queued;
 	_Atomic uint32_t dg_routes_queued_max;
 	_Atomic uint32_t dg_route_errors;
@@ -356,8 +482,23 @@ static struct zebra_dplane_globals {
 	_Atomic uint32_t dg_neighs_in;
 	_Atomic uint32_t dg_neigh_errors;
 
+	_Atomic uint32_t dg_pbrs_in;
+	_Atomic uint32_t dg_pbr_errors;
+
 	_Atomic uint32_t dg_update_yields;
 
+	_Atomic uint32_t dg_kernel_batches;
+	_Atomic uint32_t dg_kernel_batch_routes;
+
+	_Atomic uint32_t dg_kernel_evpn_batches;
+	_Atomic uint32_t dg_kernel_batch_evpn;
+
+	_Atomic uint32_t dg_kernel_lsp_batches;
+	_Atomic uint32_t dg_kernel_batch_lsps;
+
+	_Atomic uint32_t dg_kernel_pbr_batches;
+	_Atomic uint32_t dg_kernel_batch_pbrs;
+
 	/* Dataplane pthread */
 	struct frr_pthread *dg_pthread;
 
@@ -387,6 +528,7 @@ static struct zebra_dplane_globals {
 
 /* Prototypes */
 static int dplane_thread_loop(struct thread *event);
+static int kernel_dplane_worker_ns_event(struct thread *event);
 static void dplane_info_from_zns(struct zebra_dplane_info *ns_info,
 				 struct zebra_ns *zns);
 static enum zebra_dplane_result lsp_update_internal(zebra_lsp_t *lsp,
@@ -537,6 +679,22 @@ static void dplane_ctx_free(struct zebra_dplane_ctx **pctx)
 		}
 		break;
 
+	case DPLANE_OP_IPTABLE_ADD:
+	case DPLANE_OP_IPTABLE_DELETE:
+		/* Free the copied interface names */
+		if ((*pctx)->u.pbr.iptable.interface_name_list) {
+			struct listnode *node, *nnode;
+			char *ifname;
+
+			for (ALL_LIST_ELEMENTS(
+				     (*pctx)->u.pbr.iptable.interface_name_list,
+				     node, nnode, ifname))
+				XFREE(MTYPE_DP_PBR_IFNAME, ifname);
+
+			list_delete(&(*pctx)->u.pbr.iptable.interface_name_list);
+		}
+		break;
+
 	case DPLANE_OP_MAC_INSTALL:
 	case DPLANE_OP_MAC_DELETE:
 	case DPLANE_OP_NEIGH_INSTALL:
@@ -544,6 +702,12 @@ static void dplane_ctx_free(struct zebra_dplane_ctx **pctx)
 	case DPLANE_OP_NEIGH_DELETE:
 	case DPLANE_OP_VTEP_ADD:
 	case DPLANE_OP_VTEP_DELETE:
+	case DPLANE_OP_RULE_ADD:
+	case DPLANE_OP_RULE_DELETE:
+	case DPLANE_OP_IPSET_ADD:
+	case DPLANE_OP_IPSET_DELETE:
+	case DPLANE_OP_IPSET_ENTRY_ADD:
+	case DPLANE_OP_IPSET_ENTRY_DELETE:
 	case DPLANE_OP_NONE:
 		break;
 	}
@@ -737,6 +901,32 @@ const char *dplane_op2str(enum dplane_op_e op)
 	case DPLANE_OP_VTEP_DELETE:
 		ret = "VTEP_DELETE";
 		break;
+
+	case DPLANE_OP_RULE_ADD:
+		ret = "RULE_ADD";
+		break;
+	case DPLANE_OP_RULE_DELETE:
+		ret = "RULE_DELETE";
+		break;
+
+	case DPLANE_OP_IPSET_ADD:
+		ret = "IPSET_ADD";
+		break;
+	case DPLANE_OP_IPSET_DELETE:
+		ret = "IPSET_DELETE";
+		break;
+	case DPLANE_OP_IPSET_ENTRY_ADD:
+		ret = "IPSET_ENTRY_ADD";
+		break;
+	case DPLANE_OP_IPSET_ENTRY_DELETE:
+		ret = "IPSET_ENTRY_DELETE";
+		break;
+	case DPLANE_OP_IPTABLE_ADD:
+		ret = "IPTABLE_ADD";
+		break;
+	case DPLANE_OP_IPTABLE_DELETE:
+		ret = "IPTABLE_DELETE";
+		break;
 	}
 
 	return ret;
@@ -1395,6 +1585,33 @@ uint16_t dplane_ctx_neigh_get_state(const struct zebra_dplane_ctx *ctx)
 	return ctx->u.neigh.state;
 }
 
+/* Accessors for policy based routing information */
+struct zebra_pbr_rule *dplane_ctx_get_pbr_rule(struct zebra_dplane_ctx *ctx)
+{
+	DPLANE_CTX_VALID(ctx);
+	return &ctx->u.pbr.rule;
+}
+
+struct zebra_pbr_ipset *dplane_ctx_get_pbr_ipset(struct zebra_dplane_ctx *ctx)
+{
+	DPLANE_CTX_VALID(ctx);
+	return &ctx->u.pbr.ipset;
+}
+
+struct zebra_pbr_ipset_entry *
+dplane_ctx_get_pbr_ipset_entry(struct zebra_dplane_ctx *ctx)
+{
+	DPLANE_CTX_VALID(ctx);
+	return &ctx->u.pbr.entry;
+}
+
+struct zebra_pbr_iptable *
+dplane_ctx_get_pbr_iptable(struct zebra_dplane_ctx *ctx)
+{
+	DPLANE_CTX_VALID(ctx);
+	return &ctx->u.pbr.iptable;
+}
+
 /*
  * End of dplane context accessors
  */
@@ -1422,6 +1639,49 @@ void dplane_set_in_queue_limit(uint32_t limit, bool set)
 			      memory_order_relaxed);
 }
 
+/*
+ * Configure whether route updates are sent to the kernel in batches.
+ */
+void dplane_set_kernel_batch(bool enable)
+{
+	atomic_store_explicit(&zdplane_info.dg_kernel_batch, enable,
+			      memory_order_relaxed);
+}
+
+/*
+ * Configure the number of kernel route worker pthreads. If the dataplane
+ * is running, the kernel provider restarts its workers once the route
+ * updates already handed to them are done.
+ */
+void dplane_set_kernel_workers(uint32_t count)
+{
+	atomic_store_explicit(&zdplane_info.dg_kernel_workers_cfg, count,
+			      memory_order_relaxed);
+
+	dplane_provider_work_ready();
+}
+
+/*
+ * A namespace is going away: each kernel route worker closes its socket
+ * for it, from its own pthread.
+ */
+void dplane_kernel_workers_ns_close(ns_id_t ns_id)
+{
+	struct dplane_kernel_worker *w;
+	uint32_t i;
+
+	DPLANE_LOCK();
+
+	for (i = 0; i < zdplane_info.dg_kernel_worker_count; i++) {
+		w = &zdplane_info.dg_kernel_workers[i];
+
+		thread_add_event(w->dw_master, kernel_dplane_worker_ns_event,
+				 w, (int)ns_id, NULL);
+	}
+
+	DPLANE_UNLOCK();
+}
+
 /*
  * Retrieve the current queue depth of incoming, unprocessed updates
  */
@@ -1618,6 +1878,36 @@ done:
 	return ret;
 }
 
+/*
+ * Capture the installed state of a route in a context block that is not
+ * enqueued, e.g. for a provider that replays the rib to a remote dataplane.
+ * Unlike a route update, this does not touch the route's dplane sequence,
+ * so results of updates in flight are still accepted.
+ */
+int dplane_ctx_route_snapshot(struct zebra_dplane_ctx *ctx,
+			      struct route_node *rn, struct route_entry *re)
+{
+	uint32_t seq = re->dplane_sequence;
+	int ret;
+
+	ret = dplane_ctx_route_init(ctx, DPLANE_OP_ROUTE_INSTALL, rn, re);
+
+	re->dplane_sequence = seq;
+	ctx->zd_seq = seq;
+
+	return ret;
+}
+
+/*
+ * Capture the installed state of a nexthop group, see
+ * dplane_ctx_route_snapshot().
+ */
+int dplane_ctx_nexthop_snapshot(struct zebra_dplane_ctx *ctx,
+				struct nhg_hash_entry *nhe)
+{
+	return dplane_ctx_nexthop_init(ctx, DPLANE_OP_NH_INSTALL, nhe);
+}
+
 /*
  * Capture information for an LSP update in a dplane context.
  */
@@ -1795,7 +2085,10 @@ static int dplane_update_enqueue(struct zebra_dplane_ctx *ctx)
 			break;
 	}
 
-	/* Ensure that an event for the dataplane thread is active */
+	/* Ensure that an event for the dataplane thread is active; this is
+	 * cheap once one is pending, so a burst of updates is handed over
+	 * with a single wakeup.
+	 */
 	ret = dplane_provider_work_ready();
 
 	return ret;
@@ -1808,7 +2101,7 @@ static enum zebra_dplane_result
 dplane_route_update_internal(struct route_node *rn,
 			     struct route_entry *re,
 			     struct route_entry *old_re,
-			     enum dplane_op_e op)
+			     enum dplane_op_e op, bool skip_kernel)
 {
 	enum zebra_dplane_result result = ZEBRA_DPLANE_REQUEST_FAILURE;
 	int ret = EINVAL;
@@ -1820,6 +2113,9 @@ dplane_route_update_internal(struct route_node *rn,
 	/* Init context with info from zebra data structs */
 	ret = dplane_ctx_route_init(ctx, op, rn, re);
 	if (ret == AOK) {
+		if (skip_kernel)
+			dplane_ctx_set_skip_kernel(ctx);
+
 		/* Capture some extra info for update case
 		 * where there's a different 'old' route.
 		 */
@@ -1924,7 +2220,7 @@ enum zebra_dplane_result dplane_route_add(struct route_node *rn,
 		goto done;
 
 	ret = dplane_route_update_internal(rn, re, NULL,
-					   DPLANE_OP_ROUTE_INSTALL);
+					   DPLANE_OP_ROUTE_INSTALL, false);
 
 done:
 	return ret;
@@ -1943,7 +2239,37 @@ enum zebra_dplane_result dplane_route_update(struct route_node *rn,
 		goto done;
 
 	ret = dplane_route_update_internal(rn, re, old_re,
-					   DPLANE_OP_ROUTE_UPDATE);
+					   DPLANE_OP_ROUTE_UPDATE, false);
+done:
+	return ret;
+}
+
+/*
+ * Enqueue an add or update of a route the kernel already holds, as left
+ * there by a previous run: the providers see it as usual, but the kernel
+ * itself is not programmed again.
+ */
+enum zebra_dplane_result dplane_route_retain(struct route_node *rn,
+					     struct route_entry *re,
+					     struct route_entry *old_re)
+{
+	enum zebra_dplane_result ret = ZEBRA_DPLANE_REQUEST_FAILURE;
+
+	if (rn == NULL || re == NULL)
+		goto done;
+
+	if (old_re)
+		ret = dplane_route_update_internal(rn, re, old_re,
+						   DPLANE_OP_ROUTE_UPDATE,
+						   true);
+	else
+		ret = dplane_route_update_internal(rn, re, NULL,
+						   DPLANE_OP_ROUTE_INSTALL,
+						   true);
+
+	if (ret == ZEBRA_DPLANE_REQUEST_QUEUED)
+		atomic_fetch_add_explicit(&zdplane_info.dg_routes_retained, 1,
+					  memory_order_relaxed);
 done:
 	return ret;
 }
@@ -1960,7 +2286,7 @@ enum zebra_dplane_result dplane_route_delete(struct route_node *rn,
 		goto done;
 
 	ret = dplane_route_update_internal(rn, re, NULL,
-					   DPLANE_OP_ROUTE_DELETE);
+					   DPLANE_OP_ROUTE_DELETE, false);
 
 done:
 	return ret;
@@ -1984,7 +2310,7 @@ enum zebra_dplane_result dplane_sys_route_add(struct route_node *rn,
 		goto done;
 
 	ret = dplane_route_update_internal(rn, re, NULL,
-					   DPLANE_OP_SYS_ROUTE_ADD);
+					   DPLANE_OP_SYS_ROUTE_ADD, false);
 
 done:
 	return ret;
@@ -2008,7 +2334,7 @@ enum zebra_dplane_result dplane_sys_route_del(struct route_node *rn,
 		goto done;
 
 	ret = dplane_route_update_internal(rn, re, NULL,
-					   DPLANE_OP_SYS_ROUTE_DELETE);
+					   DPLANE_OP_SYS_ROUTE_DELETE, false);
 
 done:
 	return ret;
@@ -2653,6 +2979,196 @@ neigh_update_internal(enum dplane_op_e op,
 	return result;
 }
 
+/*
+ * Common helper api for policy based routing updates: the caller has
+ * copied its object into the context. Rules, ipsets and iptables all
+ * live in the default namespace.
+ */
+static enum zebra_dplane_result pbr_update_internal(struct zebra_dplane_ctx *ctx,
+						   enum dplane_op_e op,
+						   vrf_id_t vrf_id)
+{
+	enum zebra_dplane_result result = ZEBRA_DPLANE_REQUEST_FAILURE;
+	int ret;
+
+	if (IS_ZEBRA_DEBUG_DPLANE_DETAIL)
+		zlog_debug("init pbr ctx %s: vrf %u", dplane_op2str(op),
+			   vrf_id);
+
+	ctx->zd_op = op;
+	ctx->zd_status = ZEBRA_DPLANE_REQUEST_SUCCESS;
+	ctx->zd_vrf_id = vrf_id;
+
+	dplane_ctx_ns_init(ctx, zebra_ns_lookup(NS_DEFAULT), false);
+
+	/* Enqueue for processing on the dplane pthread */
+	ret = dplane_update_enqueue(ctx);
+
+	/* Increment counter */
+	atomic_fetch_add_explicit(&zdplane_info.dg_pbrs_in, 1,
+				  memory_order_relaxed);
+
+	if (ret == AOK)
+		result = ZEBRA_DPLANE_REQUEST_QUEUED;
+	else {
+		/* Error counter */
+		atomic_fetch_add_explicit(&zdplane_info.dg_pbr_errors, 1,
+					  memory_order_relaxed);
+		dplane_ctx_free(&ctx);
+	}
+
+	return result;
+}
+
+static struct zebra_dplane_ctx *pbr_rule_ctx_new(struct zebra_pbr_rule *rule)
+{
+	struct zebra_dplane_ctx *ctx = dplane_ctx_alloc();
+
+	ctx->u.pbr.rule = *rule;
+
+	strlcpy(ctx->zd_ifname, rule->ifname, sizeof(ctx->zd_ifname));
+	ctx->zd_ifindex = rule->rule.ifindex;
+
+	return ctx;
+}
+
+static enum zebra_dplane_result
+pbr_rule_update_internal(enum dplane_op_e op, struct zebra_pbr_rule *rule)
+{
+	return pbr_update_internal(pbr_rule_ctx_new(rule), op, rule->vrf_id);
+}
+
+/*
+ * Enqueue policy based routing rule updates for the dataplane.
+ */
+enum zebra_dplane_result dplane_pbr_rule_add(struct zebra_pbr_rule *rule)
+{
+	return pbr_rule_update_internal(DPLANE_OP_RULE_ADD, rule);
+}
+
+enum zebra_dplane_result dplane_pbr_rule_delete(struct zebra_pbr_rule *rule)
+{
+	return pbr_rule_update_internal(DPLANE_OP_RULE_DELETE, rule);
+}
+
+/*
+ * Remove a rule from the kernel from the calling pthread, for shutdown:
+ * once the dataplane pthread has stopped, nothing would process a queued
+ * update.
+ */
+enum zebra_dplane_result
+dplane_pbr_rule_delete_sync(struct zebra_pbr_rule *rule)
+{
+	struct zebra_dplane_ctx *ctx = pbr_rule_ctx_new(rule);
+	enum zebra_dplane_result result;
+
+	ctx->zd_op = DPLANE_OP_RULE_DELETE;
+	ctx->zd_status = ZEBRA_DPLANE_REQUEST_SUCCESS;
+	ctx->zd_vrf_id = rule->vrf_id;
+
+	dplane_ctx_ns_init(ctx, zebra_ns_lookup(NS_DEFAULT), false);
+
+	result = kernel_pbr_rule_update(ctx);
+
+	dplane_ctx_fini(&ctx);
+
+	return result;
+}
+
+static enum zebra_dplane_result
+pbr_ipset_update_internal(enum dplane_op_e op, struct zebra_pbr_ipset *ipset)
+{
+	struct zebra_dplane_ctx *ctx = dplane_ctx_alloc();
+
+	ctx->u.pbr.ipset = *ipset;
+
+	return pbr_update_internal(ctx, op, ipset->vrf_id);
+}
+
+/*
+ * Enqueue ipset updates for the dataplane.
+ */
+enum zebra_dplane_result dplane_pbr_ipset_add(struct zebra_pbr_ipset *ipset)
+{
+	return pbr_ipset_update_internal(DPLANE_OP_IPSET_ADD, ipset);
+}
+
+enum zebra_dplane_result
+dplane_pbr_ipset_delete(struct zebra_pbr_ipset *ipset)
+{
+	return pbr_ipset_update_internal(DPLANE_OP_IPSET_DELETE, ipset);
+}
+
+static enum zebra_dplane_result
+pbr_ipset_entry_update_internal(enum dplane_op_e op,
+				struct zebra_pbr_ipset_entry *ipset)
+{
+	struct zebra_dplane_ctx *ctx = dplane_ctx_alloc();
+	vrf_id_t vrf_id = VRF_DEFAULT;
+
+	/* The entry refers to its ipset by name: take it along */
+	ctx->u.pbr.entry = *ipset;
+	if (ipset->backpointer) {
+		ctx->u.pbr.ipset = *ipset->backpointer;
+		vrf_id = ipset->backpointer->vrf_id;
+	}
+	ctx->u.pbr.entry.backpointer = &ctx->u.pbr.ipset;
+
+	return pbr_update_internal(ctx, op, vrf_id);
+}
+
+/*
+ * Enqueue ipset entry updates for the dataplane.
+ */
+enum zebra_dplane_result
+dplane_pbr_ipset_entry_add(struct zebra_pbr_ipset_entry *ipset)
+{
+	return pbr_ipset_entry_update_internal(DPLANE_OP_IPSET_ENTRY_ADD,
+					       ipset);
+}
+
+enum zebra_dplane_result
+dplane_pbr_ipset_entry_delete(struct zebra_pbr_ipset_entry *ipset)
+{
+	return pbr_ipset_entry_update_internal(DPLANE_OP_IPSET_ENTRY_DELETE,
+					       ipset);
+}
+
+static enum zebra_dplane_result
+pbr_iptable_update_internal(enum dplane_op_e op,
+			    struct zebra_pbr_iptable *iptable)
+{
+	struct zebra_dplane_ctx *ctx = dplane_ctx_alloc();
+	struct listnode *node;
+	char *ifname;
+
+	/* The interface names are copied: zebra may free its own list
+	 * before the dataplane gets to the update.
+	 */
+	ctx->u.pbr.iptable = *iptable;
+	ctx->u.pbr.iptable.interface_name_list = list_new();
+	for (ALL_LIST_ELEMENTS_RO(iptable->interface_name_list, node, ifname))
+		listnode_add(ctx->u.pbr.iptable.interface_name_list,
+			     XSTRDUP(MTYPE_DP_PBR_IFNAME, ifname));
+
+	return pbr_update_internal(ctx, op, iptable->vrf_id);
+}
+
+/*
+ * Enqueue iptables updates for the dataplane.
+ */
+enum zebra_dplane_result
+dplane_pbr_iptable_add(struct zebra_pbr_iptable *iptable)
+{
+	return pbr_iptable_update_internal(DPLANE_OP_IPTABLE_ADD, iptable);
+}
+
+enum zebra_dplane_result
+dplane_pbr_iptable_delete(struct zebra_pbr_iptable *iptable)
+{
+	return pbr_iptable_update_internal(DPLANE_OP_IPTABLE_DELETE, iptable);
+}
+
 /*
  * Handler for 'show dplane'
  */
@@ -2688,12 +3204,56 @@ int dplane_show_helper(struct vty *vty, bool detailed)
 	vty_out(vty, "Route update queue max:   %"PRIu64"\n", queue_max);
 	vty_out(vty, "Dplane update yields:     %"PRIu64"\n", yields);
 
-	incoming = atomic_load_explicit(&zdplane_info.dg_lsps_in,
+	incoming = atomic_load_explicit(&zdplane_info.dg_routes_retained,
 					memory_order_relaxed);
-	errs = atomic_load_explicit(&zdplane_info.dg_lsp_errors,
-				    memory_order_relaxed);
-	vty_out(vty, "LSP updates:              %"PRIu64"\n", incoming);
-	vty_out(vty, "LSP update errors:        %"PRIu64"\n", errs);
+	vty_out(vty, "Routes kept in kernel:    %"PRIu64"\n", incoming);
+
+	incoming = atomic_load_explicit(&zdplane_info.dg_kernel_batch_routes,
+					memory_order_relaxed);
+	queued = atomic_load_explicit(&zdplane_info.dg_kernel_batches,
+				      memory_order_relaxed);
+	vty_out(vty, "Kernel route batches:     %"PRIu64" (%"PRIu64" routes)\n",
+		queued, incoming);
+
+	if (detailed) {
+		struct dplane_kernel_worker *w;
+		uint32_t i;
+
+		/* The dplane pthread may be restarting the workers */
+		DPLANE_LOCK();
+
+		for (i = 0; i < zdplane_info.dg_kernel_worker_count; i++) {
+			w = &zdplane_info.dg_kernel_workers[i];
+
+			vty_out(vty,
+				"Kernel worker %u: routes %u, batches %u, queued %u, queue max %u\n",
+				w->dw_id,
+				atomic_load_explicit(&w->dw_routes,
+						     memory_order_relaxed),
+				atomic_load_explicit(&w->dw_batches,
+						     memory_order_relaxed),
+				atomic_load_explicit(&w->dw_queued,
+						     memory_order_relaxed),
+				atomic_load_explicit(&w->dw_queued_max,
+						     memory_order_relaxed));
+		}
+
+		DPLANE_UNLOCK();
+	}
+
+	incoming = atomic_load_explicit(&zdplane_info.dg_lsps_in,
+					memory_order_relaxed);
+	errs = atomic_load_explicit(&zdplane_info.dg_lsp_errors,
+				    memory_order_relaxed);
+	vty_out(vty, "LSP updates:              %"PRIu64"\n", incoming);
+	vty_out(vty, "LSP update errors:        %"PRIu64"\n", errs);
+
+	incoming = atomic_load_explicit(&zdplane_info.dg_kernel_batch_lsps,
+					memory_order_relaxed);
+	queued = atomic_load_explicit(&zdplane_info.dg_kernel_lsp_batches,
+				      memory_order_relaxed);
+	vty_out(vty, "Kernel LSP batches:       %"PRIu64" (%"PRIu64" LSPs)\n",
+		queued, incoming);
 
 	incoming = atomic_load_explicit(&zdplane_info.dg_pws_in,
 					memory_order_relaxed);
@@ -2723,6 +3283,51 @@ int dplane_show_helper(struct vty *vty, bool detailed)
 	vty_out(vty, "EVPN neigh updates:       %"PRIu64"\n", incoming);
 	vty_out(vty, "EVPN neigh errors:        %"PRIu64"\n", errs);
 
+	incoming = atomic_load_explicit(&zdplane_info.dg_kernel_batch_evpn,
+					memory_order_relaxed);
+	queued = atomic_load_explicit(&zdplane_info.dg_kernel_evpn_batches,
+				      memory_order_relaxed);
+	vty_out(vty, "Kernel EVPN batches:      %"PRIu64" (%"PRIu64" deletes)\n",
+		queued, incoming);
+
+	incoming = atomic_load_explicit(&zdplane_info.dg_pbrs_in,
+					memory_order_relaxed);
+	errs = atomic_load_explicit(&zdplane_info.dg_pbr_errors,
+				    memory_order_relaxed);
+	vty_out(vty, "PBR updates:              %"PRIu64"\n", incoming);
+	vty_out(vty, "PBR update errors:        %"PRIu64"\n", errs);
+
+	incoming = atomic_load_explicit(&zdplane_info.dg_kernel_batch_pbrs,
+					memory_order_relaxed);
+	queued = atomic_load_explicit(&zdplane_info.dg_kernel_pbr_batches,
+				      memory_order_relaxed);
+	vty_out(vty, "Kernel PBR batches:       %"PRIu64" (%"PRIu64" updates)\n",
+		queued, incoming);
+
+	if (detailed) {
+		struct zebra_dplane_provider *prov;
+
+		vty_out(vty, "Incoming queue:\n");
+		dplane_hist_show(vty, "depth", "contexts",
+				 &zdplane_info.dg_update_depth);
+
+		DPLANE_LOCK();
+		prov = TAILQ_FIRST(&zdplane_info.dg_providers_q);
+		DPLANE_UNLOCK();
+
+		while (prov) {
+			vty_out(vty, "Provider %s queues:\n", prov->dp_name);
+			dplane_hist_show(vty, "in depth", "contexts",
+					 &prov->dp_in_depth);
+			dplane_hist_show(vty, "out depth", "contexts",
+					 &prov->dp_out_depth);
+
+			DPLANE_LOCK();
+			prov = TAILQ_NEXT(prov, dp_prov_link);
+			DPLANE_UNLOCK();
+		}
+	}
+
 	return CMD_SUCCESS;
 }
 
@@ -2773,6 +3378,14 @@ int dplane_config_write_helper(struct vty *vty)
 		vty_out(vty, "zebra dplane limit %u\n",
 			zdplane_info.dg_max_queued_updates);
 
+	if (zdplane_info.dg_kernel_batch != DPLANE_DEFAULT_KERNEL_BATCH)
+		vty_out(vty, "%szebra dplane kernel-batch\n",
+			zdplane_info.dg_kernel_batch ? "" : "no ");
+
+	if (zdplane_info.dg_kernel_workers_cfg != DPLANE_DEFAULT_KERNEL_WORKERS)
+		vty_out(vty, "zebra dplane kernel-workers %u\n",
+			zdplane_info.dg_kernel_workers_cfg);
+
 	return 0;
 }
 
@@ -2946,6 +3559,23 @@ int dplane_provider_dequeue_in_list(struct zebra_dplane_provider *prov,
 	return ret;
 }
 
+/* Count contexts put on a provider's out-queue */
+static void dplane_provider_out_counters(struct zebra_dplane_provider *prov,
+					 uint32_t count)
+{
+	uint32_t curr, high;
+
+	curr = atomic_add_fetch_explicit(&prov->dp_out_queued, count,
+					 memory_order_relaxed);
+	high = atomic_load_explicit(&prov->dp_out_max, memory_order_relaxed);
+	if (curr > high)
+		atomic_store_explicit(&prov->dp_out_max, curr,
+				      memory_order_relaxed);
+
+	atomic_fetch_add_explicit(&(prov->dp_out_counter), count,
+				  memory_order_relaxed);
+}
+
 /*
  * Enqueue and maintain associated counter
  */
@@ -2959,8 +3589,32 @@ void dplane_provider_enqueue_out_ctx(struct zebra_dplane_provider *prov,
 
 	dplane_provider_unlock(prov);
 
-	atomic_fetch_add_explicit(&(prov->dp_out_counter), 1,
-				  memory_order_relaxed);
+	dplane_provider_out_counters(prov, 1);
+}
+
+/*
+ * Enqueue a list of completed work under a single lock, and maintain the
+ * associated counters; the list is left empty.
+ */
+void dplane_provider_enqueue_out_list(struct zebra_dplane_provider *prov,
+				      struct dplane_ctx_q *listp)
+{
+	struct zebra_dplane_ctx *ctx;
+	uint32_t count = 0;
+
+	TAILQ_FOREACH (ctx, listp, zd_q_entries)
+		count++;
+
+	if (count == 0)
+		return;
+
+	dplane_provider_lock(prov);
+
+	TAILQ_CONCAT(&(prov->dp_ctx_out_q), listp, zd_q_entries);
+
+	dplane_provider_unlock(prov);
+
+	dplane_provider_out_counters(prov, count);
 }
 
 /*
@@ -2997,11 +3651,18 @@ int dplane_provider_work_ready(void)
 	 * enqueue the work, but the event-scheduling machinery may not be
 	 * available.
 	 */
-	if (zdplane_info.dg_run) {
-		thread_add_event(zdplane_info.dg_master,
-				 dplane_thread_loop, NULL, 0,
-				 &zdplane_info.dg_t_update);
-	}
+	if (!zdplane_info.dg_run)
+		return AOK;
+
+	/* Coalesce wakeups: if an event is already pending, the dataplane
+	 * pthread will pick up this work when it runs.
+	 */
+	if (atomic_exchange_explicit(&zdplane_info.dg_work_signalled, true,
+				     memory_order_seq_cst))
+		return AOK;
+
+	thread_add_event(zdplane_info.dg_master, dplane_thread_loop, NULL, 0,
+			 &zdplane_info.dg_t_update);
 
 	return AOK;
 }
@@ -3099,6 +3760,76 @@ kernel_dplane_route_update(struct zebra_dplane_ctx *ctx)
 	return res;
 }
 
+/*
+ * Send a list of route updates to the kernel in batches, and pass the
+ * contexts on to the next provider. Returns the number of batches sent.
+ */
+static uint32_t kernel_dplane_route_send(struct zebra_dplane_provider *prov,
+					 struct kernel_dplane_worker *kw,
+					 struct dplane_ctx_q *ctx_list)
+{
+	struct zebra_dplane_ctx *ctx;
+	uint32_t count = 0;
+	int batches;
+
+	if (TAILQ_EMPTY(ctx_list))
+		return 0;
+
+	/* Call into the kernel-facing code here */
+	batches = kernel_route_update_multi(kw, ctx_list);
+
+	TAILQ_FOREACH (ctx, ctx_list, zd_q_entries) {
+		if (dplane_ctx_get_status(ctx) != ZEBRA_DPLANE_REQUEST_SUCCESS)
+			atomic_fetch_add_explicit(
+				&zdplane_info.dg_route_errors, 1,
+				memory_order_relaxed);
+		count++;
+	}
+
+	/* Hand the whole list on under one lock */
+	dplane_provider_enqueue_out_list(prov, ctx_list);
+
+	atomic_fetch_add_explicit(&zdplane_info.dg_kernel_batches, batches,
+				  memory_order_relaxed);
+	atomic_fetch_add_explicit(&zdplane_info.dg_kernel_batch_routes, count,
+				  memory_order_relaxed);
+
+	return batches;
+}
+
+/*
+ * Batch a list of route updates to the kernel, in order; updates that a
+ * previous provider asked to keep out of the kernel are passed on as they
+ * come. Returns the number of batches sent.
+ */
+static uint32_t
+kernel_dplane_route_update_batch(struct zebra_dplane_provider *prov,
+				 struct kernel_dplane_worker *kw,
+				 struct dplane_ctx_q *ctx_list)
+{
+	struct dplane_ctx_q kernel_list;
+	struct zebra_dplane_ctx *ctx;
+	uint32_t batches = 0;
+
+	TAILQ_INIT(&kernel_list);
+
+	while ((ctx = dplane_ctx_dequeue(ctx_list)) != NULL) {
+		if (!dplane_ctx_is_skip_kernel(ctx)) {
+			dplane_ctx_enqueue_tail(&kernel_list, ctx);
+			continue;
+		}
+
+		batches += kernel_dplane_route_send(prov, kw, &kernel_list);
+
+		dplane_ctx_set_status(ctx, ZEBRA_DPLANE_REQUEST_SUCCESS);
+		dplane_provider_enqueue_out_ctx(prov, ctx);
+	}
+
+	batches += kernel_dplane_route_send(prov, kw, &kernel_list);
+
+	return batches;
+}
+
 /*
  * Handler for kernel-facing interface address updates
  */
@@ -3210,6 +3941,400 @@ kernel_dplane_neigh_update(struct zebra_dplane_ctx *ctx)
 	return res;
 }
 
+/*
+ * EVPN MAC and neighbor deletes come in bursts, one per entry, when a
+ * remote VTEP goes away; they are collected into batches of their own.
+ */
+static bool kernel_dplane_is_evpn_delete(const struct zebra_dplane_ctx *ctx)
+{
+	if (dplane_ctx_is_skip_kernel(ctx))
+		return false;
+
+	return (dplane_ctx_get_op(ctx) == DPLANE_OP_MAC_DELETE
+		|| dplane_ctx_get_op(ctx) == DPLANE_OP_NEIGH_DELETE);
+}
+
+/*
+ * Send a list of EVPN MAC and neighbor deletes to the kernel in batches,
+ * and pass the contexts on to the next provider.
+ */
+static void kernel_dplane_evpn_update_batch(struct zebra_dplane_provider *prov,
+					    struct dplane_ctx_q *ctx_list)
+{
+	struct zebra_dplane_ctx *ctx;
+	uint32_t count = 0;
+	int batches;
+
+	if (TAILQ_EMPTY(ctx_list))
+		return;
+
+	batches = kernel_mac_neigh_update_multi(ctx_list);
+
+	while ((ctx = dplane_ctx_dequeue(ctx_list)) != NULL) {
+		if (dplane_ctx_get_status(ctx) != ZEBRA_DPLANE_REQUEST_SUCCESS)
+			atomic_fetch_add_explicit(
+				(dplane_ctx_get_op(ctx) == DPLANE_OP_MAC_DELETE
+					 ? &zdplane_info.dg_mac_errors
+					 : &zdplane_info.dg_neigh_errors),
+				1, memory_order_relaxed);
+
+		dplane_provider_enqueue_out_ctx(prov, ctx);
+		count++;
+	}
+
+	atomic_fetch_add_explicit(&zdplane_info.dg_kernel_evpn_batches,
+				  batches, memory_order_relaxed);
+	atomic_fetch_add_explicit(&zdplane_info.dg_kernel_batch_evpn, count,
+				  memory_order_relaxed);
+}
+
+/*
+ * A link flap touches every LSP resolved over it: consecutive LSP updates
+ * are collected into batches of their own.
+ */
+static bool kernel_dplane_is_lsp_update(const struct zebra_dplane_ctx *ctx)
+{
+	if (dplane_ctx_is_skip_kernel(ctx))
+		return false;
+
+	return (dplane_ctx_get_op(ctx) == DPLANE_OP_LSP_INSTALL
+		|| dplane_ctx_get_op(ctx) == DPLANE_OP_LSP_UPDATE
+		|| dplane_ctx_get_op(ctx) == DPLANE_OP_LSP_DELETE);
+}
+
+/*
+ * Send a list of LSP updates to the kernel in batches, and pass the
+ * contexts on to the next provider.
+ */
+static void kernel_dplane_lsp_update_batch(struct zebra_dplane_provider *prov,
+					   struct dplane_ctx_q *ctx_list)
+{
+	struct zebra_dplane_ctx *ctx;
+	uint32_t count = 0;
+	int batches;
+
+	if (TAILQ_EMPTY(ctx_list))
+		return;
+
+	batches = kernel_lsp_update_multi(ctx_list);
+
+	while ((ctx = dplane_ctx_dequeue(ctx_list)) != NULL) {
+		if (dplane_ctx_get_status(ctx) != ZEBRA_DPLANE_REQUEST_SUCCESS)
+			atomic_fetch_add_explicit(&zdplane_info.dg_lsp_errors,
+						  1, memory_order_relaxed);
+
+		dplane_provider_enqueue_out_ctx(prov, ctx);
+		count++;
+	}
+
+	atomic_fetch_add_explicit(&zdplane_info.dg_kernel_lsp_batches,
+				  batches, memory_order_relaxed);
+	atomic_fetch_add_explicit(&zdplane_info.dg_kernel_batch_lsps, count,
+				  memory_order_relaxed);
+}
+
+/*
+ * Handler for policy based routing updates: rules are programmed in the
+ * kernel, ipsets and iptables by the hooks registered for them.
+ */
+static enum zebra_dplane_result
+kernel_dplane_pbr_update(struct zebra_dplane_ctx *ctx)
+{
+	enum zebra_dplane_result res;
+
+	if (IS_ZEBRA_DEBUG_DPLANE_DETAIL)
+		zlog_debug("Dplane %s, vrf %u",
+			   dplane_op2str(dplane_ctx_get_op(ctx)),
+			   dplane_ctx_get_vrf(ctx));
+
+	if (dplane_ctx_get_op(ctx) == DPLANE_OP_RULE_ADD
+	    || dplane_ctx_get_op(ctx) == DPLANE_OP_RULE_DELETE)
+		res = kernel_pbr_rule_update(ctx);
+	else
+		res = zebra_pbr_dplane_update(ctx);
+
+	if (res != ZEBRA_DPLANE_REQUEST_SUCCESS)
+		atomic_fetch_add_explicit(&zdplane_info.dg_pbr_errors,
+					  1, memory_order_relaxed);
+
+	return res;
+}
+
+/*
+ * Flowspec and PBR clients push rules, ipsets and iptables in bursts of
+ * thousands; they are collected into batches of their own.
+ */
+static bool kernel_dplane_is_pbr_update(const struct zebra_dplane_ctx *ctx)
+{
+	if (dplane_ctx_is_skip_kernel(ctx))
+		return false;
+
+	switch (dplane_ctx_get_op(ctx)) {
+	case DPLANE_OP_RULE_ADD:
+	case DPLANE_OP_RULE_DELETE:
+	case DPLANE_OP_IPSET_ADD:
+	case DPLANE_OP_IPSET_DELETE:
+	case DPLANE_OP_IPSET_ENTRY_ADD:
+	case DPLANE_OP_IPSET_ENTRY_DELETE:
+	case DPLANE_OP_IPTABLE_ADD:
+	case DPLANE_OP_IPTABLE_DELETE:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/*
+ * Program a list of policy based routing updates, and pass the contexts
+ * on to the next provider. Ipsets and iptables are handed to their hooks
+ * in order; the rules are sent to the kernel in batches.
+ */
+static void kernel_dplane_pbr_update_batch(struct zebra_dplane_provider *prov,
+					   struct dplane_ctx_q *ctx_list)
+{
+	struct dplane_ctx_q rule_list, done_list;
+	struct zebra_dplane_ctx *ctx;
+	uint32_t count = 0;
+	int batches;
+
+	if (TAILQ_EMPTY(ctx_list))
+		return;
+
+	TAILQ_INIT(&rule_list);
+	TAILQ_INIT(&done_list);
+
+	while ((ctx = dplane_ctx_dequeue(ctx_list)) != NULL) {
+		if (dplane_ctx_get_op(ctx) == DPLANE_OP_RULE_ADD
+		    || dplane_ctx_get_op(ctx) == DPLANE_OP_RULE_DELETE) {
+			dplane_ctx_enqueue_tail(&rule_list, ctx);
+			continue;
+		}
+
+		dplane_ctx_set_status(ctx, zebra_pbr_dplane_update(ctx));
+		dplane_ctx_enqueue_tail(&done_list, ctx);
+	}
+
+	batches = kernel_pbr_rule_update_multi(&rule_list);
+	dplane_ctx_list_append(&done_list, &rule_list);
+
+	while ((ctx = dplane_ctx_dequeue(&done_list)) != NULL) {
+		if (dplane_ctx_get_status(ctx) != ZEBRA_DPLANE_REQUEST_SUCCESS)
+			atomic_fetch_add_explicit(&zdplane_info.dg_pbr_errors,
+						  1, memory_order_relaxed);
+
+		dplane_provider_enqueue_out_ctx(prov, ctx);
+		count++;
+	}
+
+	atomic_fetch_add_explicit(&zdplane_info.dg_kernel_pbr_batches,
+				  batches, memory_order_relaxed);
+	atomic_fetch_add_explicit(&zdplane_info.dg_kernel_batch_pbrs, count,
+				  memory_order_relaxed);
+}
+
+/*
+ * Update the kernel for one context
+ */
+static enum zebra_dplane_result
+kernel_dplane_process_ctx(struct zebra_dplane_ctx *ctx)
+{
+	enum zebra_dplane_result res;
+
+	/* A previous provider plugin may have asked to skip the
+	 * kernel update.
+	 */
+	if (dplane_ctx_is_skip_kernel(ctx))
+		return ZEBRA_DPLANE_REQUEST_SUCCESS;
+
+	/* Dispatch to appropriate kernel-facing apis */
+	switch (dplane_ctx_get_op(ctx)) {
+
+	case DPLANE_OP_ROUTE_INSTALL:
+	case DPLANE_OP_ROUTE_UPDATE:
+	case DPLANE_OP_ROUTE_DELETE:
+		res = kernel_dplane_route_update(ctx);
+		break;
+
+	case DPLANE_OP_NH_INSTALL:
+	case DPLANE_OP_NH_UPDATE:
+	case DPLANE_OP_NH_DELETE:
+		res = kernel_dplane_nexthop_update(ctx);
+		break;
+
+	case DPLANE_OP_LSP_INSTALL:
+	case DPLANE_OP_LSP_UPDATE:
+	case DPLANE_OP_LSP_DELETE:
+		res = kernel_dplane_lsp_update(ctx);
+		break;
+
+	case DPLANE_OP_PW_INSTALL:
+	case DPLANE_OP_PW_UNINSTALL:
+		res = kernel_dplane_pw_update(ctx);
+		break;
+
+	case DPLANE_OP_ADDR_INSTALL:
+	case DPLANE_OP_ADDR_UNINSTALL:
+		res = kernel_dplane_address_update(ctx);
+		break;
+
+	case DPLANE_OP_MAC_INSTALL:
+	case DPLANE_OP_MAC_DELETE:
+		res = kernel_dplane_mac_update(ctx);
+		break;
+
+	case DPLANE_OP_NEIGH_INSTALL:
+	case DPLANE_OP_NEIGH_UPDATE:
+	case DPLANE_OP_NEIGH_DELETE:
+	case DPLANE_OP_VTEP_ADD:
+	case DPLANE_OP_VTEP_DELETE:
+		res = kernel_dplane_neigh_update(ctx);
+		break;
+
+	case DPLANE_OP_RULE_ADD:
+	case DPLANE_OP_RULE_DELETE:
+	case DPLANE_OP_IPSET_ADD:
+	case DPLANE_OP_IPSET_DELETE:
+	case DPLANE_OP_IPSET_ENTRY_ADD:
+	case DPLANE_OP_IPSET_ENTRY_DELETE:
+	case DPLANE_OP_IPTABLE_ADD:
+	case DPLANE_OP_IPTABLE_DELETE:
+		res = kernel_dplane_pbr_update(ctx);
+		break;
+
+	/* Ignore 'notifications' - no-op */
+	case DPLANE_OP_SYS_ROUTE_ADD:
+	case DPLANE_OP_SYS_ROUTE_DELETE:
+	case DPLANE_OP_ROUTE_NOTIFY:
+	case DPLANE_OP_LSP_NOTIFY:
+		res = ZEBRA_DPLANE_REQUEST_SUCCESS;
+		break;
+
+	default:
+		atomic_fetch_add_explicit(
+			&zdplane_info.dg_other_errors, 1,
+			memory_order_relaxed);
+
+		res = ZEBRA_DPLANE_REQUEST_FAILURE;
+		break;
+	}
+
+	return res;
+}
+
+/*
+ * Kernel route worker event: send the queued route updates to the kernel
+ * and hand them back to the dplane pthread.
+ */
+static int kernel_dplane_worker_run(struct thread *event)
+{
+	struct dplane_kernel_worker *w = THREAD_ARG(event);
+	struct dplane_ctx_q work_list;
+	struct zebra_dplane_ctx *ctx;
+	uint32_t count, limit, batches;
+
+	limit = zdplane_info.dg_updates_per_cycle;
+
+	TAILQ_INIT(&work_list);
+
+	pthread_mutex_lock(&w->dw_mutex);
+
+	for (count = 0; count < limit; count++) {
+		ctx = TAILQ_FIRST(&w->dw_ctx_in_q);
+		if (ctx == NULL)
+			break;
+
+		TAILQ_REMOVE(&w->dw_ctx_in_q, ctx, zd_q_entries);
+		TAILQ_INSERT_TAIL(&work_list, ctx, zd_q_entries);
+	}
+
+	pthread_mutex_unlock(&w->dw_mutex);
+
+	if (count == 0)
+		return 0;
+
+	atomic_fetch_sub_explicit(&w->dw_queued, count, memory_order_relaxed);
+
+	batches = kernel_dplane_route_update_batch(w->dw_prov, w->dw_kernel,
+						   &work_list);
+
+	atomic_fetch_add_explicit(&w->dw_routes, count, memory_order_relaxed);
+	atomic_fetch_add_explicit(&w->dw_batches, batches,
+				  memory_order_relaxed);
+	atomic_fetch_sub_explicit(&zdplane_info.dg_kernel_worker_pending,
+				  count, memory_order_relaxed);
+
+	/* Let the dplane pthread collect the results */
+	dplane_provider_work_ready();
+
+	if (atomic_load_explicit(&w->dw_queued, memory_order_relaxed) > 0)
+		thread_add_event(w->dw_master, kernel_dplane_worker_run, w, 0,
+				 &w->dw_t_work);
+
+	return 0;
+}
+
+/* Kernel route worker event: a namespace was deleted */
+static int kernel_dplane_worker_ns_event(struct thread *event)
+{
+	struct dplane_kernel_worker *w = THREAD_ARG(event);
+
+	kernel_dplane_worker_close_ns(w->dw_kernel, (ns_id_t)THREAD_VAL(event));
+
+	return 0;
+}
+
+/* Worker for a route update: the same table always maps to one worker */
+static uint32_t kernel_dplane_worker_index(const struct zebra_dplane_ctx *ctx,
+					   uint32_t nworkers)
+{
+	return jhash_2words(dplane_ctx_get_table(ctx),
+			    dplane_ctx_get_ns(ctx)->ns_id, 0)
+	       % nworkers;
+}
+
+/*
+ * Hand lists of route updates over to the workers.
+ */
+static void kernel_dplane_workers_dispatch(struct dplane_ctx_q *lists,
+					   uint32_t nworkers)
+{
+	struct dplane_kernel_worker *w;
+	struct zebra_dplane_ctx *ctx;
+	uint32_t i, count, curr, high;
+
+	for (i = 0; i < nworkers; i++) {
+		if (TAILQ_EMPTY(&lists[i]))
+			continue;
+
+		w = &zdplane_info.dg_kernel_workers[i];
+
+		count = 0;
+		TAILQ_FOREACH (ctx, &lists[i], zd_q_entries)
+			count++;
+
+		atomic_fetch_add_explicit(
+			&zdplane_info.dg_kernel_worker_pending, count,
+			memory_order_relaxed);
+		curr = atomic_fetch_add_explicit(&w->dw_queued, count,
+						 memory_order_relaxed)
+		       + count;
+		high = atomic_load_explicit(&w->dw_queued_max,
+					    memory_order_relaxed);
+		if (curr > high)
+			atomic_store_explicit(&w->dw_queued_max, curr,
+					      memory_order_relaxed);
+
+		pthread_mutex_lock(&w->dw_mutex);
+		TAILQ_CONCAT(&w->dw_ctx_in_q, &lists[i], zd_q_entries);
+		pthread_mutex_unlock(&w->dw_mutex);
+
+		thread_add_event(w->dw_master, kernel_dplane_worker_run, w, 0,
+				 &w->dw_t_work);
+	}
+}
+
+static bool kernel_dplane_workers_apply(struct zebra_dplane_provider *prov);
+
 /*
  * Kernel provider callback
  */
@@ -3217,9 +4342,29 @@ static int kernel_dplane_process_func(struct zebra_dplane_provider *prov)
 {
 	enum zebra_dplane_result res;
 	struct zebra_dplane_ctx *ctx;
+	struct dplane_ctx_q batch_list, evpn_list, lsp_list, pbr_list;
+	struct dplane_ctx_q worker_lists[DPLANE_MAX_KERNEL_WORKERS];
+	uint32_t nworkers, i;
 	int counter, limit;
+	bool batch;
+
+	/* The workers return their updates and wake us up once they are
+	 * done; new updates wait while the workers are restarted.
+	 */
+	if (kernel_dplane_workers_apply(prov))
+		return 0;
 
 	limit = dplane_provider_get_work_limit(prov);
+	batch = atomic_load_explicit(&zdplane_info.dg_kernel_batch,
+				     memory_order_relaxed);
+	nworkers = zdplane_info.dg_kernel_worker_count;
+
+	TAILQ_INIT(&batch_list);
+	TAILQ_INIT(&evpn_list);
+	TAILQ_INIT(&lsp_list);
+	TAILQ_INIT(&pbr_list);
+	for (i = 0; i < nworkers; i++)
+		TAILQ_INIT(&worker_lists[i]);
 
 	if (IS_ZEBRA_DEBUG_DPLANE_DETAIL)
 		zlog_debug("dplane provider '%s': processing",
@@ -3227,85 +4372,113 @@ static int kernel_dplane_process_func(struct zebra_dplane_provider *prov)
 
 	for (counter = 0; counter < limit; counter++) {
 
-		ctx = dplane_provider_dequeue_in_ctx(prov);
-		if (ctx == NULL)
-			break;
-
-		/* A previous provider plugin may have asked to skip the
-		 * kernel update.
+		/* An update held back until the workers caught up goes
+		 * first.
 		 */
-		if (dplane_ctx_is_skip_kernel(ctx)) {
-			res = ZEBRA_DPLANE_REQUEST_SUCCESS;
-			goto skip_one;
+		ctx = zdplane_info.dg_kernel_held_ctx;
+		if (ctx) {
+			if (atomic_load_explicit(
+				    &zdplane_info.dg_kernel_worker_pending,
+				    memory_order_relaxed)
+			    > 0)
+				break;
+
+			zdplane_info.dg_kernel_held_ctx = NULL;
+		} else {
+			ctx = dplane_provider_dequeue_in_ctx(prov);
+			if (ctx == NULL)
+				break;
 		}
 
-		/* Dispatch to appropriate kernel-facing apis */
-		switch (dplane_ctx_get_op(ctx)) {
+		/* Shard route updates across the workers, or collect
+		 * consecutive route updates into a batch.
+		 */
+		if ((nworkers > 0 || batch)
+		    && (dplane_ctx_get_op(ctx) == DPLANE_OP_ROUTE_INSTALL
+			|| dplane_ctx_get_op(ctx) == DPLANE_OP_ROUTE_UPDATE
+			|| dplane_ctx_get_op(ctx) == DPLANE_OP_ROUTE_DELETE)) {
+			if (IS_ZEBRA_DEBUG_DPLANE_DETAIL) {
+				char dest_str[PREFIX_STRLEN];
+
+				prefix2str(dplane_ctx_get_dest(ctx), dest_str,
+					   sizeof(dest_str));
+
+				zlog_debug("%u:%s Dplane route update ctx %p op %s (batched)",
+					   dplane_ctx_get_vrf(ctx), dest_str,
+					   ctx,
+					   dplane_op2str(dplane_ctx_get_op(ctx)));
+			}
 
-		case DPLANE_OP_ROUTE_INSTALL:
-		case DPLANE_OP_ROUTE_UPDATE:
-		case DPLANE_OP_ROUTE_DELETE:
-			res = kernel_dplane_route_update(ctx);
-			break;
+			kernel_dplane_evpn_update_batch(prov, &evpn_list);
+			kernel_dplane_lsp_update_batch(prov, &lsp_list);
+			kernel_dplane_pbr_update_batch(prov, &pbr_list);
+
+			if (nworkers > 0)
+				dplane_ctx_enqueue_tail(
+					&worker_lists[kernel_dplane_worker_index(
+						ctx, nworkers)],
+					ctx);
+			else
+				dplane_ctx_enqueue_tail(&batch_list, ctx);
+			continue;
+		}
 
-		case DPLANE_OP_NH_INSTALL:
-		case DPLANE_OP_NH_UPDATE:
-		case DPLANE_OP_NH_DELETE:
-			res = kernel_dplane_nexthop_update(ctx);
-			break;
+		/* Keep the updates in order: anything else waits until the
+		 * route updates before it are done.
+		 */
+		if (nworkers > 0) {
+			kernel_dplane_workers_dispatch(worker_lists, nworkers);
+
+			if (atomic_load_explicit(
+				    &zdplane_info.dg_kernel_worker_pending,
+				    memory_order_relaxed)
+			    > 0) {
+				zdplane_info.dg_kernel_held_ctx = ctx;
+				break;
+			}
+		}
 
-		case DPLANE_OP_LSP_INSTALL:
-		case DPLANE_OP_LSP_UPDATE:
-		case DPLANE_OP_LSP_DELETE:
-			res = kernel_dplane_lsp_update(ctx);
-			break;
+		kernel_dplane_route_update_batch(prov, NULL, &batch_list);
 
-		case DPLANE_OP_PW_INSTALL:
-		case DPLANE_OP_PW_UNINSTALL:
-			res = kernel_dplane_pw_update(ctx);
-			break;
+		if (batch && kernel_dplane_is_evpn_delete(ctx)) {
+			kernel_dplane_lsp_update_batch(prov, &lsp_list);
+			kernel_dplane_pbr_update_batch(prov, &pbr_list);
+			dplane_ctx_enqueue_tail(&evpn_list, ctx);
+			continue;
+		}
 
-		case DPLANE_OP_ADDR_INSTALL:
-		case DPLANE_OP_ADDR_UNINSTALL:
-			res = kernel_dplane_address_update(ctx);
-			break;
+		kernel_dplane_evpn_update_batch(prov, &evpn_list);
 
-		case DPLANE_OP_MAC_INSTALL:
-		case DPLANE_OP_MAC_DELETE:
-			res = kernel_dplane_mac_update(ctx);
-			break;
+		if (batch && kernel_dplane_is_lsp_update(ctx)) {
+			kernel_dplane_pbr_update_batch(prov, &pbr_list);
+			dplane_ctx_enqueue_tail(&lsp_list, ctx);
+			continue;
+		}
 
-		case DPLANE_OP_NEIGH_INSTALL:
-		case DPLANE_OP_NEIGH_UPDATE:
-		case DPLANE_OP_NEIGH_DELETE:
-		case DPLANE_OP_VTEP_ADD:
-		case DPLANE_OP_VTEP_DELETE:
-			res = kernel_dplane_neigh_update(ctx);
-			break;
+		kernel_dplane_lsp_update_batch(prov, &lsp_list);
 
-		/* Ignore 'notifications' - no-op */
-		case DPLANE_OP_SYS_ROUTE_ADD:
-		case DPLANE_OP_SYS_ROUTE_DELETE:
-		case DPLANE_OP_ROUTE_NOTIFY:
-		case DPLANE_OP_LSP_NOTIFY:
-			res = ZEBRA_DPLANE_REQUEST_SUCCESS;
-			break;
+		if (batch && kernel_dplane_is_pbr_update(ctx)) {
+			dplane_ctx_enqueue_tail(&pbr_list, ctx);
+			continue;
+		}
 
-		default:
-			atomic_fetch_add_explicit(
-				&zdplane_info.dg_other_errors, 1,
-				memory_order_relaxed);
+		kernel_dplane_pbr_update_batch(prov, &pbr_list);
 
-			res = ZEBRA_DPLANE_REQUEST_FAILURE;
-			break;
-		}
+		res = kernel_dplane_process_ctx(ctx);
 
-skip_one:
 		dplane_ctx_set_status(ctx, res);
 
 		dplane_provider_enqueue_out_ctx(prov, ctx);
 	}
 
+	if (nworkers > 0)
+		kernel_dplane_workers_dispatch(worker_lists, nworkers);
+
+	kernel_dplane_route_update_batch(prov, NULL, &batch_list);
+	kernel_dplane_evpn_update_batch(prov, &evpn_list);
+	kernel_dplane_lsp_update_batch(prov, &lsp_list);
+	kernel_dplane_pbr_update_batch(prov, &pbr_list);
+
 	/* Ensure that we'll run the work loop again if there's still
 	 * more work to do.
 	 */
@@ -3323,6 +4496,142 @@ skip_one:
 	return 0;
 }
 
+/*
+ * Start 'n' kernel route workers. Runs in the dplane pthread, or before
+ * it is started, with no route updates handed to workers.
+ */
+static void kernel_dplane_workers_start(struct zebra_dplane_provider *prov,
+					uint32_t n)
+{
+	struct frr_pthread_attr pattr = {
+		.start = frr_pthread_attr_default.start,
+		.stop = frr_pthread_attr_default.stop
+	};
+	struct dplane_kernel_worker *workers, *w;
+	char name[32], os_name[OS_THREAD_NAMELEN];
+	uint32_t i;
+
+	workers = XCALLOC(MTYPE_DP_WORKER, n * sizeof(*workers));
+
+	for (i = 0; i < n; i++) {
+		w = &workers[i];
+
+		snprintf(name, sizeof(name), "kernel-dp-w%u", i);
+		w->dw_kernel = kernel_dplane_worker_new(name);
+		if (w->dw_kernel == NULL) {
+			zlog_warn("dplane provider '%s': parallel kernel workers are not supported",
+				  dplane_provider_get_name(prov));
+
+			while (i-- > 0)
+				kernel_dplane_worker_free(&workers[i].dw_kernel);
+			XFREE(MTYPE_DP_WORKER, workers);
+			return;
+		}
+
+		w->dw_id = i;
+		w->dw_prov = prov;
+		pthread_mutex_init(&w->dw_mutex, NULL);
+		TAILQ_INIT(&w->dw_ctx_in_q);
+	}
+
+	/* Completed updates come back from the workers' pthreads */
+	prov->dp_flags |= DPLANE_PROV_FLAG_THREADED;
+
+	for (i = 0; i < n; i++) {
+		w = &workers[i];
+
+		snprintf(name, sizeof(name), "Zebra dplane kernel worker %u",
+			 i);
+		snprintf(os_name, sizeof(os_name), "zebra_dp_kw%u", i);
+		w->dw_pthread = frr_pthread_new(&pattr, name, os_name);
+		w->dw_master = w->dw_pthread->master;
+
+		frr_pthread_run(w->dw_pthread, NULL);
+	}
+
+	DPLANE_LOCK();
+	zdplane_info.dg_kernel_workers = workers;
+	zdplane_info.dg_kernel_worker_count = n;
+	DPLANE_UNLOCK();
+
+	if (IS_ZEBRA_DEBUG_DPLANE)
+		zlog_debug("dplane provider '%s': started %u kernel workers",
+			   dplane_provider_get_name(prov), n);
+}
+
+/*
+ * Stop the kernel route workers; runs in the dplane pthread with no
+ * route updates handed to workers, or after the dplane pthread stopped.
+ */
+static void kernel_dplane_workers_stop(void)
+{
+	struct dplane_kernel_worker *workers, *w;
+	uint32_t i, n;
+
+	DPLANE_LOCK();
+	workers = zdplane_info.dg_kernel_workers;
+	n = zdplane_info.dg_kernel_worker_count;
+	zdplane_info.dg_kernel_workers = NULL;
+	zdplane_info.dg_kernel_worker_count = 0;
+	DPLANE_UNLOCK();
+
+	for (i = 0; i < n; i++) {
+		w = &workers[i];
+
+		frr_pthread_stop(w->dw_pthread, NULL);
+		frr_pthread_destroy(w->dw_pthread);
+		w->dw_pthread = NULL;
+		w->dw_master = NULL;
+
+		kernel_dplane_worker_free(&w->dw_kernel);
+		pthread_mutex_destroy(&w->dw_mutex);
+	}
+
+	XFREE(MTYPE_DP_WORKER, workers);
+}
+
+/*
+ * Restart the kernel route workers if their configured number changed.
+ * The running workers are only stopped once the route updates handed to
+ * them are done; returns true while the kernel provider has to wait.
+ */
+static bool kernel_dplane_workers_apply(struct zebra_dplane_provider *prov)
+{
+	uint32_t cfg;
+
+	cfg = atomic_load_explicit(&zdplane_info.dg_kernel_workers_cfg,
+				   memory_order_relaxed);
+	if (cfg == zdplane_info.dg_kernel_workers_applied)
+		return false;
+
+	if (atomic_load_explicit(&zdplane_info.dg_kernel_worker_pending,
+				 memory_order_relaxed)
+	    > 0)
+		return true;
+
+	kernel_dplane_workers_stop();
+	prov->dp_flags &= ~DPLANE_PROV_FLAG_THREADED;
+
+	/* One worker is the dplane pthread itself */
+	if (cfg > 1)
+		kernel_dplane_workers_start(prov, cfg);
+
+	zdplane_info.dg_kernel_workers_applied = cfg;
+
+	return false;
+}
+
+/*
+ * Kernel provider start callback: start the route workers, if configured.
+ * This runs before the dplane pthread is started.
+ */
+static int kernel_dplane_start_func(struct zebra_dplane_provider *prov)
+{
+	kernel_dplane_workers_apply(prov);
+
+	return 0;
+}
+
 #if DPLANE_TEST_PROVIDER
 
 /*
@@ -3398,7 +4707,8 @@ static void dplane_provider_init(void)
 
 	ret = dplane_provider_register("Kernel",
 				       DPLANE_PRIO_KERNEL,
-				       DPLANE_PROV_FLAGS_DEFAULT, NULL,
+				       DPLANE_PROV_FLAGS_DEFAULT,
+				       kernel_dplane_start_func,
 				       kernel_dplane_process_func,
 				       NULL,
 				       NULL, NULL);
@@ -3472,6 +4782,14 @@ static bool dplane_work_pending(void)
 		goto done;
 	}
 
+	/* Route updates still with the kernel workers */
+	if (atomic_load_explicit(&zdplane_info.dg_kernel_worker_pending,
+				 memory_order_relaxed) > 0
+	    || zdplane_info.dg_kernel_held_ctx != NULL) {
+		ret = true;
+		goto done;
+	}
+
 	while (prov) {
 
 		dplane_provider_lock(prov);
@@ -3567,6 +4885,7 @@ static int dplane_thread_loop(struct thread *event)
 	struct zebra_dplane_ctx *ctx, *tctx;
 	int limit, counter, error_counter;
 	uint64_t curr, high;
+	bool more;
 
 	/* Capture work limit per cycle */
 	limit = zdplane_info.dg_updates_per_cycle;
@@ -3580,6 +4899,16 @@ static int dplane_thread_loop(struct thread *event)
 	if (!zdplane_info.dg_run)
 		goto done;
 
+	/* Allow producers to signal again: anything they enqueue after this
+	 * point either is seen below or schedules another cycle.
+	 */
+	atomic_store_explicit(&zdplane_info.dg_work_signalled, false,
+			      memory_order_seq_cst);
+
+	dplane_hist_add(&zdplane_info.dg_update_depth,
+			atomic_load_explicit(&zdplane_info.dg_routes_queued,
+					     memory_order_relaxed));
+
 	/* Dequeue some incoming work from zebra (if any) onto the temporary
 	 * working list.
 	 */
@@ -3603,6 +4932,8 @@ static int dplane_thread_loop(struct thread *event)
 		}
 	}
 
+	more = !TAILQ_EMPTY(&zdplane_info.dg_update_ctx_q);
+
 	DPLANE_UNLOCK();
 
 	atomic_fetch_sub_explicit(&zdplane_info.dg_routes_queued, counter,
@@ -3669,6 +5000,8 @@ static int dplane_thread_loop(struct thread *event)
 
 		dplane_provider_unlock(prov);
 
+		dplane_hist_add(&prov->dp_in_depth, curr);
+
 		/* Reset the temp list (though the 'concat' may have done this
 		 * already), and the counter
 		 */
@@ -3686,6 +5019,10 @@ static int dplane_thread_loop(struct thread *event)
 			break;
 
 		/* Dequeue completed work from the provider */
+		dplane_hist_add(&prov->dp_out_depth,
+				atomic_load_explicit(&prov->dp_out_queued,
+						     memory_order_relaxed));
+
 		dplane_provider_lock(prov);
 
 		while (counter < limit) {
@@ -3703,6 +5040,9 @@ static int dplane_thread_loop(struct thread *event)
 
 		dplane_provider_unlock(prov);
 
+		atomic_fetch_sub_explicit(&prov->dp_out_queued, counter,
+					  memory_order_relaxed);
+
 		if (IS_ZEBRA_DEBUG_DPLANE_DETAIL)
 			zlog_debug("dplane dequeues %d completed work from provider %s",
 				   counter, dplane_provider_get_name(prov));
@@ -3735,6 +5075,12 @@ static int dplane_thread_loop(struct thread *event)
 
 	TAILQ_INIT(&work_list);
 
+	/* If the per-cycle limit left incoming work behind, come back for
+	 * it rather than waiting for the next enqueue.
+	 */
+	if (more)
+		dplane_provider_work_ready();
+
 done:
 	return 0;
 }
@@ -3761,6 +5107,8 @@ void zebra_dplane_shutdown(void)
 	zdplane_info.dg_pthread = NULL;
 	zdplane_info.dg_master = NULL;
 
+	kernel_dplane_workers_stop();
+
 	/* TODO -- Notify provider(s) of final shutdown */
 
 	/* TODO -- Clean-up provider objects */
@@ -3784,6 +5132,11 @@ static void zebra_dplane_init_internal(void)
 
 	zdplane_info.dg_max_queued_updates = DPLANE_DEFAULT_MAX_QUEUED;
 
+	zdplane_info.dg_kernel_batch = DPLANE_DEFAULT_KERNEL_BATCH;
+
+	zdplane_info.dg_kernel_workers_cfg = DPLANE_DEFAULT_KERNEL_WORKERS;
+	zdplane_info.dg_kernel_workers_applied = DPLANE_DEFAULT_KERNEL_WORKERS;
+
 	/* Register default kernel 'provider' during init */
 	dplane_provider_init();
 }
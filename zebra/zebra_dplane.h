@@ -144,6 +144,18 @@ enum dplane_op_e {
 	/* EVPN VTEP updates */
 	DPLANE_OP_VTEP_ADD,
 	DPLANE_OP_VTEP_DELETE,
+
+	/* Policy based routing rule update */
+	DPLANE_OP_RULE_ADD,
+	DPLANE_OP_RULE_DELETE,
+
+	/* Policy based routing ipset and iptables updates */
+	DPLANE_OP_IPSET_ADD,
+	DPLANE_OP_IPSET_DELETE,
+	DPLANE_OP_IPSET_ENTRY_ADD,
+	DPLANE_OP_IPSET_ENTRY_DELETE,
+	DPLANE_OP_IPTABLE_ADD,
+	DPLANE_OP_IPTABLE_DELETE,
 };
 
 /*
@@ -200,6 +212,12 @@ void dplane_ctx_list_append(struct dplane_ctx_q *to_list,
 /* Dequeue a context block from the head of caller's tailq */
 struct zebra_dplane_ctx *dplane_ctx_dequeue(struct dplane_ctx_q *q);
 
+/* Capture the installed state of a route in a context block, without
+ * enqueueing it.
+ */
+int dplane_ctx_route_snapshot(struct zebra_dplane_ctx *ctx,
+			      struct route_node *rn, struct route_entry *re);
+
 /*
  * Accessors for information from the context object
  */
@@ -355,6 +373,23 @@ const struct ethaddr *dplane_ctx_neigh_get_mac(
 uint32_t dplane_ctx_neigh_get_flags(const struct zebra_dplane_ctx *ctx);
 uint16_t dplane_ctx_neigh_get_state(const struct zebra_dplane_ctx *ctx);
 
+/* Forward refs of the policy based routing objects */
+struct zebra_pbr_rule;
+struct zebra_pbr_ipset;
+struct zebra_pbr_ipset_entry;
+struct zebra_pbr_iptable;
+
+/* Accessors for policy based routing information: copies of the zebra
+ * objects, owned by the context. An ipset entry's backpointer refers to a
+ * copy of its ipset.
+ */
+struct zebra_pbr_rule *dplane_ctx_get_pbr_rule(struct zebra_dplane_ctx *ctx);
+struct zebra_pbr_ipset *dplane_ctx_get_pbr_ipset(struct zebra_dplane_ctx *ctx);
+struct zebra_pbr_ipset_entry *
+dplane_ctx_get_pbr_ipset_entry(struct zebra_dplane_ctx *ctx);
+struct zebra_pbr_iptable *
+dplane_ctx_get_pbr_iptable(struct zebra_dplane_ctx *ctx);
+
 /* Namespace info - esp. for netlink communication */
 const struct zebra_dplane_info *dplane_ctx_get_ns(
 	const struct zebra_dplane_ctx *ctx);
@@ -374,6 +409,11 @@ enum zebra_dplane_result dplane_route_update(struct route_node *rn,
 					     struct route_entry *re,
 					     struct route_entry *old_re);
 
+/* Route the kernel already holds, only the other providers are updated */
+enum zebra_dplane_result dplane_route_retain(struct route_node *rn,
+					     struct route_entry *re,
+					     struct route_entry *old_re);
+
 enum zebra_dplane_result dplane_route_delete(struct route_node *rn,
 					     struct route_entry *re);
 
@@ -393,6 +433,13 @@ enum zebra_dplane_result dplane_route_notif_update(
 
 /* Forward ref of nhg_hash_entry */
 struct nhg_hash_entry;
+
+/* Capture the installed state of a nexthop group in a context block,
+ * without enqueueing it.
+ */
+int dplane_ctx_nexthop_snapshot(struct zebra_dplane_ctx *ctx,
+				struct nhg_hash_entry *nhe);
+
 /*
  * Enqueue a nexthop change operation for the dataplane.
  */
@@ -465,6 +512,29 @@ enum zebra_dplane_result dplane_vtep_delete(const struct interface *ifp,
 					    const struct in_addr *ip,
 					    vni_t vni);
 
+/*
+ * Enqueue policy based routing rule updates for the dataplane.
+ */
+enum zebra_dplane_result dplane_pbr_rule_add(struct zebra_pbr_rule *rule);
+enum zebra_dplane_result dplane_pbr_rule_delete(struct zebra_pbr_rule *rule);
+enum zebra_dplane_result
+dplane_pbr_rule_delete_sync(struct zebra_pbr_rule *rule);
+
+/*
+ * Enqueue ipset and iptables updates for the dataplane.
+ */
+enum zebra_dplane_result dplane_pbr_ipset_add(struct zebra_pbr_ipset *ipset);
+enum zebra_dplane_result
+dplane_pbr_ipset_delete(struct zebra_pbr_ipset *ipset);
+enum zebra_dplane_result
+dplane_pbr_ipset_entry_add(struct zebra_pbr_ipset_entry *ipset);
+enum zebra_dplane_result
+dplane_pbr_ipset_entry_delete(struct zebra_pbr_ipset_entry *ipset);
+enum zebra_dplane_result
+dplane_pbr_iptable_add(struct zebra_pbr_iptable *iptable);
+enum zebra_dplane_result
+dplane_pbr_iptable_delete(struct zebra_pbr_iptable *iptable);
+
 
 /* Retrieve the limit on the number of pending, unprocessed updates. */
 uint32_t dplane_get_in_queue_limit(void);
@@ -474,6 +544,15 @@ uint32_t dplane_get_in_queue_limit(void);
  */
 void dplane_set_in_queue_limit(uint32_t limit, bool set);
 
+/* Enable or disable batching of kernel route updates */
+void dplane_set_kernel_batch(bool enable);
+
+/* Configure the number of kernel route worker pthreads */
+void dplane_set_kernel_workers(uint32_t count);
+
+/* Close the kernel route workers' sockets for a deleted namespace */
+void dplane_kernel_workers_ns_close(ns_id_t ns_id);
+
 /* Retrieve the current queue depth of incoming, unprocessed updates */
 uint32_t dplane_get_in_queue_len(void);
 
@@ -582,6 +661,10 @@ int dplane_provider_dequeue_in_list(struct zebra_dplane_provider *prov,
 void dplane_provider_enqueue_out_ctx(struct zebra_dplane_provider *prov,
 				     struct zebra_dplane_ctx *ctx);
 
+/* Enqueue a list of completed work under one lock, maintain counters */
+void dplane_provider_enqueue_out_list(struct zebra_dplane_provider *prov,
+				      struct dplane_ctx_q *listp);
+
 /* Enqueue a context directly to zebra main. */
 void dplane_provider_enqueue_to_zebra(struct zebra_dplane_ctx *ctx);
 
@@ -31,6 +31,7 @@
 #include "command.h"
 #include "version.h"
 #include "jhash.h"
+#include "frr_pthread.h"
 
 #include "zebra/rib.h"
 #include "zebra/zserv.h"
@@ -53,16 +54,30 @@ DEFINE_MTYPE_STATIC(ZEBRA, FPM_MAC_INFO, "FPM_MAC_INFO");
 
 /*
  * Sizes of outgoing and incoming stream buffers for writing/reading
- * FPM messages.
+ * FPM messages. Updates are encoded into one large outgoing buffer, so
+ * that a resync goes out in few, large writes; the writer pthread is
+ * handed copies sized to what was encoded.
  */
-#define ZFPM_OBUF_SIZE (2 * FPM_MAX_MSG_LEN)
+#define ZFPM_OBUF_SIZE (64 * FPM_MAX_MSG_LEN)
 #define ZFPM_IBUF_SIZE (FPM_MAX_MSG_LEN)
 
 /*
- * The maximum number of times the FPM socket write callback can call
- * 'write' before it yields.
+ * Encoding stops once the buffers waiting for the writer pthread take
+ * this many bytes, and resumes once it has freed half of them.
  */
-#define ZFPM_MAX_WRITES_PER_RUN 10
+#define ZFPM_BACKLOG_MAX (4 * 1024 * 1024)
+
+/*
+ * With "fpm resume", time to wait for the FPM to ask to resume the
+ * session after connecting, before sending a full snapshot.
+ */
+#define ZFPM_RESUME_WAIT_MSEC 1000
+
+/*
+ * Default time for which the state needed to resume a session is kept
+ * after the connection to the FPM goes down.
+ */
+#define ZFPM_RESUME_HOLD_DEFAULT 120
 
 /*
  * Interval over which we collect statistics.
@@ -93,7 +108,7 @@ typedef struct zfpm_stats_t_ {
 	unsigned long write_cb_calls;
 	unsigned long write_calls;
 	unsigned long partial_writes;
-	unsigned long max_writes_hit;
+	unsigned long bytes_written;
 	unsigned long t_write_yields;
 
 	unsigned long nop_deletes_skipped;
@@ -116,6 +131,10 @@ typedef struct zfpm_stats_t_ {
 	unsigned long t_conn_up_aborts;
 	unsigned long t_conn_up_finishes;
 
+	unsigned long sync_msgs;
+	unsigned long snapshots;
+	unsigned long resumes;
+
 } zfpm_stats_t;
 
 /*
@@ -186,6 +205,7 @@ typedef struct zfpm_glob_t_ {
 	 * List of rib_dest_t structures to be processed
 	 */
 	TAILQ_HEAD(zfpm_dest_q, rib_dest_t_) dest_q;
+	uint32_t dest_q_len;
 
 	/*
 	 * List of fpm_mac_info structures to be processed
@@ -212,18 +232,80 @@ typedef struct zfpm_glob_t_ {
 	int sock;
 
 	/*
-	 * Buffers for messages to/from the FPM.
+	 * Buffer for messages from the FPM.
 	 */
-	struct stream *obuf;
 	struct stream *ibuf;
 
+	/*
+	 * Buffer updates are encoded into.
+	 */
+	struct stream *obuf;
+
+	/*
+	 * Buffers of encoded messages waiting to be written to the socket
+	 * by the writer pthread, and the number of bytes allocated for them.
+	 */
+	struct stream_fifo *obuf_fifo;
+	_Atomic uint32_t obuf_backlog;
+
 	/*
 	 * Threads for I/O.
 	 */
 	struct thread *t_connect;
 	struct thread *t_write;
+	struct thread *t_build;
 	struct thread *t_read;
 
+	/*
+	 * Writer pthread, and its task writing to the socket. Events it
+	 * posts to the main pthread carry the id of the connection they
+	 * belong to.
+	 */
+	struct frr_pthread *pthread;
+	struct thread *t_pwrite;
+	uint32_t conn_id;
+	_Atomic bool build_signalled;
+
+	/*
+	 * Counters updated by the writer pthread, folded into the stats
+	 * below by zfpm_stats_sync().
+	 */
+	struct {
+		_Atomic unsigned long write_calls;
+		_Atomic unsigned long partial_writes;
+		_Atomic unsigned long bytes_written;
+	} wstats;
+
+	struct {
+		unsigned long write_calls;
+		unsigned long partial_writes;
+		unsigned long bytes_written;
+	} wstats_synced;
+
+	/*
+	 * Session resumption, see fpm_sync_msg_t.
+	 */
+	bool resume;
+	uint32_t resume_hold;
+	uint32_t epoch;
+
+	/*
+	 * Last sequence number stamped on a dest, and the last one
+	 * announced to the FPM in a MARK or END.
+	 */
+	uint64_t seq;
+	uint64_t mark_seq;
+
+	/*
+	 * A BEGIN must precede the next updates, an END must follow them
+	 * once the conn_up thread is done.
+	 */
+	bool sync_begin;
+	bool sync_end;
+
+	struct thread *t_resume_wait;
+	struct thread *t_resume_hold;
+
 	/*
 	 * Thread to clean up after the TCP connection to the FPM goes down
 	 * and the state that belongs to it.
@@ -242,6 +324,12 @@ typedef struct zfpm_glob_t_ {
 
 	struct {
 		zfpm_rnodes_iter_t iter;
+
+		/*
+		 * Only dests updated after this sequence number are sent, 0
+		 * sends all of them.
+		 */
+		uint64_t resume_seq;
 	} t_conn_up_state;
 
 	unsigned long connect_calls;
@@ -283,6 +371,7 @@ static int zfpm_trigger_update(struct route_node *rn, const char *reason);
 
 static int zfpm_read_cb(struct thread *thread);
 static int zfpm_write_cb(struct thread *thread);
+static int zfpm_build_cb(struct thread *thread);
 
 static void zfpm_set_state(zfpm_state_t state, const char *reason);
 static void zfpm_start_connect_timer(const char *reason);
@@ -458,6 +547,42 @@ static void zfpm_stats_compose(const zfpm_stats_t *s1, const zfpm_stats_t *s2,
 	}
 }
 
+/*
+ * zfpm_stat_delta
+ *
+ * Returns how much a counter of the writer pthread has grown since the
+ * last call.
+ */
+static unsigned long zfpm_stat_delta(_Atomic unsigned long *counter,
+				     unsigned long *synced)
+{
+	unsigned long value, delta;
+
+	value = atomic_load_explicit(counter, memory_order_relaxed);
+	delta = value - *synced;
+	*synced = value;
+
+	return delta;
+}
+
+/*
+ * zfpm_stats_sync
+ *
+ * Fold the counters of the writer pthread into the current stats.
+ */
+static void zfpm_stats_sync(void)
+{
+	zfpm_g->stats.write_calls +=
+		zfpm_stat_delta(&zfpm_g->wstats.write_calls,
+				&zfpm_g->wstats_synced.write_calls);
+	zfpm_g->stats.partial_writes +=
+		zfpm_stat_delta(&zfpm_g->wstats.partial_writes,
+				&zfpm_g->wstats_synced.partial_writes);
+	zfpm_g->stats.bytes_written +=
+		zfpm_stat_delta(&zfpm_g->wstats.bytes_written,
+				&zfpm_g->wstats_synced.bytes_written);
+}
+
 /*
  * zfpm_read_on
  */
@@ -482,6 +607,21 @@ static inline void zfpm_write_on(void)
 			 &zfpm_g->t_write);
 }
 
+/*
+ * zfpm_build_on
+ *
+ * Schedule encoding of the pending updates. Nothing is encoded while we
+ * wait for a resume request, zfpm_conn_up_start() schedules it then.
+ */
+static inline void zfpm_build_on(void)
+{
+	if (zfpm_g->t_resume_wait)
+		return;
+
+	thread_add_event(zfpm_g->master, zfpm_build_cb, NULL, 0,
+			 &zfpm_g->t_build);
+}
+
 /*
  * zfpm_read_off
  */
@@ -496,6 +636,7 @@ static inline void zfpm_read_off(void)
 static inline void zfpm_write_off(void)
 {
 	THREAD_WRITE_OFF(zfpm_g->t_write);
+	THREAD_OFF(zfpm_g->t_build);
 }
 
 /*
@@ -527,7 +668,9 @@ static int zfpm_conn_up_thread_cb(struct thread *thread)
 	while ((rnode = zfpm_rnodes_iter_next(iter))) {
 		dest = rib_dest_from_rnode(rnode);
 
-		if (dest) {
+		if (dest
+		    && (!zfpm_g->t_conn_up_state.resume_seq
+			|| dest->fpm_seq > zfpm_g->t_conn_up_state.resume_seq)) {
 			zfpm_g->stats.t_conn_up_dests_processed++;
 			zfpm_trigger_update(rnode, NULL);
 		}
@@ -548,11 +691,71 @@ static int zfpm_conn_up_thread_cb(struct thread *thread)
 
 	zfpm_g->stats.t_conn_up_finishes++;
 
+	/*
+	 * Everything has been queued, close the snapshot once it is out.
+	 */
+	if (zfpm_g->resume) {
+		zfpm_g->sync_end = true;
+		zfpm_build_on();
+	}
+
 done:
 	zfpm_rnodes_iter_cleanup(iter);
 	return 0;
 }
 
+/*
+ * zfpm_conn_up_start
+ *
+ * Start the thread that pushes existing routes to the FPM, those updated
+ * after resume_seq or all of them if it is 0.
+ */
+static void zfpm_conn_up_start(uint64_t resume_seq)
+{
+	assert(!zfpm_g->t_conn_up);
+
+	zfpm_rnodes_iter_init(&zfpm_g->t_conn_up_state.iter);
+	zfpm_g->t_conn_up_state.resume_seq = resume_seq;
+
+	if (zfpm_g->resume) {
+		zfpm_g->sync_begin = true;
+		zfpm_g->sync_end = false;
+
+		if (resume_seq)
+			zfpm_g->stats.resumes++;
+		else
+			zfpm_g->stats.snapshots++;
+	}
+
+	zfpm_debug("Starting conn_up thread");
+	zfpm_g->t_conn_up = NULL;
+	thread_add_timer_msec(zfpm_g->master, zfpm_conn_up_thread_cb, NULL, 0,
+			      &zfpm_g->t_conn_up);
+	zfpm_g->stats.t_conn_up_starts++;
+
+	/*
+	 * Send what was queued while waiting for the FPM's resume request.
+	 */
+	zfpm_build_on();
+}
+
+/*
+ * zfpm_resume_wait_cb
+ *
+ * The FPM did not ask to resume the session, send it everything.
+ */
+static int zfpm_resume_wait_cb(struct thread *thread)
+{
+	zfpm_g->t_resume_wait = NULL;
+
+	if (zfpm_g->state != ZFPM_STATE_ESTABLISHED)
+		return 0;
+
+	zfpm_debug("No resume request from the FPM, sending a full snapshot");
+	zfpm_conn_up_start(0);
+	return 0;
+}
+
 /*
  * zfpm_connection_up
  *
@@ -562,21 +765,23 @@ static void zfpm_connection_up(const char *detail)
 {
 	assert(zfpm_g->sock >= 0);
 	zfpm_read_on();
-	zfpm_write_on();
 	zfpm_set_state(ZFPM_STATE_ESTABLISHED, detail);
 
+	zfpm_g->conn_id++;
+	THREAD_OFF(zfpm_g->t_resume_hold);
+
 	/*
-	 * Start thread to push existing routes to the FPM.
+	 * Give the FPM a chance to tell us where to resume from, see
+	 * zfpm_read_sync().
 	 */
-	assert(!zfpm_g->t_conn_up);
-
-	zfpm_rnodes_iter_init(&zfpm_g->t_conn_up_state.iter);
+	if (zfpm_g->resume) {
+		thread_add_timer_msec(zfpm_g->master, zfpm_resume_wait_cb,
+				      NULL, ZFPM_RESUME_WAIT_MSEC,
+				      &zfpm_g->t_resume_wait);
+		return;
+	}
 
-	zfpm_debug("Starting conn_up thread");
-	zfpm_g->t_conn_up = NULL;
-	thread_add_timer_msec(zfpm_g->master, zfpm_conn_up_thread_cb, NULL, 0,
-			      &zfpm_g->t_conn_up);
-	zfpm_g->stats.t_conn_up_starts++;
+	zfpm_conn_up_start(0);
 }
 
 /*
@@ -645,6 +850,7 @@ static int zfpm_conn_down_thread_cb(struct thread *thread)
 			if (CHECK_FLAG(dest->flags, RIB_DEST_UPDATE_FPM)) {
 				TAILQ_REMOVE(&zfpm_g->dest_q, dest,
 					     fpm_q_entries);
+				zfpm_g->dest_q_len--;
 			}
 
 			UNSET_FLAG(dest->flags, RIB_DEST_UPDATE_FPM);
@@ -682,6 +888,98 @@ static int zfpm_conn_down_thread_cb(struct thread *thread)
 	return 0;
 }
 
+/*
+ * zfpm_conn_down_start
+ *
+ * Start thread to clean up state after the connection goes down.
+ */
+static void zfpm_conn_down_start(void)
+{
+	assert(!zfpm_g->t_conn_down);
+	zfpm_rnodes_iter_init(&zfpm_g->t_conn_down_state.iter);
+	zfpm_g->t_conn_down = NULL;
+	thread_add_timer_msec(zfpm_g->master, zfpm_conn_down_thread_cb, NULL, 0,
+			      &zfpm_g->t_conn_down);
+	zfpm_g->stats.t_conn_down_starts++;
+}
+
+/*
+ * zfpm_conn_down_retain
+ *
+ * Drop the pending updates, but keep what has been sent to the FPM so
+ * that the session can be resumed.
+ */
+static void zfpm_conn_down_retain(void)
+{
+	struct fpm_mac_info_t *mac;
+	rib_dest_t *dest;
+
+	while ((mac = TAILQ_FIRST(&zfpm_g->mac_q)) != NULL)
+		zfpm_mac_info_del(mac);
+
+	while ((dest = TAILQ_FIRST(&zfpm_g->dest_q)) != NULL) {
+		UNSET_FLAG(dest->flags, RIB_DEST_UPDATE_FPM);
+		TAILQ_REMOVE(&zfpm_g->dest_q, dest, fpm_q_entries);
+	}
+	zfpm_g->dest_q_len = 0;
+
+	if (zfpm_g->t_conn_up) {
+		THREAD_OFF(zfpm_g->t_conn_up);
+		zfpm_rnodes_iter_cleanup(&zfpm_g->t_conn_up_state.iter);
+		zfpm_g->stats.t_conn_up_aborts++;
+	}
+
+	zfpm_g->sync_begin = false;
+	zfpm_g->sync_end = false;
+}
+
+/*
+ * zfpm_resume_hold_cb
+ *
+ * The FPM did not come back in time, give up on resuming the session
+ * and clean up as if resumption was not configured.
+ */
+static int zfpm_resume_hold_cb(struct thread *thread)
+{
+	zfpm_g->t_resume_hold = NULL;
+
+	if (zfpm_g->state == ZFPM_STATE_ESTABLISHED)
+		return 0;
+
+	zfpm_debug("FPM did not reconnect within %u seconds", zfpm_g->resume_hold);
+
+	THREAD_OFF(zfpm_g->t_connect);
+	zfpm_read_off();
+	zfpm_write_off();
+	if (zfpm_g->sock >= 0) {
+		close(zfpm_g->sock);
+		zfpm_g->sock = -1;
+	}
+
+	/*
+	 * What the FPM holds can no longer be brought up to date.
+	 */
+	zfpm_g->epoch++;
+
+	zfpm_set_state(ZFPM_STATE_IDLE, "resume hold time expired");
+	zfpm_conn_down_start();
+	return 0;
+}
+
+/*
+ * zfpm_writer_stop
+ *
+ * Stop the writer pthread from writing to the socket and drop the
+ * buffers it had yet to write.
+ */
+static void zfpm_writer_stop(void)
+{
+	thread_cancel_async(zfpm_g->pthread->master, &zfpm_g->t_pwrite, NULL);
+
+	stream_fifo_clean_safe(zfpm_g->obuf_fifo);
+	atomic_store_explicit(&zfpm_g->obuf_backlog, 0, memory_order_relaxed);
+}
+
 /*
  * zfpm_connection_down
  *
@@ -698,28 +996,74 @@ static void zfpm_connection_down(const char *detail)
 
 	zfpm_read_off();
 	zfpm_write_off();
+	THREAD_OFF(zfpm_g->t_resume_wait);
 
+	zfpm_writer_stop();
 	stream_reset(zfpm_g->ibuf);
-	stream_reset(zfpm_g->obuf);
 
 	if (zfpm_g->sock >= 0) {
 		close(zfpm_g->sock);
 		zfpm_g->sock = -1;
 	}
 
-	/*
-	 * Start thread to clean up state after the connection goes down.
-	 */
-	assert(!zfpm_g->t_conn_down);
-	zfpm_rnodes_iter_init(&zfpm_g->t_conn_down_state.iter);
-	zfpm_g->t_conn_down = NULL;
-	thread_add_timer_msec(zfpm_g->master, zfpm_conn_down_thread_cb, NULL, 0,
-			      &zfpm_g->t_conn_down);
-	zfpm_g->stats.t_conn_down_starts++;
+	if (zfpm_g->resume) {
+		zfpm_conn_down_retain();
+		zfpm_set_state(ZFPM_STATE_IDLE, detail);
+
+		thread_add_timer(zfpm_g->master, zfpm_resume_hold_cb, NULL,
+				 zfpm_g->resume_hold, &zfpm_g->t_resume_hold);
+		zfpm_start_connect_timer("retaining state to resume");
+		return;
+	}
+
+	zfpm_conn_down_start();
 
 	zfpm_set_state(ZFPM_STATE_IDLE, detail);
 }
 
+/*
+ * zfpm_read_sync
+ *
+ * Process a sync message from the FPM.
+ */
+static void zfpm_read_sync(struct stream *s, size_t msg_len)
+{
+	uint8_t version, op;
+	uint32_t epoch;
+	uint64_t seq;
+
+	if (msg_len < FPM_MSG_HDR_LEN + sizeof(fpm_sync_msg_t))
+		return;
+
+	stream_set_getp(s, FPM_MSG_HDR_LEN);
+	version = stream_getc(s);
+	op = stream_getc(s);
+	stream_forward_getp(s, 2);
+	epoch = stream_getl(s);
+	seq = stream_getq(s);
+
+	if (version != FPM_SYNC_VERSION || op != FPM_SYNC_OP_RESUME)
+		return;
+
+	if (!zfpm_g->t_resume_wait) {
+		zfpm_debug("Ignoring unexpected resume request from the FPM");
+		return;
+	}
+
+	THREAD_OFF(zfpm_g->t_resume_wait);
+
+	if (epoch != zfpm_g->epoch || !seq || seq > zfpm_g->mark_seq) {
+		zfpm_debug("FPM cannot resume from epoch %u sequence %" PRIu64
+			   ", sending a full snapshot",
+			   epoch, seq);
+		zfpm_conn_up_start(0);
+		return;
+	}
+
+	zfpm_debug("Resuming FPM session from sequence %" PRIu64, seq);
+	zfpm_conn_up_start(seq);
+}
+
 /*
  * zfpm_read_cb
  */
@@ -805,8 +1149,11 @@ static int zfpm_read_cb(struct thread *thread)
 			goto done;
 	}
 
+	if (hdr->msg_type == FPM_MSG_TYPE_SYNC)
+		zfpm_read_sync(ibuf, msg_len);
+
 	/*
-	 * Just throw it away for now.
+	 * Throw anything else away for now.
 	 */
 	stream_reset(ibuf);
 
@@ -824,27 +1171,15 @@ static bool zfpm_updates_pending(void)
 }
 
 /*
- * zfpm_writes_pending
+ * zfpm_backlog_full
  *
- * Returns true if we may have something to write to the FPM.
+ * Returns true if enough has been encoded for the writer pthread.
  */
-static int zfpm_writes_pending(void)
+static bool zfpm_backlog_full(void)
 {
-
-	/*
-	 * Check if there is any data in the outbound buffer that has not
-	 * been written to the socket yet.
-	 */
-	if (stream_get_endp(zfpm_g->obuf) - stream_get_getp(zfpm_g->obuf))
-		return 1;
-
-	/*
-	 * Check if there are any updates scheduled on the outbound queues.
-	 */
-	if (zfpm_updates_pending())
-		return 1;
-
-	return 0;
+	return atomic_load_explicit(&zfpm_g->obuf_backlog,
+				    memory_order_relaxed)
+	       >= ZFPM_BACKLOG_MAX;
 }
 
 /*
@@ -928,9 +1263,8 @@ enum {
  *
  * Process the dest_q queue and write FPM messages to the outbound buffer.
  */
-static int zfpm_build_route_updates(void)
+static int zfpm_build_route_updates(struct stream *s)
 {
-	struct stream *s;
 	rib_dest_t *dest;
 	unsigned char *buf, *data, *buf_end;
 	size_t msg_len;
@@ -944,7 +1278,6 @@ static int zfpm_build_route_updates(void)
 	if (TAILQ_EMPTY(&zfpm_g->dest_q))
 		return FPM_GOTO_NEXT_Q;
 
-	s = zfpm_g->obuf;
 	q_limit = FPM_QUEUE_PROCESS_LIMIT;
 
 	do  {
@@ -1006,6 +1339,7 @@ static int zfpm_build_route_updates(void)
 		 */
 		UNSET_FLAG(dest->flags, RIB_DEST_UPDATE_FPM);
 		TAILQ_REMOVE(&zfpm_g->dest_q, dest, fpm_q_entries);
+		zfpm_g->dest_q_len--;
 
 		if (is_add) {
 			SET_FLAG(dest->flags, RIB_DEST_SENT_TO_FPM);
@@ -1061,9 +1395,8 @@ static inline int zfpm_encode_mac(struct fpm_mac_info_t *mac, char *in_buf,
 	return len;
 }
 
-static int zfpm_build_mac_updates(void)
+static int zfpm_build_mac_updates(struct stream *s)
 {
-	struct stream *s;
 	struct fpm_mac_info_t *mac;
 	unsigned char *buf, *data, *buf_end;
 	fpm_msg_hdr_t *hdr;
@@ -1074,7 +1407,6 @@ static int zfpm_build_mac_updates(void)
 	if (TAILQ_EMPTY(&zfpm_g->mac_q))
 		return FPM_GOTO_NEXT_Q;
 
-	s = zfpm_g->obuf;
 	q_limit = FPM_QUEUE_PROCESS_LIMIT;
 
 	do  {
@@ -1123,112 +1455,239 @@ static int zfpm_build_mac_updates(void)
 	} while (1);
 }
 
+/*
+ * zfpm_encode_sync
+ *
+ * Write a sync message to the outbound buffer.
+ */
+static void zfpm_encode_sync(struct stream *s, uint8_t op, uint64_t seq)
+{
+	stream_putc(s, FPM_PROTO_VERSION);
+	stream_putc(s, FPM_MSG_TYPE_SYNC);
+	stream_putw(s, FPM_MSG_HDR_LEN + sizeof(fpm_sync_msg_t));
+	stream_putc(s, FPM_SYNC_VERSION);
+	stream_putc(s, op);
+	stream_putw(s, 0);
+	stream_putl(s, zfpm_g->epoch);
+	stream_putq(s, seq);
+
+	zfpm_g->stats.sync_msgs++;
+}
+
 /*
  * zfpm_build_updates
  *
- * Process the outgoing queues and write messages to the outbound
- * buffer.
+ * Process the outgoing queues and write messages to the given buffer.
  */
-static void zfpm_build_updates(void)
+static void zfpm_build_updates(struct stream *s)
 {
-	struct stream *s;
+	/*
+	 * Nothing goes out until we know where the FPM wants to resume from.
+	 */
+	if (zfpm_g->t_resume_wait)
+		return;
 
-	s = zfpm_g->obuf;
-	assert(stream_empty(s));
+	if (zfpm_g->sync_begin) {
+		zfpm_encode_sync(s, FPM_SYNC_OP_BEGIN,
+				 zfpm_g->t_conn_up_state.resume_seq);
+		zfpm_g->sync_begin = false;
+	}
 
 	do {
 		/*
-		 * Stop processing the queues if zfpm_g->obuf is full
+		 * Stop processing the queues if the buffer is full
 		 * or we do not have more updates to process
 		 */
-		if (zfpm_build_mac_updates() == FPM_WRITE_STOP)
+		if (zfpm_build_mac_updates(s) == FPM_WRITE_STOP)
 			break;
-		if (zfpm_build_route_updates() == FPM_WRITE_STOP)
+		if (zfpm_build_route_updates(s) == FPM_WRITE_STOP)
 			break;
 	} while (zfpm_updates_pending());
+
+	/*
+	 * Once the FPM has been brought up to date, tell it how far it
+	 * got so that it can resume from there after a reconnect.
+	 */
+	if (!zfpm_g->resume || zfpm_updates_pending() || zfpm_g->t_conn_up
+	    || STREAM_WRITEABLE(s) < FPM_MSG_HDR_LEN + sizeof(fpm_sync_msg_t))
+		return;
+
+	if (zfpm_g->sync_end) {
+		zfpm_encode_sync(s, FPM_SYNC_OP_END, zfpm_g->seq);
+		zfpm_g->sync_end = false;
+		zfpm_g->mark_seq = zfpm_g->seq;
+	} else if (zfpm_g->mark_seq < zfpm_g->seq) {
+		zfpm_encode_sync(s, FPM_SYNC_OP_MARK, zfpm_g->seq);
+		zfpm_g->mark_seq = zfpm_g->seq;
+	}
 }
 
 /*
- * zfpm_write_cb
+ * zfpm_writer_error_cb
+ *
+ * Scheduled on the main pthread when the writer fails to write to the
+ * socket.
  */
-static int zfpm_write_cb(struct thread *thread)
+static int zfpm_writer_error_cb(struct thread *thread)
 {
-	struct stream *s;
-	int num_writes;
+	uint32_t conn_id = (uintptr_t)THREAD_ARG(thread);
+	int err = THREAD_VAL(thread);
 
-	zfpm_g->stats.write_cb_calls++;
-	zfpm_g->t_write = NULL;
-
-	/*
-	 * Check if async connect is now done.
-	 */
-	if (zfpm_g->state == ZFPM_STATE_CONNECTING) {
-		zfpm_connect_check();
+	if (conn_id != zfpm_g->conn_id
+	    || zfpm_g->state != ZFPM_STATE_ESTABLISHED)
 		return 0;
-	}
-
-	assert(zfpm_g->state == ZFPM_STATE_ESTABLISHED);
-	assert(zfpm_g->sock >= 0);
-
-	num_writes = 0;
-
-	do {
-		int bytes_to_write, bytes_written;
 
-		s = zfpm_g->obuf;
+	zlog_info("failed to write to FPM socket: %s", safe_strerror(err));
+	zfpm_connection_down("failed to write to socket");
+	return 0;
+}
 
-		/*
-		 * If the stream is empty, try fill it up with data.
-		 */
-		if (stream_empty(s)) {
-			zfpm_build_updates();
-		}
+/*
+ * zfpm_writer_cb
+ *
+ * Runs on the writer pthread, writes out the buffers queued by the main
+ * pthread.
+ */
+static int zfpm_writer_cb(struct thread *thread)
+{
+	struct stream *s;
+	ssize_t bytes_to_write, bytes_written;
+	uint32_t backlog;
 
-		bytes_to_write = stream_get_endp(s) - stream_get_getp(s);
-		if (!bytes_to_write)
-			break;
+	while ((s = stream_fifo_head_safe(zfpm_g->obuf_fifo)) != NULL) {
+		bytes_to_write = STREAM_READABLE(s);
 
 		bytes_written =
-			write(zfpm_g->sock, stream_pnt(s), bytes_to_write);
-		zfpm_g->stats.write_calls++;
-		num_writes++;
+			write(THREAD_FD(thread), stream_pnt(s), bytes_to_write);
+		atomic_fetch_add_explicit(&zfpm_g->wstats.write_calls, 1,
+					  memory_order_relaxed);
 
 		if (bytes_written < 0) {
 			if (ERRNO_IO_RETRY(errno))
 				break;
 
-			zfpm_connection_down("failed to write to socket");
+			thread_add_event(zfpm_g->master, zfpm_writer_error_cb,
+					 THREAD_ARG(thread), errno, NULL);
 			return 0;
 		}
 
+		atomic_fetch_add_explicit(&zfpm_g->wstats.bytes_written,
+					  bytes_written, memory_order_relaxed);
+
 		if (bytes_written != bytes_to_write) {
 
 			/*
 			 * Partial write.
 			 */
 			stream_forward_getp(s, bytes_written);
-			zfpm_g->stats.partial_writes++;
+			atomic_fetch_add_explicit(&zfpm_g->wstats.partial_writes,
+						  1, memory_order_relaxed);
 			break;
 		}
 
+		s = stream_fifo_pop_safe(zfpm_g->obuf_fifo);
+		backlog = atomic_fetch_sub_explicit(&zfpm_g->obuf_backlog,
+						    STREAM_SIZE(s),
+						    memory_order_relaxed)
+			  - STREAM_SIZE(s);
+		stream_free(s);
+
 		/*
-		 * We've written out the entire contents of the stream.
+		 * Ask the main pthread for more once we are down to half
+		 * of the backlog.
 		 */
-		stream_reset(s);
+		if (backlog < ZFPM_BACKLOG_MAX / 2
+		    && !atomic_exchange_explicit(&zfpm_g->build_signalled, true,
+						 memory_order_relaxed))
+			thread_add_event(zfpm_g->master, zfpm_build_cb, NULL, 0,
+					 NULL);
+	}
+
+	if (s)
+		thread_add_write(zfpm_g->pthread->master, zfpm_writer_cb,
+				 THREAD_ARG(thread), THREAD_FD(thread),
+				 &zfpm_g->t_pwrite);
+
+	return 0;
+}
 
-		if (num_writes >= ZFPM_MAX_WRITES_PER_RUN) {
-			zfpm_g->stats.max_writes_hit++;
+/*
+ * zfpm_writer_enqueue
+ *
+ * Hand an encoded buffer over to the writer pthread.
+ */
+static void zfpm_writer_enqueue(struct stream *s)
+{
+	atomic_fetch_add_explicit(&zfpm_g->obuf_backlog, STREAM_SIZE(s),
+				  memory_order_relaxed);
+	stream_fifo_push_safe(zfpm_g->obuf_fifo, s);
+
+	thread_add_write(zfpm_g->pthread->master, zfpm_writer_cb,
+			 (void *)(uintptr_t)zfpm_g->conn_id, zfpm_g->sock,
+			 &zfpm_g->t_pwrite);
+}
+
+/*
+ * zfpm_build_cb
+ *
+ * Encode pending updates into buffers for the writer pthread.
+ */
+static int zfpm_build_cb(struct thread *thread)
+{
+	struct stream *s;
+	size_t len;
+
+	zfpm_g->t_build = NULL;
+	atomic_store_explicit(&zfpm_g->build_signalled, false,
+			      memory_order_relaxed);
+
+	if (zfpm_g->state != ZFPM_STATE_ESTABLISHED)
+		return 0;
+
+	assert(zfpm_g->sock >= 0);
+
+	while (!zfpm_backlog_full()) {
+		stream_reset(zfpm_g->obuf);
+		zfpm_build_updates(zfpm_g->obuf);
+
+		if (stream_empty(zfpm_g->obuf))
 			break;
-		}
+
+		/*
+		 * Queue a copy only as large as what was encoded, the
+		 * encoding buffer is reused.
+		 */
+		len = stream_get_endp(zfpm_g->obuf);
+		s = stream_new(len);
+		stream_put(s, STREAM_DATA(zfpm_g->obuf), len);
+		zfpm_writer_enqueue(s);
 
 		if (zfpm_thread_should_yield(thread)) {
 			zfpm_g->stats.t_write_yields++;
 			break;
 		}
-	} while (1);
+	}
 
-	if (zfpm_writes_pending())
-		zfpm_write_on();
+	if (zfpm_updates_pending() && !zfpm_backlog_full())
+		zfpm_build_on();
+
+	return 0;
+}
+
+/*
+ * zfpm_write_cb
+ */
+static int zfpm_write_cb(struct thread *thread)
+{
+	zfpm_g->stats.write_cb_calls++;
+	zfpm_g->t_write = NULL;
+
+	/*
+	 * Check if async connect is now done. Once the connection is
+	 * established, the writer pthread owns the socket for writing.
+	 */
+	if (zfpm_g->state == ZFPM_STATE_CONNECTING)
+		zfpm_connect_check();
 
 	return 0;
 }
@@ -1321,7 +1780,12 @@ static void zfpm_set_state(zfpm_state_t state, const char *reason)
 	switch (state) {
 
 	case ZFPM_STATE_IDLE:
-		assert(cur_state == ZFPM_STATE_ESTABLISHED);
+		/*
+		 * From ACTIVE or CONNECTING when the resume hold time
+		 * expires, after the connection attempt was given up.
+		 */
+		assert(cur_state == ZFPM_STATE_ESTABLISHED
+		       || (zfpm_g->t_connect == NULL && zfpm_g->sock < 0));
 		break;
 
 	case ZFPM_STATE_ACTIVE:
@@ -1342,7 +1806,6 @@ static void zfpm_set_state(zfpm_state_t state, const char *reason)
 		       || cur_state == ZFPM_STATE_CONNECTING);
 		assert(zfpm_g->sock);
 		assert(zfpm_g->t_read);
-		assert(zfpm_g->t_write);
 		break;
 	}
 
@@ -1433,6 +1896,14 @@ static int zfpm_trigger_update(struct route_node *rn, const char *reason)
 	rib_dest_t *dest;
 	char buf[PREFIX_STRLEN];
 
+	/*
+	 * Remember when the destination last changed, a resumed session
+	 * only needs what changed after the FPM's last sync mark.
+	 */
+	dest = rib_dest_from_rnode(rn);
+	if (dest)
+		dest->fpm_seq = ++zfpm_g->seq;
+
 	/*
 	 * Ignore if the connection is down. We will update the FPM about
 	 * all destinations once the connection comes up.
@@ -1440,8 +1911,6 @@ static int zfpm_trigger_update(struct route_node *rn, const char *reason)
 	if (!zfpm_conn_is_up())
 		return 0;
 
-	dest = rib_dest_from_rnode(rn);
-
 	if (CHECK_FLAG(dest->flags, RIB_DEST_UPDATE_FPM)) {
 		zfpm_g->stats.redundant_triggers++;
 		return 0;
@@ -1454,15 +1923,14 @@ static int zfpm_trigger_update(struct route_node *rn, const char *reason)
 
 	SET_FLAG(dest->flags, RIB_DEST_UPDATE_FPM);
 	TAILQ_INSERT_TAIL(&zfpm_g->dest_q, dest, fpm_q_entries);
+	zfpm_g->dest_q_len++;
 	zfpm_g->stats.updates_triggered++;
 
 	/*
-	 * Make sure that writes are enabled.
+	 * Make sure that the updates get encoded.
 	 */
-	if (zfpm_g->t_write)
-		return 0;
-
-	zfpm_write_on();
+	if (!zfpm_backlog_full())
+		zfpm_build_on();
 	return 0;
 }
 
@@ -1632,11 +2100,8 @@ static int zfpm_trigger_rmac_update(zebra_mac_t *rmac, zebra_l3vni_t *zl3vni,
 
 	zfpm_g->stats.updates_triggered++;
 
-	/* If writes are already enabled, return. */
-	if (zfpm_g->t_write)
-		return 0;
-
-	zfpm_write_on();
+	if (!zfpm_backlog_full())
+		zfpm_build_on();
 	return 0;
 }
 
@@ -1674,6 +2139,8 @@ static int zfpm_stats_timer_cb(struct thread *t)
 {
 	zfpm_g->t_stats = NULL;
 
+	zfpm_stats_sync();
+
 	/*
 	 * Remember the stats collected in the last interval for display
 	 * purposes.
@@ -1742,6 +2209,7 @@ static void zfpm_show_stats(struct vty *vty)
 	/*
 	 * Compute the total stats up to this instant.
 	 */
+	zfpm_stats_sync();
 	zfpm_stats_compose(&zfpm_g->cumulative_stats, &zfpm_g->stats,
 			   &total_stats);
 
@@ -1751,7 +2219,7 @@ static void zfpm_show_stats(struct vty *vty)
 	ZFPM_SHOW_STAT(write_cb_calls);
 	ZFPM_SHOW_STAT(write_calls);
 	ZFPM_SHOW_STAT(partial_writes);
-	ZFPM_SHOW_STAT(max_writes_hit);
+	ZFPM_SHOW_STAT(bytes_written);
 	ZFPM_SHOW_STAT(t_write_yields);
 	ZFPM_SHOW_STAT(nop_deletes_skipped);
 	ZFPM_SHOW_STAT(route_adds);
@@ -1768,6 +2236,23 @@ static void zfpm_show_stats(struct vty *vty)
 	ZFPM_SHOW_STAT(t_conn_up_yields);
 	ZFPM_SHOW_STAT(t_conn_up_aborts);
 	ZFPM_SHOW_STAT(t_conn_up_finishes);
+	ZFPM_SHOW_STAT(sync_msgs);
+	ZFPM_SHOW_STAT(snapshots);
+	ZFPM_SHOW_STAT(resumes);
+
+	vty_out(vty, "\nWrite rate: %lu bytes/sec\n",
+		zfpm_g->last_ivl_stats.bytes_written / ZFPM_STATS_IVL_SECS);
+	vty_out(vty, "Writer backlog: %u bytes in %zu buffers\n",
+		atomic_load_explicit(&zfpm_g->obuf_backlog,
+				     memory_order_relaxed),
+		stream_fifo_count_safe(zfpm_g->obuf_fifo));
+	vty_out(vty, "Route update queue: %u destinations\n",
+		zfpm_g->dest_q_len);
+	if (zfpm_g->resume)
+		vty_out(vty,
+			"Resume epoch %u, sequence %" PRIu64
+			", last mark %" PRIu64 "\n",
+			zfpm_g->epoch, zfpm_g->seq, zfpm_g->mark_seq);
 
 	if (!zfpm_g->last_stats_clear_time)
 		return;
@@ -1877,6 +2362,47 @@ DEFUN ( no_fpm_remote_ip,
 	return CMD_SUCCESS;
 }
 
+DEFUN (fpm_resume,
+       fpm_resume_cmd,
+       "fpm resume [hold-time (10-3600)]",
+       "Forwarding Path Manager configuration\n"
+       "Resume the FPM session after a reconnect\n"
+       "Time to retain the FPM state while disconnected\n"
+       "Seconds\n")
+{
+	zfpm_g->resume = true;
+	zfpm_g->resume_hold = ZFPM_RESUME_HOLD_DEFAULT;
+	if (argc > 3)
+		zfpm_g->resume_hold = strtoul(argv[3]->arg, NULL, 10);
+
+	return CMD_SUCCESS;
+}
+
+DEFUN (no_fpm_resume,
+       no_fpm_resume_cmd,
+       "no fpm resume [hold-time (10-3600)]",
+       NO_STR
+       "Forwarding Path Manager configuration\n"
+       "Resume the FPM session after a reconnect\n"
+       "Time to retain the FPM state while disconnected\n"
+       "Seconds\n")
+{
+	zfpm_g->resume = false;
+	zfpm_g->resume_hold = ZFPM_RESUME_HOLD_DEFAULT;
+
+	/*
+	 * Let a pending hold expire right away, there is nothing to
+	 * resume anymore.
+	 */
+	if (zfpm_g->t_resume_hold) {
+		THREAD_OFF(zfpm_g->t_resume_hold);
+		thread_add_timer(zfpm_g->master, zfpm_resume_hold_cb, NULL, 0,
+				 &zfpm_g->t_resume_hold);
+	}
+
+	return CMD_SUCCESS;
+}
+
 /*
  * zfpm_init_message_format
  */
@@ -1955,6 +2481,14 @@ static int fpm_remote_srv_write(struct vty *vty)
 		vty_out(vty, "fpm connection ip %s port %d\n", inet_ntoa(in),
 			zfpm_g->fpm_port);
 
+	if (zfpm_g->resume) {
+		if (zfpm_g->resume_hold != ZFPM_RESUME_HOLD_DEFAULT)
+			vty_out(vty, "fpm resume hold-time %u\n",
+				zfpm_g->resume_hold);
+		else
+			vty_out(vty, "fpm resume\n");
+	}
+
 	return 0;
 }
 
@@ -1979,6 +2513,10 @@ static int zfpm_init(struct thread_master *master)
 	int enable = 1;
 	uint16_t port = 0;
 	const char *format = THIS_MODULE->load_args;
+	struct frr_pthread_attr pattr = {
+		.start = frr_pthread_attr_default.start,
+		.stop = frr_pthread_attr_default.stop
+	};
 
 	memset(zfpm_g, 0, sizeof(*zfpm_g));
 	zfpm_g->master = master;
@@ -2002,6 +2540,8 @@ static int zfpm_init(struct thread_master *master)
 	install_element(ENABLE_NODE, &clear_zebra_fpm_stats_cmd);
 	install_element(CONFIG_NODE, &fpm_remote_ip_cmd);
 	install_element(CONFIG_NODE, &no_fpm_remote_ip_cmd);
+	install_element(CONFIG_NODE, &fpm_resume_cmd);
+	install_element(CONFIG_NODE, &no_fpm_resume_cmd);
 
 	zfpm_init_message_format(format);
 
@@ -2022,18 +2562,52 @@ static int zfpm_init(struct thread_master *master)
 	zfpm_g->fpm_port = port;
 
 	zfpm_g->obuf = stream_new(ZFPM_OBUF_SIZE);
+	zfpm_g->obuf_fifo = stream_fifo_new();
 	zfpm_g->ibuf = stream_new(ZFPM_IBUF_SIZE);
 
+	/*
+	 * The epoch tells the FPM whether what it holds came from this
+	 * instance of zebra.
+	 */
+	zfpm_g->epoch = (uint32_t)time(NULL) ^ (uint32_t)getpid();
+	zfpm_g->resume_hold = ZFPM_RESUME_HOLD_DEFAULT;
+
+	zfpm_g->pthread =
+		frr_pthread_new(&pattr, "Zebra FPM writer", "zebra_fpm");
+	frr_pthread_run(zfpm_g->pthread, NULL);
+
 	zfpm_start_stats_timer();
 	zfpm_start_connect_timer("initialized");
 	return 0;
 }
 
+/*
+ * zfpm_fini
+ *
+ * Stop the writer pthread.
+ */
+static int zfpm_fini(void)
+{
+	if (!zfpm_g->pthread)
+		return 0;
+
+	frr_pthread_stop(zfpm_g->pthread, NULL);
+	frr_pthread_destroy(zfpm_g->pthread);
+	zfpm_g->pthread = NULL;
+
+	stream_fifo_free(zfpm_g->obuf_fifo);
+	zfpm_g->obuf_fifo = NULL;
+	stream_free(zfpm_g->obuf);
+	zfpm_g->obuf = NULL;
+	return 0;
+}
+
 static int zebra_fpm_module_init(void)
 {
 	hook_register(rib_update, zfpm_trigger_update);
 	hook_register(zebra_rmac_update, zfpm_trigger_rmac_update);
 	hook_register(frr_late_init, zfpm_init);
+	hook_register(frr_early_fini, zfpm_fini);
 	return 0;
 }
 
@@ -831,15 +831,26 @@ static void lsp_select_best_nhlfe(zebra_lsp_t *lsp)
 			lsp->num_ecmp++;
 		}
 
-		if (CHECK_FLAG(lsp->flags, LSP_FLAG_INSTALLED) && !changed) {
+		/*
+		 * Record how each NHLFE differs from the installed LSP, so
+		 * the dataplane can tell which nexthops an update touches.
+		 * A first install carries no diff: every NHLFE is new.
+		 */
+		UNSET_FLAG(nhlfe->flags, NHLFE_FLAG_DIFF);
+		if (CHECK_FLAG(lsp->flags, LSP_FLAG_INSTALLED)) {
 			nh_chg = CHECK_FLAG(nhlfe->flags, NHLFE_FLAG_CHANGED);
 			nh_sel = CHECK_FLAG(nhlfe->flags, NHLFE_FLAG_SELECTED);
 			nh_inst =
 				CHECK_FLAG(nhlfe->flags, NHLFE_FLAG_INSTALLED);
 
-			if ((nh_sel && !nh_inst)
-			    || (nh_sel && nh_inst && nh_chg)
-			    || (nh_inst && !nh_sel))
+			if (nh_sel && !nh_inst)
+				SET_FLAG(nhlfe->flags, NHLFE_FLAG_DIFF_ADD);
+			else if (nh_inst && !nh_sel)
+				SET_FLAG(nhlfe->flags, NHLFE_FLAG_DIFF_DEL);
+			else if (nh_sel && nh_inst && nh_chg)
+				SET_FLAG(nhlfe->flags, NHLFE_FLAG_DIFF_UPDATE);
+
+			if (CHECK_FLAG(nhlfe->flags, NHLFE_FLAG_DIFF))
 				changed = 1;
 		}
 
@@ -876,6 +887,31 @@ static void lsp_schedule(struct hash_bucket *bucket, void *ctxt)
 	(void)lsp_processq_add(lsp);
 }
 
+/*
+ * Log the NHLFEs an update of an installed LSP adds, removes or changes.
+ */
+static void lsp_debug_diff(zebra_lsp_t *lsp)
+{
+	zebra_nhlfe_t *nhlfe;
+	char buf[BUFSIZ];
+	const char *op;
+
+	for (nhlfe = lsp->nhlfe_list; nhlfe; nhlfe = nhlfe->next) {
+		if (CHECK_FLAG(nhlfe->flags, NHLFE_FLAG_DIFF_ADD))
+			op = "add";
+		else if (CHECK_FLAG(nhlfe->flags, NHLFE_FLAG_DIFF_DEL))
+			op = "delete";
+		else if (CHECK_FLAG(nhlfe->flags, NHLFE_FLAG_DIFF_UPDATE))
+			op = "update";
+		else
+			continue;
+
+		nhlfe2str(nhlfe, buf, BUFSIZ);
+		zlog_debug("LSP in-label %u: %s NHLFE %s", lsp->ile.in_label,
+			   op, buf);
+	}
+}
+
 /*
  * Process a LSP entry that is in the queue. Recalculate best NHLFE and
  * any multipaths and update or delete from the kernel, as needed.
@@ -966,6 +1002,9 @@ static wq_item_status lsp_process(struct work_queue *wq, void *data)
 
 			UNSET_FLAG(lsp->flags, LSP_FLAG_CHANGED);
 
+			if (IS_ZEBRA_DEBUG_MPLS)
+				lsp_debug_diff(lsp);
+
 			/* We leave the INSTALLED flag set here
 			 * so we know an update in in-flight.
 			 */
@@ -1731,6 +1770,33 @@ static int mpls_processq_init(void)
 	return 0;
 }
 
+/*
+ * Check whether a dataplane LSP update programmed an NHLFE, i.e. whether
+ * the update's copy of it was selected and active.
+ */
+static bool lsp_ctx_nhlfe_installed(const struct zebra_dplane_ctx *ctx,
+				    zebra_nhlfe_t *nhlfe)
+{
+	const zebra_nhlfe_t *ctx_nhlfe;
+	struct nexthop *ctx_nexthop;
+
+	for (ctx_nhlfe = dplane_ctx_get_nhlfe(ctx); ctx_nhlfe;
+	     ctx_nhlfe = ctx_nhlfe->next) {
+		ctx_nexthop = ctx_nhlfe->nexthop;
+		if (!ctx_nexthop || ctx_nhlfe->type != nhlfe->type)
+			continue;
+
+		if (nhlfe_nhop_match(nhlfe, ctx_nexthop->type,
+				     &ctx_nexthop->gate, ctx_nexthop->ifindex))
+			continue;
+
+		return CHECK_FLAG(ctx_nhlfe->flags, NHLFE_FLAG_SELECTED)
+		       && CHECK_FLAG(ctx_nexthop->flags, NEXTHOP_FLAG_ACTIVE);
+	}
+
+	return false;
+}
+
 
 /* Public functions */
 
@@ -1779,7 +1845,11 @@ void zebra_mpls_lsp_dplane_result(struct zebra_dplane_ctx *ctx)
 		/* TODO -- Confirm that this result is still 'current' */
 
 		if (status == ZEBRA_DPLANE_REQUEST_SUCCESS) {
-			/* Update zebra object */
+			/* Update zebra object: only the NHLFEs the update
+			 * carried as selected are in the kernel now. Marking
+			 * the others installed would make the next pass over
+			 * the LSP see them as removed, and reprogram it.
+			 */
 			SET_FLAG(lsp->flags, LSP_FLAG_INSTALLED);
 			for (nhlfe = lsp->nhlfe_list; nhlfe;
 			     nhlfe = nhlfe->next) {
@@ -1787,8 +1857,17 @@ void zebra_mpls_lsp_dplane_result(struct zebra_dplane_ctx *ctx)
 				if (!nexthop)
 					continue;
 
-				SET_FLAG(nhlfe->flags, NHLFE_FLAG_INSTALLED);
-				SET_FLAG(nexthop->flags, NEXTHOP_FLAG_FIB);
+				if (lsp_ctx_nhlfe_installed(ctx, nhlfe)) {
+					SET_FLAG(nhlfe->flags,
+						 NHLFE_FLAG_INSTALLED);
+					SET_FLAG(nexthop->flags,
+						 NEXTHOP_FLAG_FIB);
+				} else {
+					UNSET_FLAG(nhlfe->flags,
+						   NHLFE_FLAG_INSTALLED);
+					UNSET_FLAG(nexthop->flags,
+						   NEXTHOP_FLAG_FIB);
+				}
 			}
 		} else {
 			UNSET_FLAG(lsp->flags, LSP_FLAG_INSTALLED);
@@ -3399,9 +3478,11 @@ void zebra_mpls_init_tables(struct zebra_vrf *zvrf)
 {
 	if (!zvrf)
 		return;
-	zvrf->slsp_table =
-		hash_create(label_hash, label_cmp, "ZEBRA SLSP table");
-	zvrf->lsp_table = hash_create(label_hash, label_cmp, "ZEBRA LSP table");
+	/* Start small, most VRFs never carry an LSP; the hashes grow */
+	zvrf->slsp_table = hash_create_size(8, label_hash, label_cmp,
+					    "ZEBRA SLSP table");
+	zvrf->lsp_table = hash_create_size(8, label_hash, label_cmp,
+					   "ZEBRA LSP table");
 	zvrf->fec_table[AFI_IP] = route_table_init();
 	zvrf->fec_table[AFI_IP6] = route_table_init();
 	zvrf->mpls_flags = 0;
@@ -96,6 +96,14 @@ struct zebra_nhlfe_t_ {
 #define NHLFE_FLAG_MULTIPATH   (1 << 2)
 #define NHLFE_FLAG_DELETED     (1 << 3)
 #define NHLFE_FLAG_INSTALLED   (1 << 4)
+/* How the NHLFE differs from what is installed, set when the LSP is
+ * (re)evaluated and carried into the dataplane context.
+ */
+#define NHLFE_FLAG_DIFF_ADD    (1 << 5)
+#define NHLFE_FLAG_DIFF_DEL    (1 << 6)
+#define NHLFE_FLAG_DIFF_UPDATE (1 << 7)
+#define NHLFE_FLAG_DIFF                                                        \
+	(NHLFE_FLAG_DIFF_ADD | NHLFE_FLAG_DIFF_DEL | NHLFE_FLAG_DIFF_UPDATE)
 
 	zebra_nhlfe_t *next;
 	zebra_nhlfe_t *prev;
@@ -23,44 +23,78 @@
 #ifdef HAVE_NETLINK
 
 #include "zebra/debug.h"
+#include "zebra/kernel_netlink.h"
 #include "zebra/rt.h"
 #include "zebra/rt_netlink.h"
 #include "zebra/zebra_mpls.h"
 
 /*
- * LSP forwarding update using dataplane context information.
+ * Netlink command for an LSP update, or 0 if the update is invalid.
  */
-enum zebra_dplane_result kernel_lsp_update(struct zebra_dplane_ctx *ctx)
+static int lsp_update_cmd(struct zebra_dplane_ctx *ctx)
 {
-	int cmd, ret = -1;
-
 	/* Call to netlink layer based on type of update */
-	if (dplane_ctx_get_op(ctx) == DPLANE_OP_LSP_DELETE) {
-		cmd = RTM_DELROUTE;
-	} else if (dplane_ctx_get_op(ctx) == DPLANE_OP_LSP_INSTALL ||
-		   dplane_ctx_get_op(ctx) == DPLANE_OP_LSP_UPDATE) {
+	if (dplane_ctx_get_op(ctx) == DPLANE_OP_LSP_DELETE)
+		return RTM_DELROUTE;
+
+	if (dplane_ctx_get_op(ctx) == DPLANE_OP_LSP_INSTALL ||
+	    dplane_ctx_get_op(ctx) == DPLANE_OP_LSP_UPDATE) {
 
 		/* Validate */
 		if (dplane_ctx_get_best_nhlfe(ctx) == NULL) {
 			if (IS_ZEBRA_DEBUG_KERNEL || IS_ZEBRA_DEBUG_MPLS)
 				zlog_debug("LSP in-label %u: update fails, no best NHLFE",
 					   dplane_ctx_get_in_label(ctx));
-			goto done;
+			return 0;
 		}
 
-		cmd = RTM_NEWROUTE;
-	} else
-		/* Invalid op? */
-		goto done;
+		return RTM_NEWROUTE;
+	}
 
-	ret = netlink_mpls_multipath(cmd, ctx);
+	/* Invalid op? */
+	return 0;
+}
+
+/*
+ * LSP forwarding update using dataplane context information.
+ */
+enum zebra_dplane_result kernel_lsp_update(struct zebra_dplane_ctx *ctx)
+{
+	int cmd, ret = -1;
 
-done:
+	cmd = lsp_update_cmd(ctx);
+	if (cmd)
+		ret = netlink_mpls_multipath(cmd, ctx, NULL);
 
 	return (ret == 0 ?
 		ZEBRA_DPLANE_REQUEST_SUCCESS : ZEBRA_DPLANE_REQUEST_FAILURE);
 }
 
+/* Queue the request of an LSP update on a batch */
+static int lsp_update_encode(struct zebra_dplane_ctx *ctx,
+			     struct nl_batch *bth)
+{
+	int cmd;
+
+	cmd = lsp_update_cmd(ctx);
+	if (!cmd)
+		return -1;
+
+	return netlink_mpls_multipath(cmd, ctx, bth);
+}
+
+/*
+ * Program a list of LSPs, batching the netlink requests. The kernel has
+ * no per-nexthop MPLS operations, so each changed LSP is still sent as
+ * a full route replace; batching saves the per-LSP round trip.
+ *
+ * Returns the number of batches sent to the kernel.
+ */
+int kernel_lsp_update_multi(struct dplane_ctx_q *ctx_list)
+{
+	return netlink_batch_ctx_list(ctx_list, lsp_update_encode);
+}
+
 /*
  * Pseudowire update api - not supported by netlink as of 12/18,
  * but note that the default has been to report 'success' for pw updates
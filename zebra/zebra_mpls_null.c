@@ -43,4 +43,22 @@ enum zebra_dplane_result kernel_lsp_update(struct zebra_dplane_ctx *ctx)
 	return ZEBRA_DPLANE_REQUEST_FAILURE;
 }
 
+/* No batching here: program the LSPs one at a time. */
+int kernel_lsp_update_multi(struct dplane_ctx_q *ctx_list)
+{
+	struct dplane_ctx_q done_list;
+	struct zebra_dplane_ctx *ctx;
+
+	TAILQ_INIT(&done_list);
+
+	while ((ctx = dplane_ctx_dequeue(ctx_list)) != NULL) {
+		dplane_ctx_set_status(ctx, kernel_lsp_update(ctx));
+		dplane_ctx_enqueue_tail(&done_list, ctx);
+	}
+
+	dplane_ctx_list_append(ctx_list, &done_list);
+
+	return 0;
+}
+
 #endif /* !defined(HAVE_NETLINK) && !defined(OPEN_BSD) */
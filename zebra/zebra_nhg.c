@@ -28,6 +28,7 @@
 #include "lib/mpls.h"
 #include "lib/jhash.h"
 #include "lib/debug.h"
+#include "lib/id_alloc.h"
 
 #include "zebra/connected.h"
 #include "zebra/debug.h"
@@ -45,9 +46,29 @@
 DEFINE_MTYPE_STATIC(ZEBRA, NHG, "Nexthop Group Entry");
 DEFINE_MTYPE_STATIC(ZEBRA, NHG_CONNECTED, "Nexthop Group Connected");
 DEFINE_MTYPE_STATIC(ZEBRA, NHG_CTX, "Nexthop Group Context");
+DEFINE_MTYPE_STATIC(ZEBRA, NHG_RESOLVE, "Nexthop Resolution Cache");
 
-/* id counter to keep in sync with kernel */
-uint32_t id_counter;
+DECLARE_DLIST(nhg_gc_list, struct nhg_hash_entry, gc_item);
+
+/*
+ * IDs of the nexthop groups we create. The kernel's groups can have any
+ * ID, so theirs are only reserved if the allocator already covers them;
+ * zebra_nhg_id_allocate() skips the others if it ever gets that far.
+ */
+static struct id_alloc *nhg_id_alloc;
+
+/*
+ * IDs of removed groups are held back until the next garbage collection
+ * run, so that late kernel notifications about a deleted group cannot be
+ * mistaken for a new group that got the same ID.
+ */
+static struct id_alloc_pool *nhg_id_held;
+
+/* Unreferenced groups awaiting removal, oldest first */
+static struct nhg_gc_list_head nhg_gc_list;
+static struct thread *t_nhg_gc;
+static uint64_t nhg_gc_reused;
+static uint64_t nhg_gc_removed;
 
 static struct nhg_hash_entry *depends_find(struct nexthop *nh, afi_t afi);
 static void depends_add(struct nhg_connected_tree_head *head,
@@ -239,6 +260,22 @@ struct nhg_hash_entry *zebra_nhg_lookup_id(uint32_t id)
 	return hash_lookup(zrouter.nhgs_id, &lookup);
 }
 
+/*
+ * Allocate the ID of a group we create. A kernel group whose ID was above
+ * the allocator's range when it was learnt may hold the next ID: skip it,
+ * leaving it allocated until that group is released.
+ */
+static uint32_t zebra_nhg_id_allocate(void)
+{
+	uint32_t id;
+
+	do {
+		id = idalloc_allocate(nhg_id_alloc);
+	} while (id != IDALLOC_INVALID && zebra_nhg_lookup_id(id));
+
+	return id;
+}
+
 static int zebra_nhg_insert_id(struct nhg_hash_entry *nhe)
 {
 	if (hash_lookup(zrouter.nhgs_id, nhe)) {
@@ -444,15 +481,13 @@ static bool zebra_nhg_find(struct nhg_hash_entry **nhe, uint32_t id,
 {
 	struct nhg_hash_entry lookup = {};
 
-	uint32_t old_id_counter = id_counter;
-
 	bool created = false;
 	bool recursive = false;
 
 	/*
 	 * If it has an id at this point, we must have gotten it from the kernel
 	 */
-	lookup.id = id ? id : ++id_counter;
+	lookup.id = id;
 
 	lookup.type = type ? type : ZEBRA_ROUTE_NHG;
 	lookup.nhg = nhg;
@@ -493,10 +528,6 @@ static bool zebra_nhg_find(struct nhg_hash_entry **nhe, uint32_t id,
 	else
 		(*nhe) = hash_lookup(zrouter.nhgs, &lookup);
 
-	/* If it found an nhe in our tables, this new ID is unused */
-	if (*nhe)
-		id_counter = old_id_counter;
-
 	if (!(*nhe)) {
 		/* Only hash/lookup the depends if the first lookup
 		 * fails to find something. This should hopefully save a
@@ -529,6 +560,9 @@ static bool zebra_nhg_find(struct nhg_hash_entry **nhe, uint32_t id,
 			}
 		}
 
+		if (!lookup.id)
+			lookup.id = zebra_nhg_id_allocate();
+
 		(*nhe) = hash_get(zrouter.nhgs, &lookup, zebra_nhg_hash_alloc);
 		created = true;
 
@@ -710,9 +744,13 @@ done:
 }
 
 
+static void zebra_nhg_gc_dequeue(struct nhg_hash_entry *nhe);
+static void zebra_nhg_gc_schedule(void);
+
 static void zebra_nhg_release(struct nhg_hash_entry *nhe)
 {
 	/* Remove it from any lists it may be on */
+	zebra_nhg_gc_dequeue(nhe);
 	zebra_nhg_depends_release(nhe);
 	zebra_nhg_dependents_release(nhe);
 	if (nhe->ifp)
@@ -726,6 +764,11 @@ static void zebra_nhg_release(struct nhg_hash_entry *nhe)
 		hash_release(zrouter.nhgs, nhe);
 
 	hash_release(zrouter.nhgs_id, nhe);
+
+	if (nhg_id_alloc && idalloc_is_allocated(nhg_id_alloc, nhe->id)) {
+		idalloc_free_to_pool(&nhg_id_held, nhe->id);
+		zebra_nhg_gc_schedule();
+	}
 }
 
 static void zebra_nhg_handle_uninstall(struct nhg_hash_entry *nhe)
@@ -939,6 +982,12 @@ int nhg_ctx_process(struct nhg_ctx *ctx)
 		break;
 	}
 
+	/* A new group we failed to take in no longer needs its ID */
+	if (ret && nhg_ctx_get_op(ctx) == NHG_CTX_OP_NEW
+	    && !zebra_nhg_lookup_id(nhg_ctx_get_id(ctx))
+	    && idalloc_is_allocated(nhg_id_alloc, nhg_ctx_get_id(ctx)))
+		idalloc_free(nhg_id_alloc, nhg_ctx_get_id(ctx));
+
 	nhg_ctx_set_status(ctx, (ret ? NHG_CTX_FAILURE : NHG_CTX_SUCCESS));
 
 	nhg_ctx_process_finish(ctx);
@@ -953,11 +1002,14 @@ int zebra_nhg_kernel_find(uint32_t id, struct nexthop *nh, struct nh_grp *grp,
 {
 	struct nhg_ctx *ctx = NULL;
 
-	if (id > id_counter)
-		/* Increase our counter so we don't try to create
-		 * an ID that already exists
-		 */
-		id_counter = id;
+	/* Reserve the ID right away, so we don't try to create a group
+	 * with an ID that already exists in the kernel. Only IDs the
+	 * allocator already covers: reserving a high ID would make it
+	 * allocate every page below.
+	 */
+	if (id < nhg_id_alloc->capacity
+	    && !idalloc_is_allocated(nhg_id_alloc, id))
+		idalloc_reserve(nhg_id_alloc, id);
 
 	ctx = nhg_ctx_init(id, nh, grp, vrf_id, afi, type, count);
 	nhg_ctx_set_op(ctx, NHG_CTX_OP_NEW);
@@ -1095,6 +1147,143 @@ void zebra_nhg_free(void *arg)
 	XFREE(MTYPE_NHG, nhe);
 }
 
+static int zebra_nhg_gc_run(struct thread *thread);
+
+/*
+ * Arm the garbage collection timer for the oldest unreferenced group, or
+ * to hand back the held IDs.
+ */
+static void zebra_nhg_gc_schedule(void)
+{
+	struct nhg_hash_entry *nhe;
+	time_t delay = zrouter.nhg_keep;
+
+	if (t_nhg_gc)
+		return;
+
+	nhe = nhg_gc_list_first(&nhg_gc_list);
+	if (nhe)
+		delay = MAX(nhe->gc_time + (time_t)zrouter.nhg_keep
+				    - monotime(NULL),
+			    0);
+	else if (!nhg_id_held)
+		return;
+
+	thread_add_timer(zrouter.master, zebra_nhg_gc_run, NULL, delay,
+			 &t_nhg_gc);
+}
+
+static void zebra_nhg_gc_enqueue(struct nhg_hash_entry *nhe)
+{
+	/* On the way down, remove groups right away as routes go */
+	if (atomic_load_explicit(&zrouter.in_shutdown, memory_order_relaxed)
+	    || !nhg_id_alloc) {
+		zebra_nhg_uninstall_kernel(nhe);
+		return;
+	}
+
+	if (CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_GC))
+		return;
+
+	SET_FLAG(nhe->flags, NEXTHOP_GROUP_GC);
+	nhe->gc_time = monotime(NULL);
+	nhg_gc_list_add_tail(&nhg_gc_list, nhe);
+
+	zebra_nhg_gc_schedule();
+}
+
+static void zebra_nhg_gc_dequeue(struct nhg_hash_entry *nhe)
+{
+	if (!CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_GC))
+		return;
+
+	UNSET_FLAG(nhe->flags, NEXTHOP_GROUP_GC);
+	nhg_gc_list_del(&nhg_gc_list, nhe);
+}
+
+/*
+ * Remove the unreferenced groups that have been kept long enough, in one
+ * pass, and hand the IDs held since the previous pass back to the
+ * allocator. The singletons of a group lose their last reference along
+ * with it, so they are queued at the same time and removed in the same
+ * pass.
+ */
+static int zebra_nhg_gc_run(struct thread *thread)
+{
+	struct nhg_hash_entry *nhe;
+	struct id_alloc_pool *held = nhg_id_held;
+	time_t now = monotime(NULL);
+	uint32_t count = 0;
+
+	nhg_id_held = NULL;
+	idalloc_drain_pool(nhg_id_alloc, &held);
+
+	while ((nhe = nhg_gc_list_first(&nhg_gc_list))) {
+		if (nhe->gc_time + (time_t)zrouter.nhg_keep > now)
+			break;
+
+		zebra_nhg_gc_dequeue(nhe);
+		zebra_nhg_uninstall_kernel(nhe);
+		count++;
+	}
+
+	nhg_gc_removed += count;
+
+	if (count && IS_ZEBRA_DEBUG_RIB)
+		zlog_debug("%s: removed %u unreferenced nexthop groups",
+			   __func__, count);
+
+	zebra_nhg_gc_schedule();
+
+	return 0;
+}
+
+/*
+ * Remove every unreferenced group now, e.g. at shutdown.
+ */
+void zebra_nhg_gc_flush(void)
+{
+	struct nhg_hash_entry *nhe;
+
+	while ((nhe = nhg_gc_list_first(&nhg_gc_list))) {
+		zebra_nhg_gc_dequeue(nhe);
+		zebra_nhg_uninstall_kernel(nhe);
+		nhg_gc_removed++;
+	}
+}
+
+void zebra_nhg_gc_stats(uint32_t *queued, uint32_t *ids, uint64_t *reused,
+			uint64_t *removed)
+{
+	*queued = nhg_gc_list_count(&nhg_gc_list);
+	/* Less the reserved invalid ID */
+	*ids = nhg_id_alloc ? nhg_id_alloc->allocated - 1 : 0;
+	*reused = nhg_gc_reused;
+	*removed = nhg_gc_removed;
+}
+
+void zebra_nhg_init(void)
+{
+	nhg_id_alloc = idalloc_new("Nexthop Group IDs");
+	nhg_gc_list_init(&nhg_gc_list);
+}
+
+void zebra_nhg_terminate(void)
+{
+	struct nhg_hash_entry *nhe;
+
+	THREAD_OFF(t_nhg_gc);
+
+	/* The groups themselves go with the nexthop group tables */
+	while ((nhe = nhg_gc_list_pop(&nhg_gc_list)))
+		UNSET_FLAG(nhe->flags, NEXTHOP_GROUP_GC);
+	nhg_gc_list_fini(&nhg_gc_list);
+
+	idalloc_drain_pool(nhg_id_alloc, &nhg_id_held);
+	idalloc_destroy(nhg_id_alloc);
+	nhg_id_alloc = NULL;
+}
+
 void zebra_nhg_decrement_ref(struct nhg_hash_entry *nhe)
 {
 	nhe->refcnt--;
@@ -1103,11 +1292,16 @@ void zebra_nhg_decrement_ref(struct nhg_hash_entry *nhe)
 		nhg_connected_tree_decrement_ref(&nhe->nhg_depends);
 
 	if (ZEBRA_NHG_CREATED(nhe) && nhe->refcnt <= 0)
-		zebra_nhg_uninstall_kernel(nhe);
+		zebra_nhg_gc_enqueue(nhe);
 }
 
 void zebra_nhg_increment_ref(struct nhg_hash_entry *nhe)
 {
+	if (CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_GC)) {
+		zebra_nhg_gc_dequeue(nhe);
+		nhg_gc_reused++;
+	}
+
 	nhe->refcnt++;
 
 	if (!zebra_nhg_depends_is_empty(nhe))
@@ -1228,6 +1422,197 @@ static bool nexthop_valid_resolve(const struct nexthop *nexthop,
 	return true;
 }
 
+/*
+ * Nexthop resolution cache.
+ *
+ * Resolving a recursive nexthop starts with a longest match lookup of its
+ * address in the RIB, which for a full table over a handful of nexthops
+ * is repeated for every route with the very same result.  Cache the route
+ * node returned per (vrf, afi, address).  Entries hang off the dest of
+ * that node, much like the rnh's on dest->nht, and are dropped when a
+ * covering dest is created or evaluated for nexthop tracking, which
+ * includes its removal; only these events change the longest match.
+ */
+#define NHG_RESOLVE_CACHE_MAX 65536
+
+PREDECL_HASH(nhg_resolve_hash)
+
+struct nhg_resolve_entry {
+	vrf_id_t vrf_id;
+	afi_t afi;
+	union g_addr addr;
+
+	/* Longest match for addr, locked */
+	struct route_node *rn;
+
+	struct nhg_resolve_list_item list;
+	struct nhg_resolve_hash_item hash;
+};
+
+static int nhg_resolve_cmp(const struct nhg_resolve_entry *e1,
+			   const struct nhg_resolve_entry *e2)
+{
+	if (e1->vrf_id != e2->vrf_id)
+		return numcmp(e1->vrf_id, e2->vrf_id);
+	if (e1->afi != e2->afi)
+		return numcmp(e1->afi, e2->afi);
+
+	return memcmp(&e1->addr, &e2->addr, sizeof(e1->addr));
+}
+
+static uint32_t nhg_resolve_hashfn(const struct nhg_resolve_entry *e)
+{
+	return jhash(&e->addr, sizeof(e->addr),
+		     jhash_2words(e->vrf_id, e->afi, 0));
+}
+
+DECLARE_LIST(nhg_resolve_list, struct nhg_resolve_entry, list)
+DECLARE_HASH(nhg_resolve_hash, struct nhg_resolve_entry, hash,
+	     nhg_resolve_cmp, nhg_resolve_hashfn)
+
+static struct {
+	struct nhg_resolve_hash_head entries;
+	uint64_t hits;
+	uint64_t misses;
+} nhg_resolve_cache;
+
+static void nhg_resolve_entry_prefix(const struct nhg_resolve_entry *entry,
+				     struct prefix *p)
+{
+	memset(p, 0, sizeof(*p));
+	if (entry->afi == AFI_IP) {
+		p->family = AF_INET;
+		p->prefixlen = IPV4_MAX_PREFIXLEN;
+		p->u.prefix4 = entry->addr.ipv4;
+	} else {
+		p->family = AF_INET6;
+		p->prefixlen = IPV6_MAX_PREFIXLEN;
+		p->u.prefix6 = entry->addr.ipv6;
+	}
+}
+
+static void nhg_resolve_entry_free(struct nhg_resolve_entry *entry,
+				   bool unlock)
+{
+	rib_dest_t *dest = rib_dest_from_rnode(entry->rn);
+
+	nhg_resolve_hash_del(&nhg_resolve_cache.entries, entry);
+	if (dest)
+		nhg_resolve_list_del(&dest->nh_resolve, entry);
+	if (unlock)
+		route_unlock_node(entry->rn);
+
+	XFREE(MTYPE_NHG_RESOLVE, entry);
+}
+
+static void nhg_resolve_cache_flush(void)
+{
+	struct nhg_resolve_entry *entry;
+
+	while ((entry = nhg_resolve_hash_first(&nhg_resolve_cache.entries)))
+		nhg_resolve_entry_free(entry, true);
+}
+
+void zebra_nhg_resolve_dest_init(rib_dest_t *dest)
+{
+	nhg_resolve_list_init(&dest->nh_resolve);
+}
+
+/* The dest is going away, unlock is false when its table is being freed */
+void zebra_nhg_resolve_dest_fini(rib_dest_t *dest, bool unlock)
+{
+	struct nhg_resolve_entry *entry;
+
+	while ((entry = nhg_resolve_list_first(&dest->nh_resolve)))
+		nhg_resolve_entry_free(entry, unlock);
+
+	nhg_resolve_list_fini(&dest->nh_resolve);
+}
+
+/*
+ * rn was added, changed or is about to be removed: drop every cached
+ * resolution of an address it covers.  Those can only be cached on rn
+ * itself or on a less specific node above it.
+ */
+void zebra_nhg_resolve_cache_invalidate(struct route_node *rn)
+{
+	const struct prefix *p = &rn->p;
+	struct nhg_resolve_entry *entry;
+	struct prefix addr;
+	rib_dest_t *dest;
+
+	for (; rn; rn = rn->parent) {
+		dest = rib_dest_from_rnode(rn);
+		if (!dest)
+			continue;
+
+		frr_each_safe (nhg_resolve_list, &dest->nh_resolve, entry) {
+			nhg_resolve_entry_prefix(entry, &addr);
+			if (addr.family == p->family && prefix_match(p, &addr))
+				nhg_resolve_entry_free(entry, true);
+		}
+	}
+}
+
+void zebra_nhg_resolve_cache_stats(uint32_t *count, uint64_t *hits,
+				   uint64_t *misses)
+{
+	*count = nhg_resolve_hash_count(&nhg_resolve_cache.entries);
+	*hits = nhg_resolve_cache.hits;
+	*misses = nhg_resolve_cache.misses;
+}
+
+/* route_node_match() for a nexthop address, through the cache */
+static struct route_node *nhg_resolve_match(struct route_table *table,
+					    vrf_id_t vrf_id, afi_t afi,
+					    const struct prefix *p)
+{
+	struct nhg_resolve_entry finder, *entry;
+	struct route_node *rn;
+	rib_dest_t *dest;
+
+	memset(&finder, 0, sizeof(finder));
+	finder.vrf_id = vrf_id;
+	finder.afi = afi;
+	if (afi == AFI_IP)
+		finder.addr.ipv4 = p->u.prefix4;
+	else
+		finder.addr.ipv6 = p->u.prefix6;
+
+	entry = nhg_resolve_hash_find(&nhg_resolve_cache.entries, &finder);
+	if (entry) {
+		if (entry->rn->table == table) {
+			nhg_resolve_cache.hits++;
+			return route_lock_node(entry->rn);
+		}
+
+		nhg_resolve_entry_free(entry, true);
+	}
+
+	nhg_resolve_cache.misses++;
+
+	rn = route_node_match(table, p);
+	if (!rn)
+		return NULL;
+
+	dest = rib_dest_from_rnode(rn);
+	if (!dest)
+		return rn;
+
+	if (nhg_resolve_hash_count(&nhg_resolve_cache.entries)
+	    >= NHG_RESOLVE_CACHE_MAX)
+		nhg_resolve_cache_flush();
+
+	entry = XCALLOC(MTYPE_NHG_RESOLVE, sizeof(*entry));
+	*entry = finder;
+	entry->rn = route_lock_node(rn);
+
+	nhg_resolve_list_add_tail(&dest->nh_resolve, entry);
+	nhg_resolve_hash_add(&nhg_resolve_cache.entries, entry);
+
+	return rn;
+}
+
 /*
  * Given a nexthop we need to properly recursively resolve
  * the route.  As such, do a table lookup to find and match
@@ -1335,7 +1720,7 @@ static int nexthop_active(afi_t afi, struct route_entry *re,
 		return 0;
 	}
 
-	rn = route_node_match(table, (struct prefix *)&p);
+	rn = nhg_resolve_match(table, nexthop->vrf_id, afi, &p);
 	while (rn) {
 		route_unlock_node(rn);
 
@@ -1589,6 +1974,252 @@ static unsigned nexthop_active_check(struct route_node *rn,
 	return CHECK_FLAG(nexthop->flags, NEXTHOP_FLAG_ACTIVE);
 }
 
+/*
+ * Batch-scoped memo of nexthop resolution results.
+ *
+ * While the meta-queue drains a batch of route nodes, many of the routes
+ * usually share the same nexthop group (a BGP feed being the typical
+ * case) and resolve it against the same, unchanging, covering routes.
+ * Remember the outcome of nexthop_active_update() per nexthop group so
+ * that the remaining routes of the batch can reuse it.  An entry is
+ * dropped as soon as a route covering one of its gateways is processed,
+ * and routes whose resolution depends on anything but the nexthop group
+ * itself (route-maps, resolving over themselves) are never memoized.
+ */
+#define NHG_BATCH_MEMO_SIZE 32
+#define NHG_BATCH_MEMO_GATES 8
+
+#define NHG_BATCH_STATUS_MASK                                                  \
+	(ROUTE_ENTRY_INSTALLED | ROUTE_ENTRY_LABELS_CHANGED)
+
+struct nhg_batch_memo {
+	/* Key, nhe_id 0 marks an unused slot */
+	uint32_t nhe_id;
+	int type;
+	uint8_t family;
+	uint32_t flags;
+	uint32_t status;
+
+	/* Result */
+	uint32_t new_nhe_id;
+	bool changed;
+	bool mtu_set;
+	uint32_t mtu;
+	uint8_t curr_active;
+
+	uint8_t gate_count;
+	struct prefix gates[NHG_BATCH_MEMO_GATES];
+};
+
+static struct {
+	bool active;
+	unsigned int next;
+	uint64_t hits;
+	uint64_t misses;
+	struct nhg_batch_memo memo[NHG_BATCH_MEMO_SIZE];
+} nhg_batch;
+
+void zebra_nhg_batch_begin(void)
+{
+	memset(nhg_batch.memo, 0, sizeof(nhg_batch.memo));
+	nhg_batch.next = 0;
+	nhg_batch.active = true;
+}
+
+void zebra_nhg_batch_end(void)
+{
+	nhg_batch.active = false;
+}
+
+void zebra_nhg_batch_stats(uint64_t *hits, uint64_t *misses)
+{
+	*hits = nhg_batch.hits;
+	*misses = nhg_batch.misses;
+}
+
+static bool nhg_batch_gate_covered(const struct prefix *p,
+				   const struct nhg_batch_memo *m)
+{
+	uint8_t i;
+
+	for (i = 0; i < m->gate_count; i++)
+		if (prefix_match(p, &m->gates[i]))
+			return true;
+
+	return false;
+}
+
+/* A route covering one of the gateways was just (re)selected */
+void zebra_nhg_batch_route_processed(struct route_node *rn)
+{
+	const struct prefix *p;
+	unsigned int i;
+
+	if (!nhg_batch.active)
+		return;
+
+	srcdest_rnode_prefixes(rn, &p, NULL);
+
+	for (i = 0; i < NHG_BATCH_MEMO_SIZE; i++)
+		if (nhg_batch.memo[i].nhe_id
+		    && nhg_batch_gate_covered(p, &nhg_batch.memo[i]))
+			nhg_batch.memo[i].nhe_id = 0;
+}
+
+static bool nhg_batch_rmap_configured(vrf_id_t vrf_id, int type)
+{
+	struct zebra_vrf *zvrf;
+	afi_t afi;
+
+	zvrf = zebra_vrf_lookup_by_id(vrf_id);
+	if (!zvrf)
+		return false;
+
+	for (afi = AFI_IP; afi <= AFI_IP6; afi++)
+		if (PROTO_RM_NAME(zvrf, afi, type)
+		    || PROTO_RM_NAME(zvrf, afi, ZEBRA_ROUTE_MAX))
+			return true;
+
+	return false;
+}
+
+/*
+ * Check whether the resolution of re's nexthops can be memoized and
+ * collect the gateways it depends on.
+ */
+static bool nhg_batch_memo_prepare(struct route_node *rn,
+				   struct route_entry *re,
+				   struct nhg_batch_memo *m)
+{
+	const struct prefix *p;
+	struct nexthop *nexthop;
+	struct prefix *gate;
+
+	if (!re->ng || !re->nhe_id)
+		return false;
+
+	srcdest_rnode_prefixes(rn, &p, NULL);
+
+	memset(m, 0, sizeof(*m));
+	for (nexthop = re->ng->nexthop; nexthop; nexthop = nexthop->next) {
+		if (nhg_batch_rmap_configured(nexthop->vrf_id, re->type))
+			return false;
+
+		switch (nexthop->type) {
+		case NEXTHOP_TYPE_IPV4:
+		case NEXTHOP_TYPE_IPV4_IFINDEX:
+		case NEXTHOP_TYPE_IPV6:
+		case NEXTHOP_TYPE_IPV6_IFINDEX:
+			break;
+		default:
+			continue;
+		}
+
+		if (nexthop->type == NEXTHOP_TYPE_IPV6_IFINDEX
+		    && IN6_IS_ADDR_LINKLOCAL(&nexthop->gate.ipv6))
+			continue;
+
+		if (m->gate_count == NHG_BATCH_MEMO_GATES)
+			return false;
+
+		gate = &m->gates[m->gate_count++];
+		if (nexthop->type == NEXTHOP_TYPE_IPV4
+		    || nexthop->type == NEXTHOP_TYPE_IPV4_IFINDEX) {
+			gate->family = AF_INET;
+			gate->prefixlen = IPV4_MAX_PREFIXLEN;
+			gate->u.prefix4 = nexthop->gate.ipv4;
+		} else {
+			gate->family = AF_INET6;
+			gate->prefixlen = IPV6_MAX_PREFIXLEN;
+			gate->u.prefix6 = nexthop->gate.ipv6;
+		}
+
+		/* Would resolve over itself, see nexthop_active() */
+		if (prefix_match(p, gate))
+			return false;
+	}
+
+	m->nhe_id = re->nhe_id;
+	m->type = re->type;
+	m->family = rn->p.family;
+	m->flags = re->flags;
+	m->status = re->status & NHG_BATCH_STATUS_MASK;
+	m->mtu_set = (m->gate_count > 0);
+
+	return true;
+}
+
+static struct nhg_batch_memo *nhg_batch_memo_find(struct route_node *rn,
+						  struct route_entry *re)
+{
+	const struct prefix *p;
+	struct nhg_batch_memo *m;
+	unsigned int i;
+
+	for (i = 0; i < NHG_BATCH_MEMO_SIZE; i++) {
+		m = &nhg_batch.memo[i];
+
+		if (m->nhe_id != re->nhe_id || m->type != re->type
+		    || m->family != rn->p.family || m->flags != re->flags
+		    || m->status != (re->status & NHG_BATCH_STATUS_MASK))
+			continue;
+
+		srcdest_rnode_prefixes(rn, &p, NULL);
+		if (nhg_batch_gate_covered(p, m))
+			return NULL;
+
+		return m;
+	}
+
+	return NULL;
+}
+
+/* Replay a memoized nexthop_active_update() result onto re */
+static bool nhg_batch_memo_apply(struct route_entry *re,
+				 struct nhg_batch_memo *m)
+{
+	struct nhg_hash_entry *nhe;
+
+	UNSET_FLAG(re->status, ROUTE_ENTRY_CHANGED);
+
+	if (m->changed) {
+		nhe = zebra_nhg_lookup_id(m->new_nhe_id);
+		if (!nhe) {
+			m->nhe_id = 0;
+			return false;
+		}
+
+		SET_FLAG(re->status, ROUTE_ENTRY_CHANGED);
+		zebra_nhg_re_update_ref(re, nhe);
+	}
+
+	if (m->mtu_set)
+		re->nexthop_mtu = m->mtu;
+
+	if (m->curr_active) {
+		nhe = zebra_nhg_lookup_id(re->nhe_id);
+		if (nhe)
+			SET_FLAG(nhe->flags, NEXTHOP_GROUP_VALID);
+	}
+
+	return true;
+}
+
+static void nhg_batch_memo_store(const struct nhg_batch_memo *key,
+				 struct route_entry *re, uint8_t curr_active)
+{
+	struct nhg_batch_memo *m;
+
+	m = &nhg_batch.memo[nhg_batch.next];
+	nhg_batch.next = (nhg_batch.next + 1) % NHG_BATCH_MEMO_SIZE;
+
+	*m = *key;
+	m->changed = CHECK_FLAG(re->status, ROUTE_ENTRY_CHANGED);
+	m->new_nhe_id = re->nhe_id;
+	m->mtu = re->nexthop_mtu;
+	m->curr_active = curr_active;
+}
+
 /*
  * Iterate over all nexthops of the given RIB entry and refresh their
  * ACTIVE flag.  If any nexthop is found to toggle the ACTIVE flag,
@@ -1605,8 +2236,22 @@ int nexthop_active_update(struct route_node *rn, struct route_entry *re)
 	ifindex_t prev_index;
 	uint8_t curr_active = 0;
 
+	struct nhg_batch_memo key;
+	struct nhg_batch_memo *memo;
+	bool memoize = false;
+
 	afi_t rt_afi = family2afi(rn->p.family);
 
+	if (nhg_batch.active) {
+		memo = nhg_batch_memo_find(rn, re);
+		if (memo && nhg_batch_memo_apply(re, memo)) {
+			nhg_batch.hits++;
+			return memo->curr_active;
+		}
+
+		memoize = nhg_batch_memo_prepare(rn, re, &key);
+	}
+
 	UNSET_FLAG(re->status, ROUTE_ENTRY_CHANGED);
 
 	/* Copy over the nexthops in current state */
@@ -1680,6 +2325,12 @@ int nexthop_active_update(struct route_node *rn, struct route_entry *re)
 	 * used at all.
 	 */
 	nexthops_free(new_grp.nexthop);
+
+	if (memoize) {
+		nhg_batch.misses++;
+		nhg_batch_memo_store(&key, re, curr_active);
+	}
+
 	return curr_active;
 }
 
@@ -1896,6 +2547,14 @@ void zebra_nhg_dplane_result(struct zebra_dplane_ctx *ctx)
 	case DPLANE_OP_NEIGH_DELETE:
 	case DPLANE_OP_VTEP_ADD:
 	case DPLANE_OP_VTEP_DELETE:
+	case DPLANE_OP_RULE_ADD:
+	case DPLANE_OP_RULE_DELETE:
+	case DPLANE_OP_IPSET_ADD:
+	case DPLANE_OP_IPSET_DELETE:
+	case DPLANE_OP_IPSET_ENTRY_ADD:
+	case DPLANE_OP_IPSET_ENTRY_DELETE:
+	case DPLANE_OP_IPTABLE_ADD:
+	case DPLANE_OP_IPTABLE_DELETE:
 	case DPLANE_OP_NONE:
 		break;
 	}
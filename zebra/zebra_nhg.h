@@ -40,6 +40,7 @@ struct nh_grp {
 };
 
 PREDECL_RBTREE_UNIQ(nhg_connected_tree);
+PREDECL_DLIST(nhg_gc_list);
 
 /*
  * Hashtables contiaining entries found in `zebra_router`.
@@ -105,6 +106,16 @@ struct nhg_hash_entry {
  * from the kernel. Therefore, it is unhashable.
  */
 #define NEXTHOP_GROUP_UNHASHABLE (1 << 4)
+/*
+ * Nothing references this nexthop group any more. It stays installed
+ * on the garbage collection list, so that a route picking up the same
+ * nexthops soon can reuse it, until it expires.
+ */
+#define NEXTHOP_GROUP_GC (1 << 5)
+
+	/* Garbage collection list linkage, and when the group was put on it */
+	struct nhg_gc_list_item gc_item;
+	time_t gc_time;
 };
 
 /* Was this one we created, either this session or previously? */
@@ -223,6 +234,26 @@ extern void zebra_nhg_dplane_result(struct zebra_dplane_ctx *ctx);
 /* Sweet the nhg hash tables for old entries on restart */
 extern void zebra_nhg_sweep_table(struct hash *hash);
 
+/* ID allocation and garbage collection of unreferenced groups */
+extern void zebra_nhg_init(void);
+extern void zebra_nhg_terminate(void);
+extern void zebra_nhg_gc_flush(void);
+extern void zebra_nhg_gc_stats(uint32_t *queued, uint32_t *ids,
+			       uint64_t *reused, uint64_t *removed);
+
 /* Nexthop resolution processing */
 extern int nexthop_active_update(struct route_node *rn, struct route_entry *re);
+
+/* Cache of the route nodes that recursive nexthops resolve through */
+extern void zebra_nhg_resolve_dest_init(rib_dest_t *dest);
+extern void zebra_nhg_resolve_dest_fini(rib_dest_t *dest, bool unlock);
+extern void zebra_nhg_resolve_cache_invalidate(struct route_node *rn);
+extern void zebra_nhg_resolve_cache_stats(uint32_t *count, uint64_t *hits,
+					  uint64_t *misses);
+
+/* Memoize nexthop resolution across a batch of processed route nodes */
+extern void zebra_nhg_batch_begin(void);
+extern void zebra_nhg_batch_route_processed(struct route_node *rn);
+extern void zebra_nhg_batch_end(void);
+extern void zebra_nhg_batch_stats(uint64_t *hits, uint64_t *misses);
 #endif
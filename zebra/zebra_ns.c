@@ -138,6 +138,9 @@ static int zebra_ns_disable_internal(struct zebra_ns *zns, bool complete)
 
 	kernel_terminate(zns, complete);
 
+	if (complete)
+		dplane_kernel_workers_ns_close(zns->ns_id);
+
 	table_manager_disable(zns->ns_id);
 
 	zns->ns_id = NS_DEFAULT;
@@ -54,6 +54,10 @@ struct zebra_ns {
 	struct nlsock netlink_cmd;    /* command channel */
 	struct nlsock netlink_dplane; /* dataplane channel */
 	struct thread *t_netlink;
+
+	/* Resync after messages from the kernel were lost */
+	struct thread *t_netlink_resync;
+	uint32_t netlink_rcvbuf;
 #endif
 
 	struct route_table *if_table;
@@ -125,13 +125,15 @@ DEFINE_HOOK(zebra_pbr_ipset_update,
 /* Private functions */
 
 /* Public functions */
+
+/* Only used at shutdown, after the dataplane pthread has stopped */
 void zebra_pbr_rules_free(void *arg)
 {
 	struct zebra_pbr_rule *rule;
 
 	rule = (struct zebra_pbr_rule *)arg;
 
-	(void)kernel_del_pbr_rule(rule);
+	(void)dplane_pbr_rule_delete_sync(rule);
 	XFREE(MTYPE_TMP, rule);
 }
 
@@ -435,7 +437,7 @@ void zebra_pbr_add_rule(struct zebra_pbr_rule *rule)
 		pbr_rule_lookup_unique(rule);
 
 	(void)hash_get(zrouter.rules_hash, rule, pbr_rule_alloc_intern);
-	(void)kernel_add_pbr_rule(rule);
+	(void)dplane_pbr_rule_add(rule);
 	/*
 	 * Rule Replace semantics, if we have an old, install the
 	 * new rule, look above, and then delete the old
@@ -449,7 +451,7 @@ void zebra_pbr_del_rule(struct zebra_pbr_rule *rule)
 	struct zebra_pbr_rule *lookup;
 
 	lookup = hash_lookup(zrouter.rules_hash, rule);
-	(void)kernel_del_pbr_rule(rule);
+	(void)dplane_pbr_rule_delete(rule);
 
 	if (lookup) {
 		hash_release(zrouter.rules_hash, lookup);
@@ -465,7 +467,7 @@ static void zebra_pbr_cleanup_rules(struct hash_bucket *b, void *data)
 	int *sock = data;
 
 	if (rule->sock == *sock) {
-		(void)kernel_del_pbr_rule(rule);
+		(void)dplane_pbr_rule_delete(rule);
 		if (hash_release(zrouter.rules_hash, rule))
 			XFREE(MTYPE_TMP, rule);
 		else
@@ -481,7 +483,7 @@ static void zebra_pbr_cleanup_ipset(struct hash_bucket *b, void *data)
 	int *sock = data;
 
 	if (ipset->sock == *sock) {
-		hook_call(zebra_pbr_ipset_update, 0, ipset);
+		(void)dplane_pbr_ipset_delete(ipset);
 		hash_release(zrouter.ipset_hash, ipset);
 	}
 }
@@ -492,7 +494,7 @@ static void zebra_pbr_cleanup_ipset_entry(struct hash_bucket *b, void *data)
 	int *sock = data;
 
 	if (ipset->sock == *sock) {
-		hook_call(zebra_pbr_ipset_entry_update, 0, ipset);
+		(void)dplane_pbr_ipset_entry_delete(ipset);
 		hash_release(zrouter.ipset_entry_hash, ipset);
 	}
 }
@@ -503,7 +505,7 @@ static void zebra_pbr_cleanup_iptable(struct hash_bucket *b, void *data)
 	int *sock = data;
 
 	if (iptable->sock == *sock) {
-		hook_call(zebra_pbr_iptable_update, 0, iptable);
+		(void)dplane_pbr_iptable_delete(iptable);
 		hash_release(zrouter.iptable_hash, iptable);
 	}
 }
@@ -543,13 +545,8 @@ static void *pbr_ipset_alloc_intern(void *arg)
 
 void zebra_pbr_create_ipset(struct zebra_pbr_ipset *ipset)
 {
-	int ret;
-
 	(void)hash_get(zrouter.ipset_hash, ipset, pbr_ipset_alloc_intern);
-	ret = hook_call(zebra_pbr_ipset_update, 1, ipset);
-	kernel_pbr_ipset_add_del_status(ipset,
-					ret ? ZEBRA_DPLANE_INSTALL_SUCCESS
-					: ZEBRA_DPLANE_INSTALL_FAILURE);
+	(void)dplane_pbr_ipset_add(ipset);
 }
 
 void zebra_pbr_destroy_ipset(struct zebra_pbr_ipset *ipset)
@@ -557,7 +554,7 @@ void zebra_pbr_destroy_ipset(struct zebra_pbr_ipset *ipset)
 	struct zebra_pbr_ipset *lookup;
 
 	lookup = hash_lookup(zrouter.ipset_hash, ipset);
-	hook_call(zebra_pbr_ipset_update, 0, ipset);
+	(void)dplane_pbr_ipset_delete(ipset);
 	if (lookup) {
 		hash_release(zrouter.ipset_hash, lookup);
 		XFREE(MTYPE_TMP, lookup);
@@ -622,14 +619,9 @@ static void *pbr_ipset_entry_alloc_intern(void *arg)
 
 void zebra_pbr_add_ipset_entry(struct zebra_pbr_ipset_entry *ipset)
 {
-	int ret;
-
 	(void)hash_get(zrouter.ipset_entry_hash, ipset,
 		       pbr_ipset_entry_alloc_intern);
-	ret = hook_call(zebra_pbr_ipset_entry_update, 1, ipset);
-	kernel_pbr_ipset_entry_add_del_status(ipset,
-					ret ? ZEBRA_DPLANE_INSTALL_SUCCESS
-					: ZEBRA_DPLANE_INSTALL_FAILURE);
+	(void)dplane_pbr_ipset_entry_add(ipset);
 }
 
 void zebra_pbr_del_ipset_entry(struct zebra_pbr_ipset_entry *ipset)
@@ -637,7 +629,7 @@ void zebra_pbr_del_ipset_entry(struct zebra_pbr_ipset_entry *ipset)
 	struct zebra_pbr_ipset_entry *lookup;
 
 	lookup = hash_lookup(zrouter.ipset_entry_hash, ipset);
-	hook_call(zebra_pbr_ipset_entry_update, 0, ipset);
+	(void)dplane_pbr_ipset_entry_delete(ipset);
 	if (lookup) {
 		hash_release(zrouter.ipset_entry_hash, lookup);
 		XFREE(MTYPE_TMP, lookup);
@@ -662,13 +654,8 @@ static void *pbr_iptable_alloc_intern(void *arg)
 
 void zebra_pbr_add_iptable(struct zebra_pbr_iptable *iptable)
 {
-	int ret;
-
 	(void)hash_get(zrouter.iptable_hash, iptable, pbr_iptable_alloc_intern);
-	ret = hook_call(zebra_pbr_iptable_update, 1, iptable);
-	kernel_pbr_iptable_add_del_status(iptable,
-					  ret ? ZEBRA_DPLANE_INSTALL_SUCCESS
-					  : ZEBRA_DPLANE_INSTALL_FAILURE);
+	(void)dplane_pbr_iptable_add(iptable);
 }
 
 void zebra_pbr_del_iptable(struct zebra_pbr_iptable *iptable)
@@ -676,7 +663,7 @@ void zebra_pbr_del_iptable(struct zebra_pbr_iptable *iptable)
 	struct zebra_pbr_iptable *lookup;
 
 	lookup = hash_lookup(zrouter.iptable_hash, iptable);
-	hook_call(zebra_pbr_iptable_update, 0, iptable);
+	(void)dplane_pbr_iptable_delete(iptable);
 	if (lookup) {
 		struct listnode *node, *nnode;
 		char *name;
@@ -694,6 +681,88 @@ void zebra_pbr_del_iptable(struct zebra_pbr_iptable *iptable)
 			   __PRETTY_FUNCTION__);
 }
 
+/*
+ * Program the ipset, ipset entry or iptable of a dataplane context. This
+ * runs in the dataplane pthread, with the context's own copy of the object.
+ */
+enum zebra_dplane_result zebra_pbr_dplane_update(struct zebra_dplane_ctx *ctx)
+{
+	int ret = 0;
+
+	switch (dplane_ctx_get_op(ctx)) {
+	case DPLANE_OP_IPSET_ADD:
+	case DPLANE_OP_IPSET_DELETE:
+		ret = hook_call(zebra_pbr_ipset_update,
+				dplane_ctx_get_op(ctx) == DPLANE_OP_IPSET_ADD,
+				dplane_ctx_get_pbr_ipset(ctx));
+		break;
+	case DPLANE_OP_IPSET_ENTRY_ADD:
+	case DPLANE_OP_IPSET_ENTRY_DELETE:
+		ret = hook_call(zebra_pbr_ipset_entry_update,
+				dplane_ctx_get_op(ctx)
+					== DPLANE_OP_IPSET_ENTRY_ADD,
+				dplane_ctx_get_pbr_ipset_entry(ctx));
+		break;
+	case DPLANE_OP_IPTABLE_ADD:
+	case DPLANE_OP_IPTABLE_DELETE:
+		ret = hook_call(zebra_pbr_iptable_update,
+				dplane_ctx_get_op(ctx) == DPLANE_OP_IPTABLE_ADD,
+				dplane_ctx_get_pbr_iptable(ctx));
+		break;
+	default:
+		break;
+	}
+
+	return (ret ? ZEBRA_DPLANE_REQUEST_SUCCESS
+		    : ZEBRA_DPLANE_REQUEST_FAILURE);
+}
+
+/*
+ * Handle the result of a policy based routing update from the dataplane:
+ * let the owner know. Ipset and iptable removals are not acknowledged.
+ */
+void zebra_pbr_dplane_result(struct zebra_dplane_ctx *ctx)
+{
+	bool ok = (dplane_ctx_get_status(ctx) == ZEBRA_DPLANE_REQUEST_SUCCESS);
+
+	switch (dplane_ctx_get_op(ctx)) {
+	case DPLANE_OP_RULE_ADD:
+		kernel_pbr_rule_add_del_status(
+			dplane_ctx_get_pbr_rule(ctx),
+			ok ? ZEBRA_DPLANE_INSTALL_SUCCESS
+			   : ZEBRA_DPLANE_INSTALL_FAILURE);
+		break;
+	case DPLANE_OP_RULE_DELETE:
+		kernel_pbr_rule_add_del_status(
+			dplane_ctx_get_pbr_rule(ctx),
+			ok ? ZEBRA_DPLANE_DELETE_SUCCESS
+			   : ZEBRA_DPLANE_DELETE_FAILURE);
+		break;
+	case DPLANE_OP_IPSET_ADD:
+		kernel_pbr_ipset_add_del_status(
+			dplane_ctx_get_pbr_ipset(ctx),
+			ok ? ZEBRA_DPLANE_INSTALL_SUCCESS
+			   : ZEBRA_DPLANE_INSTALL_FAILURE);
+		break;
+	case DPLANE_OP_IPSET_ENTRY_ADD:
+		kernel_pbr_ipset_entry_add_del_status(
+			dplane_ctx_get_pbr_ipset_entry(ctx),
+			ok ? ZEBRA_DPLANE_INSTALL_SUCCESS
+			   : ZEBRA_DPLANE_INSTALL_FAILURE);
+		break;
+	case DPLANE_OP_IPTABLE_ADD:
+		kernel_pbr_iptable_add_del_status(
+			dplane_ctx_get_pbr_iptable(ctx),
+			ok ? ZEBRA_DPLANE_INSTALL_SUCCESS
+			   : ZEBRA_DPLANE_INSTALL_FAILURE);
+		break;
+	default:
+		break;
+	}
+
+	dplane_ctx_fini(&ctx);
+}
+
 /*
  * Handle success or failure of rule (un)install in the kernel.
  */
@@ -170,17 +170,32 @@ void zebra_pbr_add_iptable(struct zebra_pbr_iptable *iptable);
 void zebra_pbr_del_iptable(struct zebra_pbr_iptable *iptable);
 
 /*
- * Install specified rule for a specific interface.
+ * Install or uninstall the rule of a dataplane context, for a specific
+ * interface.
  * It is possible that the user-defined sequence number and the one in the
  * forwarding plane may not coincide, hence the API requires a separate
  * rule priority - maps to preference/FRA_PRIORITY on Linux.
  */
-extern enum zebra_dplane_result kernel_add_pbr_rule(struct zebra_pbr_rule *rule);
+extern enum zebra_dplane_result
+kernel_pbr_rule_update(struct zebra_dplane_ctx *ctx);
 
 /*
- * Uninstall specified rule for a specific interface.
+ * Install or uninstall the rules of a list of dataplane contexts, in
+ * batches. Returns the number of batches sent to the kernel.
  */
-extern enum zebra_dplane_result kernel_del_pbr_rule(struct zebra_pbr_rule *rule);
+extern int kernel_pbr_rule_update_multi(struct dplane_ctx_q *ctx_list);
+
+/*
+ * Program the ipset, ipset entry or iptable of a dataplane context,
+ * through the hooks registered for them. Runs in the dataplane pthread.
+ */
+extern enum zebra_dplane_result
+zebra_pbr_dplane_update(struct zebra_dplane_ctx *ctx);
+
+/*
+ * Handle the result of a policy based routing update from the dataplane.
+ */
+extern void zebra_pbr_dplane_result(struct zebra_dplane_ctx *ctx);
 
 /*
  * Get to know existing PBR rules in the kernel - typically called at startup.
@@ -50,6 +50,7 @@
 #include "zebra/zebra_errors.h"
 #include "zebra/zebra_memory.h"
 #include "zebra/zebra_ns.h"
+#include "zebra/zebra_pbr.h"
 #include "zebra/zebra_rnh.h"
 #include "zebra/zebra_routemap.h"
 #include "zebra/zebra_vrf.h"
@@ -193,6 +194,46 @@ int zebra_check_addr(const struct prefix *p)
 	return 1;
 }
 
+/*
+ * Route entries are allocated and freed at a high rate while protocols
+ * install or withdraw large tables, so freed entries are kept in a
+ * bounded cache and recycled. Only used from the zebra main pthread.
+ */
+#define RE_POOL_MAX 4096
+
+static struct {
+	struct route_entry *entries[RE_POOL_MAX];
+	unsigned int count;
+} re_pool;
+
+struct route_entry *route_entry_new(void)
+{
+	struct route_entry *re;
+
+	if (re_pool.count == 0)
+		return XCALLOC(MTYPE_RE, sizeof(struct route_entry));
+
+	re = re_pool.entries[--re_pool.count];
+	memset(re, 0, sizeof(*re));
+
+	return re;
+}
+
+void route_entry_free(struct route_entry *re)
+{
+	if (re_pool.count < RE_POOL_MAX)
+		re_pool.entries[re_pool.count++] = re;
+	else
+		XFREE(MTYPE_RE, re);
+}
+
+/* Release the cached route entries at shutdown */
+void route_entry_pool_fini(void)
+{
+	while (re_pool.count > 0)
+		XFREE(MTYPE_RE, re_pool.entries[--re_pool.count]);
+}
+
 /* Add nexthop to the end of a rib node's nexthop list */
 void route_entry_nexthop_add(struct route_entry *re, struct nexthop *nexthop)
 {
@@ -508,6 +549,126 @@ int zebra_rib_labeled_unicast(struct route_entry *re)
 	return 1;
 }
 
+/* Next nexthop of a route that the kernel is programmed with. */
+static struct nexthop *rib_fib_nexthop_next(struct nexthop *nexthop)
+{
+	for (; nexthop; nexthop = nexthop_next(nexthop))
+		if (CHECK_FLAG(nexthop->flags, NEXTHOP_FLAG_ACTIVE)
+		    && !CHECK_FLAG(nexthop->flags, NEXTHOP_FLAG_RECURSIVE))
+			return nexthop;
+
+	return NULL;
+}
+
+/*
+ * Compare a nexthop about to be programmed with one read back from the
+ * kernel. The kernel does not keep the nexthop type zebra resolved, only
+ * what it forwards with.
+ */
+static bool rib_fib_nexthop_same(const struct nexthop *nexthop,
+				 const struct nexthop *fib)
+{
+	const union g_addr *src;
+
+	if (nexthop->ifindex != fib->ifindex)
+		return false;
+
+	switch (nexthop->type) {
+	case NEXTHOP_TYPE_IPV4:
+	case NEXTHOP_TYPE_IPV4_IFINDEX:
+		if (fib->type != NEXTHOP_TYPE_IPV4
+		    && fib->type != NEXTHOP_TYPE_IPV4_IFINDEX)
+			return false;
+		if (!IPV4_ADDR_SAME(&nexthop->gate.ipv4, &fib->gate.ipv4))
+			return false;
+		break;
+	case NEXTHOP_TYPE_IPV6:
+	case NEXTHOP_TYPE_IPV6_IFINDEX:
+		if (fib->type != NEXTHOP_TYPE_IPV6
+		    && fib->type != NEXTHOP_TYPE_IPV6_IFINDEX)
+			return false;
+		if (!IPV6_ADDR_SAME(&nexthop->gate.ipv6, &fib->gate.ipv6))
+			return false;
+		break;
+	case NEXTHOP_TYPE_IFINDEX:
+		if (fib->type != NEXTHOP_TYPE_IFINDEX)
+			return false;
+		break;
+	case NEXTHOP_TYPE_BLACKHOLE:
+		if (fib->type != NEXTHOP_TYPE_BLACKHOLE
+		    || nexthop->bh_type != fib->bh_type)
+			return false;
+		break;
+	}
+
+	/* The route-map source wins over the resolved one, as it does when
+	 * the route is programmed.
+	 */
+	if (memcmp(&nexthop->rmap_src, &in6addr_any, sizeof(nexthop->rmap_src)))
+		src = &nexthop->rmap_src;
+	else
+		src = &nexthop->src;
+	if (memcmp(src, &fib->src, sizeof(*src)))
+		return false;
+
+	return nexthop_labels_match(nexthop, fib);
+}
+
+/*
+ * A route zebra installed before it restarted is still in the kernel, and
+ * is read back at startup flagged stale. It is taken over as it is, and
+ * so is the route its daemon re-sends to replace it, as long as the kernel
+ * would be programmed with the very same thing.
+ */
+static bool rib_install_retained(struct route_entry *re,
+				 struct route_entry *old)
+{
+	struct nhg_hash_entry *nhe, *old_nhe;
+	struct nexthop *nexthop, *fib;
+	uint32_t mtu;
+
+	if (!old || old == re)
+		return (CHECK_FLAG(re->status, ROUTE_ENTRY_STALE)
+			&& CHECK_FLAG(re->flags, ZEBRA_FLAG_SELFROUTE));
+
+	if (!CHECK_FLAG(old->status, ROUTE_ENTRY_STALE)
+	    || !CHECK_FLAG(old->flags, ZEBRA_FLAG_SELFROUTE)
+	    || old->type != re->type)
+		return false;
+
+	mtu = re->mtu;
+	if (!mtu || (re->nexthop_mtu && re->nexthop_mtu < mtu))
+		mtu = re->nexthop_mtu;
+	if (mtu != old->mtu)
+		return false;
+
+	/* A route using a kernel nexthop object has to use the same one */
+	if (old->nhe_id != re->nhe_id) {
+		nhe = zebra_nhg_lookup_id(re->nhe_id);
+		old_nhe = zebra_nhg_lookup_id(old->nhe_id);
+
+		if ((nhe && CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_INSTALLED
+						     | NEXTHOP_GROUP_QUEUED))
+		    || (old_nhe
+			&& CHECK_FLAG(old_nhe->flags,
+				      NEXTHOP_GROUP_INSTALLED
+					      | NEXTHOP_GROUP_QUEUED)))
+			return false;
+	}
+
+	nexthop = rib_fib_nexthop_next(re->ng->nexthop);
+	fib = rib_fib_nexthop_next(old->ng->nexthop);
+	while (nexthop && fib) {
+		if (!rib_fib_nexthop_same(nexthop, fib))
+			return false;
+
+		nexthop = rib_fib_nexthop_next(nexthop_next(nexthop));
+		fib = rib_fib_nexthop_next(nexthop_next(fib));
+	}
+
+	return (!nexthop && !fib);
+}
+
 /* Update flag indicates whether this is a "replace" or not. Currently, this
  * is only used for IPv4.
  */
@@ -553,7 +714,9 @@ void rib_install_kernel(struct route_node *rn, struct route_entry *re,
 	hook_call(rib_update, rn, "installing in kernel");
 
 	/* Send add or update */
-	if (old)
+	if (rib_install_retained(re, old))
+		ret = dplane_route_retain(rn, re, old);
+	else if (old)
 		ret = dplane_route_update(rn, re, old);
 	else
 		ret = dplane_route_add(rn, re);
@@ -717,86 +880,139 @@ static int rib_can_delete_dest(rib_dest_t *dest)
 	return 1;
 }
 
-void zebra_rib_evaluate_rn_nexthops(struct route_node *rn, uint32_t seq)
+/*
+ * Evaluate the nexthops tracked on dest, the one of rn or of a node above it.
+ * With 'covered' set only those within that prefix are evaluated: a change
+ * to a more specific node can only alter the resolution of those.
+ */
+static void zebra_rib_evaluate_dest_nexthops(struct route_node *rn,
+					     rib_dest_t *dest,
+					     const struct prefix *covered,
+					     uint32_t seq)
 {
-	rib_dest_t *dest = rib_dest_from_rnode(rn);
 	struct rnh *rnh;
 
+	if (IS_ZEBRA_DEBUG_NHT_DETAILED) {
+		char buf[PREFIX_STRLEN];
+
+		zlog_debug("%s: %s Being examined for Nexthop Tracking Count: %zd",
+			   __PRETTY_FUNCTION__,
+			   srcdest_rnode2str(rn, buf, sizeof(buf)),
+			   rnh_list_count(&dest->nht));
+	}
+
 	/*
-	 * We are storing the rnh's associated withb
-	 * the tracked nexthop as a list of the rn's.
-	 * Unresolved rnh's are placed at the top
-	 * of the tree list.( 0.0.0.0/0 for v4 and 0::0/0 for v6 )
-	 * As such for each rn we need to walk up the tree
-	 * and see if any rnh's need to see if they
-	 * would match a more specific route
+	 * If we have any rnh's stored in the nht list
+	 * then we know that this route node was used for
+	 * nht resolution and as such we need to call the
+	 * nexthop tracking evaluation code
 	 */
-	while (rn) {
-		if (IS_ZEBRA_DEBUG_NHT_DETAILED) {
-			char buf[PREFIX_STRLEN];
+	frr_each_safe(rnh_list, &dest->nht, rnh) {
+		struct zebra_vrf *zvrf =
+			zebra_vrf_lookup_by_id(rnh->vrf_id);
+		struct prefix *p = &rnh->node->p;
 
-			zlog_debug("%s: %s Being examined for Nexthop Tracking Count: %zd",
-				   __PRETTY_FUNCTION__,
-				   srcdest_rnode2str(rn, buf, sizeof(buf)),
-				   dest ? rnh_list_count(&dest->nht) : 0);
-		}
-		if (!dest) {
-			rn = rn->parent;
-			if (rn)
-				dest = rib_dest_from_rnode(rn);
+		if (covered && !prefix_match(covered, p))
 			continue;
-		}
+
 		/*
-		 * If we have any rnh's stored in the nht list
-		 * then we know that this route node was used for
-		 * nht resolution and as such we need to call the
-		 * nexthop tracking evaluation code
+		 * Unresolved nexthops are kept on the default route, they
+		 * only depend on it if they may resolve over it.
 		 */
-		frr_each_safe(rnh_list, &dest->nht, rnh) {
-			struct zebra_vrf *zvrf =
-				zebra_vrf_lookup_by_id(rnh->vrf_id);
-			struct prefix *p = &rnh->node->p;
-
-			if (IS_ZEBRA_DEBUG_NHT_DETAILED) {
-				char buf1[PREFIX_STRLEN];
-				char buf2[PREFIX_STRLEN];
-
-				zlog_debug("%u:%s has Nexthop(%s) Type: %s depending on it, evaluating %u:%u",
-					   zvrf->vrf->vrf_id,
-					   srcdest_rnode2str(rn, buf1,
-						      sizeof(buf1)),
-					   prefix2str(p, buf2, sizeof(buf2)),
-					   rnh_type2str(rnh->type),
-					   seq, rnh->seqno);
-			}
+		if (!covered && rnh->type == RNH_NEXTHOP_TYPE && !rnh->state
+		    && is_default_prefix(&rn->p)
+		    && !rnh_resolve_via_default(zvrf, p->family))
+			continue;
 
-			/*
-			 * If we have evaluated this node on this pass
-			 * already, due to following the tree up
-			 * then we know that we can move onto the next
-			 * rnh to process.
-			 *
-			 * Additionally we call zebra_evaluate_rnh
-			 * when we gc the dest.  In this case we know
-			 * that there must be no other re's where
-			 * we were originally as such we know that
-			 * that sequence number is ok to respect.
-			 */
-			if (rnh->seqno == seq) {
-				if (IS_ZEBRA_DEBUG_NHT_DETAILED)
-					zlog_debug(
-						"\tNode processed and moved already");
-				continue;
-			}
+		if (IS_ZEBRA_DEBUG_NHT_DETAILED) {
+			char buf1[PREFIX_STRLEN];
+			char buf2[PREFIX_STRLEN];
+
+			zlog_debug("%u:%s has Nexthop(%s) Type: %s depending on it, evaluating %u:%u",
+				   zvrf->vrf->vrf_id,
+				   srcdest_rnode2str(rn, buf1,
+					      sizeof(buf1)),
+				   prefix2str(p, buf2, sizeof(buf2)),
+				   rnh_type2str(rnh->type),
+				   seq, rnh->seqno);
+		}
 
-			rnh->seqno = seq;
-			zebra_evaluate_rnh(zvrf, family2afi(p->family), 0,
-					   rnh->type, p);
+		/*
+		 * If we have evaluated this node on this pass
+		 * already, due to following the tree up
+		 * then we know that we can move onto the next
+		 * rnh to process.
+		 *
+		 * Additionally we call zebra_evaluate_rnh
+		 * when we gc the dest.  In this case we know
+		 * that there must be no other re's where
+		 * we were originally as such we know that
+		 * that sequence number is ok to respect.
+		 */
+		if (rnh->seqno == seq) {
+			if (IS_ZEBRA_DEBUG_NHT_DETAILED)
+				zlog_debug(
+					"\tNode processed and moved already");
+			continue;
 		}
 
-		rn = rn->parent;
-		if (rn)
-			dest = rib_dest_from_rnode(rn);
+		rnh->seqno = seq;
+		zebra_evaluate_rnh(zvrf, family2afi(p->family), 0,
+				   rnh->type, p);
+	}
+}
+
+void zebra_rib_evaluate_rn_nexthops(struct route_node *rn, uint32_t seq)
+{
+	rib_dest_t *dest = rib_dest_from_rnode(rn);
+	rib_table_info_t *info = rib_table_info(srcdest_rnode_table(rn));
+	struct route_node *prn;
+	size_t covering = 0;
+
+	/*
+	 * Cached nexthop resolutions depend on the same nodes as the
+	 * rnh's below, drop those that rn may now resolve.
+	 */
+	zebra_nhg_resolve_cache_invalidate(rn);
+
+	/*
+	 * We are storing the rnh's associated withb
+	 * the tracked nexthop as a list of the rn's.
+	 * Unresolved rnh's are placed at the top
+	 * of the tree list.( 0.0.0.0/0 for v4 and 0::0/0 for v6 )
+	 *
+	 * The rnh's resolving over rn are evaluated first. Of those
+	 * resolving over a node above rn, only the ones within rn's
+	 * prefix may now match rn instead.
+	 */
+	if (dest)
+		zebra_rib_evaluate_dest_nexthops(rn, dest, NULL, seq);
+
+	for (prn = rn->parent; prn; prn = prn->parent) {
+		dest = rib_dest_from_rnode(prn);
+		if (dest)
+			covering += rnh_list_count(&dest->nht);
+	}
+	if (!covering)
+		return;
+
+	/*
+	 * Looking those up in the nexthop tracking tables is
+	 * less work when a lot of rnh's resolve over the nodes
+	 * above, typically the default route, unless rn covers
+	 * about as many. Only the unicast tables of a vrf are
+	 * used for resolution.
+	 */
+	if (info->zvrf && info->safi == SAFI_UNICAST
+	    && rn->table == info->zvrf->table[info->afi][SAFI_UNICAST]
+	    && zebra_rnh_evaluate_covered(info->zvrf, rn, seq, covering))
+		return;
+
+	for (prn = rn->parent; prn; prn = prn->parent) {
+		dest = rib_dest_from_rnode(prn);
+		if (dest)
+			zebra_rib_evaluate_dest_nexthops(prn, dest, &rn->p,
+							 seq);
 	}
 }
 
@@ -830,6 +1046,7 @@ int rib_gc_dest(struct route_node *rn)
 
 	dest->rnode = NULL;
 	rnh_list_fini(&dest->nht);
+	zebra_nhg_resolve_dest_fini(dest, true);
 	XFREE(MTYPE_RIB_DEST, dest);
 	rn->info = NULL;
 
@@ -2025,18 +2242,17 @@ static void process_subq_nhg(struct listnode *lnode)
 	rib_nhg_process(ctx);
 }
 
-static void process_subq_route(struct listnode *lnode, uint8_t qindex)
+static void process_subq_route(struct route_node *rnode, uint8_t qindex)
 {
-	struct route_node *rnode = NULL;
 	rib_dest_t *dest = NULL;
 	struct zebra_vrf *zvrf = NULL;
 
-	rnode = listgetdata(lnode);
 	dest = rib_dest_from_rnode(rnode);
 	if (dest)
 		zvrf = rib_dest_vrf(dest);
 
 	rib_process(rnode);
+	zebra_nhg_batch_route_processed(rnode);
 
 	if (IS_ZEBRA_DEBUG_RIB_DETAILED) {
 		char buf[SRCDEST2STR_BUFFER];
@@ -2075,22 +2291,89 @@ static unsigned int process_subq(struct list *subq, uint8_t qindex)
 	if (qindex == route_info[ZEBRA_ROUTE_NHG].meta_q_map)
 		process_subq_nhg(lnode);
 	else
-		process_subq_route(lnode, qindex);
+		process_subq_route(listgetdata(lnode), qindex);
 
 	list_delete_node(subq, lnode);
 
 	return 1;
 }
 
+/* Order route nodes by table, then by prefix, so that a batch walks each
+ * table roughly in tree order.
+ */
+static int process_subq_batch_cmp(const void *a, const void *b)
+{
+	const struct route_node *rn1 = *(const struct route_node *const *)a;
+	const struct route_node *rn2 = *(const struct route_node *const *)b;
+	int ret;
+
+	if (rn1->table != rn2->table)
+		return (uintptr_t)rn1->table < (uintptr_t)rn2->table ? -1 : 1;
+
+	if (rn1->p.family != rn2->p.family)
+		return numcmp(rn1->p.family, rn2->p.family);
+
+	ret = memcmp(&rn1->p.u.val, &rn2->p.u.val, prefix_blen(&rn1->p));
+	if (ret)
+		return ret;
+
+	return numcmp(rn1->p.prefixlen, rn2->p.prefixlen);
+}
+
+/* Take up to mq->batch route nodes off a route sub-queue, sort them and
+ * process them in one go, sharing nexthop resolution between routes using
+ * the same nexthop group. The batch stops early once the dataplane queue
+ * is over its limit, and the nodes not processed go back to the head of
+ * the sub-queue. Returns the number of nodes processed.
+ */
+static unsigned int process_subq_batch(struct meta_queue *mq, uint8_t qindex)
+{
+	struct list *subq = mq->subq[qindex];
+	struct listnode *lnode;
+	unsigned int count = 0, i, j;
+	uint32_t queue_limit = dplane_get_in_queue_limit();
+
+	while (count < mq->batch && (lnode = listhead(subq))) {
+		mq->batch_nodes[count++] = listgetdata(lnode);
+		list_delete_node(subq, lnode);
+	}
+
+	if (!count)
+		return 0;
+
+	if (count > 1)
+		qsort(mq->batch_nodes, count, sizeof(*mq->batch_nodes),
+		      process_subq_batch_cmp);
+
+	zebra_nhg_batch_begin();
+	for (i = 0; i < count; i++) {
+		if (i && dplane_get_in_queue_len() > queue_limit)
+			break;
+
+		process_subq_route(mq->batch_nodes[i], qindex);
+	}
+	zebra_nhg_batch_end();
+
+	for (j = count; j > i; j--)
+		listnode_add_head(subq, mq->batch_nodes[j - 1]);
+
+	return i;
+}
+
 /* Dispatch the meta queue by picking, processing and unlocking the next RN from
  * a non-empty sub-queue with lowest priority. wq is equal to zebra->ribq and
  * data
  * is pointed to the meta queue structure.
+ *
+ * With batching configured, a whole batch of route nodes is taken from that
+ * sub-queue instead of a single one.
  */
 static wq_item_status meta_queue_process(struct work_queue *dummy, void *data)
 {
 	struct meta_queue *mq = data;
-	unsigned i;
+	struct meta_queue_stats *stats;
+	struct timeval start;
+	unsigned i, processed;
 	uint32_t queue_len, queue_limit;
 
 	/* Ensure there's room for more dataplane updates */
@@ -2108,11 +2391,26 @@ static wq_item_status meta_queue_process(struct work_queue *dummy, void *data)
 		return WQ_QUEUE_BLOCKED;
 	}
 
-	for (i = 0; i < MQ_SIZE; i++)
-		if (process_subq(mq->subq[i], i)) {
-			mq->size--;
+	monotime(&start);
+
+	for (i = 0; i < MQ_SIZE; i++) {
+		if (mq->batch && i != route_info[ZEBRA_ROUTE_NHG].meta_q_map)
+			processed = process_subq_batch(mq, i);
+		else
+			processed = process_subq(mq->subq[i], i);
+
+		if (processed) {
+			mq->size -= processed;
+
+			stats = &mq->stats[i];
+			stats->processed += processed;
+			stats->runs++;
+			stats->usecs += monotime_since(&start, NULL);
+			if (processed > stats->max_batch)
+				stats->max_batch = processed;
 			break;
 		}
+	}
 	return mq->size ? WQ_REQUEUE : WQ_SUCCESS;
 }
 
@@ -2270,9 +2568,27 @@ void meta_queue_free(struct meta_queue *mq)
 	for (i = 0; i < MQ_SIZE; i++)
 		list_delete(&mq->subq[i]);
 
+	XFREE(MTYPE_WORK_QUEUE, mq->batch_nodes);
 	XFREE(MTYPE_WORK_QUEUE, mq);
 }
 
+/* Set the number of route nodes drained per meta queue run, 0 disables
+ * batching.
+ */
+void rib_meta_queue_batch_set(uint32_t batch)
+{
+	struct meta_queue *mq = zrouter.mq;
+
+	if (mq->batch == batch)
+		return;
+
+	XFREE(MTYPE_WORK_QUEUE, mq->batch_nodes);
+	mq->batch = batch;
+	if (batch)
+		mq->batch_nodes = XCALLOC(MTYPE_WORK_QUEUE,
+					  batch * sizeof(*mq->batch_nodes));
+}
+
 /* initialise zebra rib work queue */
 static void rib_queue_init(void)
 {
@@ -2306,10 +2622,14 @@ rib_dest_t *zebra_rib_create_dest(struct route_node *rn)
 
 	dest = XCALLOC(MTYPE_RIB_DEST, sizeof(rib_dest_t));
 	rnh_list_init(&dest->nht);
+	zebra_nhg_resolve_dest_init(dest);
 	route_lock_node(rn); /* rn route table reference */
 	rn->info = dest;
 	dest->rnode = rn;
 
+	/* rn is now the longest match for some cached nexthops */
+	zebra_nhg_resolve_cache_invalidate(rn);
+
 	return dest;
 }
 
@@ -2434,7 +2754,7 @@ void rib_unlink(struct route_node *rn, struct route_entry *re)
 
 	nexthops_free(re->fib_ng.nexthop);
 
-	XFREE(MTYPE_RE, re);
+	route_entry_free(re);
 }
 
 void rib_delnode(struct route_node *rn, struct route_entry *re)
@@ -2611,12 +2931,10 @@ void rib_lookup_and_pushup(struct prefix_ipv4 *p, vrf_id_t vrf_id)
 	struct route_node *rn;
 	rib_dest_t *dest;
 
-	if (NULL == (table = zebra_vrf_table(AFI_IP, SAFI_UNICAST, vrf_id))) {
-		flog_err(EC_ZEBRA_TABLE_LOOKUP_FAILED,
-			 "%s:%u zebra_vrf_table() returned NULL", __func__,
-			 vrf_id);
+	/* The table is created with its first route */
+	table = zebra_vrf_table(AFI_IP, SAFI_UNICAST, vrf_id);
+	if (!table)
 		return;
-	}
 
 	/* No matches would be the simplest case. */
 	if (NULL == (rn = route_node_lookup(table, (struct prefix *)p)))
@@ -2648,8 +2966,28 @@ void rib_lookup_and_pushup(struct prefix_ipv4 *p, vrf_id_t vrf_id)
 	}
 }
 
-int rib_add_multipath(afi_t afi, safi_t safi, struct prefix *p,
-		      struct prefix_ipv6 *src_p, struct route_entry *re)
+/*
+ * Add a route whose nexthops are given by 'ng', which remains owned by the
+ * caller: its nexthops are copied into a nexthop hash entry if needed, so
+ * callers may build it from nexthops that are not heap-allocated.
+ */
+/*
+ * Is 're', read back from the kernel by a resync, the kernel route
+ * 'same' zebra already has?
+ */
+static bool rib_kernel_route_unchanged(const struct route_entry *same,
+				       const struct route_entry *re)
+{
+	return same->type == ZEBRA_ROUTE_KERNEL
+	       && CHECK_FLAG(same->status, ROUTE_ENTRY_STALE)
+	       && same->nhe_id == re->nhe_id && same->flags == re->flags
+	       && same->distance == re->distance && same->metric == re->metric
+	       && same->mtu == re->mtu && same->tag == re->tag;
+}
+
+int rib_add_multipath_nhg(afi_t afi, safi_t safi, struct prefix *p,
+			  struct prefix_ipv6 *src_p, struct route_entry *re,
+			  struct nexthop_group *ng)
 {
 	struct nhg_hash_entry *nhe = NULL;
 	struct route_table *table;
@@ -2661,14 +2999,13 @@ int rib_add_multipath(afi_t afi, safi_t safi, struct prefix *p,
 		return 0;
 
 	assert(!src_p || !src_p->prefixlen || afi == AFI_IP6);
+	assert(re->ng == NULL);
 
 	/* Lookup table.  */
 	table = zebra_vrf_get_table_with_table_id(afi, safi, re->vrf_id,
 						  re->table);
 	if (!table) {
-		if (re->ng)
-			nexthop_group_delete(&re->ng);
-		XFREE(MTYPE_RE, re);
+		route_entry_free(re);
 		return 0;
 	}
 
@@ -2680,17 +3017,12 @@ int rib_add_multipath(afi_t afi, safi_t safi, struct prefix *p,
 				EC_ZEBRA_TABLE_LOOKUP_FAILED,
 				"Zebra failed to find the nexthop hash entry for id=%u in a route entry",
 				re->nhe_id);
-			XFREE(MTYPE_RE, re);
+			route_entry_free(re);
 			return -1;
 		}
 	} else {
-		nhe = zebra_nhg_rib_find(0, re->ng, afi);
-
-		/*
-		 * The nexthops got copied over into an nhe,
-		 * so free them now.
-		 */
-		nexthop_group_delete(&re->ng);
+		if (ng && ng->nexthop)
+			nhe = zebra_nhg_rib_find(0, ng, afi);
 
 		if (!nhe) {
 			char buf[PREFIX_STRLEN] = "";
@@ -2704,7 +3036,7 @@ int rib_add_multipath(afi_t afi, safi_t safi, struct prefix *p,
 				src_p ? prefix2str(src_p, buf2, sizeof(buf2))
 				      : "");
 
-			XFREE(MTYPE_RE, re);
+			route_entry_free(re);
 			return -1;
 		}
 	}
@@ -2742,7 +3074,11 @@ int rib_add_multipath(afi_t afi, safi_t safi, struct prefix *p,
 
 		if (same->type != re->type)
 			continue;
-		if (same->instance != re->instance)
+		/* A route retained from the previous run does not know
+		 * the instance that installed it.
+		 */
+		if (same->instance != re->instance
+		    && !CHECK_FLAG(same->status, ROUTE_ENTRY_STALE))
 			continue;
 		if (same->type == ZEBRA_ROUTE_KERNEL
 		    && same->metric != re->metric)
@@ -2761,6 +3097,17 @@ int rib_add_multipath(afi_t afi, safi_t safi, struct prefix *p,
 			break;
 	}
 
+	/* Nothing changed for a kernel route read back by a resync, it is
+	 * only confirmed.
+	 */
+	if (same && rib_kernel_route_unchanged(same, re)) {
+		UNSET_FLAG(same->status, ROUTE_ENTRY_STALE);
+		zebra_nhg_decrement_ref(nhe);
+		route_entry_free(re);
+		route_unlock_node(rn);
+		return 0;
+	}
+
 	/* If this route is kernel/connected route, notify the dataplane. */
 	if (RIB_SYSTEM_ROUTE(re)) {
 		/* Notify dataplane */
@@ -2777,6 +3124,13 @@ int rib_add_multipath(afi_t afi, safi_t safi, struct prefix *p,
 			route_entry_dump(p, src_p, re);
 	}
 
+	/* Our own routes read back at startup were left by the previous
+	 * run. They stay in the kernel until their daemon re-sends them, or
+	 * until they are swept.
+	 */
+	if (CHECK_FLAG(re->flags, ZEBRA_FLAG_SELFROUTE))
+		SET_FLAG(re->status, ROUTE_ENTRY_STALE);
+
 	SET_FLAG(re->status, ROUTE_ENTRY_CHANGED);
 	rib_addnode(rn, re, 1);
 	ret = 1;
@@ -2791,6 +3145,30 @@ int rib_add_multipath(afi_t afi, safi_t safi, struct prefix *p,
 	return ret;
 }
 
+int rib_add_multipath(afi_t afi, safi_t safi, struct prefix *p,
+		      struct prefix_ipv6 *src_p, struct route_entry *re)
+{
+	struct nexthop_group *ng;
+	int ret;
+
+	if (!re)
+		return 0;
+
+	/*
+	 * The nexthops get copied over into an nhe,
+	 * so free them once the route is added.
+	 */
+	ng = re->ng;
+	re->ng = NULL;
+
+	ret = rib_add_multipath_nhg(afi, safi, p, src_p, re, ng);
+
+	if (ng)
+		nexthop_group_delete(&ng);
+
+	return ret;
+}
+
 void rib_delete(afi_t afi, safi_t safi, vrf_id_t vrf_id, int type,
 		unsigned short instance, int flags, struct prefix *p,
 		struct prefix_ipv6 *src_p, const struct nexthop *nh,
@@ -2962,6 +3340,8 @@ void rib_delete(afi_t afi, safi_t safi, vrf_id_t vrf_id, int type,
 	if (same) {
 		if (fromkernel && CHECK_FLAG(flags, ZEBRA_FLAG_SELFROUTE)
 		    && !allow_delete) {
+			/* Not in the kernel any more, retained or not */
+			UNSET_FLAG(same->status, ROUTE_ENTRY_STALE);
 			rib_install_kernel(rn, same, NULL);
 			route_unlock_node(rn);
 
@@ -3014,10 +3394,11 @@ int rib_add(afi_t afi, safi_t safi, vrf_id_t vrf_id, int type,
 	    uint8_t distance, route_tag_t tag)
 {
 	struct route_entry *re = NULL;
-	struct nexthop *nexthop = NULL;
+	struct nexthop_group ng = {};
+	struct nexthop nexthop;
 
 	/* Allocate new route_entry structure. */
-	re = XCALLOC(MTYPE_RE, sizeof(struct route_entry));
+	re = route_entry_new();
 	re->type = type;
 	re->instance = instance;
 	re->distance = distance;
@@ -3031,15 +3412,14 @@ int rib_add(afi_t afi, safi_t safi, vrf_id_t vrf_id, int type,
 	re->nhe_id = nhe_id;
 
 	if (!nhe_id) {
-		re->ng = nexthop_group_new();
-
-		/* Add nexthop. */
-		nexthop = nexthop_new();
-		*nexthop = *nh;
-		route_entry_nexthop_add(re, nexthop);
+		/* Add nexthop; it is copied into an nhe if needed. */
+		nexthop = *nh;
+		nexthop.next = NULL;
+		nexthop.prev = NULL;
+		ng.nexthop = &nexthop;
 	}
 
-	return rib_add_multipath(afi, safi, p, src_p, re);
+	return rib_add_multipath_nhg(afi, safi, p, src_p, re, &ng);
 }
 
 static const char *rib_update_event2str(rib_update_event_t event)
@@ -3247,13 +3627,43 @@ void rib_update(rib_update_event_t event)
 			   rib_update_event2str(event));
 }
 
+/* Remove a route read back from the kernel at startup. */
+static void rib_sweep_stale_route(struct route_node *rn,
+				  struct route_entry *re)
+{
+	struct nexthop *nexthop;
+
+	/*
+	 * So we are starting up and have received
+	 * routes from the kernel that we have installed
+	 * from a previous run of zebra but not cleaned
+	 * up ( say a kill -9 )
+	 * Unless they were selected, and so taken over
+	 * as they are, we don't think they are active.
+	 * So let's pretend they are active to actually
+	 * remove them.
+	 * In all honesty I'm not sure if we should
+	 * mark them as active when we receive them
+	 * This is startup only so probably ok.
+	 *
+	 * If we ever decide to move rib_sweep_table
+	 * to a different spot (ie startup )
+	 * this decision needs to be revisited
+	 */
+	SET_FLAG(re->status, ROUTE_ENTRY_INSTALLED);
+	for (ALL_NEXTHOPS_PTR(re->ng, nexthop))
+		SET_FLAG(nexthop->flags, NEXTHOP_FLAG_FIB);
+
+	rib_uninstall_kernel(rn, re);
+	rib_delnode(rn, re);
+}
+
 /* Delete self installed routes after zebra is relaunched.  */
 void rib_sweep_table(struct route_table *table)
 {
 	struct route_node *rn;
 	struct route_entry *re;
 	struct route_entry *next;
-	struct nexthop *nexthop;
 
 	if (!table)
 		return;
@@ -3278,32 +3688,68 @@ void rib_sweep_table(struct route_table *table)
 			if (zrouter.startup_time < re->uptime)
 				continue;
 
-			/*
-			 * So we are starting up and have received
-			 * routes from the kernel that we have installed
-			 * from a previous run of zebra but not cleaned
-			 * up ( say a kill -9 )
-			 * But since we haven't actually installed
-			 * them yet( we received them from the kernel )
-			 * we don't think they are active.
-			 * So let's pretend they are active to actually
-			 * remove them.
-			 * In all honesty I'm not sure if we should
-			 * mark them as active when we receive them
-			 * This is startup only so probably ok.
-			 *
-			 * If we ever decide to move rib_sweep_table
-			 * to a different spot (ie startup )
-			 * this decision needs to be revisited
-			 */
-			SET_FLAG(re->status, ROUTE_ENTRY_INSTALLED);
-			for (ALL_NEXTHOPS_PTR(re->ng, nexthop))
-				SET_FLAG(nexthop->flags, NEXTHOP_FLAG_FIB);
+			rib_sweep_stale_route(rn, re);
+		}
+	}
+}
+
+/* Remove the stale routes of a protocol from one table */
+static unsigned long rib_sweep_stale_proto_table(struct route_table *table,
+						 uint8_t proto)
+{
+	struct route_node *rn;
+	struct route_entry *re, *next;
+	unsigned long n = 0;
+
+	if (!table)
+		return 0;
+
+	for (rn = route_top(table); rn; rn = srcdest_route_next(rn)) {
+		RNODE_FOREACH_RE_SAFE (rn, re, next) {
+			if (re->type != proto
+			    || !CHECK_FLAG(re->status, ROUTE_ENTRY_STALE)
+			    || !CHECK_FLAG(re->flags, ZEBRA_FLAG_SELFROUTE)
+			    || CHECK_FLAG(re->status, ROUTE_ENTRY_REMOVED))
+				continue;
 
-			rib_uninstall_kernel(rn, re);
-			rib_delnode(rn, re);
+			rib_sweep_stale_route(rn, re);
+			n++;
 		}
 	}
+
+	return n;
+}
+
+/*
+ * Remove the routes of a protocol left in the kernel by the previous run,
+ * which its daemon has not re-sent since it reconnected. The tables are
+ * walked as rib_sweep_route() walks them.
+ */
+unsigned long rib_sweep_stale_proto(uint8_t proto)
+{
+	struct zebra_router_table *zrt;
+	struct vrf *vrf;
+	struct zebra_vrf *zvrf;
+	unsigned long n = 0;
+
+	RB_FOREACH (vrf, vrf_id_head, &vrfs_by_id) {
+		if ((zvrf = vrf->info) == NULL)
+			continue;
+
+		n += rib_sweep_stale_proto_table(
+			zvrf->table[AFI_IP][SAFI_UNICAST], proto);
+		n += rib_sweep_stale_proto_table(
+			zvrf->table[AFI_IP6][SAFI_UNICAST], proto);
+	}
+
+	RB_FOREACH (zrt, zebra_router_table_head, &zrouter.tables) {
+		if (zrt->ns_id != NS_DEFAULT)
+			continue;
+
+		n += rib_sweep_stale_proto_table(zrt->table, proto);
+	}
+
+	return n;
 }
 
 /* Sweep all RIB tables.  */
@@ -3326,6 +3772,68 @@ int rib_sweep_route(struct thread *t)
 	return 0;
 }
 
+/*
+ * Flag the kernel routes of a namespace as stale before its routing tables
+ * are read back from the kernel. The routes read back unchanged are only
+ * unflagged, the changed ones replace them, and rib_sweep_kernel_stale()
+ * removes the others.
+ */
+void rib_mark_kernel_stale(ns_id_t ns_id)
+{
+	struct zebra_router_table *zrt;
+	struct route_node *rn;
+	struct route_entry *re;
+
+	RB_FOREACH (zrt, zebra_router_table_head, &zrouter.tables) {
+		if (zrt->ns_id != ns_id || zrt->safi != SAFI_UNICAST)
+			continue;
+
+		for (rn = route_top(zrt->table); rn;
+		     rn = srcdest_route_next(rn))
+			RNODE_FOREACH_RE (rn, re) {
+				if (re->type != ZEBRA_ROUTE_KERNEL
+				    || CHECK_FLAG(re->status,
+						  ROUTE_ENTRY_REMOVED))
+					continue;
+
+				SET_FLAG(re->status, ROUTE_ENTRY_STALE);
+			}
+	}
+}
+
+/* Remove the kernel routes still flagged by rib_mark_kernel_stale(). */
+unsigned long rib_sweep_kernel_stale(ns_id_t ns_id)
+{
+	struct zebra_router_table *zrt;
+	struct route_node *rn;
+	struct route_entry *re, *next;
+	unsigned long n = 0;
+
+	RB_FOREACH (zrt, zebra_router_table_head, &zrouter.tables) {
+		if (zrt->ns_id != ns_id || zrt->safi != SAFI_UNICAST)
+			continue;
+
+		for (rn = route_top(zrt->table); rn;
+		     rn = srcdest_route_next(rn))
+			RNODE_FOREACH_RE_SAFE (rn, re, next) {
+				if (re->type != ZEBRA_ROUTE_KERNEL
+				    || !CHECK_FLAG(re->status,
+						   ROUTE_ENTRY_STALE))
+					continue;
+
+				UNSET_FLAG(re->status, ROUTE_ENTRY_STALE);
+				if (CHECK_FLAG(re->status, ROUTE_ENTRY_REMOVED))
+					continue;
+
+				dplane_sys_route_del(rn, re);
+				rib_delnode(rn, re);
+				n++;
+			}
+	}
+
+	return n;
+}
+
 /* Remove specific by protocol routes from 'table'. */
 unsigned long rib_score_proto_table(uint8_t proto, unsigned short instance,
 				    struct route_table *table)
@@ -3533,6 +4041,17 @@ static int rib_process_dplane_results(struct thread *thread)
 				zebra_vxlan_handle_result(ctx);
 				break;
 
+			case DPLANE_OP_RULE_ADD:
+			case DPLANE_OP_RULE_DELETE:
+			case DPLANE_OP_IPSET_ADD:
+			case DPLANE_OP_IPSET_DELETE:
+			case DPLANE_OP_IPSET_ENTRY_ADD:
+			case DPLANE_OP_IPSET_ENTRY_DELETE:
+			case DPLANE_OP_IPTABLE_ADD:
+			case DPLANE_OP_IPTABLE_DELETE:
+				zebra_pbr_dplane_result(ctx);
+				break;
+
 			/* Some op codes not handled here */
 			case DPLANE_OP_ADDR_INSTALL:
 			case DPLANE_OP_ADDR_UNINSTALL:
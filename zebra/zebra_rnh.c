@@ -151,7 +151,8 @@ static void zebra_rnh_store_in_routing_table(struct rnh *rnh)
 struct rnh *zebra_add_rnh(struct prefix *p, vrf_id_t vrfid, rnh_type_t type,
 			  bool *exists)
 {
-	struct route_table *table;
+	struct zebra_vrf *zvrf;
+	struct route_table *table = NULL;
 	struct route_node *rn;
 	struct rnh *rnh = NULL;
 	char buf[PREFIX2STR_BUFFER];
@@ -162,7 +163,9 @@ struct rnh *zebra_add_rnh(struct prefix *p, vrf_id_t vrfid, rnh_type_t type,
 		zlog_debug("%u: Add RNH %s type %s", vrfid, buf,
 			   rnh_type2str(type));
 	}
-	table = get_rnh_table(vrfid, afi, type);
+	zvrf = zebra_vrf_lookup_by_id(vrfid);
+	if (zvrf)
+		table = zebra_vrf_get_rnh_table(zvrf, afi, type);
 	if (!table) {
 		prefix2str(p, buf, sizeof(buf));
 		flog_warn(EC_ZEBRA_RNH_NO_TABLE,
@@ -908,6 +911,103 @@ void zebra_evaluate_rnh(struct zebra_vrf *zvrf, afi_t afi, int force,
 	}
 }
 
+/*
+ * Add the tracked entries of table within p that resolve over a less specific
+ * route than p, or over none, to *covered. Returns false once more than
+ * 'budget' entries have been looked at in total.
+ */
+static bool zebra_rnh_collect_covered(struct route_table *table,
+				      const struct prefix *p,
+				      struct rnh ***covered, size_t *num,
+				      size_t *size, size_t *visited,
+				      size_t budget)
+{
+	struct route_node *nrn;
+	struct rnh *rnh;
+
+	if (!table)
+		return true;
+
+	/* The entry for p itself, then the ones below it */
+	nrn = route_node_lookup(table, p);
+	if (!nrn)
+		nrn = route_table_get_next(table, p);
+	for (; nrn && prefix_match(p, &nrn->p); nrn = route_next(nrn)) {
+		rnh = nrn->info;
+		if (!rnh)
+			continue;
+
+		if (++(*visited) > budget) {
+			route_unlock_node(nrn);
+			return false;
+		}
+
+		if (rnh->resolved_route.prefixlen >= p->prefixlen)
+			continue;
+
+		if (*num == *size) {
+			*size = MAX(*size * 2, 64);
+			*covered = XREALLOC(MTYPE_TMP, *covered,
+					    *size * sizeof(**covered));
+		}
+		(*covered)[(*num)++] = rnh;
+	}
+	if (nrn)
+		route_unlock_node(nrn);
+
+	return true;
+}
+
+/*
+ * Evaluate the tracked entries that a change to rib node rn may resolve
+ * differently, besides the ones resolving over rn itself: those within rn's
+ * prefix that resolve over a less specific route or over none. They are found
+ * in the part of the tracking tables covered by rn. This gives up without
+ * evaluating anything, returning false, if that means looking at more than
+ * 'budget' entries.
+ */
+bool zebra_rnh_evaluate_covered(struct zebra_vrf *zvrf, struct route_node *rn,
+				uint32_t seq, size_t budget)
+{
+	afi_t afi = family2afi(rn->p.family);
+	struct rnh **covered = NULL;
+	size_t num = 0, size = 0, visited = 0, i;
+	struct rnh *rnh;
+
+	if (!zebra_rnh_collect_covered(zvrf->rnh_table[afi], &rn->p, &covered,
+				       &num, &size, &visited, budget)
+	    || !zebra_rnh_collect_covered(zvrf->import_check_table[afi],
+					  &rn->p, &covered, &num, &size,
+					  &visited, budget)) {
+		XFREE(MTYPE_TMP, covered);
+		return false;
+	}
+
+	for (i = 0; i < num; i++) {
+		rnh = covered[i];
+		if (rnh->seqno == seq)
+			continue;
+
+		if (IS_ZEBRA_DEBUG_NHT_DETAILED) {
+			char buf1[PREFIX_STRLEN];
+			char buf2[PREFIX_STRLEN];
+
+			zlog_debug("%u:%s covers Nexthop(%s) Type: %s, evaluating",
+				   zvrf_id(zvrf),
+				   srcdest_rnode2str(rn, buf1, sizeof(buf1)),
+				   prefix2str(&rnh->node->p, buf2,
+					      sizeof(buf2)),
+				   rnh_type2str(rnh->type));
+		}
+
+		rnh->seqno = seq;
+		zebra_evaluate_rnh(zvrf, afi, 0, rnh->type, &rnh->node->p);
+	}
+
+	XFREE(MTYPE_TMP, covered);
+	return true;
+}
+
 void zebra_print_rnh_table(vrf_id_t vrfid, afi_t afi, struct vty *vty,
 			   rnh_type_t type, struct prefix *p)
 {
@@ -997,6 +1097,7 @@ static int send_client(struct rnh *rnh, struct zserv *client, rnh_type_t type,
 		       vrf_id_t vrf_id)
 {
 	struct stream *s;
+	struct zserv_coalesce_key key;
 	struct route_entry *re;
 	unsigned long nump;
 	uint8_t num;
@@ -1084,7 +1185,14 @@ static int send_client(struct rnh *rnh, struct zserv *client, rnh_type_t type,
 
 	client->nh_last_upd_time = monotime(NULL);
 	client->last_write_cmd = cmd;
-	return zserv_send_message(client, s);
+
+	/* A later update for the same nexthop supersedes this one */
+	memset(&key, 0, sizeof(key));
+	key.cmd = cmd;
+	key.vrf_id = vrf_id;
+	prefix_copy(&key.p, &rn->p);
+
+	return zserv_send_message_coalesce(client, s, &key);
 }
 
 static void print_nh(struct nexthop *nexthop, struct vty *vty)
@@ -1168,11 +1276,10 @@ static int zebra_cleanup_rnh_client(vrf_id_t vrf_id, afi_t afi,
 			   vrf_id, zebra_route_string(client->proto),
 			   afi2str(afi), rnh_type2str(type));
 
+	/* Not created until something is tracked */
 	ntable = get_rnh_table(vrf_id, afi, type);
-	if (!ntable) {
-		zlog_debug("cleanup_rnh_client: rnh table not found");
-		return -1;
-	}
+	if (!ntable)
+		return 0;
 
 	for (nrn = route_top(ntable); nrn; nrn = route_next(nrn)) {
 		if (!nrn->info)
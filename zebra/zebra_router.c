@@ -124,23 +124,68 @@ struct route_table *zebra_router_get_table(struct zebra_vrf *zvrf,
 	return zrt->table;
 }
 
+/*
+ * Approximate memory held by a table and its nodes, not counting the
+ * route entries themselves
+ */
+static size_t zebra_router_table_memory(struct zebra_router_table *zrt)
+{
+	size_t node_size = sizeof(struct route_node) + sizeof(rib_dest_t);
+
+	/* srcdest nodes also point to their source table */
+	if (zrt->afi == AFI_IP6)
+		node_size += sizeof(struct route_table *);
+
+	return sizeof(*zrt) + sizeof(struct route_table)
+	       + sizeof(rib_table_info_t)
+	       + HASH_SIZE(zrt->table->hash.hh) * sizeof(void *)
+	       + zrt->table->count * node_size;
+}
+
 void zebra_router_show_table_summary(struct vty *vty)
 {
 	struct zebra_router_table *zrt;
+	struct vrf *vrf;
+	size_t memory, total = 0;
+	unsigned int tables = 0, rnh_tables = 0, vrfs = 0;
+	afi_t afi;
 
 	vty_out(vty,
-		"VRF             NS ID    VRF ID     AFI            SAFI    Table      Count\n");
+		"VRF             NS ID    VRF ID     AFI            SAFI    Table      Count     Memory\n");
 	vty_out(vty,
-		"---------------------------------------------------------------------------\n");
+		"--------------------------------------------------------------------------------------\n");
 	RB_FOREACH (zrt, zebra_router_table_head, &zrouter.tables) {
 		rib_table_info_t *info = route_table_get_info(zrt->table);
 
-		vty_out(vty, "%-16s%5d %9d %7s %15s %8d %10lu\n", info->zvrf->vrf->name,
-			zrt->ns_id, info->zvrf->vrf->vrf_id,
-			afi2str(zrt->afi), safi2str(zrt->safi),
-			zrt->tableid,
-			zrt->table->count);
+		memory = zebra_router_table_memory(zrt);
+		total += memory;
+		tables++;
+
+		vty_out(vty, "%-16s%5d %9d %7s %15s %8d %10lu %10zu\n",
+			info->zvrf->vrf->name, zrt->ns_id,
+			info->zvrf->vrf->vrf_id, afi2str(zrt->afi),
+			safi2str(zrt->safi), zrt->tableid, zrt->table->count,
+			memory);
 	}
+
+	RB_FOREACH (vrf, vrf_id_head, &vrfs_by_id) {
+		struct zebra_vrf *zvrf = vrf->info;
+
+		if (!zvrf)
+			continue;
+
+		vrfs++;
+		for (afi = AFI_IP; afi <= AFI_IP6; afi++) {
+			if (zvrf->rnh_table[afi])
+				rnh_tables++;
+			if (zvrf->import_check_table[afi])
+				rnh_tables++;
+		}
+	}
+
+	vty_out(vty,
+		"%u VRFs, %u routing tables using %zu bytes, %u nexthop tracking tables\n",
+		vrfs, tables, total, rnh_tables);
 }
 
 void zebra_router_sweep_route(void)
@@ -223,6 +268,8 @@ void zebra_router_terminate(void)
 	zebra_vxlan_disable();
 	zebra_mlag_terminate();
 
+	zebra_nhg_terminate();
+
 	hash_clean(zrouter.nhgs, zebra_nhg_free);
 	hash_free(zrouter.nhgs);
 	hash_clean(zrouter.nhgs_id, NULL);
@@ -244,6 +291,11 @@ void zebra_router_init(void)
 	zrouter.sequence_num = 0;
 
 	zrouter.packets_to_process = ZEBRA_ZAPI_PACKETS_TO_PROCESS;
+	zrouter.obuf_high_watermark = ZEBRA_ZAPI_OBUF_HIGH_WATERMARK;
+	zrouter.obuf_low_watermark = ZEBRA_ZAPI_OBUF_LOW_WATERMARK;
+	zrouter.obuf_limit = ZEBRA_ZAPI_OBUF_LIMIT;
+	zrouter.nhg_keep = ZEBRA_DEFAULT_NHG_KEEP_TIMER;
+	zrouter.if_event_window = ZEBRA_IF_EVENT_WINDOW;
 
 	zebra_vxlan_init();
 	zebra_mlag_init();
@@ -270,4 +322,5 @@ void zebra_router_init(void)
 	zrouter.nhgs_id =
 		hash_create_size(8, zebra_nhg_id_key, zebra_nhg_hash_id_equal,
 				 "Zebra Router Nexthop Groups ID index");
+	zebra_nhg_init();
 }
@@ -115,6 +115,19 @@ struct zebra_router {
 #define ZEBRA_ZAPI_PACKETS_TO_PROCESS 1000
 	_Atomic uint32_t packets_to_process;
 
+	/*
+	 * Watermarks, in KiB, of the data queued for a client: above the
+	 * high one messages that supersede a queued one replace it, until
+	 * the client has caught up to below the low one. A client that
+	 * would have more than the limit queued is closed.
+	 */
+#define ZEBRA_ZAPI_OBUF_HIGH_WATERMARK 8192
+#define ZEBRA_ZAPI_OBUF_LOW_WATERMARK 2048
+#define ZEBRA_ZAPI_OBUF_LIMIT 65536
+	_Atomic uint32_t obuf_high_watermark;
+	_Atomic uint32_t obuf_low_watermark;
+	_Atomic uint32_t obuf_limit;
+
 	/* Mlag information for the router */
 	struct zebra_mlag_info mlag_info;
 
@@ -138,6 +151,20 @@ struct zebra_router {
 	 */
 	struct hash *nhgs;
 	struct hash *nhgs_id;
+
+	/*
+	 * Seconds an unreferenced nexthop group we created is kept around,
+	 * installed, for reuse before it is removed
+	 */
+#define ZEBRA_DEFAULT_NHG_KEEP_TIMER 180
+	uint32_t nhg_keep;
+
+	/*
+	 * Milliseconds for which interface events are merged before
+	 * clients and the RIB are updated, 0 to handle each right away
+	 */
+#define ZEBRA_IF_EVENT_WINDOW 10
+	uint32_t if_event_window;
 };
 
 #define GRACEFUL_RESTART_TIME 60
@@ -108,9 +108,6 @@ static int zebra_vrf_new(struct vrf *vrf)
 static int zebra_vrf_enable(struct vrf *vrf)
 {
 	struct zebra_vrf *zvrf = vrf->info;
-	struct route_table *table;
-	afi_t afi;
-	safi_t safi;
 
 	assert(zvrf);
 	if (IS_ZEBRA_DEBUG_EVENT)
@@ -130,19 +127,12 @@ static int zebra_vrf_enable(struct vrf *vrf)
 	 */
 
 	zebra_vrf_add_update(zvrf);
-	/* Allocate tables */
-	for (afi = AFI_IP; afi <= AFI_IP6; afi++) {
-		for (safi = SAFI_UNICAST; safi <= SAFI_MULTICAST; safi++)
-			zebra_vrf_table_create(zvrf, afi, safi);
 
-		table = route_table_init();
-		table->cleanup = zebra_rnhtable_node_cleanup;
-		zvrf->rnh_table[afi] = table;
-
-		table = route_table_init();
-		table->cleanup = zebra_rnhtable_node_cleanup;
-		zvrf->import_check_table[afi] = table;
-	}
+	/*
+	 * The routing and nexthop tracking tables are allocated as they
+	 * are first needed, see zebra_vrf_get_table() and
+	 * zebra_vrf_get_rnh_table().
+	 */
 
 	/* Kick off any VxLAN-EVPN processing. */
 	zebra_vxlan_vrf_enable(zvrf);
@@ -384,6 +374,12 @@ struct route_table *zebra_vrf_get_table_with_table_id(afi_t afi, safi_t safi,
 	if (table)
 		goto done;
 
+	if (table_id == zvrf->table_id) {
+		table = zebra_vrf_get_table(zvrf, afi, safi);
+		if (table)
+			goto done;
+	}
+
 	/* Create it as an `other` table */
 	table = zebra_router_get_table(zvrf, table_id, afi, safi);
 
@@ -411,6 +407,7 @@ void zebra_rtable_node_cleanup(struct route_table *table,
 		rib_dest_t *dest = node->info;
 
 		rnh_list_fini(&dest->nht);
+		zebra_nhg_resolve_dest_fini(dest, false);
 		XFREE(MTYPE_RIB_DEST, node->info);
 	}
 }
@@ -443,6 +440,63 @@ static void zebra_vrf_table_create(struct zebra_vrf *zvrf, afi_t afi,
 	zebra_rib_create_dest(rn);
 }
 
+/*
+ * Get the routing table for the specific AFI/SAFI in the given VRF,
+ * creating it with its first route. On a PE most VRFs only ever hold
+ * a handful of routes, in one or two of their four tables.
+ */
+struct route_table *zebra_vrf_get_table(struct zebra_vrf *zvrf, afi_t afi,
+					safi_t safi)
+{
+	if (afi < AFI_IP || afi > AFI_IP6 || safi < SAFI_UNICAST
+	    || safi > SAFI_MULTICAST)
+		return NULL;
+
+	if (!zvrf->table[afi][safi]) {
+		if (!vrf_is_enabled(zvrf->vrf))
+			return NULL;
+
+		zebra_vrf_table_create(zvrf, afi, safi);
+	}
+
+	return zvrf->table[afi][safi];
+}
+
+/*
+ * Get the nexthop tracking table of the given type, creating it with its
+ * first entry. The unicast table of the AFI is created along with it, so
+ * that every tracked nexthop can be stored on the route resolving it.
+ */
+struct route_table *zebra_vrf_get_rnh_table(struct zebra_vrf *zvrf, afi_t afi,
+					    rnh_type_t type)
+{
+	struct route_table **tablep;
+
+	if (afi < AFI_IP || afi > AFI_IP6)
+		return NULL;
+
+	if (!zebra_vrf_get_table(zvrf, afi, SAFI_UNICAST))
+		return NULL;
+
+	switch (type) {
+	case RNH_NEXTHOP_TYPE:
+		tablep = &zvrf->rnh_table[afi];
+		break;
+	case RNH_IMPORT_CHECK_TYPE:
+		tablep = &zvrf->import_check_table[afi];
+		break;
+	default:
+		return NULL;
+	}
+
+	if (!*tablep) {
+		*tablep = route_table_init();
+		(*tablep)->cleanup = zebra_rnhtable_node_cleanup;
+	}
+
+	return *tablep;
+}
+
 /* Allocate new zebra VRF. */
 struct zebra_vrf *zebra_vrf_alloc(void)
 {
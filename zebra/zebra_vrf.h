@@ -246,6 +246,11 @@ extern struct zebra_vrf *zebra_vrf_lookup_by_id(vrf_id_t vrf_id);
 extern struct zebra_vrf *zebra_vrf_lookup_by_name(const char *);
 extern struct zebra_vrf *zebra_vrf_alloc(void);
 extern struct route_table *zebra_vrf_table(afi_t, safi_t, vrf_id_t);
+extern struct route_table *zebra_vrf_get_table(struct zebra_vrf *zvrf,
+					       afi_t afi, safi_t safi);
+extern struct route_table *zebra_vrf_get_rnh_table(struct zebra_vrf *zvrf,
+						   afi_t afi,
+						   rnh_type_t type);
 
 extern int zebra_vrf_has_config(struct zebra_vrf *zvrf);
 extern void zebra_vrf_init(void);
@@ -54,6 +54,7 @@
 #include "zebra/zebra_pbr.h"
 #include "zebra/zebra_nhg.h"
 #include "zebra/interface.h"
+#include "zebra/if_netlink.h"
 
 extern int allow_delete;
 
@@ -1125,6 +1126,12 @@ static void show_nexthop_group_out(struct vty *vty, struct nhg_hash_entry *nhe)
 	if (CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_UNHASHABLE))
 		vty_out(vty, "     Duplicate - from kernel not hashable\n");
 
+	if (CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_GC))
+		vty_out(vty, "     Unreferenced, removal in %lld seconds\n",
+			(long long)MAX(nhe->gc_time + (time_t)zrouter.nhg_keep
+					       - monotime(NULL),
+				       0));
+
 	if (CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_VALID)) {
 		vty_out(vty, "     Valid");
 		if (CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_INSTALLED))
@@ -2864,6 +2871,121 @@ DEFUN_HIDDEN (no_zebra_packet_process,
 	return CMD_SUCCESS;
 }
 
+DEFPY_HIDDEN (zebra_zapi_obuf_watermark,
+	      zebra_zapi_obuf_watermark_cmd,
+	      "zebra zapi-obuf watermark high (1-1048576)$high low (1-1048576)$low [limit (1-4194304)$limit]",
+	      ZEBRA_STR
+	      "Zapi Protocol output queues\n"
+	      "Bounds of the data queued for a client\n"
+	      "Start coalescing messages above this\n"
+	      "KiB queued\n"
+	      "Stop coalescing messages below this\n"
+	      "KiB queued\n"
+	      "Close a client that would have more queued\n"
+	      "KiB queued\n")
+{
+	if (!limit_str)
+		limit = ZEBRA_ZAPI_OBUF_LIMIT;
+
+	if (low > high) {
+		vty_out(vty, "%% Low watermark must not exceed the high one\n");
+		return CMD_WARNING_CONFIG_FAILED;
+	}
+	if (high > limit) {
+		vty_out(vty, "%% High watermark must not exceed the limit\n");
+		return CMD_WARNING_CONFIG_FAILED;
+	}
+
+	atomic_store_explicit(&zrouter.obuf_high_watermark, high,
+			      memory_order_relaxed);
+	atomic_store_explicit(&zrouter.obuf_low_watermark, low,
+			      memory_order_relaxed);
+	atomic_store_explicit(&zrouter.obuf_limit, limit,
+			      memory_order_relaxed);
+
+	return CMD_SUCCESS;
+}
+
+DEFUN_HIDDEN (no_zebra_zapi_obuf_watermark,
+	      no_zebra_zapi_obuf_watermark_cmd,
+	      "no zebra zapi-obuf watermark [high (1-1048576) low (1-1048576) [limit (1-4194304)]]",
+	      NO_STR
+	      ZEBRA_STR
+	      "Zapi Protocol output queues\n"
+	      "Bounds of the data queued for a client\n"
+	      "Start coalescing messages above this\n"
+	      "KiB queued\n"
+	      "Stop coalescing messages below this\n"
+	      "KiB queued\n"
+	      "Close a client that would have more queued\n"
+	      "KiB queued\n")
+{
+	atomic_store_explicit(&zrouter.obuf_high_watermark,
+			      ZEBRA_ZAPI_OBUF_HIGH_WATERMARK,
+			      memory_order_relaxed);
+	atomic_store_explicit(&zrouter.obuf_low_watermark,
+			      ZEBRA_ZAPI_OBUF_LOW_WATERMARK,
+			      memory_order_relaxed);
+	atomic_store_explicit(&zrouter.obuf_limit, ZEBRA_ZAPI_OBUF_LIMIT,
+			      memory_order_relaxed);
+
+	return CMD_SUCCESS;
+}
+
+DEFPY (zebra_nhg_keep,
+       zebra_nhg_keep_cmd,
+       "zebra nexthop-group keep (1-3600)$keep",
+       ZEBRA_STR
+       "Nexthop Group\n"
+       "How long an unreferenced nexthop group is kept for reuse\n"
+       "Time in seconds\n")
+{
+	zrouter.nhg_keep = keep;
+
+	return CMD_SUCCESS;
+}
+
+DEFUN (no_zebra_nhg_keep,
+       no_zebra_nhg_keep_cmd,
+       "no zebra nexthop-group keep [(1-3600)]",
+       NO_STR
+       ZEBRA_STR
+       "Nexthop Group\n"
+       "How long an unreferenced nexthop group is kept for reuse\n"
+       "Time in seconds\n")
+{
+	zrouter.nhg_keep = ZEBRA_DEFAULT_NHG_KEEP_TIMER;
+
+	return CMD_SUCCESS;
+}
+
+DEFPY (zebra_if_event_window,
+       zebra_if_event_window_cmd,
+       "zebra interface-event window (0-1000)$window",
+       ZEBRA_STR
+       "Interface events from the kernel\n"
+       "How long events for the same interface are merged\n"
+       "Time in milliseconds, 0 to disable\n")
+{
+	zrouter.if_event_window = window;
+
+	return CMD_SUCCESS;
+}
+
+DEFUN (no_zebra_if_event_window,
+       no_zebra_if_event_window_cmd,
+       "no zebra interface-event window [(0-1000)]",
+       NO_STR
+       ZEBRA_STR
+       "Interface events from the kernel\n"
+       "How long events for the same interface are merged\n"
+       "Time in milliseconds, 0 to disable\n")
+{
+	zrouter.if_event_window = ZEBRA_IF_EVENT_WINDOW;
+
+	return CMD_SUCCESS;
+}
+
 DEFUN_HIDDEN (zebra_workqueue_timer,
 	      zebra_workqueue_timer_cmd,
 	      "zebra work-queue (0-10000)",
@@ -2890,6 +3012,35 @@ DEFUN_HIDDEN (no_zebra_workqueue_timer,
 	return CMD_SUCCESS;
 }
 
+DEFUN (zebra_meta_queue_batch,
+       zebra_meta_queue_batch_cmd,
+       "zebra meta-queue batch (2-10000)",
+       ZEBRA_STR
+       "Route processing meta-queue\n"
+       "Process route nodes in sorted batches\n"
+       "Number of route nodes per batch\n")
+{
+	uint32_t batch = strtoul(argv[3]->arg, NULL, 10);
+
+	rib_meta_queue_batch_set(batch);
+
+	return CMD_SUCCESS;
+}
+
+DEFUN (no_zebra_meta_queue_batch,
+       no_zebra_meta_queue_batch_cmd,
+       "no zebra meta-queue batch [(2-10000)]",
+       NO_STR
+       ZEBRA_STR
+       "Route processing meta-queue\n"
+       "Process route nodes in sorted batches\n"
+       "Number of route nodes per batch\n")
+{
+	rib_meta_queue_batch_set(0);
+
+	return CMD_SUCCESS;
+}
+
 DEFUN (no_ip_zebra_import_table,
        no_ip_zebra_import_table_cmd,
        "no ip import-table (1-252) [distance (1-255)] [route-map NAME]",
@@ -2932,10 +3083,31 @@ static int config_write_protocol(struct vty *vty)
 	if (zrouter.ribq->spec.hold != ZEBRA_RIB_PROCESS_HOLD_TIME)
 		vty_out(vty, "zebra work-queue %u\n", zrouter.ribq->spec.hold);
 
+	if (zrouter.mq->batch)
+		vty_out(vty, "zebra meta-queue batch %u\n", zrouter.mq->batch);
+
 	if (zrouter.packets_to_process != ZEBRA_ZAPI_PACKETS_TO_PROCESS)
 		vty_out(vty, "zebra zapi-packets %u\n",
 			zrouter.packets_to_process);
 
+	if (zrouter.nhg_keep != ZEBRA_DEFAULT_NHG_KEEP_TIMER)
+		vty_out(vty, "zebra nexthop-group keep %u\n", zrouter.nhg_keep);
+
+	if (zrouter.if_event_window != ZEBRA_IF_EVENT_WINDOW)
+		vty_out(vty, "zebra interface-event window %u\n",
+			zrouter.if_event_window);
+
+	if (zrouter.obuf_limit != ZEBRA_ZAPI_OBUF_LIMIT)
+		vty_out(vty,
+			"zebra zapi-obuf watermark high %u low %u limit %u\n",
+			zrouter.obuf_high_watermark,
+			zrouter.obuf_low_watermark, zrouter.obuf_limit);
+	else if (zrouter.obuf_high_watermark != ZEBRA_ZAPI_OBUF_HIGH_WATERMARK
+		 || zrouter.obuf_low_watermark != ZEBRA_ZAPI_OBUF_LOW_WATERMARK)
+		vty_out(vty, "zebra zapi-obuf watermark high %u low %u\n",
+			zrouter.obuf_high_watermark,
+			zrouter.obuf_low_watermark);
+
 	enum multicast_mode ipv4_multicast_mode = multicast_mode_ipv4_get();
 
 	if (ipv4_multicast_mode != MCAST_NO_CONFIG)
@@ -2958,6 +3130,74 @@ static int config_write_protocol(struct vty *vty)
 	return 1;
 }
 
+/* Sub-queue names, see the meta-queue layout in rib.h */
+static const char *const meta_queue_names[MQ_SIZE] = {
+	"NHG", "Connected/Kernel", "Static", "IGP", "BGP", "Other",
+};
+
+static void show_zebra_rib_stats(struct vty *vty)
+{
+	struct meta_queue *mq = zrouter.mq;
+	struct meta_queue_stats *stats;
+	uint64_t hits, misses, reused, removed;
+	uint32_t count, ids;
+	unsigned int i;
+
+	vty_out(vty, "\nMeta-queue: %u queued, batching %s",
+		mq->size, mq->batch ? "" : "disabled\n");
+	if (mq->batch)
+		vty_out(vty, "%u nodes\n", mq->batch);
+
+	vty_out(vty,
+		"Sub-queue              Queued  Processed       Runs  Max Batch  Usec/Run    Per Sec\n");
+	for (i = 0; i < MQ_SIZE; i++) {
+		stats = &mq->stats[i];
+
+		vty_out(vty,
+			"%u %-18s %8u %10" PRIu64 " %10" PRIu64
+			" %10u %9" PRIu64 " %10" PRIu64 "\n",
+			i, meta_queue_names[i], listcount(mq->subq[i]),
+			stats->processed, stats->runs, stats->max_batch,
+			stats->runs ? stats->usecs / stats->runs : 0,
+			stats->usecs ? stats->processed * 1000000
+					       / stats->usecs
+				     : 0);
+	}
+
+	zebra_nhg_batch_stats(&hits, &misses);
+	vty_out(vty,
+		"Batched nexthop resolution: %" PRIu64 " reused, %" PRIu64
+		" resolved\n",
+		hits, misses);
+
+	zebra_nhg_resolve_cache_stats(&count, &hits, &misses);
+	vty_out(vty,
+		"Nexthop resolution cache: %u entries, %" PRIu64
+		" hits, %" PRIu64 " misses\n",
+		count, hits, misses);
+
+	zebra_nhg_gc_stats(&count, &ids, &reused, &removed);
+	vty_out(vty,
+		"Nexthop groups: %u IDs in use, %u unreferenced (kept %us), %"
+		PRIu64 " reused, %" PRIu64 " removed\n",
+		ids, count, zrouter.nhg_keep, reused, removed);
+
+#ifdef HAVE_NETLINK
+	{
+		uint64_t updates, updates_merged, passes, passes_merged;
+
+		netlink_if_event_stats(&updates, &updates_merged, &passes,
+				       &passes_merged);
+		vty_out(vty,
+			"Interface events: %" PRIu64 " updates, %" PRIu64
+			" merged; %" PRIu64 " kernel route passes, %" PRIu64
+			" merged (window %ums)\n",
+			updates, updates_merged, passes, passes_merged,
+			zrouter.if_event_window);
+	}
+#endif
+}
+
 DEFUN (show_zebra,
        show_zebra_cmd,
        "show zebra",
@@ -2981,6 +3221,8 @@ DEFUN (show_zebra,
 			zvrf->lsp_removals);
 	}
 
+	show_zebra_rib_stats(vty);
+
 	return CMD_SUCCESS;
 }
 
@@ -3184,6 +3426,48 @@ DEFUN (no_zebra_dplane_queue_limit,
 	return CMD_SUCCESS;
 }
 
+/* Configure batching of kernel route updates */
+DEFUN (zebra_dplane_kernel_batch,
+       zebra_dplane_kernel_batch_cmd,
+       "[no] zebra dplane kernel-batch",
+       NO_STR
+       ZEBRA_STR
+       "Zebra dataplane\n"
+       "Send route updates to the kernel in batches\n")
+{
+	dplane_set_kernel_batch(!strmatch(argv[0]->text, "no"));
+
+	return CMD_SUCCESS;
+}
+
+/* Configure parallel kernel route workers */
+DEFPY (zebra_dplane_kernel_workers,
+       zebra_dplane_kernel_workers_cmd,
+       "zebra dplane kernel-workers (1-16)$count",
+       ZEBRA_STR
+       "Zebra dataplane\n"
+       "Install routes to the kernel from parallel workers, by table\n"
+       "Number of workers\n")
+{
+	dplane_set_kernel_workers(count);
+
+	return CMD_SUCCESS;
+}
+
+DEFUN (no_zebra_dplane_kernel_workers,
+       no_zebra_dplane_kernel_workers_cmd,
+       "no zebra dplane kernel-workers [(1-16)]",
+       NO_STR
+       ZEBRA_STR
+       "Zebra dataplane\n"
+       "Install routes to the kernel from parallel workers, by table\n"
+       "Number of workers\n")
+{
+	dplane_set_kernel_workers(1);
+
+	return CMD_SUCCESS;
+}
+
 DEFUN (zebra_show_routing_tables_summary,
        zebra_show_routing_tables_summary_cmd,
        "show zebra router table summary",
@@ -3324,8 +3608,16 @@ void zebra_vty_init(void)
 	install_element(CONFIG_NODE, &no_ip_zebra_import_table_cmd);
 	install_element(CONFIG_NODE, &zebra_workqueue_timer_cmd);
 	install_element(CONFIG_NODE, &no_zebra_workqueue_timer_cmd);
+	install_element(CONFIG_NODE, &zebra_nhg_keep_cmd);
+	install_element(CONFIG_NODE, &no_zebra_nhg_keep_cmd);
+	install_element(CONFIG_NODE, &zebra_if_event_window_cmd);
+	install_element(CONFIG_NODE, &no_zebra_if_event_window_cmd);
+	install_element(CONFIG_NODE, &zebra_meta_queue_batch_cmd);
+	install_element(CONFIG_NODE, &no_zebra_meta_queue_batch_cmd);
 	install_element(CONFIG_NODE, &zebra_packet_process_cmd);
 	install_element(CONFIG_NODE, &no_zebra_packet_process_cmd);
+	install_element(CONFIG_NODE, &zebra_zapi_obuf_watermark_cmd);
+	install_element(CONFIG_NODE, &no_zebra_zapi_obuf_watermark_cmd);
 
 	install_element(VIEW_NODE, &show_nexthop_group_cmd);
 	install_element(VIEW_NODE, &show_interface_nexthop_group_cmd);
@@ -3397,6 +3689,9 @@ void zebra_vty_init(void)
 	install_element(VIEW_NODE, &show_dataplane_providers_cmd);
 	install_element(CONFIG_NODE, &zebra_dplane_queue_limit_cmd);
 	install_element(CONFIG_NODE, &no_zebra_dplane_queue_limit_cmd);
+	install_element(CONFIG_NODE, &zebra_dplane_kernel_batch_cmd);
+	install_element(CONFIG_NODE, &zebra_dplane_kernel_workers_cmd);
+	install_element(CONFIG_NODE, &no_zebra_dplane_kernel_workers_cmd);
 
 	install_element(VIEW_NODE, &zebra_show_routing_tables_summary_cmd);
 }
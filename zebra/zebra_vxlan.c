@@ -79,8 +79,8 @@ static const struct message zvtep_flood_str[] = {
 static int ip_prefix_send_to_client(vrf_id_t vrf_id, struct prefix *p,
 				    uint16_t cmd);
 static void zvni_print_neigh(zebra_neigh_t *n, void *ctxt, json_object *json);
-static void zvni_print_neigh_hash(struct hash_bucket *bucket, void *ctxt);
-static void zvni_print_dad_neigh_hash(struct hash_bucket *bucket, void *ctxt);
+static void zvni_print_neigh_hash(zebra_neigh_t *n, void *ctxt);
+static void zvni_print_dad_neigh_hash(zebra_neigh_t *nbr, void *ctxt);
 static void zvni_print_neigh_hash_all_vni(struct hash_bucket *bucket,
 					  void **args);
 static void zl3vni_print_nh(zebra_neigh_t *n, struct vty *vty,
@@ -88,7 +88,7 @@ static void zl3vni_print_nh(zebra_neigh_t *n, struct vty *vty,
 static void zl3vni_print_rmac(zebra_mac_t *zrmac, struct vty *vty,
 			      json_object *json);
 static void zvni_print_mac(zebra_mac_t *mac, void *ctxt, json_object *json);
-static void zvni_print_mac_hash(struct hash_bucket *bucket, void *ctxt);
+static void zvni_print_mac_hash(zebra_mac_t *mac, void *ctxt);
 static void zvni_print_mac_hash_all_vni(struct hash_bucket *bucket, void *ctxt);
 static void zvni_print(zebra_vni_t *zvni, void **ctxt);
 static void zvni_print_hash(struct hash_bucket *bucket, void *ctxt[]);
@@ -97,7 +97,6 @@ static int zvni_macip_send_msg_to_client(vni_t vni, struct ethaddr *macaddr,
 					 struct ipaddr *ip, uint8_t flags,
 					 uint32_t seq, int state, uint16_t cmd);
 static unsigned int neigh_hash_keymake(const void *p);
-static void *zvni_neigh_alloc(void *p);
 static zebra_neigh_t *zvni_neigh_add(zebra_vni_t *zvni, struct ipaddr *ip,
 				     struct ethaddr *mac);
 static int zvni_neigh_del(zebra_vni_t *zvni, zebra_neigh_t *n);
@@ -151,7 +150,6 @@ static void zebra_vxlan_process_l3vni_oper_down(zebra_l3vni_t *zl3vni);
 
 static unsigned int mac_hash_keymake(const void *p);
 static bool mac_cmp(const void *p1, const void *p2);
-static void *zvni_mac_alloc(void *p);
 static zebra_mac_t *zvni_mac_add(zebra_vni_t *zvni, struct ethaddr *macaddr);
 static int zvni_mac_del(zebra_vni_t *zvni, zebra_mac_t *mac);
 static void zvni_mac_del_from_vtep(zebra_vni_t *zvni, int uninstall,
@@ -166,7 +164,7 @@ static zebra_vni_t *zvni_map_vlan(struct interface *ifp,
 				  struct interface *br_if, vlanid_t vid);
 static int zvni_mac_install(zebra_vni_t *zvni, zebra_mac_t *mac);
 static int zvni_mac_uninstall(zebra_vni_t *zvni, zebra_mac_t *mac);
-static void zvni_install_mac_hash(struct hash_bucket *bucket, void *ctxt);
+static void zvni_install_mac_hash(zebra_mac_t *mac, void *ctxt);
 
 static unsigned int vni_hash_keymake(const void *p);
 static void *zvni_alloc(void *p);
@@ -228,6 +226,60 @@ static void zebra_vxlan_sg_cleanup(struct hash_backet *backet, void *arg);
 static void zvni_send_mac_to_client(zebra_vni_t *zvn);
 static void zvni_send_neigh_to_client(zebra_vni_t *zvni);
 
+/* Per-VNI MAC and neighbor tables */
+static int zvni_mac_table_cmp(const zebra_mac_t *mac1, const zebra_mac_t *mac2)
+{
+	return memcmp(mac1->macaddr.octet, mac2->macaddr.octet, ETH_ALEN);
+}
+
+static uint32_t zvni_mac_table_hash(const zebra_mac_t *mac)
+{
+	return mac_hash_keymake(mac);
+}
+
+DECLARE_HASH(zvni_mac_table, zebra_mac_t, item, zvni_mac_table_cmp,
+	     zvni_mac_table_hash)
+
+static int zvni_neigh_table_cmp(const zebra_neigh_t *n1,
+				const zebra_neigh_t *n2)
+{
+	return memcmp(&n1->ip, &n2->ip, sizeof(struct ipaddr));
+}
+
+static uint32_t zvni_neigh_table_hash(const zebra_neigh_t *n)
+{
+	return neigh_hash_keymake(n);
+}
+
+DECLARE_HASH(zvni_neigh_table, zebra_neigh_t, item, zvni_neigh_table_cmp,
+	     zvni_neigh_table_hash)
+
+/*
+ * Walk the MACs of a VNI; the callback may delete the entry it is given.
+ */
+static void zvni_mac_walk(zebra_vni_t *zvni,
+			  void (*func)(zebra_mac_t *mac, void *arg), void *arg)
+{
+	zebra_mac_t *mac;
+
+	frr_each_safe (zvni_mac_table, &zvni->mac_table, mac)
+		func(mac, arg);
+}
+
+/*
+ * Walk the neighbors of a VNI; the callback may delete the entry it is
+ * given.
+ */
+static void zvni_neigh_walk(zebra_vni_t *zvni,
+			    void (*func)(zebra_neigh_t *n, void *arg),
+			    void *arg)
+{
+	zebra_neigh_t *n;
+
+	frr_each_safe (zvni_neigh_table, &zvni->neigh_table, n)
+		func(n, arg);
+}
+
 /* Private functions */
 static int host_rb_entry_compare(const struct host_rb_entry *hle1,
 				 const struct host_rb_entry *hle2)
@@ -280,23 +332,14 @@ static uint32_t rb_host_count(struct host_rb_tree_entry *hrbe)
  */
 static uint32_t num_valid_macs(zebra_vni_t *zvni)
 {
-	unsigned int i;
 	uint32_t num_macs = 0;
-	struct hash *hash;
-	struct hash_bucket *hb;
 	zebra_mac_t *mac;
 
-	hash = zvni->mac_table;
-	if (!hash)
-		return num_macs;
-	for (i = 0; i < hash->size; i++) {
-		for (hb = hash->index[i]; hb; hb = hb->next) {
-			mac = (zebra_mac_t *)hb->data;
-			if (CHECK_FLAG(mac->flags, ZEBRA_MAC_REMOTE)
-			    || CHECK_FLAG(mac->flags, ZEBRA_MAC_LOCAL)
-			    || !CHECK_FLAG(mac->flags, ZEBRA_MAC_AUTO))
-				num_macs++;
-		}
+	frr_each (zvni_mac_table, &zvni->mac_table, mac) {
+		if (CHECK_FLAG(mac->flags, ZEBRA_MAC_REMOTE)
+		    || CHECK_FLAG(mac->flags, ZEBRA_MAC_LOCAL)
+		    || !CHECK_FLAG(mac->flags, ZEBRA_MAC_AUTO))
+			num_macs++;
 	}
 
 	return num_macs;
@@ -304,21 +347,12 @@ static uint32_t num_valid_macs(zebra_vni_t *zvni)
 
 static uint32_t num_dup_detected_macs(zebra_vni_t *zvni)
 {
-	unsigned int i;
 	uint32_t num_macs = 0;
-	struct hash *hash;
-	struct hash_bucket *hb;
 	zebra_mac_t *mac;
 
-	hash = zvni->mac_table;
-	if (!hash)
-		return num_macs;
-	for (i = 0; i < hash->size; i++) {
-		for (hb = hash->index[i]; hb; hb = hb->next) {
-			mac = (zebra_mac_t *)hb->data;
-			if (CHECK_FLAG(mac->flags, ZEBRA_MAC_DUPLICATE))
-				num_macs++;
-		}
+	frr_each (zvni_mac_table, &zvni->mac_table, mac) {
+		if (CHECK_FLAG(mac->flags, ZEBRA_MAC_DUPLICATE))
+			num_macs++;
 	}
 
 	return num_macs;
@@ -326,21 +360,12 @@ static uint32_t num_dup_detected_macs(zebra_vni_t *zvni)
 
 static uint32_t num_dup_detected_neighs(zebra_vni_t *zvni)
 {
-	unsigned int i;
 	uint32_t num_neighs = 0;
-	struct hash *hash;
-	struct hash_bucket *hb;
 	zebra_neigh_t *nbr;
 
-	hash = zvni->neigh_table;
-	if (!hash)
-		return num_neighs;
-	for (i = 0; i < hash->size; i++) {
-		for (hb = hash->index[i]; hb; hb = hb->next) {
-			nbr = (zebra_neigh_t *)hb->data;
-			if (CHECK_FLAG(nbr->flags, ZEBRA_NEIGH_DUPLICATE))
-				num_neighs++;
-		}
+	frr_each (zvni_neigh_table, &zvni->neigh_table, nbr) {
+		if (CHECK_FLAG(nbr->flags, ZEBRA_NEIGH_DUPLICATE))
+			num_neighs++;
 	}
 
 	return num_neighs;
@@ -703,15 +728,12 @@ static void zebra_vxlan_dup_addr_detect_for_neigh(struct zebra_vrf *zvrf,
  * display - just because we're dealing with IPv6 addresses that can
  * widely vary.
  */
-static void zvni_find_neigh_addr_width(struct hash_bucket *bucket, void *ctxt)
+static void zvni_find_neigh_addr_width(zebra_neigh_t *n, void *ctxt)
 {
-	zebra_neigh_t *n;
 	char buf[INET6_ADDRSTRLEN];
 	struct neigh_walk_ctx *wctx = ctxt;
 	int width;
 
-	n = (zebra_neigh_t *)bucket->data;
-
 	ipaddr2str(&n->ip, buf, sizeof(buf));
 	width = strlen(buf);
 	if (width > wctx->addr_width)
@@ -817,11 +839,10 @@ static void zvni_print_neigh(zebra_neigh_t *n, void *ctxt, json_object *json)
 /*
  * Print neighbor hash entry - called for display of all neighbors.
  */
-static void zvni_print_neigh_hash(struct hash_bucket *bucket, void *ctxt)
+static void zvni_print_neigh_hash(zebra_neigh_t *n, void *ctxt)
 {
 	struct vty *vty;
 	json_object *json_vni = NULL, *json_row = NULL;
-	zebra_neigh_t *n;
 	char buf1[ETHER_ADDR_STRLEN];
 	char buf2[INET6_ADDRSTRLEN];
 	struct neigh_walk_ctx *wctx = ctxt;
@@ -829,7 +850,6 @@ static void zvni_print_neigh_hash(struct hash_bucket *bucket, void *ctxt)
 
 	vty = wctx->vty;
 	json_vni = wctx->json;
-	n = (zebra_neigh_t *)bucket->data;
 
 	if (json_vni)
 		json_row = json_object_new_object();
@@ -913,19 +933,15 @@ static void zvni_print_neigh_hash(struct hash_bucket *bucket, void *ctxt)
 /*
  * Print neighbor hash entry in detail - called for display of all neighbors.
  */
-static void zvni_print_neigh_hash_detail(struct hash_bucket *bucket, void *ctxt)
+static void zvni_print_neigh_hash_detail(zebra_neigh_t *n, void *ctxt)
 {
 	struct vty *vty;
 	json_object *json_vni = NULL, *json_row = NULL;
-	zebra_neigh_t *n;
 	char buf[INET6_ADDRSTRLEN];
 	struct neigh_walk_ctx *wctx = ctxt;
 
 	vty = wctx->vty;
 	json_vni = wctx->json;
-	n = (zebra_neigh_t *)bucket->data;
-	if (!n)
-		return;
 
 	ipaddr2str(&n->ip, buf, sizeof(buf));
 	if (json_vni)
@@ -957,7 +973,7 @@ static void zvni_print_neigh_hash_all_vni(struct hash_bucket *bucket,
 
 	zvni = (zebra_vni_t *)bucket->data;
 
-	num_neigh = hashcount(zvni->neigh_table);
+	num_neigh = zvni_neigh_table_count(&zvni->neigh_table);
 
 	if (print_dup)
 		num_neigh = num_dup_detected_neighs(zvni);
@@ -987,7 +1003,7 @@ static void zvni_print_neigh_hash_all_vni(struct hash_bucket *bucket,
 	wctx.vty = vty;
 	wctx.addr_width = 15;
 	wctx.json = json_vni;
-	hash_iterate(zvni->neigh_table, zvni_find_neigh_addr_width, &wctx);
+	zvni_neigh_walk(zvni, zvni_find_neigh_addr_width, &wctx);
 
 	if (json == NULL) {
 		vty_out(vty, "%*s %-6s %-8s %-17s %-21s %s\n",
@@ -995,38 +1011,24 @@ static void zvni_print_neigh_hash_all_vni(struct hash_bucket *bucket,
 			"State", "MAC", "Remote VTEP", "Seq #'s");
 	}
 	if (print_dup)
-		hash_iterate(zvni->neigh_table, zvni_print_dad_neigh_hash,
-			     &wctx);
+		zvni_neigh_walk(zvni, zvni_print_dad_neigh_hash, &wctx);
 	else
-		hash_iterate(zvni->neigh_table, zvni_print_neigh_hash, &wctx);
+		zvni_neigh_walk(zvni, zvni_print_neigh_hash, &wctx);
 
 	if (json)
 		json_object_object_add(json, vni_str, json_vni);
 }
 
-static void zvni_print_dad_neigh_hash(struct hash_bucket *bucket, void *ctxt)
+static void zvni_print_dad_neigh_hash(zebra_neigh_t *nbr, void *ctxt)
 {
-	zebra_neigh_t *nbr;
-
-	nbr = (zebra_neigh_t *)bucket->data;
-	if (!nbr)
-		return;
-
 	if (CHECK_FLAG(nbr->flags, ZEBRA_NEIGH_DUPLICATE))
-		zvni_print_neigh_hash(bucket, ctxt);
+		zvni_print_neigh_hash(nbr, ctxt);
 }
 
-static void zvni_print_dad_neigh_hash_detail(struct hash_bucket *bucket,
-					     void *ctxt)
+static void zvni_print_dad_neigh_hash_detail(zebra_neigh_t *nbr, void *ctxt)
 {
-	zebra_neigh_t *nbr;
-
-	nbr = (zebra_neigh_t *)bucket->data;
-	if (!nbr)
-		return;
-
 	if (CHECK_FLAG(nbr->flags, ZEBRA_NEIGH_DUPLICATE))
-		zvni_print_neigh_hash_detail(bucket, ctxt);
+		zvni_print_neigh_hash_detail(nbr, ctxt);
 }
 
 /*
@@ -1053,7 +1055,7 @@ static void zvni_print_neigh_hash_all_vni_detail(struct hash_bucket *bucket,
 			vty_out(vty, "{}\n");
 		return;
 	}
-	num_neigh = hashcount(zvni->neigh_table);
+	num_neigh = zvni_neigh_table_count(&zvni->neigh_table);
 
 	if (print_dup && num_dup_detected_neighs(zvni) == 0)
 		return;
@@ -1080,11 +1082,9 @@ static void zvni_print_neigh_hash_all_vni_detail(struct hash_bucket *bucket,
 	wctx.json = json_vni;
 
 	if (print_dup)
-		hash_iterate(zvni->neigh_table,
-			     zvni_print_dad_neigh_hash_detail, &wctx);
+		zvni_neigh_walk(zvni, zvni_print_dad_neigh_hash_detail, &wctx);
 	else
-		hash_iterate(zvni->neigh_table, zvni_print_neigh_hash_detail,
-			     &wctx);
+		zvni_neigh_walk(zvni, zvni_print_neigh_hash_detail, &wctx);
 
 	if (json)
 		json_object_object_add(json, vni_str, json_vni);
@@ -1344,17 +1344,15 @@ static void zvni_print_mac(zebra_mac_t *mac, void *ctxt, json_object *json)
 /*
  * Print MAC hash entry - called for display of all MACs.
  */
-static void zvni_print_mac_hash(struct hash_bucket *bucket, void *ctxt)
+static void zvni_print_mac_hash(zebra_mac_t *mac, void *ctxt)
 {
 	struct vty *vty;
 	json_object *json_mac_hdr = NULL, *json_mac = NULL;
-	zebra_mac_t *mac;
 	char buf1[ETHER_ADDR_STRLEN];
 	struct mac_walk_ctx *wctx = ctxt;
 
 	vty = wctx->vty;
 	json_mac_hdr = wctx->json;
-	mac = (zebra_mac_t *)bucket->data;
 
 	prefix_mac2str(&mac->macaddr, buf1, sizeof(buf1));
 
@@ -1455,34 +1453,24 @@ static void zvni_print_mac_hash(struct hash_bucket *bucket, void *ctxt)
 }
 
 /* Print Duplicate MAC */
-static void zvni_print_dad_mac_hash(struct hash_bucket *bucket, void *ctxt)
+static void zvni_print_dad_mac_hash(zebra_mac_t *mac, void *ctxt)
 {
-	zebra_mac_t *mac;
-
-	mac = (zebra_mac_t *)bucket->data;
-	if (!mac)
-		return;
-
 	if (CHECK_FLAG(mac->flags, ZEBRA_MAC_DUPLICATE))
-		zvni_print_mac_hash(bucket, ctxt);
+		zvni_print_mac_hash(mac, ctxt);
 }
 
 /*
  * Print MAC hash entry in detail - called for display of all MACs.
  */
-static void zvni_print_mac_hash_detail(struct hash_bucket *bucket, void *ctxt)
+static void zvni_print_mac_hash_detail(zebra_mac_t *mac, void *ctxt)
 {
 	struct vty *vty;
 	json_object *json_mac_hdr = NULL;
-	zebra_mac_t *mac;
 	struct mac_walk_ctx *wctx = ctxt;
 	char buf1[ETHER_ADDR_STRLEN];
 
 	vty = wctx->vty;
 	json_mac_hdr = wctx->json;
-	mac = (zebra_mac_t *)bucket->data;
-	if (!mac)
-		return;
 
 	wctx->count++;
 	prefix_mac2str(&mac->macaddr, buf1, sizeof(buf1));
@@ -1491,17 +1479,10 @@ static void zvni_print_mac_hash_detail(struct hash_bucket *bucket, void *ctxt)
 }
 
 /* Print Duplicate MAC in detail */
-static void zvni_print_dad_mac_hash_detail(struct hash_bucket *bucket,
-					   void *ctxt)
+static void zvni_print_dad_mac_hash_detail(zebra_mac_t *mac, void *ctxt)
 {
-	zebra_mac_t *mac;
-
-	mac = (zebra_mac_t *)bucket->data;
-	if (!mac)
-		return;
-
 	if (CHECK_FLAG(mac->flags, ZEBRA_MAC_DUPLICATE))
-		zvni_print_mac_hash_detail(bucket, ctxt);
+		zvni_print_mac_hash_detail(mac, ctxt);
 }
 
 /*
@@ -1563,9 +1544,9 @@ static void zvni_print_mac_hash_all_vni(struct hash_bucket *bucket, void *ctxt)
 	 */
 	wctx->json = json_mac;
 	if (wctx->print_dup)
-		hash_iterate(zvni->mac_table, zvni_print_dad_mac_hash, wctx);
+		zvni_mac_walk(zvni, zvni_print_dad_mac_hash, wctx);
 	else
-		hash_iterate(zvni->mac_table, zvni_print_mac_hash, wctx);
+		zvni_mac_walk(zvni, zvni_print_mac_hash, wctx);
 	wctx->json = json;
 	if (json) {
 		if (wctx->count)
@@ -1628,10 +1609,9 @@ static void zvni_print_mac_hash_all_vni_detail(struct hash_bucket *bucket,
 	 */
 	wctx->json = json_mac;
 	if (wctx->print_dup)
-		hash_iterate(zvni->mac_table, zvni_print_dad_mac_hash_detail,
-			     wctx);
+		zvni_mac_walk(zvni, zvni_print_dad_mac_hash_detail, wctx);
 	else
-		hash_iterate(zvni->mac_table, zvni_print_mac_hash_detail, wctx);
+		zvni_mac_walk(zvni, zvni_print_mac_hash_detail, wctx);
 	wctx->json = json;
 	if (json) {
 		if (wctx->count)
@@ -1881,7 +1861,7 @@ static void zvni_print(zebra_vni_t *zvni, void **ctxt)
 		return;
 	}
 	num_macs = num_valid_macs(zvni);
-	num_neigh = hashcount(zvni->neigh_table);
+	num_neigh = zvni_neigh_table_count(&zvni->neigh_table);
 	if (json == NULL) {
 		vty_out(vty, " VxLAN interface: %s\n", zvni->vxlan_if->name);
 		vty_out(vty, " VxLAN ifIndex: %u\n", zvni->vxlan_if->ifindex);
@@ -2039,7 +2019,7 @@ static void zvni_print_hash(struct hash_bucket *bucket, void *ctxt[])
 	}
 
 	num_macs = num_valid_macs(zvni);
-	num_neigh = hashcount(zvni->neigh_table);
+	num_neigh = zvni_neigh_table_count(&zvni->neigh_table);
 	if (json == NULL)
 		vty_out(vty, "%-10u %-4s %-21s %-8u %-8u %-15u %-37s\n",
 			zvni->vni, "L2",
@@ -2201,34 +2181,18 @@ static int neigh_list_cmp(void *p1, void *p2)
 	return memcmp(&n1->ip, &n2->ip, sizeof(struct ipaddr));
 }
 
-/*
- * Callback to allocate neighbor hash entry.
- */
-static void *zvni_neigh_alloc(void *p)
-{
-	const zebra_neigh_t *tmp_n = p;
-	zebra_neigh_t *n;
-
-	n = XCALLOC(MTYPE_NEIGH, sizeof(zebra_neigh_t));
-	*n = *tmp_n;
-
-	return ((void *)n);
-}
-
 /*
  * Add neighbor entry.
  */
 static zebra_neigh_t *zvni_neigh_add(zebra_vni_t *zvni, struct ipaddr *ip,
 				     struct ethaddr *mac)
 {
-	zebra_neigh_t tmp_n;
 	zebra_neigh_t *n = NULL;
 	zebra_mac_t *zmac = NULL;
 
-	memset(&tmp_n, 0, sizeof(zebra_neigh_t));
-	memcpy(&tmp_n.ip, ip, sizeof(struct ipaddr));
-	n = hash_get(zvni->neigh_table, &tmp_n, zvni_neigh_alloc);
-	assert(n);
+	n = XCALLOC(MTYPE_NEIGH, sizeof(zebra_neigh_t));
+	memcpy(&n->ip, ip, sizeof(struct ipaddr));
+	zvni_neigh_table_add(&zvni->neigh_table, n);
 
 	memcpy(&n->emac, mac, ETH_ALEN);
 	n->state = ZEBRA_NEIGH_INACTIVE;
@@ -2248,7 +2212,6 @@ static zebra_neigh_t *zvni_neigh_add(zebra_vni_t *zvni, struct ipaddr *ip,
  */
 static int zvni_neigh_del(zebra_vni_t *zvni, zebra_neigh_t *n)
 {
-	zebra_neigh_t *tmp_n;
 	zebra_mac_t *zmac = NULL;
 
 	zmac = zvni_mac_lookup(zvni, &n->emac);
@@ -2259,8 +2222,8 @@ static int zvni_neigh_del(zebra_vni_t *zvni, zebra_neigh_t *n)
 	THREAD_OFF(n->dad_ip_auto_recovery_timer);
 
 	/* Free the VNI hash entry and allocated memory. */
-	tmp_n = hash_release(zvni->neigh_table, n);
-	XFREE(MTYPE_NEIGH, tmp_n);
+	zvni_neigh_table_del(&zvni->neigh_table, n);
+	XFREE(MTYPE_NEIGH, n);
 
 	return 0;
 }
@@ -2268,10 +2231,9 @@ static int zvni_neigh_del(zebra_vni_t *zvni, zebra_neigh_t *n)
 /*
  * Free neighbor hash entry (callback)
  */
-static void zvni_neigh_del_hash_entry(struct hash_bucket *bucket, void *arg)
+static void zvni_neigh_del_hash_entry(zebra_neigh_t *n, void *arg)
 {
 	struct neigh_walk_ctx *wctx = arg;
-	zebra_neigh_t *n = bucket->data;
 
 	if (((wctx->flags & DEL_LOCAL_NEIGH) && (n->flags & ZEBRA_NEIGH_LOCAL))
 	    || ((wctx->flags & DEL_REMOTE_NEIGH)
@@ -2300,16 +2262,13 @@ static void zvni_neigh_del_from_vtep(zebra_vni_t *zvni, int uninstall,
 {
 	struct neigh_walk_ctx wctx;
 
-	if (!zvni->neigh_table)
-		return;
-
 	memset(&wctx, 0, sizeof(struct neigh_walk_ctx));
 	wctx.zvni = zvni;
 	wctx.uninstall = uninstall;
 	wctx.flags = DEL_REMOTE_NEIGH_FROM_VTEP;
 	wctx.r_vtep_ip = *r_vtep_ip;
 
-	hash_iterate(zvni->neigh_table, zvni_neigh_del_hash_entry, &wctx);
+	zvni_neigh_walk(zvni, zvni_neigh_del_hash_entry, &wctx);
 }
 
 /*
@@ -2320,16 +2279,13 @@ static void zvni_neigh_del_all(zebra_vni_t *zvni, int uninstall, int upd_client,
 {
 	struct neigh_walk_ctx wctx;
 
-	if (!zvni->neigh_table)
-		return;
-
 	memset(&wctx, 0, sizeof(struct neigh_walk_ctx));
 	wctx.zvni = zvni;
 	wctx.uninstall = uninstall;
 	wctx.upd_client = upd_client;
 	wctx.flags = flags;
 
-	hash_iterate(zvni->neigh_table, zvni_neigh_del_hash_entry, &wctx);
+	zvni_neigh_walk(zvni, zvni_neigh_del_hash_entry, &wctx);
 }
 
 /*
@@ -2342,7 +2298,7 @@ static zebra_neigh_t *zvni_neigh_lookup(zebra_vni_t *zvni, struct ipaddr *ip)
 
 	memset(&tmp, 0, sizeof(tmp));
 	memcpy(&tmp.ip, ip, sizeof(struct ipaddr));
-	n = hash_lookup(zvni->neigh_table, &tmp);
+	n = zvni_neigh_table_find(&zvni->neigh_table, &tmp);
 
 	return n;
 }
@@ -2601,13 +2557,10 @@ static int zvni_neigh_probe(zebra_vni_t *zvni, zebra_neigh_t *n)
 /*
  * Install neighbor hash entry - called upon access VLAN change.
  */
-static void zvni_install_neigh_hash(struct hash_bucket *bucket, void *ctxt)
+static void zvni_install_neigh_hash(zebra_neigh_t *n, void *ctxt)
 {
-	zebra_neigh_t *n;
 	struct neigh_walk_ctx *wctx = ctxt;
 
-	n = (zebra_neigh_t *)bucket->data;
-
 	if (CHECK_FLAG(n->flags, ZEBRA_NEIGH_REMOTE))
 		zvni_neigh_install(wctx->zvni, n);
 }
@@ -3364,32 +3317,16 @@ static bool mac_cmp(const void *p1, const void *p2)
 		== 0);
 }
 
-/*
- * Callback to allocate MAC hash entry.
- */
-static void *zvni_mac_alloc(void *p)
-{
-	const zebra_mac_t *tmp_mac = p;
-	zebra_mac_t *mac;
-
-	mac = XCALLOC(MTYPE_MAC, sizeof(zebra_mac_t));
-	*mac = *tmp_mac;
-
-	return ((void *)mac);
-}
-
 /*
  * Add MAC entry.
  */
 static zebra_mac_t *zvni_mac_add(zebra_vni_t *zvni, struct ethaddr *macaddr)
 {
-	zebra_mac_t tmp_mac;
 	zebra_mac_t *mac = NULL;
 
-	memset(&tmp_mac, 0, sizeof(zebra_mac_t));
-	memcpy(&tmp_mac.macaddr, macaddr, ETH_ALEN);
-	mac = hash_get(zvni->mac_table, &tmp_mac, zvni_mac_alloc);
-	assert(mac);
+	mac = XCALLOC(MTYPE_MAC, sizeof(zebra_mac_t));
+	memcpy(&mac->macaddr, macaddr, ETH_ALEN);
+	zvni_mac_table_add(&zvni->mac_table, mac);
 
 	mac->zvni = zvni;
 	mac->dad_mac_auto_recovery_timer = NULL;
@@ -3405,16 +3342,14 @@ static zebra_mac_t *zvni_mac_add(zebra_vni_t *zvni, struct ethaddr *macaddr)
  */
 static int zvni_mac_del(zebra_vni_t *zvni, zebra_mac_t *mac)
 {
-	zebra_mac_t *tmp_mac;
-
 	/* Cancel auto recovery */
 	THREAD_OFF(mac->dad_mac_auto_recovery_timer);
 
 	list_delete(&mac->neigh_list);
 
 	/* Free the VNI hash entry and allocated memory. */
-	tmp_mac = hash_release(zvni->mac_table, mac);
-	XFREE(MTYPE_MAC, tmp_mac);
+	zvni_mac_table_del(&zvni->mac_table, mac);
+	XFREE(MTYPE_MAC, mac);
 
 	return 0;
 }
@@ -3455,10 +3390,9 @@ static bool zvni_check_mac_del_from_db(struct mac_walk_ctx *wctx,
 /*
  * Free MAC hash entry (callback)
  */
-static void zvni_mac_del_hash_entry(struct hash_bucket *bucket, void *arg)
+static void zvni_mac_del_hash_entry(zebra_mac_t *mac, void *arg)
 {
 	struct mac_walk_ctx *wctx = arg;
-	zebra_mac_t *mac = bucket->data;
 
 	if (zvni_check_mac_del_from_db(wctx, mac)) {
 		if (wctx->upd_client && (mac->flags & ZEBRA_MAC_LOCAL)) {
@@ -3482,16 +3416,13 @@ static void zvni_mac_del_from_vtep(zebra_vni_t *zvni, int uninstall,
 {
 	struct mac_walk_ctx wctx;
 
-	if (!zvni->mac_table)
-		return;
-
 	memset(&wctx, 0, sizeof(struct mac_walk_ctx));
 	wctx.zvni = zvni;
 	wctx.uninstall = uninstall;
 	wctx.flags = DEL_REMOTE_MAC_FROM_VTEP;
 	wctx.r_vtep_ip = *r_vtep_ip;
 
-	hash_iterate(zvni->mac_table, zvni_mac_del_hash_entry, &wctx);
+	zvni_mac_walk(zvni, zvni_mac_del_hash_entry, &wctx);
 }
 
 /*
@@ -3502,16 +3433,13 @@ static void zvni_mac_del_all(zebra_vni_t *zvni, int uninstall, int upd_client,
 {
 	struct mac_walk_ctx wctx;
 
-	if (!zvni->mac_table)
-		return;
-
 	memset(&wctx, 0, sizeof(struct mac_walk_ctx));
 	wctx.zvni = zvni;
 	wctx.uninstall = uninstall;
 	wctx.upd_client = upd_client;
 	wctx.flags = flags;
 
-	hash_iterate(zvni->mac_table, zvni_mac_del_hash_entry, &wctx);
+	zvni_mac_walk(zvni, zvni_mac_del_hash_entry, &wctx);
 }
 
 /*
@@ -3524,7 +3452,7 @@ static zebra_mac_t *zvni_mac_lookup(zebra_vni_t *zvni, struct ethaddr *mac)
 
 	memset(&tmp, 0, sizeof(tmp));
 	memcpy(&tmp.macaddr, mac, ETH_ALEN);
-	pmac = hash_lookup(zvni->mac_table, &tmp);
+	pmac = zvni_mac_table_find(&zvni->mac_table, &tmp);
 
 	return pmac;
 }
@@ -3830,13 +3758,10 @@ static int zvni_mac_uninstall(zebra_vni_t *zvni, zebra_mac_t *mac)
 /*
  * Install MAC hash entry - called upon access VLAN change.
  */
-static void zvni_install_mac_hash(struct hash_bucket *bucket, void *ctxt)
+static void zvni_install_mac_hash(zebra_mac_t *mac, void *ctxt)
 {
-	zebra_mac_t *mac;
 	struct mac_walk_ctx *wctx = ctxt;
 
-	mac = (zebra_mac_t *)bucket->data;
-
 	if (CHECK_FLAG(mac->flags, ZEBRA_MAC_REMOTE))
 		zvni_mac_install(wctx->zvni, mac);
 }
@@ -3997,12 +3922,10 @@ static zebra_vni_t *zvni_add(vni_t vni)
 	assert(zvni);
 
 	/* Create hash table for MAC */
-	zvni->mac_table =
-		hash_create(mac_hash_keymake, mac_cmp, "Zebra VNI MAC Table");
+	zvni_mac_table_init(&zvni->mac_table);
 
 	/* Create hash table for neighbors */
-	zvni->neigh_table = hash_create(neigh_hash_keymake, neigh_cmp,
-					"Zebra VNI Neighbor Table");
+	zvni_neigh_table_init(&zvni->neigh_table);
 
 	return zvni;
 }
@@ -4014,6 +3937,8 @@ static int zvni_del(zebra_vni_t *zvni)
 {
 	struct zebra_vrf *zvrf;
 	zebra_vni_t *tmp_zvni;
+	zebra_neigh_t *n;
+	zebra_mac_t *mac;
 
 	zvrf = zebra_vrf_get_evpn();
 	assert(zvrf);
@@ -4023,13 +3948,17 @@ static int zvni_del(zebra_vni_t *zvni)
 	/* Remove references to the BUM mcast grp */
 	zebra_vxlan_sg_deref(zvni->local_vtep_ip, zvni->mcast_grp);
 
-	/* Free the neighbor hash table. */
-	hash_free(zvni->neigh_table);
-	zvni->neigh_table = NULL;
+	/* Free the neighbors and MACs the callers did not delete, the
+	 * tables must be empty when they are freed.  Neighbors go first as
+	 * they are on their MAC's list.
+	 */
+	while ((n = zvni_neigh_table_first(&zvni->neigh_table)))
+		zvni_neigh_del(zvni, n);
+	zvni_neigh_table_fini(&zvni->neigh_table);
 
-	/* Free the MAC hash table. */
-	hash_free(zvni->mac_table);
-	zvni->mac_table = NULL;
+	while ((mac = zvni_mac_table_first(&zvni->mac_table)))
+		zvni_mac_del(zvni, mac);
+	zvni_mac_table_fini(&zvni->mac_table);
 
 	/* Free the VNI hash entry and allocated memory. */
 	tmp_zvni = hash_release(zvrf->vni_table, zvni);
@@ -6250,7 +6179,7 @@ void zebra_vxlan_print_neigh_vni(struct vty *vty, struct zebra_vrf *zvrf,
 			vty_out(vty, "%% VNI %u does not exist\n", vni);
 		return;
 	}
-	num_neigh = hashcount(zvni->neigh_table);
+	num_neigh = zvni_neigh_table_count(&zvni->neigh_table);
 	if (!num_neigh)
 		return;
 
@@ -6266,7 +6195,7 @@ void zebra_vxlan_print_neigh_vni(struct vty *vty, struct zebra_vrf *zvrf,
 	wctx.vty = vty;
 	wctx.addr_width = 15;
 	wctx.json = json;
-	hash_iterate(zvni->neigh_table, zvni_find_neigh_addr_width, &wctx);
+	zvni_neigh_walk(zvni, zvni_find_neigh_addr_width, &wctx);
 
 	if (!use_json) {
 		vty_out(vty,
@@ -6277,7 +6206,7 @@ void zebra_vxlan_print_neigh_vni(struct vty *vty, struct zebra_vrf *zvrf,
 	} else
 		json_object_int_add(json, "numArpNd", num_neigh);
 
-	hash_iterate(zvni->neigh_table, zvni_print_neigh_hash, &wctx);
+	zvni_neigh_walk(zvni, zvni_print_neigh_hash, &wctx);
 	if (use_json) {
 		vty_out(vty, "%s\n", json_object_to_json_string_ext(
 					     json, JSON_C_TO_STRING_PRETTY));
@@ -6410,7 +6339,7 @@ void zebra_vxlan_print_neigh_vni_vtep(struct vty *vty, struct zebra_vrf *zvrf,
 			vty_out(vty, "%% VNI %u does not exist\n", vni);
 		return;
 	}
-	num_neigh = hashcount(zvni->neigh_table);
+	num_neigh = zvni_neigh_table_count(&zvni->neigh_table);
 	if (!num_neigh)
 		return;
 
@@ -6421,8 +6350,8 @@ void zebra_vxlan_print_neigh_vni_vtep(struct vty *vty, struct zebra_vrf *zvrf,
 	wctx.flags = SHOW_REMOTE_NEIGH_FROM_VTEP;
 	wctx.r_vtep_ip = vtep_ip;
 	wctx.json = json;
-	hash_iterate(zvni->neigh_table, zvni_find_neigh_addr_width, &wctx);
-	hash_iterate(zvni->neigh_table, zvni_print_neigh_hash, &wctx);
+	zvni_neigh_walk(zvni, zvni_find_neigh_addr_width, &wctx);
+	zvni_neigh_walk(zvni, zvni_print_neigh_hash, &wctx);
 
 	if (use_json) {
 		vty_out(vty, "%s\n", json_object_to_json_string_ext(
@@ -6454,7 +6383,7 @@ void zebra_vxlan_print_neigh_vni_dad(struct vty *vty,
 		return;
 	}
 
-	num_neigh = hashcount(zvni->neigh_table);
+	num_neigh = zvni_neigh_table_count(&zvni->neigh_table);
 	if (!num_neigh)
 		return;
 
@@ -6474,7 +6403,7 @@ void zebra_vxlan_print_neigh_vni_dad(struct vty *vty,
 	wctx.vty = vty;
 	wctx.addr_width = 15;
 	wctx.json = json;
-	hash_iterate(zvni->neigh_table, zvni_find_neigh_addr_width, &wctx);
+	zvni_neigh_walk(zvni, zvni_find_neigh_addr_width, &wctx);
 
 	if (!use_json) {
 		vty_out(vty,
@@ -6486,7 +6415,7 @@ void zebra_vxlan_print_neigh_vni_dad(struct vty *vty,
 	} else
 		json_object_int_add(json, "numArpNd", num_neigh);
 
-	hash_iterate(zvni->neigh_table, zvni_print_dad_neigh_hash, &wctx);
+	zvni_neigh_walk(zvni, zvni_print_dad_neigh_hash, &wctx);
 
 	if (use_json) {
 		vty_out(vty, "%s\n", json_object_to_json_string_ext(
@@ -6540,7 +6469,7 @@ void zebra_vxlan_print_macs_vni(struct vty *vty, struct zebra_vrf *zvrf,
 	} else
 		json_object_int_add(json, "numMacs", num_macs);
 
-	hash_iterate(zvni->mac_table, zvni_print_mac_hash, &wctx);
+	zvni_mac_walk(zvni, zvni_print_mac_hash, &wctx);
 
 	if (use_json) {
 		json_object_object_add(json, "macs", json_mac);
@@ -6733,7 +6662,7 @@ void zebra_vxlan_print_macs_vni_dad(struct vty *vty,
 	} else
 		json_object_int_add(json, "numMacs", num_macs);
 
-	hash_iterate(zvni->mac_table, zvni_print_dad_mac_hash, &wctx);
+	zvni_mac_walk(zvni, zvni_print_dad_mac_hash, &wctx);
 
 	if (use_json) {
 		json_object_object_add(json, "macs", json_mac);
@@ -6898,18 +6827,13 @@ int zebra_vxlan_clear_dup_detect_vni_ip(struct vty *vty,
 	return CMD_SUCCESS;
 }
 
-static void zvni_clear_dup_mac_hash(struct hash_bucket *bucket, void *ctxt)
+static void zvni_clear_dup_mac_hash(zebra_mac_t *mac, void *ctxt)
 {
 	struct mac_walk_ctx *wctx = ctxt;
-	zebra_mac_t *mac;
 	zebra_vni_t *zvni;
 	struct listnode *node = NULL;
 	zebra_neigh_t *nbr = NULL;
 
-	mac = (zebra_mac_t *)bucket->data;
-	if (!mac)
-		return;
-
 	zvni = wctx->zvni;
 
 	if (!CHECK_FLAG(mac->flags, ZEBRA_MAC_DUPLICATE))
@@ -6953,17 +6877,12 @@ static void zvni_clear_dup_mac_hash(struct hash_bucket *bucket, void *ctxt)
 	}
 }
 
-static void zvni_clear_dup_neigh_hash(struct hash_bucket *bucket, void *ctxt)
+static void zvni_clear_dup_neigh_hash(zebra_neigh_t *nbr, void *ctxt)
 {
 	struct neigh_walk_ctx *wctx = ctxt;
-	zebra_neigh_t *nbr;
 	zebra_vni_t *zvni;
 	char buf[INET6_ADDRSTRLEN];
 
-	nbr = (zebra_neigh_t *)bucket->data;
-	if (!nbr)
-		return;
-
 	zvni = wctx->zvni;
 
 	if (!CHECK_FLAG(nbr->flags, ZEBRA_NEIGH_DUPLICATE))
@@ -7009,13 +6928,12 @@ static void zvni_clear_dup_detect_hash_vni_all(struct hash_bucket *bucket,
 	vty = (struct vty *)args[0];
 	zvrf = (struct zebra_vrf *)args[1];
 
-	if (hashcount(zvni->neigh_table)) {
+	if (zvni_neigh_table_count(&zvni->neigh_table)) {
 		memset(&n_wctx, 0, sizeof(struct neigh_walk_ctx));
 		n_wctx.vty = vty;
 		n_wctx.zvni = zvni;
 		n_wctx.zvrf = zvrf;
-		hash_iterate(zvni->neigh_table, zvni_clear_dup_neigh_hash,
-			     &n_wctx);
+		zvni_neigh_walk(zvni, zvni_clear_dup_neigh_hash, &n_wctx);
 	}
 
 	if (num_valid_macs(zvni)) {
@@ -7023,7 +6941,7 @@ static void zvni_clear_dup_detect_hash_vni_all(struct hash_bucket *bucket,
 		m_wctx.zvni = zvni;
 		m_wctx.vty = vty;
 		m_wctx.zvrf = zvrf;
-		hash_iterate(zvni->mac_table, zvni_clear_dup_mac_hash, &m_wctx);
+		zvni_mac_walk(zvni, zvni_clear_dup_mac_hash, &m_wctx);
 	}
 
 }
@@ -7063,13 +6981,12 @@ int  zebra_vxlan_clear_dup_detect_vni(struct vty *vty,
 		return CMD_WARNING;
 	}
 
-	if (hashcount(zvni->neigh_table)) {
+	if (zvni_neigh_table_count(&zvni->neigh_table)) {
 		memset(&n_wctx, 0, sizeof(struct neigh_walk_ctx));
 		n_wctx.vty = vty;
 		n_wctx.zvni = zvni;
 		n_wctx.zvrf = zvrf;
-		hash_iterate(zvni->neigh_table, zvni_clear_dup_neigh_hash,
-			     &n_wctx);
+		zvni_neigh_walk(zvni, zvni_clear_dup_neigh_hash, &n_wctx);
 	}
 
 	if (num_valid_macs(zvni)) {
@@ -7077,7 +6994,7 @@ int  zebra_vxlan_clear_dup_detect_vni(struct vty *vty,
 		m_wctx.zvni = zvni;
 		m_wctx.vty = vty;
 		m_wctx.zvrf = zvrf;
-		hash_iterate(zvni->mac_table, zvni_clear_dup_mac_hash, &m_wctx);
+		zvni_mac_walk(zvni, zvni_clear_dup_mac_hash, &m_wctx);
 	}
 
 	return CMD_SUCCESS;
@@ -7121,7 +7038,7 @@ void zebra_vxlan_print_macs_vni_vtep(struct vty *vty, struct zebra_vrf *zvrf,
 	wctx.flags = SHOW_REMOTE_MAC_FROM_VTEP;
 	wctx.r_vtep_ip = vtep_ip;
 	wctx.json = json_mac;
-	hash_iterate(zvni->mac_table, zvni_print_mac_hash, &wctx);
+	zvni_mac_walk(zvni, zvni_print_mac_hash, &wctx);
 
 	if (use_json) {
 		json_object_int_add(json, "numMacs", wctx.count);
@@ -8411,8 +8328,7 @@ int zebra_vxlan_svi_up(struct interface *ifp, struct interface *link_if)
 		/* Install any remote neighbors for this VNI. */
 		memset(&n_wctx, 0, sizeof(struct neigh_walk_ctx));
 		n_wctx.zvni = zvni;
-		hash_iterate(zvni->neigh_table, zvni_install_neigh_hash,
-			     &n_wctx);
+		zvni_neigh_walk(zvni, zvni_install_neigh_hash, &n_wctx);
 	}
 
 	return 0;
@@ -8776,13 +8692,11 @@ int zebra_vxlan_if_update(struct interface *ifp, uint16_t chgflags)
 
 			memset(&m_wctx, 0, sizeof(struct mac_walk_ctx));
 			m_wctx.zvni = zvni;
-			hash_iterate(zvni->mac_table, zvni_install_mac_hash,
-				     &m_wctx);
+			zvni_mac_walk(zvni, zvni_install_mac_hash, &m_wctx);
 
 			memset(&n_wctx, 0, sizeof(struct neigh_walk_ctx));
 			n_wctx.zvni = zvni;
-			hash_iterate(zvni->neigh_table, zvni_install_neigh_hash,
-				     &n_wctx);
+			zvni_neigh_walk(zvni, zvni_install_neigh_hash, &n_wctx);
 		}
 	}
 
@@ -9437,9 +9351,11 @@ void zebra_vxlan_init_tables(struct zebra_vrf *zvrf)
 {
 	if (!zvrf)
 		return;
-	zvrf->vni_table = hash_create(vni_hash_keymake, vni_hash_cmp,
-				      "Zebra VRF VNI Table");
-	zvrf->vxlan_sg_table = hash_create(zebra_vxlan_sg_hash_key_make,
+	/* Start small, only the EVPN instance holds VNIs; the hashes grow */
+	zvrf->vni_table = hash_create_size(8, vni_hash_keymake, vni_hash_cmp,
+					   "Zebra VRF VNI Table");
+	zvrf->vxlan_sg_table = hash_create_size(8,
+			zebra_vxlan_sg_hash_key_make,
 			zebra_vxlan_sg_hash_eq, "Zebra VxLAN SG Table");
 }
 
@@ -9861,11 +9777,9 @@ void zebra_vxlan_sg_replay(ZAPI_HANDLER_ARGS)
 
 /************************** EVPN BGP config management ************************/
 /* Notify Local MACs to the clienti, skips GW MAC */
-static void zvni_send_mac_hash_entry_to_client(struct hash_bucket *bucket,
-					       void *arg)
+static void zvni_send_mac_hash_entry_to_client(zebra_mac_t *zmac, void *arg)
 {
 	struct mac_walk_ctx *wctx = arg;
-	zebra_mac_t *zmac = bucket->data;
 
 	if (CHECK_FLAG(zmac->flags, ZEBRA_MAC_DEF_GW))
 		return;
@@ -9880,22 +9794,16 @@ static void zvni_send_mac_to_client(zebra_vni_t *zvni)
 {
 	struct mac_walk_ctx wctx;
 
-	if (!zvni->mac_table)
-		return;
-
 	memset(&wctx, 0, sizeof(struct mac_walk_ctx));
 	wctx.zvni = zvni;
 
-	hash_iterate(zvni->mac_table, zvni_send_mac_hash_entry_to_client,
-			&wctx);
+	zvni_mac_walk(zvni, zvni_send_mac_hash_entry_to_client, &wctx);
 }
 
 /* Notify Neighbor entries to the Client, skips the GW entry */
-static void zvni_send_neigh_hash_entry_to_client(struct hash_bucket *bucket,
-						 void *arg)
+static void zvni_send_neigh_hash_entry_to_client(zebra_neigh_t *zn, void *arg)
 {
 	struct mac_walk_ctx *wctx = arg;
-	zebra_neigh_t *zn = bucket->data;
 	zebra_mac_t *zmac = NULL;
 
 	if (CHECK_FLAG(zn->flags, ZEBRA_NEIGH_DEF_GW))
@@ -9921,8 +9829,7 @@ static void zvni_send_neigh_to_client(zebra_vni_t *zvni)
 	memset(&wctx, 0, sizeof(struct neigh_walk_ctx));
 	wctx.zvni = zvni;
 
-	hash_iterate(zvni->neigh_table, zvni_send_neigh_hash_entry_to_client,
-			&wctx);
+	zvni_neigh_walk(zvni, zvni_send_neigh_hash_entry_to_client, &wctx);
 }
 
 static void zvni_evpn_cfg_cleanup(struct hash_bucket *bucket, void *ctxt)
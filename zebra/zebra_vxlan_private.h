@@ -28,6 +28,7 @@
 
 #include "if.h"
 #include "linklist.h"
+#include "typesafe.h"
 #include "zebra_vxlan.h"
 
 #ifdef __cplusplus
@@ -43,6 +44,12 @@ typedef struct zebra_mac_t_ zebra_mac_t;
 typedef struct zebra_neigh_t_ zebra_neigh_t;
 typedef struct zebra_l3vni_t_ zebra_l3vni_t;
 
+/* Per-VNI MAC and neighbor tables; the hash items are embedded in the
+ * entries, so a lookup does not chase a separate bucket allocation.
+ */
+PREDECL_HASH(zvni_mac_table)
+PREDECL_HASH(zvni_neigh_table)
+
 /*
  * VTEP info
  *
@@ -98,10 +105,10 @@ struct zebra_vni_t_ {
 	vrf_id_t vrf_id;
 
 	/* List of local or remote MAC */
-	struct hash *mac_table;
+	struct zvni_mac_table_head mac_table;
 
 	/* List of local or remote neighbors (MAC+IP) */
-	struct hash *neigh_table;
+	struct zvni_neigh_table_head neigh_table;
 };
 
 /* L3 VNI hash table */
@@ -252,6 +259,9 @@ struct zebra_mac_t_ {
 	/* MAC address. */
 	struct ethaddr macaddr;
 
+	/* Entry in the VNI's MAC table */
+	struct zvni_mac_table_item item;
+
 	uint32_t flags;
 #define ZEBRA_MAC_LOCAL   0x01
 #define ZEBRA_MAC_REMOTE  0x02
@@ -348,6 +358,9 @@ struct zebra_neigh_t_ {
 	/* IP address. */
 	struct ipaddr ip;
 
+	/* Entry in the VNI's neighbor table */
+	struct zvni_neigh_table_item item;
+
 	/* MAC address. */
 	struct ethaddr emac;
 
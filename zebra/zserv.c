@@ -54,6 +54,7 @@
 #include "lib/zclient.h"          /* for zmsghdr, ZEBRA_HEADER_SIZE, ZEBRA... */
 #include "lib/frr_pthread.h"      /* for frr_pthread_new, frr_pthread_stop... */
 #include "lib/frratomic.h"        /* for atomic_load_explicit, atomic_stor... */
+#include "lib/jhash.h"            /* for jhash */
 #include "lib/lib_errors.h"       /* for generic ferr ids */
 
 #include "zebra/debug.h"          /* for various debugging macros */
@@ -63,6 +64,7 @@
 #include "zebra/zserv.h"          /* for zserv */
 #include "zebra/zebra_router.h"
 #include "zebra/zebra_errors.h"   /* for error messages */
+#include "zebra/zebra_memory.h"   /* for MTYPE_ZEBRA */
 /* clang-format on */
 
 /* privileges */
@@ -71,6 +73,39 @@ extern struct zebra_privs_t zserv_privs;
 /* The listener socket for clients connecting to us */
 static int zsock;
 
+DEFINE_MTYPE_STATIC(ZEBRA, ZSERV_COALESCE, "ZAPI output coalescing")
+
+/* A message on a congested client's output queue that may be superseded */
+struct zserv_coalesce_entry {
+	struct zserv_coalesce_key key;
+	struct stream *msg;
+
+	struct zserv_coalesce_item item;
+};
+
+static int zserv_coalesce_cmp(const struct zserv_coalesce_entry *e1,
+			      const struct zserv_coalesce_entry *e2)
+{
+	return memcmp(&e1->key, &e2->key, sizeof(e1->key));
+}
+
+static uint32_t zserv_coalesce_hash(const struct zserv_coalesce_entry *e)
+{
+	return jhash(&e->key, sizeof(e->key), 0x5a9c0a1e);
+}
+
+DECLARE_HASH(zserv_coalesce, struct zserv_coalesce_entry, item,
+	     zserv_coalesce_cmp, zserv_coalesce_hash)
+
+/* Forget the queued messages, they have been taken off obuf_fifo */
+static void zserv_coalesce_flush(struct zserv *client)
+{
+	struct zserv_coalesce_entry *entry;
+
+	while ((entry = zserv_coalesce_pop(&client->obuf_coalesce)))
+		XFREE(MTYPE_ZSERV_COALESCE, entry);
+}
+
 /*
  * Client thread events.
  *
@@ -213,7 +248,10 @@ static int zserv_write(struct thread *thread)
 	struct zserv *client = THREAD_ARG(thread);
 	struct stream *msg;
 	uint32_t wcmd = 0;
+	uint32_t redist = 0;
+	uint16_t cmd;
 	struct stream_fifo *cache;
+	int64_t latency;
 
 	/* If we have any data pending, try to flush it first */
 	switch (buffer_flush_all(client->wb, client->sock)) {
@@ -232,25 +270,46 @@ static int zserv_write(struct thread *thread)
 	cache = stream_fifo_new();
 
 	frr_with_mutex(&client->obuf_mtx) {
+		if (stream_fifo_head(client->obuf_fifo)) {
+			latency = monotime_since(&client->obuf_head_time, NULL);
+			if (latency > client->obuf_latency_max)
+				client->obuf_latency_max = latency;
+		}
+
 		while (stream_fifo_head(client->obuf_fifo))
 			stream_fifo_push(cache,
 					 stream_fifo_pop(client->obuf_fifo));
-	}
 
-	if (cache->tail) {
-		msg = cache->tail;
-		stream_set_getp(msg, 0);
-		wcmd = stream_getw_from(msg, ZAPI_HEADER_CMD_LOCATION);
+		client->wb_bytes = client->obuf_bytes;
+		client->obuf_bytes = 0;
+		zserv_coalesce_flush(client);
+		client->obuf_run_cmd = 0;
 	}
 
 	while (stream_fifo_head(cache)) {
 		msg = stream_fifo_pop(cache);
+
+		/* Superseded while queued */
+		if (!stream_get_endp(msg)) {
+			stream_free(msg);
+			continue;
+		}
+
+		cmd = stream_getw_from(msg, ZAPI_HEADER_CMD_LOCATION);
+		wcmd = cmd;
+		if (cmd == ZEBRA_REDISTRIBUTE_ROUTE_ADD
+		    || cmd == ZEBRA_REDISTRIBUTE_ROUTE_DEL)
+			redist++;
 		buffer_put(client->wb, STREAM_DATA(msg), stream_get_endp(msg));
 		stream_free(msg);
 	}
 
 	stream_fifo_free(cache);
 
+	if (redist)
+		atomic_fetch_sub_explicit(&client->redist_backlog, redist,
+					  memory_order_relaxed);
+
 	/* If we have any data pending, try to flush it first */
 	switch (buffer_flush_all(client->wb, client->sock)) {
 	case BUFFER_ERROR:
@@ -265,6 +324,22 @@ static int zserv_write(struct thread *thread)
 		break;
 	}
 
+	frr_with_mutex(&client->obuf_mtx) {
+		client->wb_bytes = 0;
+		if (client->obuf_congested
+		    && client->obuf_bytes
+			       < atomic_load_explicit(
+					 &zrouter.obuf_low_watermark,
+					 memory_order_relaxed)
+					 * 1024) {
+			client->obuf_congested = false;
+			if (IS_ZEBRA_DEBUG_EVENT)
+				zlog_debug("%s: client %s caught up",
+					   __func__,
+					   zebra_route_string(client->proto));
+		}
+	}
+
 	atomic_store_explicit(&client->last_write_cmd, wcmd,
 			      memory_order_relaxed);
 
@@ -527,17 +602,153 @@ static int zserv_process_messages(struct thread *thread)
 	return 0;
 }
 
-int zserv_send_message(struct zserv *client, struct stream *msg)
+/*
+ * Replace 'old', still on the output queue, with 'msg'. The message is copied
+ * into 'old' when it fits, otherwise 'old' is emptied and 'msg' is queued
+ * after all; that keeps it within the run of 'old'. Returns whether 'msg' was
+ * queued. Called with obuf_mtx held.
+ */
+static bool zserv_obuf_replace(struct zserv *client, struct stream *old,
+			       struct stream *msg)
 {
+	stream_reset(old);
+
+	if (STREAM_SIZE(old) >= stream_get_endp(msg)) {
+		stream_put(old, STREAM_DATA(msg), stream_get_endp(msg));
+		return false;
+	}
+
+	/* The emptied stream is still held until the writer drops it */
+	stream_fifo_push(client->obuf_fifo, msg);
+	client->obuf_bytes += STREAM_SIZE(msg);
+	return true;
+}
+
+/*
+ * Close a client that has more queued than the limit; it is not reading.
+ * Called with obuf_mtx held.
+ */
+static void zserv_obuf_overflow(struct zserv *client, size_t queued)
+{
+	client->obuf_overflow = true;
+
+	flog_warn(EC_ZEBRA_CLIENT_WRITE_FAILED,
+		  "Client '%s' is not reading, %zu bytes queued for it, closing it",
+		  zebra_route_string(client->proto), queued);
+}
+
+int zserv_send_message_coalesce(struct zserv *client, struct stream *msg,
+				const struct zserv_coalesce_key *key)
+{
+	struct zserv_coalesce_entry *entry = NULL, lookup;
+	bool superseded = false, queued = true, overflow = false;
+	size_t high, limit, size;
+
 	frr_with_mutex(&client->obuf_mtx) {
-		stream_fifo_push(client->obuf_fifo, msg);
+		/* Nothing more is queued for a client that is being closed */
+		if (client->obuf_overflow) {
+			queued = false;
+			break;
+		}
+
+		/*
+		 * Only a message of the run at the tail of the queue is
+		 * replaced, so it is not moved past messages of another kind.
+		 */
+		if (key && client->obuf_congested
+		    && key->cmd == client->obuf_run_cmd) {
+			lookup.key = *key;
+			entry = zserv_coalesce_find(&client->obuf_coalesce,
+						    &lookup);
+		}
+
+		if (entry) {
+			queued = zserv_obuf_replace(client, entry->msg, msg);
+			if (queued)
+				entry->msg = msg;
+			superseded = true;
+			client->obuf_coalesced++;
+		} else {
+			limit = atomic_load_explicit(&zrouter.obuf_limit,
+						     memory_order_relaxed)
+				* 1024;
+			size = client->obuf_bytes + client->wb_bytes;
+			if (size + stream_get_endp(msg) > limit) {
+				zserv_obuf_overflow(client, size);
+				overflow = true;
+				queued = false;
+				break;
+			}
+
+			/* Don't hold on to a message's unused space */
+			if (client->obuf_congested
+			    && STREAM_SIZE(msg) > stream_get_endp(msg))
+				stream_resize_inplace(&msg,
+						      stream_get_endp(msg));
+
+			if (!stream_fifo_head(client->obuf_fifo))
+				monotime(&client->obuf_head_time);
+			stream_fifo_push(client->obuf_fifo, msg);
+			client->obuf_bytes += STREAM_SIZE(msg);
+
+			/* Another kind of message ends the run */
+			if (!key || key->cmd != client->obuf_run_cmd) {
+				zserv_coalesce_flush(client);
+				client->obuf_run_cmd = key ? key->cmd : 0;
+			}
+
+			if (key && client->obuf_congested) {
+				entry = XCALLOC(MTYPE_ZSERV_COALESCE,
+						sizeof(*entry));
+				entry->key = *key;
+				entry->msg = msg;
+				zserv_coalesce_add(&client->obuf_coalesce,
+						   entry);
+			}
+		}
+
+		size = client->obuf_bytes + client->wb_bytes;
+		if (size > client->obuf_bytes_max)
+			client->obuf_bytes_max = size;
+
+		high = atomic_load_explicit(&zrouter.obuf_high_watermark,
+					    memory_order_relaxed)
+		       * 1024;
+		if (!client->obuf_congested && size > high) {
+			client->obuf_congested = true;
+			client->obuf_congested_cnt++;
+			if (IS_ZEBRA_DEBUG_EVENT)
+				zlog_debug("%s: client %s is congested, %zu bytes queued",
+					   __func__,
+					   zebra_route_string(client->proto),
+					   size);
+		}
 	}
 
-	zserv_client_event(client, ZSERV_CLIENT_WRITE);
+	/*
+	 * Only one of the two redistributed routes will be written out, and
+	 * none once the client is being closed.
+	 */
+	if ((superseded || !queued) && key
+	    && key->cmd == ZEBRA_REDISTRIBUTE_ROUTE_ADD)
+		atomic_fetch_sub_explicit(&client->redist_backlog, 1,
+					  memory_order_relaxed);
+	if (!queued)
+		stream_free(msg);
+
+	if (overflow)
+		zserv_event(client, ZSERV_HANDLE_CLIENT_FAIL);
+	else if (queued || superseded)
+		zserv_client_event(client, ZSERV_CLIENT_WRITE);
 
 	return 0;
 }
 
+int zserv_send_message(struct zserv *client, struct stream *msg)
+{
+	return zserv_send_message_coalesce(client, msg, NULL);
+}
+
 
 /* Hooks for client connect / disconnect */
 DEFINE_HOOK(zserv_client_connect, (struct zserv *client), (client));
@@ -578,8 +789,12 @@ static void zserv_client_free(struct zserv *client)
 		stream_free(client->ibuf_work);
 	if (client->obuf_work)
 		stream_free(client->obuf_work);
+	if (client->notify_bulk)
+		stream_free(client->notify_bulk);
 	if (client->ibuf_fifo)
 		stream_fifo_free(client->ibuf_fifo);
+	zserv_coalesce_flush(client);
+	zserv_coalesce_fini(&client->obuf_coalesce);
 	if (client->obuf_fifo)
 		stream_fifo_free(client->obuf_fifo);
 	if (client->wb)
@@ -613,6 +828,7 @@ void zserv_close_client(struct zserv *client)
 	thread_cancel_event(zrouter.master, client);
 	THREAD_OFF(client->t_cleanup);
 	THREAD_OFF(client->t_process);
+	THREAD_OFF(client->t_notify_bulk);
 
 	/* destroy pthread */
 	frr_pthread_destroy(client->pthread);
@@ -667,6 +883,7 @@ static struct zserv *zserv_client_create(int sock)
 	client->obuf_work = stream_new(stream_size);
 	pthread_mutex_init(&client->ibuf_mtx, NULL);
 	pthread_mutex_init(&client->obuf_mtx, NULL);
+	zserv_coalesce_init(&client->obuf_coalesce);
 	client->wb = buffer_new(0);
 
 	atomic_store_explicit(&client->connect_time, (uint32_t) monotime(NULL),
@@ -934,6 +1151,27 @@ static void zebra_show_client_detail(struct vty *vty, struct zserv *client)
 		client->v6_nh_watch_add_cnt, 0, client->v6_nh_watch_rem_cnt);
 	vty_out(vty, "VxLAN SG    %-12d%-12d%-12d\n", client->vxlan_sg_add_cnt,
 		0, client->vxlan_sg_del_cnt);
+	vty_out(vty, "Redist backlog: %u (max %u)\n",
+		atomic_load_explicit(&client->redist_backlog,
+				     memory_order_relaxed),
+		client->redist_backlog_max);
+	frr_with_mutex(&client->obuf_mtx) {
+		vty_out(vty,
+			"Output queue: %zu bytes (max %zu, limit %u), %s, congested %" PRIu64
+			" times\n",
+			client->obuf_bytes + client->wb_bytes,
+			client->obuf_bytes_max,
+			atomic_load_explicit(&zrouter.obuf_limit,
+					     memory_order_relaxed)
+				* 1024,
+			client->obuf_congested ? "congested" : "not congested",
+			client->obuf_congested_cnt);
+		vty_out(vty,
+			"Output queue: %" PRIu64
+			" messages coalesced, max latency %" PRId64 " ms\n",
+			client->obuf_coalesced,
+			client->obuf_latency_max / 1000);
+	}
 	vty_out(vty, "Interface Up Notifications: %d\n", client->ifup_cnt);
 	vty_out(vty, "Interface Down Notifications: %d\n", client->ifdown_cnt);
 	vty_out(vty, "VNI add notifications: %d\n", client->vniadd_cnt);
@@ -36,6 +36,8 @@
 #include "lib/linklist.h"     /* for list */
 #include "lib/workqueue.h"    /* for work_queue */
 #include "lib/hook.h"         /* for DECLARE_HOOK, DECLARE_KOOH */
+#include "lib/nexthop.h"      /* for nexthop */
+#include "lib/typesafe.h"     /* for PREDECL_HASH */
 
 #include "zebra/zebra_vrf.h"  /* for zebra_vrf */
 /* clang-format on */
@@ -52,6 +54,22 @@ extern "C" {
 
 #define ZEBRA_RMAP_DEFAULT_UPDATE_TIMER 5 /* disabled by default */
 
+/*
+ * Identifies what a message sent to a client is about, so that a later
+ * message about the same thing can replace it while it is still queued.
+ * Unused fields must be zero.
+ */
+struct zserv_coalesce_key {
+	uint16_t cmd;
+	vrf_id_t vrf_id;
+	uint8_t type;
+	unsigned short instance;
+	struct prefix p;
+	struct prefix src_p;
+};
+
+PREDECL_HASH(zserv_coalesce)
+
 /* Client structure. */
 struct zserv {
 	/* Client pthread */
@@ -66,6 +84,29 @@ struct zserv {
 	pthread_mutex_t obuf_mtx;
 	struct stream_fifo *obuf_fifo;
 
+	/*
+	 * Output queue accounting, in bytes of memory held, protected by
+	 * obuf_mtx. Once more than the high watermark is queued the client
+	 * is congested: a message that supersedes one still on obuf_fifo
+	 * replaces it, until the backlog drains below the low watermark.
+	 * Only messages of the run of one command at the tail of obuf_fifo
+	 * (obuf_run_cmd) are replaced. A client that would have more than
+	 * the limit queued is closed.
+	 */
+	size_t obuf_bytes;
+	size_t wb_bytes;
+	bool obuf_congested;
+	bool obuf_overflow;
+	uint16_t obuf_run_cmd;
+	struct zserv_coalesce_head obuf_coalesce;
+	struct timeval obuf_head_time;
+
+	/* Output queue statistics, protected by obuf_mtx */
+	size_t obuf_bytes_max;
+	uint64_t obuf_coalesced;
+	uint64_t obuf_congested_cnt;
+	int64_t obuf_latency_max;
+
 	/* Private I/O buffers */
 	struct stream *ibuf_work;
 	struct stream *obuf_work;
@@ -144,6 +185,23 @@ struct zserv {
 	time_t nh_dereg_time;
 	time_t nh_last_upd_time;
 
+	/*
+	 * Nexthops into which route adds from this client are decoded. They
+	 * are copied into a nexthop hash entry if needed, so they are reused
+	 * for every message. Only used from the main pthread.
+	 */
+	struct nexthop nh_scratch[MULTIPATH_NUM];
+
+	/*
+	 * Route notifications are sent in bulk to clients that send route
+	 * updates in bulk; these are the pending ones and the event that
+	 * sends them.
+	 */
+	bool notify_owner_bulk;
+	struct stream *notify_bulk;
+	uint16_t notify_bulk_count;
+	struct thread *t_notify_bulk;
+
 	/*
 	 * Session information.
 	 *
@@ -162,6 +220,13 @@ struct zserv {
 	_Atomic uint32_t last_read_cmd;
 	/* command code of last message written */
 	_Atomic uint32_t last_write_cmd;
+
+	/*
+	 * Redistributed routes queued for the client but not yet written
+	 * out, and the highest that has been seen.
+	 */
+	_Atomic uint32_t redist_backlog;
+	uint32_t redist_backlog_max;
 };
 
 #define ZAPI_HANDLER_ARGS                                                      \
@@ -208,6 +273,23 @@ extern void zserv_start(char *path);
  */
 extern int zserv_send_message(struct zserv *client, struct stream *msg);
 
+/*
+ * Send a message to a connected Zebra API client, which may replace a still
+ * queued message with the same key while the client is congested.
+ *
+ * client
+ *    the client to send to
+ *
+ * msg
+ *    the message to send
+ *
+ * key
+ *    what the message is about, or NULL if it never supersedes another one
+ */
+extern int zserv_send_message_coalesce(struct zserv *client,
+				       struct stream *msg,
+				       const struct zserv_coalesce_key *key);
+
 /*
  * Retrieve a client by its protocol and instance number.
  *